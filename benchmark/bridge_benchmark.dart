@@ -0,0 +1,484 @@
+// Measures the Dart/native bridge of printing_ffi piece by piece, against the
+// no-op native backend in src/printing_ffi_noop.c so that no printing system
+// cost is mixed in:
+//
+//   cmake -S src -B build/noop -DPRINTING_FFI_BUILD_NOOP=ON
+//   cmake --build build/noop --target printing_ffi_noop
+//   dart run benchmark/bridge_benchmark.dart --library build/noop/libprinting_ffi_noop.so
+//
+// Options:
+//   --library <path>         The no-op library to load (required).
+//   --iterations <n>         Samples per measurement (default 2000).
+//   --payload-sizes <a,b>    Payload sizes in bytes (default 256,4096,65536,1048576).
+//   --options <n>            Print options marshaled per call (default 6).
+//   --output <file>          Also write the results as JSON, in the same shape
+//                            as printing_ffi_bench.
+//
+// The steps mirror what lib/printing_ffi.dart does for rawDataToPrinter and
+// listPrinters; keep them in sync when the bridge changes. Timings are
+// reported per call, in microseconds.
+import 'dart:async';
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import 'package:ffi/ffi.dart';
+import 'package:printing_ffi/models/printer.dart';
+import 'package:printing_ffi/printing_ffi_bindings_generated.dart';
+
+Future<void> main(List<String> args) async {
+  final BridgeBenchConfig config;
+  try {
+    config = BridgeBenchConfig.parse(args);
+  } on FormatException catch (e) {
+    stderr.writeln('bridge_benchmark: ${e.message}');
+    exitCode = 64;
+    return;
+  }
+
+  final bindings = PrintingFfiBindings(DynamicLibrary.open(config.library));
+  final bench = BridgeBenchmark(config, bindings);
+  await bench.run();
+
+  final output = config.output;
+  if (output != null) {
+    File(output).writeAsStringSync(
+      const JsonEncoder.withIndent('  ').convert({
+        'benchmark': 'printing_ffi_bridge',
+        'platform': Platform.operatingSystem,
+        'iterations': config.iterations,
+        'results': [for (final result in bench.results) result.toJson()],
+      }),
+    );
+  }
+}
+
+/// Settings for a [BridgeBenchmark] run.
+class BridgeBenchConfig {
+  final String library;
+  final int iterations;
+  final List<int> payloadSizes;
+  final int options;
+  final String? output;
+
+  const BridgeBenchConfig({
+    required this.library,
+    this.iterations = 2000,
+    this.payloadSizes = const [256, 4096, 65536, 1048576],
+    this.options = 6,
+    this.output,
+  });
+
+  factory BridgeBenchConfig.parse(List<String> args) {
+    final values = <String, String>{};
+    for (var i = 0; i < args.length; i++) {
+      final arg = args[i];
+      if (!arg.startsWith('--') || i + 1 >= args.length) {
+        throw FormatException('unexpected argument "$arg"');
+      }
+      values[arg.substring(2)] = args[++i];
+    }
+
+    int intOption(String name, int fallback, {int min = 0}) {
+      final value = values.remove(name);
+      if (value == null) return fallback;
+      final parsed = int.tryParse(value);
+      if (parsed == null || parsed < min) throw FormatException('--$name expects an integer of at least $min');
+      return parsed;
+    }
+
+    final library = values.remove('library');
+    if (library == null) {
+      throw const FormatException('--library is required');
+    }
+    final sizesValue = values.remove('payload-sizes');
+    final payloadSizes = sizesValue?.split(',').map((size) => int.tryParse(size.trim())).toList();
+    if (payloadSizes != null && payloadSizes.any((size) => size == null || size <= 0)) {
+      throw const FormatException('--payload-sizes expects a comma-separated list of positive sizes');
+    }
+
+    final config = BridgeBenchConfig(
+      library: library,
+      iterations: intOption('iterations', 2000, min: 1),
+      payloadSizes: payloadSizes?.cast<int>() ?? const [256, 4096, 65536, 1048576],
+      options: intOption('options', 6),
+      output: values.remove('output'),
+    );
+    if (values.isNotEmpty) {
+      throw FormatException('unknown option --${values.keys.first}');
+    }
+    return config;
+  }
+}
+
+/// Per-call timings of one measurement.
+class BridgeBenchResult {
+  final String scenario;
+  final Map<String, Object> params;
+  final List<double> _samplesNs = [];
+
+  static final double _nsPerTick = 1e9 / Stopwatch().frequency;
+
+  BridgeBenchResult(this.scenario, [this.params = const {}]);
+
+  /// Adds a sample covering [calls] calls that took [ticks] stopwatch ticks.
+  void add(int ticks, [int calls = 1]) {
+    _samplesNs.add(ticks * _nsPerTick / calls);
+  }
+
+  double _percentileUs(List<double> sorted, double quantile) {
+    if (sorted.isEmpty) return 0;
+    final rank = (quantile * sorted.length).ceil().clamp(1, sorted.length);
+    return sorted[rank - 1] / 1000;
+  }
+
+  Map<String, Object> toJson() {
+    final sorted = [..._samplesNs]..sort();
+    final mean = sorted.isEmpty ? 0.0 : sorted.reduce((a, b) => a + b) / sorted.length / 1000;
+    return {
+      'scenario': scenario,
+      'params': params,
+      'samples': sorted.length,
+      'mean_us': mean,
+      'p50_us': _percentileUs(sorted, 0.50),
+      'p90_us': _percentileUs(sorted, 0.90),
+      'p99_us': _percentileUs(sorted, 0.99),
+      'p999_us': _percentileUs(sorted, 0.999),
+      'max_us': _percentileUs(sorted, 1.0),
+    };
+  }
+
+  @override
+  String toString() {
+    final json = toJson();
+    String us(String key) => (json[key] as double).toStringAsFixed(3).padLeft(10);
+    final label = params.isEmpty ? scenario : '$scenario ${params.entries.map((e) => '${e.key}=${e.value}').join(' ')}';
+    return '${label.padRight(40)} p50 ${us('p50_us')}us  p99 ${us('p99_us')}us  mean ${us('mean_us')}us';
+  }
+}
+
+class BridgeBenchmark {
+  final BridgeBenchConfig config;
+  final PrintingFfiBindings bindings;
+  final List<BridgeBenchResult> results = [];
+
+  BridgeBenchmark(this.config, this.bindings);
+
+  Map<String, String> get _options => {for (var i = 0; i < config.options; i++) 'option-$i': 'value-$i'};
+
+  Future<void> run() async {
+    _ffiCall();
+    _nativeNoopPrint();
+    _optionMarshaling();
+    for (final size in config.payloadSizes) {
+      _payloadCopy(size);
+    }
+    _printerConversion();
+    await _isolateHops();
+  }
+
+  void _report(BridgeBenchResult result) {
+    results.add(result);
+    stdout.writeln(result);
+  }
+
+  // Fast operations are timed in batches so the stopwatch does not dominate.
+  void _batched(BridgeBenchResult result, int batch, void Function() body) {
+    final stopwatch = Stopwatch();
+    for (var i = 0; i < batch; i++) {
+      body(); // Warm up.
+    }
+    for (var sample = 0; sample < config.iterations; sample++) {
+      stopwatch
+        ..reset()
+        ..start();
+      for (var i = 0; i < batch; i++) {
+        body();
+      }
+      stopwatch.stop();
+      result.add(stopwatch.elapsedTicks, batch);
+    }
+    _report(result);
+  }
+
+  /// The floor: a leaf call with two integer arguments.
+  void _ffiCall() {
+    _batched(BridgeBenchResult('ffi_call'), 1000, () => bindings.sum(1, 2));
+  }
+
+  /// The native print call itself, with every argument already marshaled.
+  void _nativeNoopPrint() {
+    final name = 'noop-1'.toNativeUtf8();
+    final docName = 'Flutter Document'.toNativeUtf8();
+    final data = malloc<Uint8>(256);
+    try {
+      _batched(BridgeBenchResult('native_noop_print'), 1000, () => bindings.raw_data_to_printer(name.cast(), data, 256, docName.cast(), 0, nullptr, nullptr));
+    } finally {
+      malloc.free(name);
+      malloc.free(docName);
+      malloc.free(data);
+    }
+  }
+
+  /// `toNativeUtf8` for the printer, document name and options, and the frees that undo it.
+  void _optionMarshaling() {
+    final marshal = BridgeBenchResult('option_marshal', {'options': config.options});
+    final free = BridgeBenchResult('option_free', {'options': config.options});
+    final options = _options;
+    const batch = 100;
+    final stopwatch = Stopwatch();
+    for (var sample = 0; sample <= config.iterations; sample++) {
+      final marshaled = <(Pointer<Utf8>, Pointer<Utf8>, Pointer<Pointer<Utf8>>, Pointer<Pointer<Utf8>>)>[];
+      stopwatch
+        ..reset()
+        ..start();
+      for (var i = 0; i < batch; i++) {
+        final namePtr = 'noop-1'.toNativeUtf8();
+        final docNamePtr = 'Flutter Document'.toNativeUtf8();
+        Pointer<Pointer<Utf8>> keysPtr = nullptr;
+        Pointer<Pointer<Utf8>> valuesPtr = nullptr;
+        if (options.isNotEmpty) {
+          keysPtr = malloc<Pointer<Utf8>>(options.length);
+          valuesPtr = malloc<Pointer<Utf8>>(options.length);
+          var j = 0;
+          for (final entry in options.entries) {
+            keysPtr[j] = entry.key.toNativeUtf8();
+            valuesPtr[j] = entry.value.toNativeUtf8();
+            j++;
+          }
+        }
+        marshaled.add((namePtr, docNamePtr, keysPtr, valuesPtr));
+      }
+      stopwatch.stop();
+      // The first round is a warm-up.
+      if (sample > 0) marshal.add(stopwatch.elapsedTicks, batch);
+
+      stopwatch
+        ..reset()
+        ..start();
+      for (final (namePtr, docNamePtr, keysPtr, valuesPtr) in marshaled) {
+        if (options.isNotEmpty) {
+          for (var j = 0; j < options.length; j++) {
+            malloc.free(keysPtr[j]);
+            malloc.free(valuesPtr[j]);
+          }
+          malloc.free(keysPtr);
+          malloc.free(valuesPtr);
+        }
+        malloc.free(namePtr);
+        malloc.free(docNamePtr);
+      }
+      stopwatch.stop();
+      if (sample > 0) free.add(stopwatch.elapsedTicks, batch);
+    }
+    _report(marshal);
+    _report(free);
+  }
+
+  /// The `malloc` + `setAll` copy of a payload into native memory, and its free.
+  void _payloadCopy(int size) {
+    final copy = BridgeBenchResult('payload_copy', {'bytes': size});
+    final free = BridgeBenchResult('payload_free', {'bytes': size});
+    final payload = Uint8List(size);
+    final stopwatch = Stopwatch();
+    for (var sample = 0; sample <= config.iterations; sample++) {
+      stopwatch
+        ..reset()
+        ..start();
+      final dataPtr = malloc<Uint8>(size);
+      dataPtr.asTypedList(size).setAll(0, payload);
+      stopwatch.stop();
+      if (sample > 0) copy.add(stopwatch.elapsedTicks);
+
+      stopwatch
+        ..reset()
+        ..start();
+      malloc.free(dataPtr);
+      stopwatch.stop();
+      if (sample > 0) free.add(stopwatch.elapsedTicks);
+    }
+    _report(copy);
+    _report(free);
+  }
+
+  /// `get_printers`, the struct-to-model conversion of `listPrinters` and `free_printer_list`.
+  void _printerConversion() {
+    final printers = bindings.get_printers();
+    final count = printers == nullptr ? 0 : printers.ref.count;
+    bindings.free_printer_list(printers);
+
+    final native = BridgeBenchResult('get_printers_native', {'printers': count});
+    final convert = BridgeBenchResult('printer_from_info', {'printers': count});
+    final free = BridgeBenchResult('free_printer_list', {'printers': count});
+    final stopwatch = Stopwatch();
+    var converted = 0;
+    for (var sample = 0; sample <= config.iterations; sample++) {
+      stopwatch
+        ..reset()
+        ..start();
+      final listPtr = bindings.get_printers();
+      stopwatch.stop();
+      if (sample > 0) native.add(stopwatch.elapsedTicks);
+      if (listPtr == nullptr) continue;
+
+      stopwatch
+        ..reset()
+        ..start();
+      final list = listPtr.ref;
+      final models = <Printer>[];
+      for (var i = 0; i < list.count; i++) {
+        models.add(_printerFromInfo(list.printers[i]));
+      }
+      stopwatch.stop();
+      converted += models.length;
+      if (sample > 0) convert.add(stopwatch.elapsedTicks);
+
+      stopwatch
+        ..reset()
+        ..start();
+      bindings.free_printer_list(listPtr);
+      stopwatch.stop();
+      if (sample > 0) free.add(stopwatch.elapsedTicks);
+    }
+    if (converted == 0) stderr.writeln('bridge_benchmark: get_printers returned no printers');
+    _report(native);
+    _report(convert);
+    _report(free);
+  }
+
+  /// Round trips to a helper isolate: the bare hop with a print request, the
+  /// same with the payload sent as TransferableTypedData, and the whole
+  /// rawDataToPrinter path (hop, marshaling, no-op call, frees).
+  Future<void> _isolateHops() async {
+    final responses = ReceivePort();
+    final replies = StreamIterator(responses);
+    await Isolate.spawn(_helperEntryPoint, (responses.sendPort, config.library));
+    await replies.moveNext();
+    final helper = replies.current as SendPort;
+
+    Future<void> measure(BridgeBenchResult result, _HopMode mode, int size) async {
+      final payload = Uint8List(size);
+      final options = _options;
+      final stopwatch = Stopwatch();
+      for (var sample = 0; sample <= config.iterations; sample++) {
+        stopwatch
+          ..reset()
+          ..start();
+        final Object data = mode == _HopMode.transferable ? TransferableTypedData.fromList([payload]) : payload;
+        helper.send(_HopRequest(sample, mode, 'noop-1', data, 'Flutter Document', options));
+        await replies.moveNext();
+        stopwatch.stop();
+        if (sample > 0) result.add(stopwatch.elapsedTicks);
+      }
+      _report(result);
+    }
+
+    for (final size in config.payloadSizes) {
+      await measure(BridgeBenchResult('sendport_hop', {'bytes': size}), _HopMode.echo, size);
+      await measure(BridgeBenchResult('sendport_hop_transferable', {'bytes': size}), _HopMode.transferable, size);
+      await measure(BridgeBenchResult('raw_print_end_to_end', {'bytes': size, 'options': config.options}), _HopMode.print, size);
+    }
+    helper.send(null);
+    await replies.cancel();
+    responses.close();
+  }
+}
+
+// Mirrors PrintingFfi._printerFromInfo.
+Printer _printerFromInfo(PrinterInfo info) {
+  final model = info.model.cast<Utf8>().toDartString();
+  final location = info.location.cast<Utf8>().toDartString();
+  final comment = info.comment.cast<Utf8>().toDartString();
+
+  return Printer(
+    name: info.name.cast<Utf8>().toDartString(),
+    state: info.state,
+    url: info.url.cast<Utf8>().toDartString(),
+    model: model.isEmpty ? null : model,
+    location: location.isEmpty ? null : location,
+    comment: comment.isEmpty ? null : comment,
+    isDefault: info.is_default,
+    isAvailable: info.is_available,
+  );
+}
+
+enum _HopMode { echo, transferable, print }
+
+// Shaped like the plugin's _PrintRequest, so the message copy costs the same.
+class _HopRequest {
+  final int id;
+  final _HopMode mode;
+  final String printerName;
+  final Object data; // Uint8List, or TransferableTypedData in _HopMode.transferable.
+  final String docName;
+  final Map<String, String>? options;
+
+  const _HopRequest(this.id, this.mode, this.printerName, this.data, this.docName, this.options);
+}
+
+class _HopResponse {
+  final int id;
+  final bool result;
+
+  const _HopResponse(this.id, this.result);
+}
+
+void _helperEntryPoint((SendPort, String) args) {
+  final (sendPort, library) = args;
+  final bindings = PrintingFfiBindings(DynamicLibrary.open(library));
+  final receivePort = ReceivePort();
+  receivePort.listen((dynamic message) {
+    if (message is! _HopRequest) {
+      receivePort.close();
+      return;
+    }
+    final Uint8List data = switch (message.data) {
+      final TransferableTypedData transferable => transferable.materialize().asUint8List(),
+      final Uint8List bytes => bytes,
+      _ => Uint8List(0),
+    };
+    if (message.mode != _HopMode.print) {
+      sendPort.send(_HopResponse(message.id, data.isNotEmpty));
+      return;
+    }
+
+    // As in the plugin's helper isolate for a _PrintRequest.
+    final namePtr = message.printerName.toNativeUtf8();
+    final docNamePtr = message.docName.toNativeUtf8();
+    final dataPtr = malloc<Uint8>(data.length);
+    dataPtr.asTypedList(data.length).setAll(0, data);
+    final options = {...?message.options};
+    final numOptions = options.length;
+    Pointer<Pointer<Utf8>> keysPtr = nullptr;
+    Pointer<Pointer<Utf8>> valuesPtr = nullptr;
+    try {
+      if (numOptions > 0) {
+        keysPtr = malloc<Pointer<Utf8>>(numOptions);
+        valuesPtr = malloc<Pointer<Utf8>>(numOptions);
+        var i = 0;
+        for (final entry in options.entries) {
+          keysPtr[i] = entry.key.toNativeUtf8();
+          valuesPtr[i] = entry.value.toNativeUtf8();
+          i++;
+        }
+      }
+      final result = bindings.raw_data_to_printer(namePtr.cast(), dataPtr, data.length, docNamePtr.cast(), numOptions, keysPtr.cast(), valuesPtr.cast());
+      sendPort.send(_HopResponse(message.id, result));
+    } finally {
+      if (numOptions > 0) {
+        for (var i = 0; i < numOptions; i++) {
+          malloc.free(keysPtr[i]);
+          malloc.free(valuesPtr[i]);
+        }
+        malloc.free(keysPtr);
+        malloc.free(valuesPtr);
+      }
+      malloc.free(namePtr);
+      malloc.free(docNamePtr);
+      malloc.free(dataPtr);
+    }
+  });
+  sendPort.send(receivePort.sendPort);
+}
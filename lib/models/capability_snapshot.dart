@@ -0,0 +1,203 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+import '../printing_ffi_bindings_generated.dart' show CAPABILITY_SNAPSHOT_VERSION;
+import 'printer_capabilities.dart';
+
+/// A printer's capabilities as one flat buffer, returned by
+/// [PrintingFfi.getCapabilitySnapshot].
+///
+/// Nothing is decoded up front: every accessor reads only the fields it needs
+/// from [bytes], so a settings screen pays for the options it shows rather
+/// than for every choice the printer reports. The layout is documented with
+/// `CapabilitySnapshot` in `printing_ffi.h`.
+class PrinterCapabilitySnapshot {
+  static const int _headerSize = 20;
+  static const int _sectionSize = 12;
+  static const int _kindCups = 1;
+  static const int _kindWindows = 2;
+  static const int _flagColor = 1;
+  static const int _flagMonochrome = 2;
+  static const int _flagLandscape = 4;
+
+  /// The raw snapshot.
+  final Uint8List bytes;
+  final ByteData _data;
+  final int _kind;
+  final int _flags;
+  final List<_Section> _sections;
+
+  PrinterCapabilitySnapshot._(this.bytes, this._data, this._kind, this._flags, this._sections);
+
+  /// Wraps [bytes] without copying. Throws a [FormatException] if they are
+  /// not a capability snapshot or use a layout version this reader does not
+  /// know.
+  factory PrinterCapabilitySnapshot(Uint8List bytes) {
+    final data = ByteData.sublistView(bytes);
+    if (bytes.length < _headerSize || ascii.decode(bytes.sublist(0, 4), allowInvalid: true) != 'PFCS') {
+      throw const FormatException('Not a capability snapshot.');
+    }
+    final version = data.getUint16(4, Endian.little);
+    if (version != CAPABILITY_SNAPSHOT_VERSION) {
+      throw FormatException('Unsupported capability snapshot version $version.');
+    }
+    final kind = data.getUint16(6, Endian.little);
+    final size = data.getUint32(8, Endian.little);
+    final sectionCount = data.getUint32(16, Endian.little);
+    final minimumRecordSizes = kind == _kindCups ? const [16, 8] : (kind == _kindWindows ? const [16, 8, 8, 8] : null);
+    if (minimumRecordSizes == null || size != bytes.length || sectionCount < minimumRecordSizes.length || _headerSize + sectionCount * _sectionSize > size) {
+      throw const FormatException('Corrupt capability snapshot.');
+    }
+    final sections = <_Section>[
+      for (var i = 0; i < sectionCount; i++)
+        _Section(
+          data.getUint32(_headerSize + i * _sectionSize, Endian.little),
+          data.getUint32(_headerSize + i * _sectionSize + 4, Endian.little),
+          data.getUint32(_headerSize + i * _sectionSize + 8, Endian.little),
+        ),
+    ];
+    for (var i = 0; i < sections.length; i++) {
+      final section = sections[i];
+      if ((i < minimumRecordSizes.length && section.recordSize < minimumRecordSizes[i]) || section.offset + section.count * section.recordSize > size) {
+        throw const FormatException('Corrupt capability snapshot.');
+      }
+    }
+    return PrinterCapabilitySnapshot._(bytes, data, kind, data.getUint32(12, Endian.little), sections);
+  }
+
+  /// Whether this snapshot holds CUPS options (macOS and Linux).
+  bool get isCups => _kind == _kindCups;
+
+  /// Whether this snapshot holds Windows printer capabilities.
+  bool get isWindows => _kind == _kindWindows;
+
+  int _field(int section, int index, int offset) {
+    final s = _sections[section];
+    if (index < 0 || index >= s.count) throw RangeError.index(index, this, 'index', null, s.count);
+    return _data.getUint32(s.offset + index * s.recordSize + offset, Endian.little);
+  }
+
+  String _string(int offset) {
+    if (offset == 0) return '';
+    final length = _data.getUint32(offset, Endian.little);
+    return utf8.decode(Uint8List.sublistView(bytes, offset + 4, offset + 4 + length));
+  }
+
+  bool _stringEquals(int offset, List<int> value) {
+    if (offset == 0) return value.isEmpty;
+    if (_data.getUint32(offset, Endian.little) != value.length) return false;
+    for (var i = 0; i < value.length; i++) {
+      if (bytes[offset + 4 + i] != value[i]) return false;
+    }
+    return true;
+  }
+
+  void _requireCups() {
+    if (!isCups) throw StateError('This snapshot does not hold CUPS options.');
+  }
+
+  /// The number of CUPS options.
+  int get cupsOptionCount {
+    _requireCups();
+    return _sections[0].count;
+  }
+
+  /// The name of the CUPS option at [index].
+  String cupsOptionName(int index) {
+    _requireCups();
+    return _string(_field(0, index, 0));
+  }
+
+  /// The default value of the CUPS option at [index].
+  String cupsOptionDefault(int index) {
+    _requireCups();
+    return _string(_field(0, index, 4));
+  }
+
+  /// The number of supported values of the CUPS option at [index].
+  int cupsChoiceCount(int index) {
+    _requireCups();
+    return _field(0, index, 12);
+  }
+
+  int _choiceIndex(int option, int choice) {
+    final count = cupsChoiceCount(option);
+    if (choice < 0 || choice >= count) throw RangeError.index(choice, this, 'choice', null, count);
+    return _field(0, option, 8) + choice;
+  }
+
+  /// The value of supported choice [choice] of the CUPS option at [option].
+  String cupsChoiceValue(int option, int choice) => _string(_field(1, _choiceIndex(option, choice), 0));
+
+  /// The human-readable text of supported choice [choice] of the CUPS option
+  /// at [option].
+  String cupsChoiceText(int option, int choice) => _string(_field(1, _choiceIndex(option, choice), 4));
+
+  /// The index of the CUPS option called [name], or -1. Names are compared as
+  /// bytes, so no other option is decoded.
+  int indexOfCupsOption(String name) {
+    _requireCups();
+    final encoded = utf8.encode(name);
+    for (var i = 0; i < _sections[0].count; i++) {
+      if (_stringEquals(_field(0, i, 0), encoded)) return i;
+    }
+    return -1;
+  }
+
+  /// Decodes the CUPS option at [index].
+  CupsOptionModel cupsOption(int index) {
+    return CupsOptionModel(
+      name: cupsOptionName(index),
+      defaultValue: cupsOptionDefault(index),
+      supportedValues: [
+        for (var j = 0; j < cupsChoiceCount(index); j++) CupsOptionChoiceModel(choice: cupsChoiceValue(index, j), text: cupsChoiceText(index, j)),
+      ],
+    );
+  }
+
+  /// Decodes every CUPS option, as returned by [PrintingFfi.getSupportedCupsOptions].
+  List<CupsOptionModel> toCupsOptions() => [for (var i = 0; i < cupsOptionCount; i++) cupsOption(i)];
+
+  /// Decodes the Windows capabilities, as returned by
+  /// [PrintingFfi.getWindowsPrinterCapabilities].
+  WindowsPrinterCapabilitiesModel toWindowsCapabilities() {
+    if (!isWindows) throw StateError('This snapshot does not hold Windows capabilities.');
+    int signed(int section, int index, int offset) => _field(section, index, offset).toSigned(32);
+    double float(int section, int index, int offset) {
+      final s = _sections[section];
+      return _data.getFloat32(s.offset + index * s.recordSize + offset, Endian.little);
+    }
+
+    return WindowsPrinterCapabilitiesModel(
+      paperSizes: [
+        for (var i = 0; i < _sections[0].count; i++)
+          WindowsPaperSize(
+            name: _string(_field(0, i, 0)),
+            id: signed(0, i, 4),
+            widthMillimeters: float(0, i, 8),
+            heightMillimeters: float(0, i, 12),
+          ),
+      ],
+      paperSources: [
+        for (var i = 0; i < _sections[1].count; i++) WindowsPaperSource(name: _string(_field(1, i, 0)), id: signed(1, i, 4)),
+      ],
+      resolutions: [
+        for (var i = 0; i < _sections[2].count; i++) WindowsResolution(xdpi: signed(2, i, 0), ydpi: signed(2, i, 4)),
+      ],
+      mediaTypes: [
+        for (var i = 0; i < _sections[3].count; i++) WindowsMediaType(name: _string(_field(3, i, 0)), id: signed(3, i, 4)),
+      ],
+      isColorSupported: (_flags & _flagColor) != 0,
+      isMonochromeSupported: (_flags & _flagMonochrome) != 0,
+      supportsLandscape: (_flags & _flagLandscape) != 0,
+    );
+  }
+}
+
+class _Section {
+  final int offset;
+  final int count;
+  final int recordSize;
+
+  const _Section(this.offset, this.count, this.recordSize);
+}
@@ -10,6 +10,31 @@ class PrintingFfiException implements Exception {
   String toString() => 'PrintingFfiException: $message';
 }
 
+/// Why a printer turned a job away before anything was spooled, see
+/// [PrinterUnavailableException].
+enum PrinterUnavailableReason {
+  /// The queue is stopped (CUPS) or paused (Windows).
+  stopped,
+
+  /// The queue is rejecting new jobs.
+  notAcceptingJobs,
+}
+
+/// Thrown by the print and submit methods when admission control finds that
+/// [printerName] cannot take the job and no usable fallback printer is
+/// configured. Nothing has been uploaded when this is thrown.
+///
+/// See [PrintingFfi.setAdmissionControl] and [PrintingFfi.setFallbackPrinter].
+class PrinterUnavailableException extends PrintingFfiException {
+  final String printerName;
+  final PrinterUnavailableReason reason;
+
+  PrinterUnavailableException(this.printerName, this.reason, String message) : super(message);
+
+  @override
+  String toString() => 'PrinterUnavailableException: $message';
+}
+
 /// Exception thrown when the helper isolate encounters a fatal error or exits unexpectedly.
 class IsolateError extends Error {
   final String message;
@@ -0,0 +1,72 @@
+/// A point in a print job's lifecycle recorded by the native tracer.
+enum JobStage {
+  optionsParsed,
+  spooled,
+  requestSent,
+  jobIdReturned,
+  firstProcessing,
+  completed,
+  canceled,
+  aborted,
+}
+
+/// An interval between two [JobStage]s that [PrintingFfi.getJobTimings] summarizes.
+enum JobInterval {
+  /// From entering the submit call until the spooler returned a job id.
+  submit,
+
+  /// From the job id being returned until the job was first seen processing.
+  queued,
+
+  /// From the job first being seen processing until it completed.
+  printing,
+
+  /// From entering the submit call until the job completed.
+  total,
+}
+
+/// The recorded lifecycle of a single job.
+class PrintJobTrace {
+  final int jobId;
+  final String printerName;
+
+  /// Time from entering the submit call to each stage that was observed.
+  ///
+  /// Stages after [JobStage.jobIdReturned] are only recorded when the job is
+  /// seen in that state, e.g. while listing or cancelling jobs, so their
+  /// precision is bounded by how often the queue is polled.
+  final Map<JobStage, Duration> stages;
+
+  PrintJobTrace({required this.jobId, required this.printerName, required this.stages});
+}
+
+/// Latency percentiles of one [JobInterval] on one printer.
+class PrintJobLatency {
+  final String printerName;
+  final JobInterval interval;
+
+  /// The number of traced jobs in which both ends of [interval] were observed.
+  final int samples;
+  final Duration p50;
+  final Duration p95;
+  final Duration p99;
+  final Duration max;
+
+  PrintJobLatency({
+    required this.printerName,
+    required this.interval,
+    required this.samples,
+    required this.p50,
+    required this.p95,
+    required this.p99,
+    required this.max,
+  });
+}
+
+/// The traces and summaries returned by [PrintingFfi.getJobTimings].
+class PrintJobTimings {
+  final List<PrintJobTrace> traces;
+  final List<PrintJobLatency> summaries;
+
+  PrintJobTimings({required this.traces, required this.summaries});
+}
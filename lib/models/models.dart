@@ -1,7 +1,12 @@
 export 'printer.dart';
+export 'printer_changes.dart';
+export 'printer_status.dart';
+export 'job_timings.dart';
+export 'native_metrics.dart';
 export 'print_job.dart';
 export 'print_options.dart';
 export 'pdf_print_settings.dart';
 export 'printer_capabilities.dart';
+export 'capability_snapshot.dart';
 export 'exceptions.dart';
 export 'printer_properties_result.dart';
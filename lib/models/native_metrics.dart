@@ -0,0 +1,49 @@
+/// A native operation tracked by [PrintingFfi.getNativeMetrics].
+enum NativeOperation {
+  getPrinters,
+  getPrintJobs,
+
+  /// `rawDataToPrinter` and `submitRawDataJob`.
+  printRaw,
+
+  /// `printPdf` and `submitPdfJob`.
+  printPdf,
+
+  /// Get-Printer-Attributes capability queries (macOS and Linux only).
+  capabilities,
+
+  /// IPP round trips to the CUPS scheduler (macOS and Linux only).
+  ippRequest,
+}
+
+/// Call counts and latency percentiles of one [NativeOperation].
+///
+/// Percentiles come from a log-linear histogram and are accurate to within 25%.
+class NativeOperationMetrics {
+  final int calls;
+  final int errors;
+  final Duration total;
+  final Duration max;
+  final Duration p50;
+  final Duration p90;
+  final Duration p99;
+  final Duration p999;
+
+  NativeOperationMetrics({
+    required this.calls,
+    required this.errors,
+    required this.total,
+    required this.max,
+    required this.p50,
+    required this.p90,
+    required this.p99,
+    required this.p999,
+  });
+}
+
+/// The process-wide native metrics returned by [PrintingFfi.getNativeMetrics].
+class NativeMetrics {
+  final Map<NativeOperation, NativeOperationMetrics> operations;
+
+  NativeMetrics({required this.operations});
+}
@@ -76,8 +76,77 @@ class PrintJob {
   /// The parsed, cross-platform status.
   final PrintJobStatus status;
 
-  PrintJob(this.id, this.title, this.rawStatus) : status = PrintJobStatus.fromRaw(rawStatus);
+  /// The user who submitted the job, when requested with [PrintJobField.user].
+  final String? user;
+
+  /// The spooled size in kilobytes, when requested with [PrintJobField.size].
+  final int? sizeKb;
+
+  /// The number of pages printed so far, when requested with [PrintJobField.pages].
+  final int? pagesCompleted;
+
+  /// When the job was submitted, when requested with [PrintJobField.times].
+  final DateTime? createdAt;
+
+  /// When the job started processing, when requested with [PrintJobField.times] (CUPS only).
+  final DateTime? processingAt;
+
+  /// When the job finished, when requested with [PrintJobField.times] (CUPS only).
+  final DateTime? completedAt;
+
+  PrintJob(
+    this.id,
+    this.title,
+    this.rawStatus, {
+    this.user,
+    this.sizeKb,
+    this.pagesCompleted,
+    this.createdAt,
+    this.processingAt,
+    this.completedAt,
+  }) : status = PrintJobStatus.fromRaw(rawStatus);
 
   /// A user-friendly description of the status.
   String get statusDescription => status.description;
 }
+
+/// Which jobs [PrintingFfi.listPrintJobsPage] returns.
+enum PrintJobFilter {
+  /// Jobs that have not finished yet.
+  active,
+
+  /// Completed, cancelled and aborted jobs that the system still retains.
+  completed,
+
+  /// Both active and completed jobs.
+  all,
+}
+
+/// Optional columns that [PrintingFfi.listPrintJobsPage] can fetch.
+///
+/// Only the requested fields are transferred from the printing system; the
+/// job id is always included.
+enum PrintJobField { title, state, user, size, pages, times }
+
+/// One page of jobs returned by [PrintingFfi.listPrintJobsPage].
+class PrintJobPage {
+  /// The jobs on this page.
+  final List<PrintJob> jobs;
+
+  /// Whether more jobs exist after this page.
+  final bool hasMore;
+
+  const PrintJobPage({required this.jobs, required this.hasMore});
+}
+
+/// Which jobs [PrintingFfi.cancelAllPrintJobs] removes from a printer's queue.
+enum CancelJobsScope {
+  /// Every job on the printer. Usually requires operator rights.
+  allJobs,
+
+  /// Only jobs submitted by the current user.
+  myJobs,
+
+  /// Every job, also discarding job history (CUPS) or purging the spooler queue (Windows).
+  purge,
+}
@@ -96,3 +96,69 @@ class WindowsPrinterCapabilitiesModel {
     required this.supportsLandscape,
   });
 }
+
+/// The outcome of [PrintingFfi.prefetchCapabilities].
+class CapabilityPrefetchResult {
+  /// Printers whose capabilities are now cached natively.
+  final int succeeded;
+
+  /// Printers whose query failed or returned no capabilities.
+  final int failed;
+
+  CapabilityPrefetchResult({required this.succeeded, required this.failed});
+}
+
+/// The outcome of [PrintingFfi.validateOptions].
+enum OptionValidationStatus {
+  /// No checked option is unsupported or in conflict.
+  valid,
+
+  /// An option value is not supported by the printer.
+  unsupported,
+
+  /// Two or more option values cannot be used together on the printer.
+  conflict,
+}
+
+/// The result of checking an option set with [PrintingFfi.validateOptions].
+class OptionValidationResult {
+  final OptionValidationStatus status;
+
+  /// Describes the unsupported value or the conflicting options, or `null` if [isValid].
+  final String? message;
+
+  OptionValidationResult({required this.status, this.message});
+
+  bool get isValid => status == OptionValidationStatus.valid;
+}
+
+/// A media size from the library's built-in PWG 5101.1 table, returned by
+/// [PrintingFfi.lookupMediaSize] and [PrintingFfi.lookupWindowsMediaSize].
+class MediaSize {
+  /// The PWG self-describing name (e.g., "iso_a4_210x297mm").
+  final String pwgName;
+
+  /// The PPD PageSize name (e.g., "A4"), or `null` if there is none.
+  final String? ppdName;
+
+  /// The legacy IPP `media` keyword (e.g., "iso-a4"), or `null` if there is none.
+  final String? ippName;
+
+  /// The Windows DMPAPER id, or `null` if Windows has none for this size.
+  final int? windowsPaperSizeId;
+
+  final double widthMillimeters;
+  final double heightMillimeters;
+
+  MediaSize({
+    required this.pwgName,
+    this.ppdName,
+    this.ippName,
+    this.windowsPaperSizeId,
+    required this.widthMillimeters,
+    required this.heightMillimeters,
+  });
+
+  @override
+  String toString() => '$pwgName (${widthMillimeters.toStringAsFixed(1)} x ${heightMillimeters.toStringAsFixed(1)} mm)';
+}
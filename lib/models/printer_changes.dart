@@ -0,0 +1,33 @@
+import 'printer.dart';
+
+/// The kind of change reported for a printer by [PrintingFfi.getPrinterChanges].
+enum PrinterChangeType { added, modified, removed }
+
+/// A single change to the printer directory.
+class PrinterChangeModel {
+  /// Whether the printer was added, modified or removed.
+  final PrinterChangeType type;
+
+  /// The printer as it is now, or as it was last seen for [PrinterChangeType.removed].
+  final Printer printer;
+
+  PrinterChangeModel({required this.type, required this.printer});
+}
+
+/// The printer directory changes since a caller-held generation.
+class PrinterChanges {
+  /// The generation to pass to the next [PrintingFfi.getPrinterChanges] call.
+  final int generation;
+
+  /// Whether [changes] is a full snapshot that replaces any previously held model.
+  ///
+  /// This is the case for the first call (generation `0`) and whenever the
+  /// native side could not relate the given generation to its own history,
+  /// e.g. because it is older than the removals it still remembers.
+  final bool reset;
+
+  /// The printers that were added, modified or removed.
+  final List<PrinterChangeModel> changes;
+
+  PrinterChanges({required this.generation, required this.reset, required this.changes});
+}
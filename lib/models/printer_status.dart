@@ -0,0 +1,52 @@
+/// The level of one printer supply (toner, ink, ...), from the printer's
+/// marker-names and marker-levels attributes.
+class PrinterSupply {
+  /// The supply's name as reported by the printer, e.g. "Black Toner".
+  final String name;
+
+  /// The remaining level in percent, or a negative IPP value: -1 if the level
+  /// is unavailable, -2 if it is unknown and -3 if some is remaining.
+  final int level;
+
+  const PrinterSupply({required this.name, required this.level});
+
+  /// Whether [level] is a percentage.
+  bool get isKnown => level >= 0;
+}
+
+/// A printer's live status, returned by [PrintingFfi.getPrinterStatuses].
+class PrinterStatusReport {
+  /// The printer's name.
+  final String name;
+
+  /// Whether the printer's status could be read. When `false` the other
+  /// fields hold their defaults.
+  final bool found;
+
+  /// The raw platform-specific state value, with the same meaning as
+  /// [Printer.state].
+  final int state;
+
+  /// The printer-state-reasons keywords, e.g. `['media-empty-error']`. Empty
+  /// when there are none.
+  final List<String> stateReasons;
+
+  /// Whether the printer is accepting new jobs.
+  final bool isAcceptingJobs;
+
+  /// The number of jobs queued on the printer.
+  final int queuedJobCount;
+
+  /// The printer's supply levels. Always empty on Windows.
+  final List<PrinterSupply> supplies;
+
+  const PrinterStatusReport({
+    required this.name,
+    required this.found,
+    this.state = 0,
+    this.stateReasons = const [],
+    this.isAcceptingJobs = false,
+    this.queuedJobCount = 0,
+    this.supplies = const [],
+  });
+}
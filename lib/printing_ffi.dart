@@ -12,6 +12,9 @@ export 'models/models.dart';
 /// A function that handles log messages from the native side.
 typedef LogHandler = void Function(String message);
 
+/// The verbosity of native logging, see [PrintingFfi.setNativeLogLevel].
+enum NativeLogLevel { off, error, warn, info, debug }
+
 class PrintingFfi {
   PrintingFfi._();
   static final PrintingFfi instance = PrintingFfi._();
@@ -31,40 +34,126 @@ class PrintingFfi {
 
   LogHandler? _customLogHandler;
 
-  NativeCallable<Void Function(Pointer<Char>)>? _logCallback;
+  NativeCallable<log_batch_callback_tFunction>? _logCallback;
+
+  NativeCallable<prefetch_callback_tFunction>? _prefetchCallback;
+  final Map<int, Completer<CapabilityPrefetchResult>> _prefetchRequests = <int, Completer<CapabilityPrefetchResult>>{};
+  int _nextPrefetchRequestId = 0;
+  // Native prefetches that will still call back, including those whose
+  // completer was already failed by dispose().
+  int _outstandingPrefetches = 0;
+  bool _disposed = false;
 
-  void _logHandler(Pointer<Char> message) {
-    final logMessage = message.cast<Utf8>().toDartString();
-    if (_customLogHandler != null) {
-      _customLogHandler!(logMessage);
-    } else {
-      debugPrint(logMessage);
+  // Native log lines arrive in batches from a background drain thread; the
+  // batch is owned by this handler and released once it has been split.
+  void _logHandler(Pointer<Char> messages, int count) {
+    final String batch;
+    try {
+      batch = messages.cast<Utf8>().toDartString();
+    } finally {
+      _bindings.free_native_string(messages);
+    }
+    for (final logMessage in batch.split('\n')) {
+      if (logMessage.isEmpty) continue;
+      if (_customLogHandler != null) {
+        _customLogHandler!(logMessage);
+      } else {
+        debugPrint(logMessage);
+      }
     }
   }
 
-  void initialize({LogHandler? logHandler}) {
+  /// Registers [logHandler] for native log messages.
+  ///
+  /// If [logLevel] is given, it replaces the native default, which is
+  /// [NativeLogLevel.debug] in debug builds of the native library and
+  /// [NativeLogLevel.off] in release builds.
+  void initialize({LogHandler? logHandler, NativeLogLevel? logLevel}) {
+    _customLogHandler = logHandler;
+    if (logLevel != null) {
+      setNativeLogLevel(logLevel);
+    }
     if (_logCallback != null) {
-      _customLogHandler = logHandler;
       return;
     }
 
-    _customLogHandler = logHandler;
+    // Unregistering sends a final null batch after every batch already
+    // posted, so the callable closes itself only once those are freed.
+    late final NativeCallable<log_batch_callback_tFunction> callback;
+    callback = NativeCallable<log_batch_callback_tFunction>.listener((Pointer<Char> messages, int count) {
+      if (messages == nullptr) {
+        callback.close();
+      } else {
+        _logHandler(messages, count);
+      }
+    });
+    _logCallback = callback;
+    _bindings.register_log_batch_callback(callback.nativeFunction);
+  }
 
-    _logCallback = NativeCallable<Void Function(Pointer<Char>)>.listener(_logHandler);
+  /// Sets the verbosity of native logging at runtime, including in release builds.
+  ///
+  /// Messages below [level] cost a single comparison on the native side.
+  /// Enabled messages are queued in a lock-free ring buffer and delivered to
+  /// the handler passed to [initialize] in batches, off the calling thread.
+  void setNativeLogLevel(NativeLogLevel level) {
+    _bindings.set_log_level(level.index);
+  }
 
-    final registerer = _dylib.lookup<NativeFunction<Void Function(Pointer<NativeFunction<Void Function(Pointer<Char>)>>)>>('register_log_callback').asFunction<void Function(Pointer<NativeFunction<Void Function(Pointer<Char>)>>)>();
+  /// Returns the current native log verbosity.
+  NativeLogLevel getNativeLogLevel() => NativeLogLevel.values[_bindings.get_log_level()];
+
+  int? _sharedSnapshotMaxAgeMs;
+
+  /// Serves [listPrinters] from a printer list shared by every process on
+  /// this host that opens the same [name].
+  ///
+  /// When the shared list is older than [maxAge], one process refreshes it
+  /// from the printing system while the others keep reading the previous
+  /// list, so a fleet of worker processes queries cupsd or the spooler once
+  /// per [maxAge] instead of once per call. Returns `false` if the shared
+  /// memory segment could not be opened, in which case [listPrinters] keeps
+  /// querying the printing system directly.
+  bool enableSharedPrinterSnapshot({String name = 'printing_ffi', Duration maxAge = const Duration(seconds: 2)}) {
+    final namePtr = name.toNativeUtf8();
+    try {
+      final opened = _bindings.open_shared_printer_snapshot(namePtr.cast());
+      _sharedSnapshotMaxAgeMs = opened ? maxAge.inMilliseconds : null;
+      return opened;
+    } finally {
+      malloc.free(namePtr);
+    }
+  }
 
-    registerer(_logCallback!.nativeFunction);
+  /// Stops using the shared printer list enabled by [enableSharedPrinterSnapshot].
+  void disableSharedPrinterSnapshot() {
+    _sharedSnapshotMaxAgeMs = null;
+    _bindings.close_shared_printer_snapshot();
   }
 
   void dispose() {
-    _logCallback?.close();
+    // Waits for an in-flight delivery; the callable then closes itself once
+    // the batches already posted to it have been handled.
+    _bindings.register_log_batch_callback(nullptr);
     _logCallback = null;
+    // A running prefetch still calls back from a native thread, so its
+    // callable is closed here only if none is outstanding, and otherwise by
+    // _prefetchHandler once the last one has called back.
+    _disposed = true;
+    if (_outstandingPrefetches == 0) {
+      _prefetchCallback?.close();
+      _prefetchCallback = null;
+    }
+    for (final completer in _prefetchRequests.values) {
+      completer.completeError(IsolateError('PrintingFfi instance disposed.'));
+    }
+    _prefetchRequests.clear();
     _failAllPendingRequests(IsolateError('PrintingFfi instance disposed.'));
   }
 
   List<Printer> listPrinters() {
-    final printerListPtr = _bindings.get_printers();
+    final sharedMaxAgeMs = _sharedSnapshotMaxAgeMs;
+    final printerListPtr = sharedMaxAgeMs != null ? _bindings.get_printers_shared(sharedMaxAgeMs) : _bindings.get_printers();
 
     if (printerListPtr == nullptr) {
       return [];
@@ -96,6 +185,252 @@ class PrintingFfi {
     }
   }
 
+  /// Returns the printers that were added, modified or removed since [sinceGeneration].
+  ///
+  /// Pass `0` on the first call to receive every printer as
+  /// [PrinterChangeType.added], then pass the returned
+  /// [PrinterChanges.generation] on subsequent calls to receive only the delta.
+  /// This lets a UI patch its printer model in place instead of rebuilding and
+  /// diffing the full list from [listPrinters] on every refresh.
+  PrinterChanges getPrinterChanges({int sinceGeneration = 0}) {
+    final changeListPtr = _bindings.get_printer_changes(sinceGeneration);
+
+    if (changeListPtr == nullptr) {
+      return PrinterChanges(generation: sinceGeneration, reset: false, changes: const []);
+    }
+
+    try {
+      final changeList = changeListPtr.ref;
+      final changes = <PrinterChangeModel>[];
+      for (var i = 0; i < changeList.count; i++) {
+        final change = changeList.changes[i];
+        changes.add(
+          PrinterChangeModel(
+            type: switch (change.change_type) {
+              PRINTER_CHANGE_ADDED => PrinterChangeType.added,
+              PRINTER_CHANGE_REMOVED => PrinterChangeType.removed,
+              _ => PrinterChangeType.modified,
+            },
+            printer: _printerFromInfo(change.printer),
+          ),
+        );
+      }
+      return PrinterChanges(generation: changeList.generation, reset: changeList.reset, changes: changes);
+    } finally {
+      _bindings.free_printer_change_list(changeListPtr);
+    }
+  }
+
+  /// Discards the native printer list, default printer and option caches.
+  ///
+  /// On Linux these caches are invalidated automatically when the local CUPS
+  /// configuration changes. Call this after changing printer settings through
+  /// a channel the plugin cannot observe, such as a remote CUPS server.
+  void invalidatePrinterCaches() {
+    _bindings.invalidate_printer_caches();
+  }
+
+  /// Configures the check that every print and submit method runs before
+  /// uploading anything.
+  ///
+  /// A printer that is stopped (paused on Windows) or not accepting jobs fails
+  /// the call at once with a [PrinterUnavailableException], or the job goes to
+  /// its fallback printer (see [setFallbackPrinter]). A printer's state is
+  /// reused for [maxAge]; [getPrinterStatuses] and [invalidatePrinterCaches]
+  /// refresh it early.
+  ///
+  /// The check is disabled by default: without it the spooler queues jobs for
+  /// stopped and paused printers, and a cache miss costs an extra round trip
+  /// to the printing system before every print or submit.
+  void setAdmissionControl({bool enabled = true, Duration maxAge = const Duration(seconds: 2)}) {
+    _bindings.set_admission_control(enabled, maxAge.inMilliseconds);
+  }
+
+  /// Sends jobs for [printerName] to [fallbackPrinterName] while admission
+  /// control finds that [printerName] cannot take them. Fallbacks are not
+  /// chained. Pass `null` to remove the fallback.
+  void setFallbackPrinter(String printerName, String? fallbackPrinterName) {
+    using((arena) {
+      final namePtr = printerName.toNativeUtf8(allocator: arena);
+      final fallbackPtr = fallbackPrinterName?.toNativeUtf8(allocator: arena) ?? nullptr;
+      if (!_bindings.set_fallback_printer(namePtr.cast(), fallbackPtr.cast())) {
+        throw PrintingFfiException(_bindings.get_last_error().cast<Utf8>().toDartString());
+      }
+    });
+  }
+
+  /// Returns the lifecycle traces of recently submitted jobs with latency
+  /// percentiles per printer.
+  ///
+  /// The native side keeps traces of jobs submitted through this plugin in a
+  /// 1024-slot table indexed by job id, so a newer job can evict an older one
+  /// whose id maps to the same slot. Stages after [JobStage.jobIdReturned] are
+  /// recorded when [listPrintJobs] or a job action observes them. On CUPS a
+  /// finished job just drops out of the listing, so this call looks up the
+  /// final state of such jobs once, dated to the listing that first missed
+  /// them; it may therefore block for up to 32 requests to the scheduler.
+  /// If [printerName] is given, only that printer's jobs are returned.
+  PrintJobTimings getJobTimings({String? printerName}) {
+    return using((arena) {
+      final namePtr = printerName == null ? nullptr : printerName.toNativeUtf8(allocator: arena).cast<Char>();
+      final timingsPtr = _bindings.get_job_timings(namePtr);
+      if (timingsPtr == nullptr) {
+        return PrintJobTimings(traces: const [], summaries: const []);
+      }
+
+      try {
+        final timings = timingsPtr.ref;
+        final traces = <PrintJobTrace>[];
+        for (var i = 0; i < timings.trace_count; i++) {
+          final trace = timings.traces[i];
+          final stages = <JobStage, Duration>{};
+          for (final stage in JobStage.values) {
+            final ns = trace.stage_ns[stage.index];
+            if (ns != 0) {
+              stages[stage] = Duration(microseconds: ns ~/ 1000);
+            }
+          }
+          traces.add(
+            PrintJobTrace(jobId: trace.job_id, printerName: trace.printer_name.cast<Utf8>().toDartString(), stages: stages),
+          );
+        }
+
+        final summaries = <PrintJobLatency>[];
+        for (var i = 0; i < timings.summary_count; i++) {
+          final summary = timings.summaries[i];
+          summaries.add(
+            PrintJobLatency(
+              printerName: summary.printer_name.cast<Utf8>().toDartString(),
+              interval: JobInterval.values[summary.interval],
+              samples: summary.samples,
+              p50: Duration(microseconds: summary.p50_ns ~/ 1000),
+              p95: Duration(microseconds: summary.p95_ns ~/ 1000),
+              p99: Duration(microseconds: summary.p99_ns ~/ 1000),
+              max: Duration(microseconds: summary.max_ns ~/ 1000),
+            ),
+          );
+        }
+        return PrintJobTimings(traces: traces, summaries: summaries);
+      } finally {
+        _bindings.free_job_timings(timingsPtr);
+      }
+    });
+  }
+
+  /// Discards all recorded job traces.
+  void resetJobTimings() {
+    _bindings.reset_job_timings();
+  }
+
+  /// Returns call counts and latency percentiles of the native operations.
+  ///
+  /// The counters are process-wide and always on, so they include calls made
+  /// from every isolate since the library was loaded or [resetNativeMetrics].
+  NativeMetrics getNativeMetrics() {
+    final snapshotPtr = _bindings.get_metrics_snapshot();
+    if (snapshotPtr == nullptr) {
+      return NativeMetrics(operations: const {});
+    }
+
+    Duration fromNs(int ns) => Duration(microseconds: ns ~/ 1000);
+    try {
+      final operations = <NativeOperation, NativeOperationMetrics>{};
+      for (final operation in NativeOperation.values) {
+        final metrics = snapshotPtr.ref.operations[operation.index];
+        operations[operation] = NativeOperationMetrics(
+          calls: metrics.calls,
+          errors: metrics.errors,
+          total: fromNs(metrics.total_ns),
+          max: fromNs(metrics.max_ns),
+          p50: fromNs(metrics.p50_ns),
+          p90: fromNs(metrics.p90_ns),
+          p99: fromNs(metrics.p99_ns),
+          p999: fromNs(metrics.p999_ns),
+        );
+      }
+      return NativeMetrics(operations: operations);
+    } finally {
+      _bindings.free_metrics_snapshot(snapshotPtr);
+    }
+  }
+
+  /// Returns the native metrics in the Prometheus text exposition format,
+  /// ready to be served from a `/metrics` endpoint.
+  String getNativeMetricsPrometheus() {
+    final textPtr = _bindings.render_metrics_prometheus();
+    if (textPtr == nullptr) {
+      return '';
+    }
+    try {
+      return textPtr.cast<Utf8>().toDartString();
+    } finally {
+      _bindings.free_native_string(textPtr);
+    }
+  }
+
+  /// Resets all native metrics to zero.
+  void resetNativeMetrics() {
+    _bindings.reset_metrics();
+  }
+
+  /// Starts recording native spans (printer enumeration, capability queries, spool
+  /// writes, job submission and, on Windows, PDF page load, render and
+  /// transmit) with their thread IDs and arguments.
+  ///
+  /// Call [stopNativeTrace] to write them to [outputPath] as Chrome trace
+  /// event JSON, which can be opened in `chrome://tracing` or Perfetto.
+  /// Returns `false` if the recording could not be started.
+  bool startNativeTrace(String outputPath) {
+    final pathPtr = outputPath.toNativeUtf8();
+    try {
+      return _bindings.start_trace_recording(pathPtr.cast());
+    } finally {
+      malloc.free(pathPtr);
+    }
+  }
+
+  /// Stops the recording started by [startNativeTrace] and writes the trace file.
+  ///
+  /// Throws a [PrintingFfiException] if no recording is in progress or the
+  /// file could not be written.
+  void stopNativeTrace() {
+    if (!_bindings.stop_trace_recording()) {
+      throw PrintingFfiException(_bindings.get_last_error().cast<Utf8>().toDartString());
+    }
+  }
+
+  /// Starts recording every printer listing, status sweep, job listing, print
+  /// and job control call made through the plugin to [outputPath] in a
+  /// compact binary format.
+  ///
+  /// Each record holds the call's start time and duration, printer, options,
+  /// outcome, and the payload size and hash (raw data is not stored). Job
+  /// control calls also hold their job ids, and paged listings their
+  /// arguments. Replay a recording against a test server with
+  /// `printing_ffi_bench replay`; replayed job control calls act on the jobs
+  /// the replayed submits created.
+  /// Throws a [PrintingFfiException] if the file could not be created.
+  void startCallRecording(String outputPath) {
+    final pathPtr = outputPath.toNativeUtf8();
+    try {
+      if (!_bindings.start_call_recording(pathPtr.cast())) {
+        throw PrintingFfiException(_bindings.get_last_error().cast<Utf8>().toDartString());
+      }
+    } finally {
+      malloc.free(pathPtr);
+    }
+  }
+
+  /// Stops the recording started by [startCallRecording] and closes its file.
+  ///
+  /// Throws a [PrintingFfiException] if no recording is in progress or the
+  /// file could not be written.
+  void stopCallRecording() {
+    if (!_bindings.stop_call_recording()) {
+      throw PrintingFfiException(_bindings.get_last_error().cast<Utf8>().toDartString());
+    }
+  }
+
   Printer _printerFromInfo(PrinterInfo info) {
     final model = info.model.cast<Utf8>().toDartString();
     final location = info.location.cast<Utf8>().toDartString();
@@ -261,16 +596,18 @@ class PrintingFfi {
   Stream<PrintJob> _streamJobStatus({
     required String printerName,
     required Duration pollInterval,
-    required Future<int> Function() submitJob,
+    required Future<_SubmittedJob> Function() submitJob,
   }) {
     late StreamController<PrintJob> controller;
+    // Admission control may reroute the job to a fallback printer.
+    var jobPrinterName = printerName;
     Timer? poller;
     PrintJob? lastJob;
 
     Future<void> poll(int jobId) async {
       if (controller.isClosed) return;
       try {
-        final jobs = await listPrintJobs(printerName);
+        final jobs = await listPrintJobs(jobPrinterName);
         PrintJob? foundJob;
         try {
           foundJob = jobs.firstWhere((j) => j.id == jobId);
@@ -309,7 +646,17 @@ class PrintingFfi {
 
     controller = StreamController<PrintJob>(
       onListen: () async {
-        final jobId = await submitJob();
+        // A rejected submission, e.g. by admission control, ends the stream with its error.
+        final _SubmittedJob job;
+        try {
+          job = await submitJob();
+        } catch (e, s) {
+          controller.addError(e, s);
+          await controller.close();
+          return;
+        }
+        jobPrinterName = job.printerName;
+        final jobId = job.jobId;
         if (jobId <= 0) {
           controller.addError(Exception('Failed to submit job to the print queue.'));
           await controller.close();
@@ -326,6 +673,40 @@ class PrintingFfi {
     return controller.stream;
   }
 
+  /// Persists printer capabilities ([getSupportedCupsOptions] and
+  /// [getWindowsPrinterCapabilities]) in [directory], typically a
+  /// subdirectory of the app's cache directory, so that after a restart they
+  /// are loaded from a memory-mapped file instead of being queried again.
+  ///
+  /// A persisted entry is only used while the printer is unchanged: its
+  /// `printer-config-change-time` on macOS and Linux, or the spooler's
+  /// ChangeID on Windows. Pass `null` to stop using the directory. Throws a
+  /// [PrintingFfiException] if [directory] cannot be created.
+  void setCapabilitiesCacheDirectory(String? directory) {
+    final directoryPtr = directory?.toNativeUtf8() ?? nullptr;
+    try {
+      if (!_bindings.set_capabilities_cache_dir(directoryPtr.cast())) {
+        throw PrintingFfiException(_bindings.get_last_error().cast<Utf8>().toDartString());
+      }
+    } finally {
+      if (directoryPtr != nullptr) malloc.free(directoryPtr);
+    }
+  }
+
+  /// Returns the options a CUPS printer supports, read with an IPP
+  /// Get-Printer-Attributes request, so driverless queues without a PPD are
+  /// covered too.
+  ///
+  /// Options use their IPP names (`media`, `media-source`, `sides`,
+  /// `print-color-mode`, `print-quality`, `printer-resolution`, `finishings`,
+  /// `output-bin`, ...), and each choice can be passed back unchanged in
+  /// `cupsOptions`. They are cached natively per printer; a cached list is
+  /// revalidated against the printer's `printer-config-change-time`. The
+  /// geometry of a `media` choice can be resolved with [lookupMediaSize].
+  ///
+  /// PPD option names (`PageSize`, `Duplex`, `InputSlot`, ...) and PPD-only
+  /// vendor options are not listed. They are still forwarded when passed in
+  /// `cupsOptions`, so queues with a PPD keep honoring them.
   Future<List<CupsOptionModel>> getSupportedCupsOptions(String printerName) async {
     if (!Platform.isMacOS && !Platform.isLinux) {
       return [];
@@ -340,6 +721,111 @@ class PrintingFfi {
     return completer.future;
   }
 
+  /// Checks [options] against the printer's capabilities before anything is
+  /// spooled, so that an invalid combination fails fast instead of being
+  /// rejected by the scheduler or driver after upload.
+  ///
+  /// On macOS and Linux, generic keys (`orientation`, `color-mode`, `duplex`,
+  /// ...) are first mapped to their IPP names, then every key returned by
+  /// [getSupportedCupsOptions] must use one of its values, and the values must
+  /// not match one of the printer's `job-constraints-supported`. On Windows,
+  /// `paper-size-id`, `paper-source-id`, `media-type-id`, `color-mode` and
+  /// `orientation` are checked. Other keys are not checked.
+  ///
+  /// Media sizes match by PWG alias, so `A4`, `iso-a4` and
+  /// `iso_a4_210x297mm` are interchangeable.
+  ///
+  /// Capabilities come from the native cache; warm it with
+  /// [prefetchCapabilities] to avoid printer round trips. A cache miss is
+  /// loaded on the helper isolate like [getSupportedCupsOptions].
+  Future<OptionValidationResult> validateOptions(String printerName, Map<String, String> options) async {
+    final SendPort helperIsolateSendPort = await _helperIsolateSendPort;
+    final int requestId = _nextValidateOptionsRequestId++;
+    final request = _ValidateOptionsRequest(requestId, printerName, options);
+    final completer = Completer<OptionValidationResult>();
+    _validateOptionsRequests[requestId] = completer;
+    helperIsolateSendPort.send(request);
+    return completer.future;
+  }
+
+  /// Looks up a media size in the built-in PWG 5101.1 table by its PWG name
+  /// (`iso_a4_210x297mm`), PPD PageSize name (`A4`) or legacy IPP keyword
+  /// (`iso-a4`). Self-describing PWG names that are not in the table, such as
+  /// a printer's `oe_4x6-label_4x6in`, are resolved from the dimensions in the
+  /// name. Returns `null` if the name is not recognized.
+  ///
+  /// This never contacts a printer, so layout code can call it freely.
+  MediaSize? lookupMediaSize(String name) {
+    final info = using((arena) => _bindings.get_media_size(name.toNativeUtf8(allocator: arena).cast<Char>()));
+    return _mediaSizeFromInfo(info);
+  }
+
+  /// Looks up a media size in the built-in PWG 5101.1 table by its Windows
+  /// DMPAPER id (see [WindowsPaperSize.id]). Returns `null` for ids that are
+  /// not standard sizes, such as driver-defined ids.
+  MediaSize? lookupWindowsMediaSize(int paperSizeId) {
+    return _mediaSizeFromInfo(_bindings.get_media_size_by_windows_id(paperSizeId));
+  }
+
+  MediaSize? _mediaSizeFromInfo(Pointer<MediaSizeInfo> info) {
+    if (info == nullptr) return null;
+    try {
+      String? optional(Pointer<Char> value) {
+        final text = value.cast<Utf8>().toDartString();
+        return text.isEmpty ? null : text;
+      }
+
+      final ref = info.ref;
+      return MediaSize(
+        pwgName: ref.pwg_name.cast<Utf8>().toDartString(),
+        ppdName: optional(ref.ppd_name),
+        ippName: optional(ref.ipp_name),
+        windowsPaperSizeId: ref.windows_id != 0 ? ref.windows_id : null,
+        widthMillimeters: ref.width_mm,
+        heightMillimeters: ref.height_mm,
+      );
+    } finally {
+      _bindings.free_media_size_info(info);
+    }
+  }
+
+  /// Warms the native caches behind [getSupportedCupsOptions] (macOS and
+  /// Linux) and [getWindowsPrinterCapabilities] (Windows) for [printerNames].
+  ///
+  /// The printers are queried in parallel on up to [concurrency] native
+  /// worker threads instead of one after another on the helper isolate, so
+  /// warming many printers takes roughly as long as the slowest few. Later
+  /// calls for these printers are served from the cache while the printers
+  /// are unchanged.
+  Future<CapabilityPrefetchResult> prefetchCapabilities(List<String> printerNames, {int concurrency = 8}) {
+    final callback = _prefetchCallback ??= NativeCallable<prefetch_callback_tFunction>.listener(_prefetchHandler);
+    final requestId = _nextPrefetchRequestId++;
+    final completer = Completer<CapabilityPrefetchResult>();
+    _prefetchRequests[requestId] = completer;
+    _outstandingPrefetches++;
+    using((arena) {
+      final names = arena<Pointer<Char>>(printerNames.isEmpty ? 1 : printerNames.length);
+      for (var i = 0; i < printerNames.length; i++) {
+        names[i] = printerNames[i].toNativeUtf8(allocator: arena).cast<Char>();
+      }
+      if (!_bindings.prefetch_capabilities(names, printerNames.length, concurrency, requestId, callback.nativeFunction)) {
+        _prefetchRequests.remove(requestId);
+        _outstandingPrefetches--;
+        completer.completeError(PrintingFfiException(_bindings.get_last_error().cast<Utf8>().toDartString()));
+      }
+    });
+    return completer.future;
+  }
+
+  void _prefetchHandler(int requestId, int succeeded, int failed) {
+    _outstandingPrefetches--;
+    _prefetchRequests.remove(requestId)?.complete(CapabilityPrefetchResult(succeeded: succeeded, failed: failed));
+    if (_disposed && _outstandingPrefetches == 0) {
+      _prefetchCallback?.close();
+      _prefetchCallback = null;
+    }
+  }
+
   Future<WindowsPrinterCapabilitiesModel?> getWindowsPrinterCapabilities(String printerName) async {
     if (!Platform.isWindows) {
       return null;
@@ -353,16 +839,155 @@ class PrintingFfi {
     return completer.future;
   }
 
-  Future<List<PrintJob>> listPrintJobs(String printerName) async {
+  /// Returns the printer's capabilities as one flat binary buffer: its CUPS
+  /// options on macOS and Linux, its Windows capabilities on Windows.
+  ///
+  /// [getSupportedCupsOptions] and [getWindowsPrinterCapabilities] convert
+  /// every option, choice and string into Dart objects before returning. The
+  /// snapshot instead crosses from the helper isolate as a single buffer, and
+  /// [PrinterCapabilitySnapshot] decodes only the fields that are read, which
+  /// keeps printers with thousands of choices cheap to open. Returns `null` if
+  /// the capabilities could not be loaded.
+  Future<PrinterCapabilitySnapshot?> getCapabilitySnapshot(String printerName) async {
+    final SendPort helperIsolateSendPort = await _helperIsolateSendPort;
+    final int requestId = _nextGetCapabilitySnapshotRequestId++;
+    final request = _GetCapabilitySnapshotRequest(requestId, printerName);
+    final completer = Completer<PrinterCapabilitySnapshot?>();
+    _getCapabilitySnapshotRequests[requestId] = completer;
+    helperIsolateSendPort.send(request);
+    return completer.future;
+  }
+
+  /// Returns the live status of each printer in [printerNames], in the same
+  /// order, or of every printer when [printerNames] is empty.
+  ///
+  /// On macOS and Linux all printers are read with a single request to the
+  /// CUPS scheduler, so polling a fleet of queues costs one round trip rather
+  /// than one per printer. A printer that could not be read is returned with
+  /// [PrinterStatusReport.found] set to `false`. Throws a
+  /// [PrintingFfiException] if the scheduler could not be queried.
+  Future<List<PrinterStatusReport>> getPrinterStatuses([List<String> printerNames = const []]) async {
     final SendPort helperIsolateSendPort = await _helperIsolateSendPort;
-    final int requestId = _nextPrintJobsRequestId++;
-    final _PrintJobsRequest request = _PrintJobsRequest(requestId, printerName);
-    final Completer<List<PrintJob>> completer = Completer<List<PrintJob>>();
-    _printJobsRequests[requestId] = completer;
+    final int requestId = _nextGetPrinterStatusesRequestId++;
+    final request = _GetPrinterStatusesRequest(requestId, printerNames);
+    final completer = Completer<List<PrinterStatusReport>>();
+    _getPrinterStatusesRequests[requestId] = completer;
     helperIsolateSendPort.send(request);
     return completer.future;
   }
 
+  /// Opens a [PrinterSession] that keeps the native printer handle (Windows)
+  /// or scheduler connection (CUPS) open across job operations.
+  ///
+  /// Use it for high-frequency job control on one printer instead of the
+  /// name-based methods, which open and close the printer on every call.
+  /// Throws a [PrintingFfiException] if the printer cannot be opened.
+  PrinterSession openPrinterSession(String printerName) {
+    final namePtr = printerName.toNativeUtf8();
+    try {
+      final handle = _bindings.open_printer_handle(namePtr.cast());
+      if (handle == nullptr) {
+        throw PrintingFfiException(_bindings.get_last_error().cast<Utf8>().toDartString());
+      }
+      return PrinterSession._(printerName, handle.address);
+    } finally {
+      malloc.free(namePtr);
+    }
+  }
+
+  Future<List<PrintJob>> listPrintJobs(String printerName) => _listPrintJobs(printerName);
+
+  Future<List<PrintJob>> _listPrintJobs(String printerName, [PrinterSession? session]) {
+    return _withSession(session, (handleAddress) async {
+      final SendPort helperIsolateSendPort = await _helperIsolateSendPort;
+      final int requestId = _nextPrintJobsRequestId++;
+      final _PrintJobsRequest request = _PrintJobsRequest(requestId, printerName, handleAddress);
+      final Completer<List<PrintJob>> completer = Completer<List<PrintJob>>();
+      _printJobsRequests[requestId] = completer;
+      helperIsolateSendPort.send(request);
+      return completer.future;
+    });
+  }
+
+  /// Closes a [PrinterSession]'s native handle on the helper isolate, so that
+  /// it is never freed while the helper isolate is using it.
+  Future<void> _closePrinterHandle(int handleAddress) async {
+    final SendPort helperIsolateSendPort = await _helperIsolateSendPort;
+    final int requestId = _nextClosePrinterHandleRequestId++;
+    final completer = Completer<void>();
+    _closePrinterHandleRequests[requestId] = completer;
+    helperIsolateSendPort.send(_ClosePrinterHandleRequest(requestId, handleAddress));
+    return completer.future;
+  }
+
+  /// Runs [send] with the native handle of [session], or 0 without a session.
+  /// The session's handle stays open until the returned future completes.
+  Future<T> _withSession<T>(PrinterSession? session, Future<T> Function(int handleAddress) send) {
+    if (session == null) return send(0);
+    final handleAddress = session._acquire();
+    return send(handleAddress).whenComplete(session._release);
+  }
+
+  /// Returns one page of the jobs on [printerName].
+  ///
+  /// Skips [firstIndex] jobs and returns at most [limit], selecting jobs with
+  /// [which] and, if [myJobs] is set, only those of the current user. Only the
+  /// columns in [fields] are fetched from the printing system; fields that are
+  /// not requested are left empty on the returned [PrintJob]s. Use this for
+  /// queues that retain many completed jobs instead of [listPrintJobs].
+  Future<PrintJobPage> listPrintJobsPage(
+    String printerName, {
+    int firstIndex = 0,
+    int limit = 50,
+    PrintJobFilter which = PrintJobFilter.active,
+    bool myJobs = false,
+    Set<PrintJobField> fields = const {PrintJobField.title, PrintJobField.state},
+  }) => _listPrintJobsPage(printerName, firstIndex, limit, which, myJobs, fields);
+
+  Future<PrintJobPage> _listPrintJobsPage(
+    String printerName,
+    int firstIndex,
+    int limit,
+    PrintJobFilter which,
+    bool myJobs,
+    Set<PrintJobField> fields, [
+    PrinterSession? session,
+  ]) {
+    return _withSession(session, (handleAddress) async {
+      final SendPort helperIsolateSendPort = await _helperIsolateSendPort;
+      final int requestId = _nextPrintJobsPageRequestId++;
+      var attributes = 0;
+      for (final field in fields) {
+        attributes |= switch (field) {
+          PrintJobField.title => JOB_ATTR_TITLE,
+          PrintJobField.state => JOB_ATTR_STATE,
+          PrintJobField.user => JOB_ATTR_USER,
+          PrintJobField.size => JOB_ATTR_SIZE,
+          PrintJobField.pages => JOB_ATTR_PAGES,
+          PrintJobField.times => JOB_ATTR_TIMES,
+        };
+      }
+      final request = _PrintJobsPageRequest(
+        requestId,
+        printerName,
+        firstIndex,
+        limit,
+        switch (which) {
+          PrintJobFilter.active => WHICH_JOBS_ACTIVE,
+          PrintJobFilter.completed => WHICH_JOBS_COMPLETED,
+          PrintJobFilter.all => WHICH_JOBS_ALL,
+        },
+        myJobs,
+        attributes,
+        handleAddress,
+      );
+      final Completer<PrintJobPage> completer = Completer<PrintJobPage>();
+      _printJobsPageRequests[requestId] = completer;
+      helperIsolateSendPort.send(request);
+      return completer.future;
+    });
+  }
+
   Stream<List<PrintJob>> listPrintJobsStream(
     String printerName, {
     Duration pollInterval = const Duration(seconds: 2),
@@ -418,52 +1043,74 @@ class PrintingFfi {
     return controller.stream;
   }
 
-  Future<bool> pausePrintJob(String printerName, int jobId) async {
-    final SendPort helperIsolateSendPort = await _helperIsolateSendPort;
-    final int requestId = _nextPrintJobActionRequestId++;
-    final _PrintJobActionRequest request = _PrintJobActionRequest(
-      requestId,
-      printerName,
-      jobId,
-      'pause',
-    );
-    final Completer<bool> completer = Completer<bool>();
-    _printJobActionRequests[requestId] = completer;
-    helperIsolateSendPort.send(request);
-    return completer.future;
+  Future<bool> pausePrintJob(String printerName, int jobId) => _sendPrintJobAction(printerName, jobId, 'pause');
+
+  Future<bool> resumePrintJob(String printerName, int jobId) => _sendPrintJobAction(printerName, jobId, 'resume');
+
+  Future<bool> cancelPrintJob(String printerName, int jobId) => _sendPrintJobAction(printerName, jobId, 'cancel');
+
+  /// Cancels all of [jobIds] on [printerName] in as few native requests as the
+  /// platform allows, and returns how many were cancelled.
+  ///
+  /// On CUPS this sends a single IPP Cancel-Jobs request per 500 ids instead of
+  /// one request per job.
+  Future<int> cancelPrintJobs(String printerName, List<int> jobIds) => _sendBulkJobAction(printerName, 'cancel', jobIds: jobIds);
+
+  /// Holds (pauses) all of [jobIds] on [printerName] and returns how many were held.
+  Future<int> holdPrintJobs(String printerName, List<int> jobIds) => _sendBulkJobAction(printerName, 'hold', jobIds: jobIds);
+
+  /// Releases (resumes) all of [jobIds] on [printerName] and returns how many were released.
+  Future<int> releasePrintJobs(String printerName, List<int> jobIds) => _sendBulkJobAction(printerName, 'release', jobIds: jobIds);
+
+  /// Removes every job in [scope] from [printerName]'s queue with a single request.
+  Future<bool> cancelAllPrintJobs(String printerName, {CancelJobsScope scope = CancelJobsScope.allJobs}) async {
+    return await _sendBulkJobAction(printerName, 'cancel-all', scope: scope) != 0;
   }
 
-  Future<bool> resumePrintJob(String printerName, int jobId) async {
-    final SendPort helperIsolateSendPort = await _helperIsolateSendPort;
-    final int requestId = _nextPrintJobActionRequestId++;
-    final _PrintJobActionRequest request = _PrintJobActionRequest(
-      requestId,
-      printerName,
-      jobId,
-      'resume',
-    );
-    final Completer<bool> completer = Completer<bool>();
-    _printJobActionRequests[requestId] = completer;
-    helperIsolateSendPort.send(request);
-    return completer.future;
+  Future<int> _sendBulkJobAction(
+    String printerName,
+    String action, {
+    List<int> jobIds = const [],
+    CancelJobsScope scope = CancelJobsScope.allJobs,
+    PrinterSession? session,
+  }) {
+    return _withSession(session, (handleAddress) async {
+      final SendPort helperIsolateSendPort = await _helperIsolateSendPort;
+      final int requestId = _nextBulkJobActionRequestId++;
+      final request = _BulkJobActionRequest(
+        requestId,
+        printerName,
+        action,
+        jobIds,
+        scope,
+        handleAddress,
+      );
+      final Completer<int> completer = Completer<int>();
+      _bulkJobActionRequests[requestId] = completer;
+      helperIsolateSendPort.send(request);
+      return completer.future;
+    });
   }
 
-  Future<bool> cancelPrintJob(String printerName, int jobId) async {
-    final SendPort helperIsolateSendPort = await _helperIsolateSendPort;
-    final int requestId = _nextPrintJobActionRequestId++;
-    final _PrintJobActionRequest request = _PrintJobActionRequest(
-      requestId,
-      printerName,
-      jobId,
-      'cancel',
-    );
-    final Completer<bool> completer = Completer<bool>();
-    _printJobActionRequests[requestId] = completer;
-    helperIsolateSendPort.send(request);
-    return completer.future;
+  Future<bool> _sendPrintJobAction(String printerName, int jobId, String action, [PrinterSession? session]) {
+    return _withSession(session, (handleAddress) async {
+      final SendPort helperIsolateSendPort = await _helperIsolateSendPort;
+      final int requestId = _nextPrintJobActionRequestId++;
+      final _PrintJobActionRequest request = _PrintJobActionRequest(
+        requestId,
+        printerName,
+        jobId,
+        action,
+        handleAddress,
+      );
+      final Completer<bool> completer = Completer<bool>();
+      _printJobActionRequests[requestId] = completer;
+      helperIsolateSendPort.send(request);
+      return completer.future;
+    });
   }
 
-  Future<int> _sendRawDataJobRequest(
+  Future<_SubmittedJob> _sendRawDataJobRequest(
     String printerName,
     Uint8List data, {
     String docName = 'Flutter Document',
@@ -478,13 +1125,13 @@ class PrintingFfi {
       docName,
       options,
     );
-    final completer = Completer<int>();
+    final completer = Completer<_SubmittedJob>();
     _submitRawDataJobRequests[requestId] = completer;
     helperIsolateSendPort.send(request);
     return completer.future;
   }
 
-  Future<int> _sendPdfJobRequest(
+  Future<_SubmittedJob> _sendPdfJobRequest(
     String printerName,
     String pdfFilePath, {
     String docName = 'Flutter PDF Document',
@@ -507,7 +1154,7 @@ class PrintingFfi {
       pageRange,
       alignment,
     );
-    final completer = Completer<int>();
+    final completer = Completer<_SubmittedJob>();
     _submitPdfJobRequests[requestId] = completer;
     helperIsolateSendPort.send(request);
     return completer.future;
@@ -519,9 +1166,15 @@ class PrintingFfi {
   int _nextPrintPdfRequestId = 0;
   int _nextGetCupsOptionsRequestId = 0;
   int _nextGetWindowsCapsRequestId = 0;
+  int _nextGetCapabilitySnapshotRequestId = 0;
+  int _nextGetPrinterStatusesRequestId = 0;
   int _nextOpenPrinterPropertiesRequestId = 0;
   int _nextSubmitRawDataJobRequestId = 0;
   int _nextSubmitPdfJobRequestId = 0;
+  int _nextBulkJobActionRequestId = 0;
+  int _nextPrintJobsPageRequestId = 0;
+  int _nextClosePrinterHandleRequestId = 0;
+  int _nextValidateOptionsRequestId = 0;
 
   final Map<int, Completer<bool>> _printRequests = <int, Completer<bool>>{};
   final Map<int, Completer<List<PrintJob>>> _printJobsRequests = <int, Completer<List<PrintJob>>>{};
@@ -529,9 +1182,15 @@ class PrintingFfi {
   final Map<int, Completer<bool>> _printPdfRequests = <int, Completer<bool>>{};
   final Map<int, Completer<List<CupsOptionModel>>> _getCupsOptionsRequests = <int, Completer<List<CupsOptionModel>>>{};
   final Map<int, Completer<WindowsPrinterCapabilitiesModel?>> _getWindowsCapsRequests = <int, Completer<WindowsPrinterCapabilitiesModel?>>{};
+  final Map<int, Completer<PrinterCapabilitySnapshot?>> _getCapabilitySnapshotRequests = <int, Completer<PrinterCapabilitySnapshot?>>{};
+  final Map<int, Completer<List<PrinterStatusReport>>> _getPrinterStatusesRequests = <int, Completer<List<PrinterStatusReport>>>{};
   final Map<int, Completer<PrinterPropertiesResult>> _openPrinterPropertiesRequests = <int, Completer<PrinterPropertiesResult>>{};
-  final Map<int, Completer<int>> _submitRawDataJobRequests = <int, Completer<int>>{};
-  final Map<int, Completer<int>> _submitPdfJobRequests = <int, Completer<int>>{};
+  final Map<int, Completer<_SubmittedJob>> _submitRawDataJobRequests = <int, Completer<_SubmittedJob>>{};
+  final Map<int, Completer<_SubmittedJob>> _submitPdfJobRequests = <int, Completer<_SubmittedJob>>{};
+  final Map<int, Completer<int>> _bulkJobActionRequests = <int, Completer<int>>{};
+  final Map<int, Completer<PrintJobPage>> _printJobsPageRequests = <int, Completer<PrintJobPage>>{};
+  final Map<int, Completer<void>> _closePrinterHandleRequests = <int, Completer<void>>{};
+  final Map<int, Completer<OptionValidationResult>> _validateOptionsRequests = <int, Completer<OptionValidationResult>>{};
 
   void _failAllPendingRequests(Object error, [StackTrace? stackTrace]) {
     final allCompleters = [
@@ -541,9 +1200,15 @@ class PrintingFfi {
       ..._printPdfRequests.values,
       ..._getCupsOptionsRequests.values,
       ..._getWindowsCapsRequests.values,
+      ..._getCapabilitySnapshotRequests.values,
+      ..._getPrinterStatusesRequests.values,
       ..._openPrinterPropertiesRequests.values,
       ..._submitRawDataJobRequests.values,
       ..._submitPdfJobRequests.values,
+      ..._bulkJobActionRequests.values,
+      ..._printJobsPageRequests.values,
+      ..._closePrinterHandleRequests.values,
+      ..._validateOptionsRequests.values,
     ];
 
     for (final completer in allCompleters) {
@@ -558,9 +1223,15 @@ class PrintingFfi {
     _printPdfRequests.clear();
     _getCupsOptionsRequests.clear();
     _getWindowsCapsRequests.clear();
+    _getCapabilitySnapshotRequests.clear();
+    _getPrinterStatusesRequests.clear();
     _openPrinterPropertiesRequests.clear();
     _submitRawDataJobRequests.clear();
     _submitPdfJobRequests.clear();
+    _bulkJobActionRequests.clear();
+    _printJobsPageRequests.clear();
+    _closePrinterHandleRequests.clear();
+    _validateOptionsRequests.clear();
   }
 
   Future<SendPort> get _helperIsolateSendPort async {
@@ -626,6 +1297,22 @@ class PrintingFfi {
         completer.complete(data.capabilities);
         return;
       }
+      if (data is _GetCapabilitySnapshotResponse) {
+        final Completer<PrinterCapabilitySnapshot?> completer = _getCapabilitySnapshotRequests.remove(data.id)!;
+        final bytes = data.bytes;
+        try {
+          completer.complete(bytes == null ? null : PrinterCapabilitySnapshot(bytes.materialize().asUint8List()));
+        } catch (e, s) {
+          completer.completeError(e, s);
+        }
+        return;
+      }
+      if (data is _GetPrinterStatusesResponse) {
+        final Completer<List<PrinterStatusReport>> completer = _getPrinterStatusesRequests[data.id]!;
+        _getPrinterStatusesRequests.remove(data.id);
+        completer.complete(data.statuses);
+        return;
+      }
       if (data is _OpenPrinterPropertiesResponse) {
         final Completer<PrinterPropertiesResult> completer = _openPrinterPropertiesRequests[data.id]!;
         _openPrinterPropertiesRequests.remove(data.id);
@@ -634,12 +1321,32 @@ class PrintingFfi {
       }
       if (data is _SubmitJobResponse) {
         if (_submitRawDataJobRequests.containsKey(data.id)) {
-          _submitRawDataJobRequests.remove(data.id)!.complete(data.jobId);
+          _submitRawDataJobRequests.remove(data.id)!.complete(data.job);
         } else if (_submitPdfJobRequests.containsKey(data.id)) {
-          _submitPdfJobRequests.remove(data.id)!.complete(data.jobId);
+          _submitPdfJobRequests.remove(data.id)!.complete(data.job);
         }
         return;
       }
+      if (data is _BulkJobActionResponse) {
+        final Completer<int> completer = _bulkJobActionRequests[data.id]!;
+        _bulkJobActionRequests.remove(data.id);
+        completer.complete(data.count);
+        return;
+      }
+      if (data is _PrintJobsPageResponse) {
+        final Completer<PrintJobPage> completer = _printJobsPageRequests[data.id]!;
+        _printJobsPageRequests.remove(data.id);
+        completer.complete(data.page);
+        return;
+      }
+      if (data is _ClosePrinterHandleResponse) {
+        _closePrinterHandleRequests.remove(data.id)!.complete();
+        return;
+      }
+      if (data is _ValidateOptionsResponse) {
+        _validateOptionsRequests.remove(data.id)!.complete(data.result);
+        return;
+      }
       if (data is _ErrorResponse) {
         Completer? requestCompleter;
         final allRequestMaps = [
@@ -649,9 +1356,15 @@ class PrintingFfi {
           _printPdfRequests,
           _getCupsOptionsRequests,
           _getWindowsCapsRequests,
+          _getCapabilitySnapshotRequests,
+          _getPrinterStatusesRequests,
           _openPrinterPropertiesRequests,
           _submitRawDataJobRequests,
           _submitPdfJobRequests,
+          _bulkJobActionRequests,
+          _printJobsPageRequests,
+          _closePrinterHandleRequests,
+          _validateOptionsRequests,
         ];
         for (final map in allRequestMaps) {
           if (map.containsKey(data.id)) {
@@ -674,6 +1387,80 @@ class PrintingFfi {
   }
 }
 
+/// An open printer whose native handle is reused across job operations.
+///
+/// Obtain one with [PrintingFfi.openPrinterSession] and [close] it when done.
+/// Do not close a session while one of its operations is still pending.
+class PrinterSession {
+  PrinterSession._(this.printerName, this._address);
+
+  /// The name of the printer this session was opened for.
+  final String printerName;
+
+  final int _address;
+  int _pending = 0;
+  Completer<void>? _closing;
+
+  /// Whether [close] has been called.
+  bool get isClosed => _closing != null;
+
+  /// Returns the native handle for a request that is about to be sent. The
+  /// handle stays open until the matching [_release].
+  int _acquire() {
+    if (_closing != null) {
+      throw StateError('PrinterSession for "$printerName" has been closed.');
+    }
+    _pending++;
+    return _address;
+  }
+
+  void _release() {
+    _pending--;
+    if (_closing != null && _pending == 0) _closeHandle();
+  }
+
+  void _closeHandle() {
+    final closing = _closing!;
+    PrintingFfi.instance._closePrinterHandle(_address).then(closing.complete, onError: closing.completeError);
+  }
+
+  Future<List<PrintJob>> listPrintJobs() => PrintingFfi.instance._listPrintJobs(printerName, this);
+
+  Future<bool> pausePrintJob(int jobId) => PrintingFfi.instance._sendPrintJobAction(printerName, jobId, 'pause', this);
+
+  Future<bool> resumePrintJob(int jobId) => PrintingFfi.instance._sendPrintJobAction(printerName, jobId, 'resume', this);
+
+  Future<bool> cancelPrintJob(int jobId) => PrintingFfi.instance._sendPrintJobAction(printerName, jobId, 'cancel', this);
+
+  Future<PrintJobPage> listPrintJobsPage({
+    int firstIndex = 0,
+    int limit = 50,
+    PrintJobFilter which = PrintJobFilter.active,
+    bool myJobs = false,
+    Set<PrintJobField> fields = const {PrintJobField.title, PrintJobField.state},
+  }) => PrintingFfi.instance._listPrintJobsPage(printerName, firstIndex, limit, which, myJobs, fields, this);
+
+  Future<int> cancelPrintJobs(List<int> jobIds) => PrintingFfi.instance._sendBulkJobAction(printerName, 'cancel', jobIds: jobIds, session: this);
+
+  Future<int> holdPrintJobs(List<int> jobIds) => PrintingFfi.instance._sendBulkJobAction(printerName, 'hold', jobIds: jobIds, session: this);
+
+  Future<int> releasePrintJobs(List<int> jobIds) => PrintingFfi.instance._sendBulkJobAction(printerName, 'release', jobIds: jobIds, session: this);
+
+  Future<bool> cancelAllPrintJobs({CancelJobsScope scope = CancelJobsScope.allJobs}) async {
+    return await PrintingFfi.instance._sendBulkJobAction(printerName, 'cancel-all', scope: scope, session: this) != 0;
+  }
+
+  /// Releases the native handle once the requests already made on this
+  /// session have completed. Further calls on this session throw a
+  /// [StateError]. The returned future completes when the handle is released.
+  Future<void> close() {
+    if (_closing != null) return _closing!.future;
+    final closing = _closing = Completer<void>();
+    if (_pending == 0) _closeHandle();
+    return closing.future;
+  }
+}
+
 // Helper classes for isolate communication
 
 class _PrintRequest {
@@ -689,8 +1476,9 @@ class _PrintRequest {
 class _PrintJobsRequest {
   final int id;
   final String printerName;
+  final int handleAddress;
 
-  const _PrintJobsRequest(this.id, this.printerName);
+  const _PrintJobsRequest(this.id, this.printerName, [this.handleAddress = 0]);
 }
 
 class _PrintJobActionRequest {
@@ -698,8 +1486,33 @@ class _PrintJobActionRequest {
   final String printerName;
   final int jobId;
   final String action;
+  final int handleAddress;
+
+  const _PrintJobActionRequest(this.id, this.printerName, this.jobId, this.action, [this.handleAddress = 0]);
+}
+
+class _PrintJobsPageRequest {
+  final int id;
+  final String printerName;
+  final int firstIndex;
+  final int limit;
+  final int whichJobs;
+  final bool myJobs;
+  final int attributes;
+  final int handleAddress;
+
+  const _PrintJobsPageRequest(this.id, this.printerName, this.firstIndex, this.limit, this.whichJobs, this.myJobs, this.attributes, this.handleAddress);
+}
+
+class _BulkJobActionRequest {
+  final int id;
+  final String printerName;
+  final String action;
+  final List<int> jobIds;
+  final CancelJobsScope scope;
+  final int handleAddress;
 
-  const _PrintJobActionRequest(this.id, this.printerName, this.jobId, this.action);
+  const _BulkJobActionRequest(this.id, this.printerName, this.action, this.jobIds, this.scope, this.handleAddress);
 }
 
 class _PrintPdfRequest {
@@ -723,6 +1536,14 @@ class _GetCupsOptionsRequest {
   const _GetCupsOptionsRequest(this.id, this.printerName);
 }
 
+class _ValidateOptionsRequest {
+  final int id;
+  final String printerName;
+  final Map<String, String> options;
+
+  const _ValidateOptionsRequest(this.id, this.printerName, this.options);
+}
+
 class _GetWindowsCapsRequest {
   final int id;
   final String printerName;
@@ -730,6 +1551,20 @@ class _GetWindowsCapsRequest {
   const _GetWindowsCapsRequest(this.id, this.printerName);
 }
 
+class _GetCapabilitySnapshotRequest {
+  final int id;
+  final String printerName;
+
+  const _GetCapabilitySnapshotRequest(this.id, this.printerName);
+}
+
+class _GetPrinterStatusesRequest {
+  final int id;
+  final List<String> printerNames;
+
+  const _GetPrinterStatusesRequest(this.id, this.printerNames);
+}
+
 class _OpenPrinterPropertiesRequest {
   final int id;
   final String printerName;
@@ -783,6 +1618,20 @@ class _PrintJobActionResponse {
   const _PrintJobActionResponse(this.id, this.result);
 }
 
+class _PrintJobsPageResponse {
+  final int id;
+  final PrintJobPage page;
+
+  const _PrintJobsPageResponse(this.id, this.page);
+}
+
+class _BulkJobActionResponse {
+  final int id;
+  final int count;
+
+  const _BulkJobActionResponse(this.id, this.count);
+}
+
 class _PrintPdfResponse {
   final int id;
   final bool result;
@@ -797,6 +1646,13 @@ class _GetCupsOptionsResponse {
   const _GetCupsOptionsResponse(this.id, this.options);
 }
 
+class _ValidateOptionsResponse {
+  final int id;
+  final OptionValidationResult result;
+
+  const _ValidateOptionsResponse(this.id, this.result);
+}
+
 class _GetWindowsCapsResponse {
   final int id;
   final WindowsPrinterCapabilitiesModel? capabilities;
@@ -804,6 +1660,20 @@ class _GetWindowsCapsResponse {
   const _GetWindowsCapsResponse(this.id, this.capabilities);
 }
 
+class _GetCapabilitySnapshotResponse {
+  final int id;
+  final TransferableTypedData? bytes;
+
+  const _GetCapabilitySnapshotResponse(this.id, this.bytes);
+}
+
+class _GetPrinterStatusesResponse {
+  final int id;
+  final List<PrinterStatusReport> statuses;
+
+  const _GetPrinterStatusesResponse(this.id, this.statuses);
+}
+
 class _OpenPrinterPropertiesResponse {
   final int id;
   final PrinterPropertiesResult result;
@@ -811,11 +1681,34 @@ class _OpenPrinterPropertiesResponse {
   const _OpenPrinterPropertiesResponse(this.id, this.result);
 }
 
-class _SubmitJobResponse {
+class _ClosePrinterHandleRequest {
+  final int id;
+  final int handleAddress;
+
+  const _ClosePrinterHandleRequest(this.id, this.handleAddress);
+}
+
+class _ClosePrinterHandleResponse {
   final int id;
+
+  const _ClosePrinterHandleResponse(this.id);
+}
+
+class _SubmittedJob {
   final int jobId;
 
-  const _SubmitJobResponse(this.id, this.jobId);
+  /// The printer that took the job, which is a fallback printer if admission
+  /// control rerouted it.
+  final String printerName;
+
+  const _SubmittedJob(this.jobId, this.printerName);
+}
+
+class _SubmitJobResponse {
+  final int id;
+  final _SubmittedJob job;
+
+  const _SubmitJobResponse(this.id, this.job);
 }
 
 class _ErrorResponse {
@@ -826,6 +1719,43 @@ class _ErrorResponse {
   const _ErrorResponse(this.id, this.error, this.stackTrace);
 }
 
+/// The exception for a print or submit call that failed, from the native last
+/// error of this thread.
+PrintingFfiException _printError(PrintingFfiBindings bindings, String printerName) {
+  final message = bindings.get_last_error().cast<Utf8>().toDartString();
+  return switch (bindings.get_last_error_code()) {
+    PRINTING_ERROR_PRINTER_STOPPED => PrinterUnavailableException(printerName, PrinterUnavailableReason.stopped, message),
+    PRINTING_ERROR_NOT_ACCEPTING_JOBS => PrinterUnavailableException(printerName, PrinterUnavailableReason.notAcceptingJobs, message),
+    _ => PrintingFfiException(message),
+  };
+}
+
+/// The printer that took the job just submitted on this thread.
+String _jobPrinterName(PrintingFfiBindings bindings, String printerName) {
+  final rerouted = bindings.get_last_rerouted_printer();
+  return rerouted == nullptr ? printerName : rerouted.cast<Utf8>().toDartString();
+}
+
+PrinterStatusReport _printerStatusFromNative(PrinterStatus status) {
+  final name = status.name.cast<Utf8>().toDartString();
+  if (!status.found) {
+    return PrinterStatusReport(name: name, found: false);
+  }
+  final reasons = status.state_reasons == nullptr ? 'none' : status.state_reasons.cast<Utf8>().toDartString();
+  return PrinterStatusReport(
+    name: name,
+    found: true,
+    state: status.state,
+    stateReasons: reasons == 'none' ? const [] : reasons.split(','),
+    isAcceptingJobs: status.is_accepting_jobs,
+    queuedJobCount: status.queued_job_count,
+    supplies: [
+      for (var i = 0; i < status.supply_count; i++)
+        PrinterSupply(name: status.supplies[i].name.cast<Utf8>().toDartString(), level: status.supplies[i].level),
+    ],
+  );
+}
+
 /// The entry point for the helper isolate.
 void _helperIsolateEntryPoint(SendPort sendPort) {
   runZonedGuarded(
@@ -864,7 +1794,6 @@ void _helperIsolateEntryPoint(SendPort sendPort) {
       }();
 
       final bindings = PrintingFfiBindings(dylib);
-      final getLastError = dylib.lookup<NativeFunction<Pointer<Utf8> Function()>>('get_last_error').asFunction<Pointer<Utf8> Function()>();
 
       final helperReceivePort = ReceivePort()
         ..listen((dynamic data) {
@@ -876,49 +1805,6 @@ void _helperIsolateEntryPoint(SendPort sendPort) {
               dataPtr.asTypedList(data.data.length).setAll(0, data.data);
               try {
                 final options = {...?data.options};
-                if (Platform.isWindows) {
-                  // No option remapping is needed for Windows.
-                  // The C code parses these options directly.
-                } else if (Platform.isMacOS || Platform.isLinux) {
-                  if (options.containsKey('orientation')) {
-                    final orientationValue = options.remove('orientation');
-                    options['orientation-requested'] = orientationValue == 'landscape' ? '4' : '3';
-                  }
-                  if (options.containsKey('color-mode')) {
-                    final colorValue = options.remove('color-mode');
-                    options['print-color-mode'] = colorValue!;
-                  }
-                  if (options.containsKey('print-quality')) {
-                    final qualityValue = options.remove('print-quality');
-                    switch (qualityValue) {
-                      case 'draft':
-                      case 'low':
-                        options['print-quality'] = '3';
-                        break;
-                      case 'normal':
-                        options['print-quality'] = '4';
-                        break;
-                      case 'high':
-                        options['print-quality'] = '5';
-                        break;
-                    }
-                  }
-
-                  if (options.containsKey('duplex')) {
-                    final duplexValue = options.remove('duplex');
-                    switch (duplexValue) {
-                      case 'singleSided':
-                        options['sides'] = 'one-sided';
-                        break;
-                      case 'duplexLongEdge':
-                        options['sides'] = 'two-sided-long-edge';
-                        break;
-                      case 'duplexShortEdge':
-                        options['sides'] = 'two-sided-short-edge';
-                        break;
-                    }
-                  }
-                }
                 final int numOptions = options.length;
                 Pointer<Pointer<Utf8>> keysPtr = nullptr;
                 Pointer<Pointer<Utf8>> valuesPtr = nullptr;
@@ -947,8 +1833,7 @@ void _helperIsolateEntryPoint(SendPort sendPort) {
                   if (result) {
                     sendPort.send(_PrintResponse(data.id, true));
                   } else {
-                    final errorMsg = getLastError().toDartString();
-                    sendPort.send(_ErrorResponse(data.id, PrintingFfiException(errorMsg), StackTrace.current));
+                    sendPort.send(_ErrorResponse(data.id, _printError(bindings, data.printerName), StackTrace.current));
                   }
                 } finally {
                   if (numOptions > 0) {
@@ -972,7 +1857,7 @@ void _helperIsolateEntryPoint(SendPort sendPort) {
             try {
               final namePtr = data.printerName.toNativeUtf8();
               try {
-                final jobListPtr = bindings.get_print_jobs(namePtr.cast());
+                final jobListPtr = data.handleAddress != 0 ? bindings.get_print_jobs_h(Pointer<PrinterHandle>.fromAddress(data.handleAddress)) : bindings.get_print_jobs(namePtr.cast());
                 final jobs = <PrintJob>[];
                 if (jobListPtr != nullptr) {
                   try {
@@ -1003,7 +1888,16 @@ void _helperIsolateEntryPoint(SendPort sendPort) {
               final namePtr = data.printerName.toNativeUtf8();
               try {
                 bool result = false;
-                if (data.action == 'pause') {
+                if (data.handleAddress != 0) {
+                  final handle = Pointer<PrinterHandle>.fromAddress(data.handleAddress);
+                  if (data.action == 'pause') {
+                    result = bindings.pause_print_job_h(handle, data.jobId);
+                  } else if (data.action == 'resume') {
+                    result = bindings.resume_print_job_h(handle, data.jobId);
+                  } else if (data.action == 'cancel') {
+                    result = bindings.cancel_print_job_h(handle, data.jobId);
+                  }
+                } else if (data.action == 'pause') {
                   result = bindings.pause_print_job(namePtr.cast(), data.jobId);
                 } else if (data.action == 'resume') {
                   result = bindings.resume_print_job(namePtr.cast(), data.jobId);
@@ -1017,6 +1911,78 @@ void _helperIsolateEntryPoint(SendPort sendPort) {
             } catch (e, s) {
               sendPort.send(_ErrorResponse(data.id, e, s));
             }
+          } else if (data is _PrintJobsPageRequest) {
+            try {
+              final namePtr = data.printerName.toNativeUtf8();
+              try {
+                final pagePtr = data.handleAddress != 0
+                    ? bindings.get_print_jobs_paged_h(Pointer<PrinterHandle>.fromAddress(data.handleAddress), data.firstIndex, data.limit, data.whichJobs, data.myJobs, data.attributes)
+                    : bindings.get_print_jobs_paged(namePtr.cast(), data.firstIndex, data.limit, data.whichJobs, data.myJobs, data.attributes);
+                if (pagePtr == nullptr) {
+                  throw PrintingFfiException(bindings.get_last_error().cast<Utf8>().toDartString());
+                }
+                try {
+                  final page = pagePtr.ref;
+                  DateTime? toTime(int seconds) => seconds > 0 ? DateTime.fromMillisecondsSinceEpoch(seconds * 1000) : null;
+                  final hasTimes = data.attributes & JOB_ATTR_TIMES != 0;
+                  final jobs = <PrintJob>[];
+                  for (var i = 0; i < page.count; i++) {
+                    final entry = page.jobs[i];
+                    jobs.add(
+                      PrintJob(
+                        entry.id,
+                        entry.title == nullptr ? '' : entry.title.cast<Utf8>().toDartString(),
+                        entry.state,
+                        user: entry.user == nullptr ? null : entry.user.cast<Utf8>().toDartString(),
+                        sizeKb: data.attributes & JOB_ATTR_SIZE != 0 ? entry.size_kb : null,
+                        pagesCompleted: data.attributes & JOB_ATTR_PAGES != 0 ? entry.pages_completed : null,
+                        createdAt: hasTimes ? toTime(entry.created_at) : null,
+                        processingAt: hasTimes ? toTime(entry.processing_at) : null,
+                        completedAt: hasTimes ? toTime(entry.completed_at) : null,
+                      ),
+                    );
+                  }
+                  sendPort.send(_PrintJobsPageResponse(data.id, PrintJobPage(jobs: jobs, hasMore: page.has_more)));
+                } finally {
+                  bindings.free_job_page(pagePtr);
+                }
+              } finally {
+                malloc.free(namePtr);
+              }
+            } catch (e, s) {
+              sendPort.send(_ErrorResponse(data.id, e, s));
+            }
+          } else if (data is _BulkJobActionRequest) {
+            try {
+              final namePtr = data.printerName.toNativeUtf8();
+              final idsPtr = malloc<Uint32>(data.jobIds.isEmpty ? 1 : data.jobIds.length);
+              try {
+                for (var i = 0; i < data.jobIds.length; i++) {
+                  idsPtr[i] = data.jobIds[i];
+                }
+                final handle = Pointer<PrinterHandle>.fromAddress(data.handleAddress);
+                final useHandle = data.handleAddress != 0;
+                final count = data.jobIds.length;
+                final scope = switch (data.scope) {
+                  CancelJobsScope.allJobs => CANCEL_SCOPE_ALL_JOBS,
+                  CancelJobsScope.myJobs => CANCEL_SCOPE_MY_JOBS,
+                  CancelJobsScope.purge => CANCEL_SCOPE_PURGE,
+                };
+                final int result = switch (data.action) {
+                  'cancel' => useHandle ? bindings.cancel_jobs_h(handle, idsPtr, count) : bindings.cancel_jobs(namePtr.cast(), idsPtr, count),
+                  'hold' => useHandle ? bindings.hold_jobs_h(handle, idsPtr, count) : bindings.hold_jobs(namePtr.cast(), idsPtr, count),
+                  'release' => useHandle ? bindings.release_jobs_h(handle, idsPtr, count) : bindings.release_jobs(namePtr.cast(), idsPtr, count),
+                  'cancel-all' => (useHandle ? bindings.cancel_all_jobs_h(handle, scope) : bindings.cancel_all_jobs(namePtr.cast(), scope)) ? 1 : 0,
+                  _ => 0,
+                };
+                sendPort.send(_BulkJobActionResponse(data.id, result));
+              } finally {
+                malloc.free(namePtr);
+                malloc.free(idsPtr);
+              }
+            } catch (e, s) {
+              sendPort.send(_ErrorResponse(data.id, e, s));
+            }
           } else if (data is _GetCupsOptionsRequest) {
             try {
               final namePtr = data.printerName.toNativeUtf8();
@@ -1058,6 +2024,33 @@ void _helperIsolateEntryPoint(SendPort sendPort) {
             } catch (e, s) {
               sendPort.send(_ErrorResponse(data.id, e, s));
             }
+          } else if (data is _ValidateOptionsRequest) {
+            try {
+              final result = using((arena) {
+                final entries = data.options.entries.toList();
+                final keys = arena<Pointer<Char>>(entries.isEmpty ? 1 : entries.length);
+                final values = arena<Pointer<Char>>(entries.isEmpty ? 1 : entries.length);
+                for (var i = 0; i < entries.length; i++) {
+                  keys[i] = entries[i].key.toNativeUtf8(allocator: arena).cast<Char>();
+                  values[i] = entries[i].value.toNativeUtf8(allocator: arena).cast<Char>();
+                }
+                final code = bindings.validate_options(data.printerName.toNativeUtf8(allocator: arena).cast<Char>(), entries.length, keys, values);
+                String lastError() => bindings.get_last_error().cast<Utf8>().toDartString();
+                switch (code) {
+                  case OPTION_VALIDATION_OK:
+                    return OptionValidationResult(status: OptionValidationStatus.valid);
+                  case OPTION_VALIDATION_UNSUPPORTED:
+                    return OptionValidationResult(status: OptionValidationStatus.unsupported, message: lastError());
+                  case OPTION_VALIDATION_CONFLICT:
+                    return OptionValidationResult(status: OptionValidationStatus.conflict, message: lastError());
+                  default:
+                    throw PrintingFfiException(lastError());
+                }
+              });
+              sendPort.send(_ValidateOptionsResponse(data.id, result));
+            } catch (e, s) {
+              sendPort.send(_ErrorResponse(data.id, e, s));
+            }
           } else if (data is _GetWindowsCapsRequest) {
             try {
               final namePtr = data.printerName.toNativeUtf8();
@@ -1129,6 +2122,61 @@ void _helperIsolateEntryPoint(SendPort sendPort) {
             } catch (e, s) {
               sendPort.send(_ErrorResponse(data.id, e, s));
             }
+          } else if (data is _GetCapabilitySnapshotRequest) {
+            try {
+              final namePtr = data.printerName.toNativeUtf8();
+              try {
+                final snapshotPtr = bindings.get_capability_snapshot(namePtr.cast());
+                if (snapshotPtr == nullptr) {
+                  sendPort.send(_GetCapabilitySnapshotResponse(data.id, null));
+                } else {
+                  try {
+                    // One copy into a transferable buffer; the main isolate
+                    // receives it without another copy and decodes lazily.
+                    final snapshot = snapshotPtr.ref;
+                    final bytes = TransferableTypedData.fromList([snapshot.data.asTypedList(snapshot.size)]);
+                    sendPort.send(_GetCapabilitySnapshotResponse(data.id, bytes));
+                  } finally {
+                    bindings.free_capability_snapshot(snapshotPtr);
+                  }
+                }
+              } finally {
+                malloc.free(namePtr);
+              }
+            } catch (e, s) {
+              sendPort.send(_ErrorResponse(data.id, e, s));
+            }
+          } else if (data is _ClosePrinterHandleRequest) {
+            try {
+              bindings.close_printer_handle(Pointer<PrinterHandle>.fromAddress(data.handleAddress));
+              sendPort.send(_ClosePrinterHandleResponse(data.id));
+            } catch (e, s) {
+              sendPort.send(_ErrorResponse(data.id, e, s));
+            }
+          } else if (data is _GetPrinterStatusesRequest) {
+            try {
+              final statuses = using((arena) {
+                final names = arena<Pointer<Char>>(data.printerNames.isEmpty ? 1 : data.printerNames.length);
+                for (var i = 0; i < data.printerNames.length; i++) {
+                  names[i] = data.printerNames[i].toNativeUtf8(allocator: arena).cast<Char>();
+                }
+                final listPtr = bindings.get_printer_statuses(names, data.printerNames.length);
+                if (listPtr == nullptr) {
+                  throw PrintingFfiException(bindings.get_last_error().cast<Utf8>().toDartString());
+                }
+                try {
+                  final list = listPtr.ref;
+                  return [
+                    for (var i = 0; i < list.count; i++) _printerStatusFromNative(list.statuses[i]),
+                  ];
+                } finally {
+                  bindings.free_printer_status_list(listPtr);
+                }
+              });
+              sendPort.send(_GetPrinterStatusesResponse(data.id, statuses));
+            } catch (e, s) {
+              sendPort.send(_ErrorResponse(data.id, e, s));
+            }
           } else if (data is _OpenPrinterPropertiesRequest) {
             try {
               final namePtr = data.printerName.toNativeUtf8();
@@ -1159,50 +2207,10 @@ void _helperIsolateEntryPoint(SendPort sendPort) {
                 if (data.scaling is PdfPrintScalingCustom) {
                   options['custom-scale-factor'] = (data.scaling as PdfPrintScalingCustom).scale.toString();
                 }
-                if (Platform.isWindows) {
-                  // No option remapping is needed for Windows.
-                }
+                // Generic options are normalized by the native library on every platform.
                 if (Platform.isMacOS || Platform.isLinux) {
                   if (data.copies > 1) options['copies'] = data.copies.toString();
                   if (pageRangeValue != null && pageRangeValue.isNotEmpty) options['page-ranges'] = pageRangeValue;
-                  if (options.containsKey('orientation')) {
-                    final orientationValue = options.remove('orientation');
-                    options['orientation-requested'] = orientationValue == 'landscape' ? '4' : '3';
-                  }
-                  if (options.containsKey('color-mode')) {
-                    final colorValue = options.remove('color-mode');
-                    options['print-color-mode'] = colorValue!;
-                  }
-                  if (options.containsKey('print-quality')) {
-                    final qualityValue = options.remove('print-quality');
-                    switch (qualityValue) {
-                      case 'draft':
-                      case 'low':
-                        options['print-quality'] = '3';
-                        break;
-                      case 'normal':
-                        options['print-quality'] = '4';
-                        break;
-                      case 'high':
-                        options['print-quality'] = '5';
-                        break;
-                    }
-                  }
-
-                  if (options.containsKey('duplex')) {
-                    final duplexValue = options.remove('duplex');
-                    switch (duplexValue) {
-                      case 'singleSided':
-                        options['sides'] = 'one-sided';
-                        break;
-                      case 'duplexLongEdge':
-                        options['sides'] = 'two-sided-long-edge';
-                        break;
-                      case 'duplexShortEdge':
-                        options['sides'] = 'two-sided-short-edge';
-                        break;
-                    }
-                  }
                 }
 
                 final int numOptions = options.length;
@@ -1235,8 +2243,7 @@ void _helperIsolateEntryPoint(SendPort sendPort) {
                 if (result) {
                   sendPort.send(_PrintPdfResponse(data.id, true));
                 } else {
-                  final errorMsg = getLastError().toDartString();
-                  sendPort.send(_ErrorResponse(data.id, PrintingFfiException(errorMsg), StackTrace.current));
+                  sendPort.send(_ErrorResponse(data.id, _printError(bindings, data.printerName), StackTrace.current));
                 }
 
                 if (numOptions > 0) {
@@ -1265,49 +2272,6 @@ void _helperIsolateEntryPoint(SendPort sendPort) {
               dataPtr.asTypedList(data.data.length).setAll(0, data.data);
               try {
                 final options = {...?data.options};
-                if (Platform.isWindows) {
-                  // No option remapping is needed for Windows.
-                  // The C code parses these options directly.
-                } else if (Platform.isMacOS || Platform.isLinux) {
-                  if (options.containsKey('orientation')) {
-                    final orientationValue = options.remove('orientation');
-                    options['orientation-requested'] = orientationValue == 'landscape' ? '4' : '3';
-                  }
-                  if (options.containsKey('color-mode')) {
-                    final colorValue = options.remove('color-mode');
-                    options['print-color-mode'] = colorValue!;
-                  }
-                  if (options.containsKey('print-quality')) {
-                    final qualityValue = options.remove('print-quality');
-                    switch (qualityValue) {
-                      case 'draft':
-                      case 'low':
-                        options['print-quality'] = '3';
-                        break;
-                      case 'normal':
-                        options['print-quality'] = '4';
-                        break;
-                      case 'high':
-                        options['print-quality'] = '5';
-                        break;
-                    }
-                  }
-
-                  if (options.containsKey('duplex')) {
-                    final duplexValue = options.remove('duplex');
-                    switch (duplexValue) {
-                      case 'singleSided':
-                        options['sides'] = 'one-sided';
-                        break;
-                      case 'duplexLongEdge':
-                        options['sides'] = 'two-sided-long-edge';
-                        break;
-                      case 'duplexShortEdge':
-                        options['sides'] = 'two-sided-short-edge';
-                        break;
-                    }
-                  }
-                }
                 final int numOptions = options.length;
                 Pointer<Pointer<Utf8>> keysPtr = nullptr;
                 Pointer<Pointer<Utf8>> valuesPtr = nullptr;
@@ -1334,10 +2298,9 @@ void _helperIsolateEntryPoint(SendPort sendPort) {
                     valuesPtr.cast(),
                   );
                   if (jobId > 0) {
-                    sendPort.send(_SubmitJobResponse(data.id, jobId));
+                    sendPort.send(_SubmitJobResponse(data.id, _SubmittedJob(jobId, _jobPrinterName(bindings, data.printerName))));
                   } else {
-                    final errorMsg = getLastError().toDartString();
-                    sendPort.send(_ErrorResponse(data.id, PrintingFfiException(errorMsg), StackTrace.current));
+                    sendPort.send(_ErrorResponse(data.id, _printError(bindings, data.printerName), StackTrace.current));
                   }
                 } finally {
                   if (numOptions > 0) {
@@ -1370,50 +2333,10 @@ void _helperIsolateEntryPoint(SendPort sendPort) {
                 if (data.scaling is PdfPrintScalingCustom) {
                   options['custom-scale-factor'] = (data.scaling as PdfPrintScalingCustom).scale.toString();
                 }
-                if (Platform.isWindows) {
-                  // No option remapping is needed for Windows.
-                }
+                // Generic options are normalized by the native library on every platform.
                 if (Platform.isMacOS || Platform.isLinux) {
                   if (data.copies > 1) options['copies'] = data.copies.toString();
                   if (pageRangeValue != null && pageRangeValue.isNotEmpty) options['page-ranges'] = pageRangeValue;
-                  if (options.containsKey('orientation')) {
-                    final orientationValue = options.remove('orientation');
-                    options['orientation-requested'] = orientationValue == 'landscape' ? '4' : '3';
-                  }
-                  if (options.containsKey('color-mode')) {
-                    final colorValue = options.remove('color-mode');
-                    options['print-color-mode'] = colorValue!;
-                  }
-                  if (options.containsKey('print-quality')) {
-                    final qualityValue = options.remove('print-quality');
-                    switch (qualityValue) {
-                      case 'draft':
-                      case 'low':
-                        options['print-quality'] = '3';
-                        break;
-                      case 'normal':
-                        options['print-quality'] = '4';
-                        break;
-                      case 'high':
-                        options['print-quality'] = '5';
-                        break;
-                    }
-                  }
-
-                  if (options.containsKey('duplex')) {
-                    final duplexValue = options.remove('duplex');
-                    switch (duplexValue) {
-                      case 'singleSided':
-                        options['sides'] = 'one-sided';
-                        break;
-                      case 'duplexLongEdge':
-                        options['sides'] = 'two-sided-long-edge';
-                        break;
-                      case 'duplexShortEdge':
-                        options['sides'] = 'two-sided-short-edge';
-                        break;
-                    }
-                  }
                 }
 
                 final int numOptions = options.length;
@@ -1444,10 +2367,9 @@ void _helperIsolateEntryPoint(SendPort sendPort) {
                   alignmentPtr.cast(),
                 );
                 if (jobId > 0) {
-                  sendPort.send(_SubmitJobResponse(data.id, jobId));
+                  sendPort.send(_SubmitJobResponse(data.id, _SubmittedJob(jobId, _jobPrinterName(bindings, data.printerName))));
                 } else {
-                  final errorMsg = getLastError().toDartString();
-                  sendPort.send(_ErrorResponse(data.id, PrintingFfiException(errorMsg), StackTrace.current));
+                  sendPort.send(_ErrorResponse(data.id, _printError(bindings, data.printerName), StackTrace.current));
                 }
 
                 if (numOptions > 0) {
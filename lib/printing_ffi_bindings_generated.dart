@@ -66,6 +66,35 @@ class PrintingFfiBindings {
   late final _register_log_callbackPtr = _lookup<ffi.NativeFunction<ffi.Void Function(log_callback_t)>>('register_log_callback');
   late final _register_log_callback = _register_log_callbackPtr.asFunction<void Function(log_callback_t)>();
 
+  void register_log_batch_callback(
+    log_batch_callback_t callback,
+  ) {
+    return _register_log_batch_callback(
+      callback,
+    );
+  }
+
+  late final _register_log_batch_callbackPtr = _lookup<ffi.NativeFunction<ffi.Void Function(log_batch_callback_t)>>('register_log_batch_callback');
+  late final _register_log_batch_callback = _register_log_batch_callbackPtr.asFunction<void Function(log_batch_callback_t)>();
+
+  void set_log_level(
+    int level,
+  ) {
+    return _set_log_level(
+      level,
+    );
+  }
+
+  late final _set_log_levelPtr = _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Int)>>('set_log_level');
+  late final _set_log_level = _set_log_levelPtr.asFunction<void Function(int)>();
+
+  int get_log_level() {
+    return _get_log_level();
+  }
+
+  late final _get_log_levelPtr = _lookup<ffi.NativeFunction<ffi.Int Function()>>('get_log_level');
+  late final _get_log_level = _get_log_levelPtr.asFunction<int Function()>();
+
   void free_printer_list(
     ffi.Pointer<PrinterList> printer_list,
   ) {
@@ -95,6 +124,64 @@ class PrintingFfiBindings {
   late final _free_printer_infoPtr = _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<PrinterInfo>)>>('free_printer_info');
   late final _free_printer_info = _free_printer_infoPtr.asFunction<void Function(ffi.Pointer<PrinterInfo>)>();
 
+  ffi.Pointer<PrinterChangeList> get_printer_changes(
+    int since_generation,
+  ) {
+    return _get_printer_changes(
+      since_generation,
+    );
+  }
+
+  late final _get_printer_changesPtr = _lookup<ffi.NativeFunction<ffi.Pointer<PrinterChangeList> Function(ffi.Uint64)>>('get_printer_changes');
+  late final _get_printer_changes = _get_printer_changesPtr.asFunction<ffi.Pointer<PrinterChangeList> Function(int)>();
+
+  void free_printer_change_list(
+    ffi.Pointer<PrinterChangeList> change_list,
+  ) {
+    return _free_printer_change_list(
+      change_list,
+    );
+  }
+
+  late final _free_printer_change_listPtr = _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<PrinterChangeList>)>>('free_printer_change_list');
+  late final _free_printer_change_list = _free_printer_change_listPtr.asFunction<void Function(ffi.Pointer<PrinterChangeList>)>();
+
+  void invalidate_printer_caches() {
+    return _invalidate_printer_caches();
+  }
+
+  late final _invalidate_printer_cachesPtr = _lookup<ffi.NativeFunction<ffi.Void Function()>>('invalidate_printer_caches');
+  late final _invalidate_printer_caches = _invalidate_printer_cachesPtr.asFunction<void Function()>();
+
+  bool open_shared_printer_snapshot(
+    ffi.Pointer<ffi.Char> name,
+  ) {
+    return _open_shared_printer_snapshot(
+      name,
+    );
+  }
+
+  late final _open_shared_printer_snapshotPtr = _lookup<ffi.NativeFunction<ffi.Bool Function(ffi.Pointer<ffi.Char>)>>('open_shared_printer_snapshot');
+  late final _open_shared_printer_snapshot = _open_shared_printer_snapshotPtr.asFunction<bool Function(ffi.Pointer<ffi.Char>)>();
+
+  void close_shared_printer_snapshot() {
+    return _close_shared_printer_snapshot();
+  }
+
+  late final _close_shared_printer_snapshotPtr = _lookup<ffi.NativeFunction<ffi.Void Function()>>('close_shared_printer_snapshot');
+  late final _close_shared_printer_snapshot = _close_shared_printer_snapshotPtr.asFunction<void Function()>();
+
+  ffi.Pointer<PrinterList> get_printers_shared(
+    int max_age_ms,
+  ) {
+    return _get_printers_shared(
+      max_age_ms,
+    );
+  }
+
+  late final _get_printers_sharedPtr = _lookup<ffi.NativeFunction<ffi.Pointer<PrinterList> Function(ffi.Uint32)>>('get_printers_shared');
+  late final _get_printers_shared = _get_printers_sharedPtr.asFunction<ffi.Pointer<PrinterList> Function(int)>();
+
   int open_printer_properties(
     ffi.Pointer<ffi.Char> printer_name,
     int hwnd,
@@ -188,6 +275,63 @@ class PrintingFfiBindings {
   late final _free_job_listPtr = _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<JobList>)>>('free_job_list');
   late final _free_job_list = _free_job_listPtr.asFunction<void Function(ffi.Pointer<JobList>)>();
 
+  ffi.Pointer<PrinterStatusList> get_printer_statuses(
+    ffi.Pointer<ffi.Pointer<ffi.Char>> printer_names,
+    int count,
+  ) {
+    return _get_printer_statuses(
+      printer_names,
+      count,
+    );
+  }
+
+  late final _get_printer_statusesPtr = _lookup<ffi.NativeFunction<ffi.Pointer<PrinterStatusList> Function(ffi.Pointer<ffi.Pointer<ffi.Char>>, ffi.Int)>>('get_printer_statuses');
+  late final _get_printer_statuses = _get_printer_statusesPtr.asFunction<ffi.Pointer<PrinterStatusList> Function(ffi.Pointer<ffi.Pointer<ffi.Char>>, int)>();
+
+  void free_printer_status_list(
+    ffi.Pointer<PrinterStatusList> list,
+  ) {
+    return _free_printer_status_list(
+      list,
+    );
+  }
+
+  late final _free_printer_status_listPtr = _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<PrinterStatusList>)>>('free_printer_status_list');
+  late final _free_printer_status_list = _free_printer_status_listPtr.asFunction<void Function(ffi.Pointer<PrinterStatusList>)>();
+
+  ffi.Pointer<PrinterHandle> open_printer_handle(
+    ffi.Pointer<ffi.Char> printer_name,
+  ) {
+    return _open_printer_handle(
+      printer_name,
+    );
+  }
+
+  late final _open_printer_handlePtr = _lookup<ffi.NativeFunction<ffi.Pointer<PrinterHandle> Function(ffi.Pointer<ffi.Char>)>>('open_printer_handle');
+  late final _open_printer_handle = _open_printer_handlePtr.asFunction<ffi.Pointer<PrinterHandle> Function(ffi.Pointer<ffi.Char>)>();
+
+  void close_printer_handle(
+    ffi.Pointer<PrinterHandle> handle,
+  ) {
+    return _close_printer_handle(
+      handle,
+    );
+  }
+
+  late final _close_printer_handlePtr = _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<PrinterHandle>)>>('close_printer_handle');
+  late final _close_printer_handle = _close_printer_handlePtr.asFunction<void Function(ffi.Pointer<PrinterHandle>)>();
+
+  ffi.Pointer<JobList> get_print_jobs_h(
+    ffi.Pointer<PrinterHandle> handle,
+  ) {
+    return _get_print_jobs_h(
+      handle,
+    );
+  }
+
+  late final _get_print_jobs_hPtr = _lookup<ffi.NativeFunction<ffi.Pointer<JobList> Function(ffi.Pointer<PrinterHandle>)>>('get_print_jobs_h');
+  late final _get_print_jobs_h = _get_print_jobs_hPtr.asFunction<ffi.Pointer<JobList> Function(ffi.Pointer<PrinterHandle>)>();
+
   bool pause_print_job(
     ffi.Pointer<ffi.Char> printer_name,
     int job_id,
@@ -227,6 +371,333 @@ class PrintingFfiBindings {
   late final _cancel_print_jobPtr = _lookup<ffi.NativeFunction<ffi.Bool Function(ffi.Pointer<ffi.Char>, ffi.Uint32)>>('cancel_print_job');
   late final _cancel_print_job = _cancel_print_jobPtr.asFunction<bool Function(ffi.Pointer<ffi.Char>, int)>();
 
+  bool pause_print_job_h(
+    ffi.Pointer<PrinterHandle> handle,
+    int job_id,
+  ) {
+    return _pause_print_job_h(
+      handle,
+      job_id,
+    );
+  }
+
+  late final _pause_print_job_hPtr = _lookup<ffi.NativeFunction<ffi.Bool Function(ffi.Pointer<PrinterHandle>, ffi.Uint32)>>('pause_print_job_h');
+  late final _pause_print_job_h = _pause_print_job_hPtr.asFunction<bool Function(ffi.Pointer<PrinterHandle>, int)>();
+
+  bool resume_print_job_h(
+    ffi.Pointer<PrinterHandle> handle,
+    int job_id,
+  ) {
+    return _resume_print_job_h(
+      handle,
+      job_id,
+    );
+  }
+
+  late final _resume_print_job_hPtr = _lookup<ffi.NativeFunction<ffi.Bool Function(ffi.Pointer<PrinterHandle>, ffi.Uint32)>>('resume_print_job_h');
+  late final _resume_print_job_h = _resume_print_job_hPtr.asFunction<bool Function(ffi.Pointer<PrinterHandle>, int)>();
+
+  bool cancel_print_job_h(
+    ffi.Pointer<PrinterHandle> handle,
+    int job_id,
+  ) {
+    return _cancel_print_job_h(
+      handle,
+      job_id,
+    );
+  }
+
+  late final _cancel_print_job_hPtr = _lookup<ffi.NativeFunction<ffi.Bool Function(ffi.Pointer<PrinterHandle>, ffi.Uint32)>>('cancel_print_job_h');
+  late final _cancel_print_job_h = _cancel_print_job_hPtr.asFunction<bool Function(ffi.Pointer<PrinterHandle>, int)>();
+
+  int cancel_jobs(
+    ffi.Pointer<ffi.Char> printer_name,
+    ffi.Pointer<ffi.Uint32> job_ids,
+    int count,
+  ) {
+    return _cancel_jobs(
+      printer_name,
+      job_ids,
+      count,
+    );
+  }
+
+  late final _cancel_jobsPtr = _lookup<ffi.NativeFunction<ffi.Int Function(ffi.Pointer<ffi.Char>, ffi.Pointer<ffi.Uint32>, ffi.Int)>>('cancel_jobs');
+  late final _cancel_jobs = _cancel_jobsPtr.asFunction<int Function(ffi.Pointer<ffi.Char>, ffi.Pointer<ffi.Uint32>, int)>();
+
+  int hold_jobs(
+    ffi.Pointer<ffi.Char> printer_name,
+    ffi.Pointer<ffi.Uint32> job_ids,
+    int count,
+  ) {
+    return _hold_jobs(
+      printer_name,
+      job_ids,
+      count,
+    );
+  }
+
+  late final _hold_jobsPtr = _lookup<ffi.NativeFunction<ffi.Int Function(ffi.Pointer<ffi.Char>, ffi.Pointer<ffi.Uint32>, ffi.Int)>>('hold_jobs');
+  late final _hold_jobs = _hold_jobsPtr.asFunction<int Function(ffi.Pointer<ffi.Char>, ffi.Pointer<ffi.Uint32>, int)>();
+
+  int release_jobs(
+    ffi.Pointer<ffi.Char> printer_name,
+    ffi.Pointer<ffi.Uint32> job_ids,
+    int count,
+  ) {
+    return _release_jobs(
+      printer_name,
+      job_ids,
+      count,
+    );
+  }
+
+  late final _release_jobsPtr = _lookup<ffi.NativeFunction<ffi.Int Function(ffi.Pointer<ffi.Char>, ffi.Pointer<ffi.Uint32>, ffi.Int)>>('release_jobs');
+  late final _release_jobs = _release_jobsPtr.asFunction<int Function(ffi.Pointer<ffi.Char>, ffi.Pointer<ffi.Uint32>, int)>();
+
+  int cancel_jobs_h(
+    ffi.Pointer<PrinterHandle> handle,
+    ffi.Pointer<ffi.Uint32> job_ids,
+    int count,
+  ) {
+    return _cancel_jobs_h(
+      handle,
+      job_ids,
+      count,
+    );
+  }
+
+  late final _cancel_jobs_hPtr = _lookup<ffi.NativeFunction<ffi.Int Function(ffi.Pointer<PrinterHandle>, ffi.Pointer<ffi.Uint32>, ffi.Int)>>('cancel_jobs_h');
+  late final _cancel_jobs_h = _cancel_jobs_hPtr.asFunction<int Function(ffi.Pointer<PrinterHandle>, ffi.Pointer<ffi.Uint32>, int)>();
+
+  int hold_jobs_h(
+    ffi.Pointer<PrinterHandle> handle,
+    ffi.Pointer<ffi.Uint32> job_ids,
+    int count,
+  ) {
+    return _hold_jobs_h(
+      handle,
+      job_ids,
+      count,
+    );
+  }
+
+  late final _hold_jobs_hPtr = _lookup<ffi.NativeFunction<ffi.Int Function(ffi.Pointer<PrinterHandle>, ffi.Pointer<ffi.Uint32>, ffi.Int)>>('hold_jobs_h');
+  late final _hold_jobs_h = _hold_jobs_hPtr.asFunction<int Function(ffi.Pointer<PrinterHandle>, ffi.Pointer<ffi.Uint32>, int)>();
+
+  int release_jobs_h(
+    ffi.Pointer<PrinterHandle> handle,
+    ffi.Pointer<ffi.Uint32> job_ids,
+    int count,
+  ) {
+    return _release_jobs_h(
+      handle,
+      job_ids,
+      count,
+    );
+  }
+
+  late final _release_jobs_hPtr = _lookup<ffi.NativeFunction<ffi.Int Function(ffi.Pointer<PrinterHandle>, ffi.Pointer<ffi.Uint32>, ffi.Int)>>('release_jobs_h');
+  late final _release_jobs_h = _release_jobs_hPtr.asFunction<int Function(ffi.Pointer<PrinterHandle>, ffi.Pointer<ffi.Uint32>, int)>();
+
+  bool cancel_all_jobs(
+    ffi.Pointer<ffi.Char> printer_name,
+    int scope,
+  ) {
+    return _cancel_all_jobs(
+      printer_name,
+      scope,
+    );
+  }
+
+  late final _cancel_all_jobsPtr = _lookup<ffi.NativeFunction<ffi.Bool Function(ffi.Pointer<ffi.Char>, ffi.Int)>>('cancel_all_jobs');
+  late final _cancel_all_jobs = _cancel_all_jobsPtr.asFunction<bool Function(ffi.Pointer<ffi.Char>, int)>();
+
+  bool cancel_all_jobs_h(
+    ffi.Pointer<PrinterHandle> handle,
+    int scope,
+  ) {
+    return _cancel_all_jobs_h(
+      handle,
+      scope,
+    );
+  }
+
+  late final _cancel_all_jobs_hPtr = _lookup<ffi.NativeFunction<ffi.Bool Function(ffi.Pointer<PrinterHandle>, ffi.Int)>>('cancel_all_jobs_h');
+  late final _cancel_all_jobs_h = _cancel_all_jobs_hPtr.asFunction<bool Function(ffi.Pointer<PrinterHandle>, int)>();
+
+  ffi.Pointer<JobPage> get_print_jobs_paged(
+    ffi.Pointer<ffi.Char> printer_name,
+    int first_index,
+    int limit,
+    int which_jobs,
+    bool my_jobs,
+    int attributes,
+  ) {
+    return _get_print_jobs_paged(
+      printer_name,
+      first_index,
+      limit,
+      which_jobs,
+      my_jobs,
+      attributes,
+    );
+  }
+
+  late final _get_print_jobs_pagedPtr = _lookup<ffi.NativeFunction<ffi.Pointer<JobPage> Function(ffi.Pointer<ffi.Char>, ffi.Int, ffi.Int, ffi.Int, ffi.Bool, ffi.Uint32)>>('get_print_jobs_paged');
+  late final _get_print_jobs_paged = _get_print_jobs_pagedPtr.asFunction<ffi.Pointer<JobPage> Function(ffi.Pointer<ffi.Char>, int, int, int, bool, int)>();
+
+  ffi.Pointer<JobPage> get_print_jobs_paged_h(
+    ffi.Pointer<PrinterHandle> handle,
+    int first_index,
+    int limit,
+    int which_jobs,
+    bool my_jobs,
+    int attributes,
+  ) {
+    return _get_print_jobs_paged_h(
+      handle,
+      first_index,
+      limit,
+      which_jobs,
+      my_jobs,
+      attributes,
+    );
+  }
+
+  late final _get_print_jobs_paged_hPtr = _lookup<ffi.NativeFunction<ffi.Pointer<JobPage> Function(ffi.Pointer<PrinterHandle>, ffi.Int, ffi.Int, ffi.Int, ffi.Bool, ffi.Uint32)>>('get_print_jobs_paged_h');
+  late final _get_print_jobs_paged_h = _get_print_jobs_paged_hPtr.asFunction<ffi.Pointer<JobPage> Function(ffi.Pointer<PrinterHandle>, int, int, int, bool, int)>();
+
+  void free_job_page(
+    ffi.Pointer<JobPage> page,
+  ) {
+    return _free_job_page(
+      page,
+    );
+  }
+
+  late final _free_job_pagePtr = _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<JobPage>)>>('free_job_page');
+  late final _free_job_page = _free_job_pagePtr.asFunction<void Function(ffi.Pointer<JobPage>)>();
+
+  ffi.Pointer<JobTimings> get_job_timings(
+    ffi.Pointer<ffi.Char> printer_name,
+  ) {
+    return _get_job_timings(
+      printer_name,
+    );
+  }
+
+  late final _get_job_timingsPtr = _lookup<ffi.NativeFunction<ffi.Pointer<JobTimings> Function(ffi.Pointer<ffi.Char>)>>('get_job_timings');
+  late final _get_job_timings = _get_job_timingsPtr.asFunction<ffi.Pointer<JobTimings> Function(ffi.Pointer<ffi.Char>)>();
+
+  void free_job_timings(
+    ffi.Pointer<JobTimings> timings,
+  ) {
+    return _free_job_timings(
+      timings,
+    );
+  }
+
+  late final _free_job_timingsPtr = _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<JobTimings>)>>('free_job_timings');
+  late final _free_job_timings = _free_job_timingsPtr.asFunction<void Function(ffi.Pointer<JobTimings>)>();
+
+  void reset_job_timings() {
+    return _reset_job_timings();
+  }
+
+  late final _reset_job_timingsPtr = _lookup<ffi.NativeFunction<ffi.Void Function()>>('reset_job_timings');
+  late final _reset_job_timings = _reset_job_timingsPtr.asFunction<void Function()>();
+
+  ffi.Pointer<MetricsSnapshot> get_metrics_snapshot() {
+    return _get_metrics_snapshot();
+  }
+
+  late final _get_metrics_snapshotPtr = _lookup<ffi.NativeFunction<ffi.Pointer<MetricsSnapshot> Function()>>('get_metrics_snapshot');
+  late final _get_metrics_snapshot = _get_metrics_snapshotPtr.asFunction<ffi.Pointer<MetricsSnapshot> Function()>();
+
+  void free_metrics_snapshot(
+    ffi.Pointer<MetricsSnapshot> snapshot,
+  ) {
+    return _free_metrics_snapshot(
+      snapshot,
+    );
+  }
+
+  late final _free_metrics_snapshotPtr = _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<MetricsSnapshot>)>>('free_metrics_snapshot');
+  late final _free_metrics_snapshot = _free_metrics_snapshotPtr.asFunction<void Function(ffi.Pointer<MetricsSnapshot>)>();
+
+  void reset_metrics() {
+    return _reset_metrics();
+  }
+
+  late final _reset_metricsPtr = _lookup<ffi.NativeFunction<ffi.Void Function()>>('reset_metrics');
+  late final _reset_metrics = _reset_metricsPtr.asFunction<void Function()>();
+
+  ffi.Pointer<ffi.Char> render_metrics_prometheus() {
+    return _render_metrics_prometheus();
+  }
+
+  late final _render_metrics_prometheusPtr = _lookup<ffi.NativeFunction<ffi.Pointer<ffi.Char> Function()>>('render_metrics_prometheus');
+  late final _render_metrics_prometheus = _render_metrics_prometheusPtr.asFunction<ffi.Pointer<ffi.Char> Function()>();
+
+  void free_native_string(
+    ffi.Pointer<ffi.Char> str,
+  ) {
+    return _free_native_string(
+      str,
+    );
+  }
+
+  late final _free_native_stringPtr = _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<ffi.Char>)>>('free_native_string');
+  late final _free_native_string = _free_native_stringPtr.asFunction<void Function(ffi.Pointer<ffi.Char>)>();
+
+  bool start_trace_recording(
+    ffi.Pointer<ffi.Char> output_path,
+  ) {
+    return _start_trace_recording(
+      output_path,
+    );
+  }
+
+  late final _start_trace_recordingPtr = _lookup<ffi.NativeFunction<ffi.Bool Function(ffi.Pointer<ffi.Char>)>>('start_trace_recording');
+  late final _start_trace_recording = _start_trace_recordingPtr.asFunction<bool Function(ffi.Pointer<ffi.Char>)>();
+
+  bool stop_trace_recording() {
+    return _stop_trace_recording();
+  }
+
+  late final _stop_trace_recordingPtr = _lookup<ffi.NativeFunction<ffi.Bool Function()>>('stop_trace_recording');
+  late final _stop_trace_recording = _stop_trace_recordingPtr.asFunction<bool Function()>();
+
+  bool start_call_recording(
+    ffi.Pointer<ffi.Char> output_path,
+  ) {
+    return _start_call_recording(
+      output_path,
+    );
+  }
+
+  late final _start_call_recordingPtr = _lookup<ffi.NativeFunction<ffi.Bool Function(ffi.Pointer<ffi.Char>)>>('start_call_recording');
+  late final _start_call_recording = _start_call_recordingPtr.asFunction<bool Function(ffi.Pointer<ffi.Char>)>();
+
+  bool stop_call_recording() {
+    return _stop_call_recording();
+  }
+
+  late final _stop_call_recordingPtr = _lookup<ffi.NativeFunction<ffi.Bool Function()>>('stop_call_recording');
+  late final _stop_call_recording = _stop_call_recordingPtr.asFunction<bool Function()>();
+
+  bool set_capabilities_cache_dir(
+    ffi.Pointer<ffi.Char> directory,
+  ) {
+    return _set_capabilities_cache_dir(
+      directory,
+    );
+  }
+
+  late final _set_capabilities_cache_dirPtr = _lookup<ffi.NativeFunction<ffi.Bool Function(ffi.Pointer<ffi.Char>)>>('set_capabilities_cache_dir');
+  late final _set_capabilities_cache_dir = _set_capabilities_cache_dirPtr.asFunction<bool Function(ffi.Pointer<ffi.Char>)>();
+
   ffi.Pointer<CupsOptionList> get_supported_cups_options(
     ffi.Pointer<ffi.Char> printer_name,
   ) {
@@ -271,6 +742,97 @@ class PrintingFfiBindings {
   late final _free_windows_printer_capabilitiesPtr = _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<WindowsPrinterCapabilities>)>>('free_windows_printer_capabilities');
   late final _free_windows_printer_capabilities = _free_windows_printer_capabilitiesPtr.asFunction<void Function(ffi.Pointer<WindowsPrinterCapabilities>)>();
 
+  ffi.Pointer<MediaSizeInfo> get_media_size(
+    ffi.Pointer<ffi.Char> name,
+  ) {
+    return _get_media_size(
+      name,
+    );
+  }
+
+  late final _get_media_sizePtr = _lookup<ffi.NativeFunction<ffi.Pointer<MediaSizeInfo> Function(ffi.Pointer<ffi.Char>)>>('get_media_size');
+  late final _get_media_size = _get_media_sizePtr.asFunction<ffi.Pointer<MediaSizeInfo> Function(ffi.Pointer<ffi.Char>)>();
+
+  ffi.Pointer<MediaSizeInfo> get_media_size_by_windows_id(
+    int windows_id,
+  ) {
+    return _get_media_size_by_windows_id(
+      windows_id,
+    );
+  }
+
+  late final _get_media_size_by_windows_idPtr = _lookup<ffi.NativeFunction<ffi.Pointer<MediaSizeInfo> Function(ffi.Int)>>('get_media_size_by_windows_id');
+  late final _get_media_size_by_windows_id = _get_media_size_by_windows_idPtr.asFunction<ffi.Pointer<MediaSizeInfo> Function(int)>();
+
+  void free_media_size_info(
+    ffi.Pointer<MediaSizeInfo> info,
+  ) {
+    return _free_media_size_info(
+      info,
+    );
+  }
+
+  late final _free_media_size_infoPtr = _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<MediaSizeInfo>)>>('free_media_size_info');
+  late final _free_media_size_info = _free_media_size_infoPtr.asFunction<void Function(ffi.Pointer<MediaSizeInfo>)>();
+
+  ffi.Pointer<CapabilitySnapshot> get_capability_snapshot(
+    ffi.Pointer<ffi.Char> printer_name,
+  ) {
+    return _get_capability_snapshot(
+      printer_name,
+    );
+  }
+
+  late final _get_capability_snapshotPtr = _lookup<ffi.NativeFunction<ffi.Pointer<CapabilitySnapshot> Function(ffi.Pointer<ffi.Char>)>>('get_capability_snapshot');
+  late final _get_capability_snapshot = _get_capability_snapshotPtr.asFunction<ffi.Pointer<CapabilitySnapshot> Function(ffi.Pointer<ffi.Char>)>();
+
+  void free_capability_snapshot(
+    ffi.Pointer<CapabilitySnapshot> snapshot,
+  ) {
+    return _free_capability_snapshot(
+      snapshot,
+    );
+  }
+
+  late final _free_capability_snapshotPtr = _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Pointer<CapabilitySnapshot>)>>('free_capability_snapshot');
+  late final _free_capability_snapshot = _free_capability_snapshotPtr.asFunction<void Function(ffi.Pointer<CapabilitySnapshot>)>();
+
+  int validate_options(
+    ffi.Pointer<ffi.Char> printer_name,
+    int num_options,
+    ffi.Pointer<ffi.Pointer<ffi.Char>> option_keys,
+    ffi.Pointer<ffi.Pointer<ffi.Char>> option_values,
+  ) {
+    return _validate_options(
+      printer_name,
+      num_options,
+      option_keys,
+      option_values,
+    );
+  }
+
+  late final _validate_optionsPtr = _lookup<ffi.NativeFunction<ffi.Int Function(ffi.Pointer<ffi.Char>, ffi.Int, ffi.Pointer<ffi.Pointer<ffi.Char>>, ffi.Pointer<ffi.Pointer<ffi.Char>>)>>('validate_options');
+  late final _validate_options = _validate_optionsPtr.asFunction<int Function(ffi.Pointer<ffi.Char>, int, ffi.Pointer<ffi.Pointer<ffi.Char>>, ffi.Pointer<ffi.Pointer<ffi.Char>>)>();
+
+  bool prefetch_capabilities(
+    ffi.Pointer<ffi.Pointer<ffi.Char>> printers,
+    int count,
+    int concurrency,
+    int request_id,
+    prefetch_callback_t callback,
+  ) {
+    return _prefetch_capabilities(
+      printers,
+      count,
+      concurrency,
+      request_id,
+      callback,
+    );
+  }
+
+  late final _prefetch_capabilitiesPtr = _lookup<ffi.NativeFunction<ffi.Bool Function(ffi.Pointer<ffi.Pointer<ffi.Char>>, ffi.Int, ffi.Int, ffi.Int64, prefetch_callback_t)>>('prefetch_capabilities');
+  late final _prefetch_capabilities = _prefetch_capabilitiesPtr.asFunction<bool Function(ffi.Pointer<ffi.Pointer<ffi.Char>>, int, int, int, prefetch_callback_t)>();
+
   ffi.Pointer<ffi.Char> get_last_error() {
     return _get_last_error();
   }
@@ -278,6 +840,46 @@ class PrintingFfiBindings {
   late final _get_last_errorPtr = _lookup<ffi.NativeFunction<ffi.Pointer<ffi.Char> Function()>>('get_last_error');
   late final _get_last_error = _get_last_errorPtr.asFunction<ffi.Pointer<ffi.Char> Function()>();
 
+  int get_last_error_code() {
+    return _get_last_error_code();
+  }
+
+  late final _get_last_error_codePtr = _lookup<ffi.NativeFunction<ffi.Int Function()>>('get_last_error_code');
+  late final _get_last_error_code = _get_last_error_codePtr.asFunction<int Function()>();
+
+  void set_admission_control(
+    bool enabled,
+    int max_age_ms,
+  ) {
+    return _set_admission_control(
+      enabled,
+      max_age_ms,
+    );
+  }
+
+  late final _set_admission_controlPtr = _lookup<ffi.NativeFunction<ffi.Void Function(ffi.Bool, ffi.Uint32)>>('set_admission_control');
+  late final _set_admission_control = _set_admission_controlPtr.asFunction<void Function(bool, int)>();
+
+  bool set_fallback_printer(
+    ffi.Pointer<ffi.Char> printer_name,
+    ffi.Pointer<ffi.Char> fallback_printer,
+  ) {
+    return _set_fallback_printer(
+      printer_name,
+      fallback_printer,
+    );
+  }
+
+  late final _set_fallback_printerPtr = _lookup<ffi.NativeFunction<ffi.Bool Function(ffi.Pointer<ffi.Char>, ffi.Pointer<ffi.Char>)>>('set_fallback_printer');
+  late final _set_fallback_printer = _set_fallback_printerPtr.asFunction<bool Function(ffi.Pointer<ffi.Char>, ffi.Pointer<ffi.Char>)>();
+
+  ffi.Pointer<ffi.Char> get_last_rerouted_printer() {
+    return _get_last_rerouted_printer();
+  }
+
+  late final _get_last_rerouted_printerPtr = _lookup<ffi.NativeFunction<ffi.Pointer<ffi.Char> Function()>>('get_last_rerouted_printer');
+  late final _get_last_rerouted_printer = _get_last_rerouted_printerPtr.asFunction<ffi.Pointer<ffi.Char> Function()>();
+
   /// Functions that submit a job and return a job ID for status tracking.
   int submit_raw_data_job(
     ffi.Pointer<ffi.Char> printer_name,
@@ -343,6 +945,18 @@ typedef Dartlog_callback_tFunction = void Function(ffi.Pointer<ffi.Char> message
 
 /// Define a function pointer type for the log callback.
 typedef log_callback_t = ffi.Pointer<ffi.NativeFunction<log_callback_tFunction>>;
+typedef log_batch_callback_tFunction = ffi.Void Function(ffi.Pointer<ffi.Char> messages, ffi.Int count);
+typedef Dartlog_batch_callback_tFunction = void Function(ffi.Pointer<ffi.Char> messages, int count);
+
+/// Callback for batches of `count` newline-separated log lines. The callback
+/// owns `messages` and must release it with free_native_string.
+typedef log_batch_callback_t = ffi.Pointer<ffi.NativeFunction<log_batch_callback_tFunction>>;
+typedef prefetch_callback_tFunction = ffi.Void Function(ffi.Int64 request_id, ffi.Int succeeded, ffi.Int failed);
+typedef Dartprefetch_callback_tFunction = void Function(int request_id, int succeeded, int failed);
+
+/// Called once by prefetch_capabilities when every printer has been fetched.
+/// `failed` counts printers whose query failed or returned nothing.
+typedef prefetch_callback_t = ffi.Pointer<ffi.NativeFunction<prefetch_callback_tFunction>>;
 
 /// Struct for returning printer information
 final class PrinterInfo extends ffi.Struct {
@@ -373,6 +987,32 @@ final class PrinterList extends ffi.Struct {
   external ffi.Pointer<PrinterInfo> printers;
 }
 
+/// Struct for a single printer directory change
+final class PrinterChange extends ffi.Struct {
+  @ffi.Int32()
+  external int change_type;
+
+  external PrinterInfo printer;
+}
+
+/// Struct for returning the printer directory changes since a generation.
+/// When `reset` is true the list is a full snapshot and replaces any previously held model.
+final class PrinterChangeList extends ffi.Struct {
+  @ffi.Uint64()
+  external int generation;
+
+  @ffi.Bool()
+  external bool reset;
+
+  @ffi.Int()
+  external int count;
+
+  external ffi.Pointer<PrinterChange> changes;
+}
+
+/// Opaque handle to an open printer, see open_printer_handle
+final class PrinterHandle extends ffi.Opaque {}
+
 /// Struct for returning print job information
 final class JobInfo extends ffi.Struct {
   @ffi.Uint32()
@@ -391,6 +1031,169 @@ final class JobList extends ffi.Struct {
   external ffi.Pointer<JobInfo> jobs;
 }
 
+/// One supply (toner, ink, ...) reported through marker-names / marker-levels.
+final class SupplyLevel extends ffi.Struct {
+  external ffi.Pointer<ffi.Char> name;
+
+  @ffi.Int()
+  external int level;
+}
+
+/// Struct for a printer's status, returned by get_printer_statuses
+final class PrinterStatus extends ffi.Struct {
+  external ffi.Pointer<ffi.Char> name;
+
+  @ffi.Bool()
+  external bool found;
+
+  @ffi.Uint32()
+  external int state;
+
+  external ffi.Pointer<ffi.Char> state_reasons;
+
+  @ffi.Bool()
+  external bool is_accepting_jobs;
+
+  @ffi.Int()
+  external int queued_job_count;
+
+  @ffi.Int()
+  external int supply_count;
+
+  external ffi.Pointer<SupplyLevel> supplies;
+}
+
+final class PrinterStatusList extends ffi.Struct {
+  @ffi.Int()
+  external int count;
+
+  external ffi.Pointer<PrinterStatus> statuses;
+}
+
+/// Struct for a single row of a paginated job listing. Times are seconds since the Unix epoch.
+final class JobEntry extends ffi.Struct {
+  @ffi.Uint32()
+  external int id;
+
+  @ffi.Uint32()
+  external int state;
+
+  external ffi.Pointer<ffi.Char> title;
+
+  external ffi.Pointer<ffi.Char> user;
+
+  @ffi.Uint32()
+  external int size_kb;
+
+  @ffi.Int32()
+  external int pages_completed;
+
+  @ffi.Int64()
+  external int created_at;
+
+  @ffi.Int64()
+  external int processing_at;
+
+  @ffi.Int64()
+  external int completed_at;
+}
+
+/// Struct for returning one page of jobs. `has_more` is true if rows exist past this page.
+final class JobPage extends ffi.Struct {
+  @ffi.Int()
+  external int count;
+
+  @ffi.Bool()
+  external bool has_more;
+
+  external ffi.Pointer<JobEntry> jobs;
+}
+
+/// Struct for the trace of a single job. `stage_ns` holds nanoseconds since
+/// `started_ns` (monotonic clock) for each JOB_STAGE_*, or 0 if not observed.
+final class JobTrace extends ffi.Struct {
+  @ffi.Uint32()
+  external int job_id;
+
+  external ffi.Pointer<ffi.Char> printer_name;
+
+  @ffi.Uint64()
+  external int started_ns;
+
+  @ffi.Array.multi([8])
+  external ffi.Array<ffi.Uint64> stage_ns;
+}
+
+/// Struct for the latency distribution of one interval on one printer
+final class JobTimingSummary extends ffi.Struct {
+  external ffi.Pointer<ffi.Char> printer_name;
+
+  @ffi.Int32()
+  external int interval;
+
+  @ffi.Uint32()
+  external int samples;
+
+  @ffi.Uint64()
+  external int p50_ns;
+
+  @ffi.Uint64()
+  external int p95_ns;
+
+  @ffi.Uint64()
+  external int p99_ns;
+
+  @ffi.Uint64()
+  external int max_ns;
+}
+
+final class JobTimings extends ffi.Struct {
+  @ffi.Int()
+  external int trace_count;
+
+  external ffi.Pointer<JobTrace> traces;
+
+  @ffi.Int()
+  external int summary_count;
+
+  external ffi.Pointer<JobTimingSummary> summaries;
+}
+
+/// Struct for the counters and latency distribution of one operation
+final class OperationMetrics extends ffi.Struct {
+  @ffi.Uint64()
+  external int calls;
+
+  @ffi.Uint64()
+  external int errors;
+
+  @ffi.Uint64()
+  external int total_ns;
+
+  @ffi.Uint64()
+  external int max_ns;
+
+  @ffi.Uint64()
+  external int p50_ns;
+
+  @ffi.Uint64()
+  external int p90_ns;
+
+  @ffi.Uint64()
+  external int p99_ns;
+
+  @ffi.Uint64()
+  external int p999_ns;
+
+  @ffi.Array.multi([144])
+  external ffi.Array<ffi.Uint64> buckets;
+}
+
+final class MetricsSnapshot extends ffi.Struct {
+  @ffi.Array.multi([6])
+  external ffi.Array<OperationMetrics> operations;
+}
+
 /// Struct for a single CUPS option choice
 final class CupsOptionChoice extends ffi.Struct {
   external ffi.Pointer<ffi.Char> choice;
@@ -508,3 +1311,178 @@ final class WindowsPrinterCapabilities extends ffi.Struct {
   @ffi.Bool()
   external bool supports_landscape;
 }
+
+/// A media size from the built-in PWG 5101.1 table. Strings are empty when the
+/// size has no name of that kind; windows_id is 0 when it has no DMPAPER id.
+final class MediaSizeInfo extends ffi.Struct {
+  external ffi.Pointer<ffi.Char> pwg_name;
+
+  external ffi.Pointer<ffi.Char> ppd_name;
+
+  external ffi.Pointer<ffi.Char> ipp_name;
+
+  @ffi.Short()
+  external int windows_id;
+
+  @ffi.Float()
+  external double width_mm;
+
+  @ffi.Float()
+  external double height_mm;
+}
+
+/// A printer's capabilities serialized into one flat buffer by
+/// get_capability_snapshot. `data` points just past the struct, in the same
+/// allocation, and holds `size` bytes.
+final class CapabilitySnapshot extends ffi.Struct {
+  external ffi.Pointer<ffi.Uint8> data;
+
+  @ffi.Uint32()
+  external int size;
+}
+
+const int PRINTING_ERROR_NONE = 0;
+
+const int PRINTING_ERROR_FAILED = 1;
+
+const int PRINTING_ERROR_PRINTER_STOPPED = 2;
+
+const int PRINTING_ERROR_NOT_ACCEPTING_JOBS = 3;
+
+const int PRINTER_CHANGE_ADDED = 0;
+
+const int PRINTER_CHANGE_MODIFIED = 1;
+
+const int PRINTER_CHANGE_REMOVED = 2;
+
+const int CANCEL_SCOPE_ALL_JOBS = 0;
+
+const int CANCEL_SCOPE_MY_JOBS = 1;
+
+const int CANCEL_SCOPE_PURGE = 2;
+
+const int WHICH_JOBS_ACTIVE = 0;
+
+const int WHICH_JOBS_COMPLETED = 1;
+
+const int WHICH_JOBS_ALL = 2;
+
+const int JOB_ATTR_TITLE = 1;
+
+const int JOB_ATTR_STATE = 2;
+
+const int JOB_ATTR_USER = 4;
+
+const int JOB_ATTR_SIZE = 8;
+
+const int JOB_ATTR_PAGES = 16;
+
+const int JOB_ATTR_TIMES = 32;
+
+const int JOB_STAGE_OPTIONS_PARSED = 0;
+
+const int JOB_STAGE_SPOOLED = 1;
+
+const int JOB_STAGE_REQUEST_SENT = 2;
+
+const int JOB_STAGE_JOB_ID_RETURNED = 3;
+
+const int JOB_STAGE_FIRST_PROCESSING = 4;
+
+const int JOB_STAGE_COMPLETED = 5;
+
+const int JOB_STAGE_CANCELED = 6;
+
+const int JOB_STAGE_ABORTED = 7;
+
+const int JOB_STAGE_COUNT = 8;
+
+const int JOB_INTERVAL_SUBMIT = 0;
+
+const int JOB_INTERVAL_QUEUED = 1;
+
+const int JOB_INTERVAL_PRINTING = 2;
+
+const int JOB_INTERVAL_TOTAL = 3;
+
+const int JOB_INTERVAL_COUNT = 4;
+
+const int METRIC_OP_GET_PRINTERS = 0;
+
+const int METRIC_OP_GET_PRINT_JOBS = 1;
+
+const int METRIC_OP_PRINT_RAW = 2;
+
+const int METRIC_OP_PRINT_PDF = 3;
+
+const int METRIC_OP_CAPABILITIES = 4;
+
+const int METRIC_OP_IPP_REQUEST = 5;
+
+const int METRIC_OP_COUNT = 6;
+
+const int METRIC_HISTOGRAM_BUCKETS = 144;
+
+const int CALL_RECORD_VERSION = 2;
+
+const int CALL_GET_PRINTERS = 0;
+
+const int CALL_GET_PRINT_JOBS = 1;
+
+const int CALL_PRINT_RAW = 2;
+
+const int CALL_SUBMIT_RAW = 3;
+
+const int CALL_PRINT_PDF = 4;
+
+const int CALL_SUBMIT_PDF = 5;
+
+const int CALL_PAUSE_JOB = 6;
+
+const int CALL_RESUME_JOB = 7;
+
+const int CALL_CANCEL_JOB = 8;
+
+const int CALL_CANCEL_JOBS = 9;
+
+const int CALL_HOLD_JOBS = 10;
+
+const int CALL_RELEASE_JOBS = 11;
+
+const int CALL_CANCEL_ALL_JOBS = 12;
+
+const int CALL_GET_PRINT_JOBS_PAGED = 13;
+
+const int CALL_GET_PRINTER_STATUSES = 14;
+
+const int CALL_COUNT = 15;
+
+const int CAPABILITY_SNAPSHOT_VERSION = 1;
+
+const int CAPABILITY_SNAPSHOT_CUPS = 1;
+
+const int CAPABILITY_SNAPSHOT_WINDOWS = 2;
+
+const int CAPABILITY_SNAPSHOT_FLAG_COLOR = 1;
+
+const int CAPABILITY_SNAPSHOT_FLAG_MONOCHROME = 2;
+
+const int CAPABILITY_SNAPSHOT_FLAG_LANDSCAPE = 4;
+
+const int OPTION_VALIDATION_ERROR = -1;
+
+const int OPTION_VALIDATION_OK = 0;
+
+const int OPTION_VALIDATION_UNSUPPORTED = 1;
+
+const int OPTION_VALIDATION_CONFLICT = 2;
+
+const int LOG_LEVEL_OFF = 0;
+
+const int LOG_LEVEL_ERROR = 1;
+
+const int LOG_LEVEL_WARN = 2;
+
+const int LOG_LEVEL_INFO = 3;
+
+const int LOG_LEVEL_DEBUG = 4;
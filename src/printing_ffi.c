@@ -3,20 +3,36 @@
 
 #ifdef _WIN32
 #include <winspool.h>
+#include <lmcons.h>
 #include <stdio.h>
 #include <shellapi.h>
 #include <wingdi.h>
 #define strdup _strdup
 #else
 #include <cups/cups.h>
-#include <cups/ppd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <strings.h>
 #include <limits.h>
 #include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 #endif
 #include <ctype.h>
 
+// On Linux, local CUPS configuration changes are observed with inotify so that
+// native caches can be invalidated exactly when a queue is edited.
+#if defined(__linux__) && !defined(__ANDROID__)
+#define PRINTING_FFI_INOTIFY
+#include <sys/inotify.h>
+#endif
+
 #ifdef _WIN32
 // Include the main Pdfium header. Ensure this is in your src/ directory.
 #include "fpdfview.h"
@@ -24,46 +40,360 @@
 // Global state for Pdfium initialization
 static bool s_pdfium_initialized = false;
 #endif
-// Use thread-local storage for the log callback to ensure isolate safety.
-// Each Dart isolate runs on its own thread, so each will have its own
-// instance of this variable.
-#ifdef _WIN32
-__declspec(thread) static log_callback_t s_log_callback = NULL;
-#else // macOS, Linux
-static __thread log_callback_t s_log_callback = NULL;
+// Log verbosity, see set_log_level. Debug builds log everything by default;
+// release builds log nothing until a level is set at runtime.
+#ifdef DEBUG_LOGGING
+static volatile int s_log_level = LOG_LEVEL_DEBUG;
+#else
+static volatile int s_log_level = LOG_LEVEL_OFF;
 #endif
 
-// Logging macro - enabled when DEBUG_LOGGING is defined (e.g., in debug builds)
-#ifdef DEBUG_LOGGING
-#define LOG(format, ...)                                                                     \
-    do                                                                                       \
-    {                                                                                        \
-        char log_message[1024];                                                              \
-        snprintf(log_message, sizeof(log_message), "[printing_ffi] " format, ##__VA_ARGS__); \
-        if (s_log_callback != NULL)                                                          \
-        {                                                                                    \
-            s_log_callback(log_message);                                                     \
-        }                                                                                    \
-        else                                                                                 \
-        {                                                                                    \
-            fprintf(stderr, "%s\n", log_message);                                            \
-        }                                                                                    \
+static void _log_write(int level, const char *format, ...);
+
+// Logging macros. The arguments are only evaluated when the level is enabled;
+// formatted messages are queued and delivered by a background thread.
+#define LOG_AT(level, format, ...)                                     \
+    do                                                                 \
+    {                                                                  \
+        if ((level) <= s_log_level)                                    \
+            _log_write((level), format, ##__VA_ARGS__);                \
     } while (0)
+#define LOG_ERROR(format, ...) LOG_AT(LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+#define LOG_WARN(format, ...) LOG_AT(LOG_LEVEL_WARN, format, ##__VA_ARGS__)
+#define LOG_INFO(format, ...) LOG_AT(LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#define LOG(format, ...) LOG_AT(LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+
+// --- Process-wide Locking ---
+
+// Native caches are shared by every isolate in the process, so they are
+// protected by a statically initialized lock rather than thread-local storage.
+#ifdef _WIN32
+typedef SRWLOCK ffi_mutex_t;
+#define FFI_MUTEX_INITIALIZER SRWLOCK_INIT
+#define ffi_mutex_lock(m) AcquireSRWLockExclusive(m)
+#define ffi_mutex_unlock(m) ReleaseSRWLockExclusive(m)
+#define ffi_mutex_init(m) InitializeSRWLock(m)
+#define ffi_mutex_destroy(m) ((void)(m))
+typedef SRWLOCK ffi_rwlock_t;
+#define FFI_RWLOCK_INITIALIZER SRWLOCK_INIT
+#define ffi_rwlock_rdlock(m) AcquireSRWLockShared(m)
+#define ffi_rwlock_rdunlock(m) ReleaseSRWLockShared(m)
+#define ffi_rwlock_wrlock(m) AcquireSRWLockExclusive(m)
+#define ffi_rwlock_wrunlock(m) ReleaseSRWLockExclusive(m)
+#else
+typedef pthread_mutex_t ffi_mutex_t;
+#define FFI_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#define ffi_mutex_lock(m) pthread_mutex_lock(m)
+#define ffi_mutex_unlock(m) pthread_mutex_unlock(m)
+#define ffi_mutex_init(m) pthread_mutex_init((m), NULL)
+#define ffi_mutex_destroy(m) pthread_mutex_destroy(m)
+typedef pthread_rwlock_t ffi_rwlock_t;
+#define FFI_RWLOCK_INITIALIZER PTHREAD_RWLOCK_INITIALIZER
+#define ffi_rwlock_rdlock(m) pthread_rwlock_rdlock(m)
+#define ffi_rwlock_rdunlock(m) pthread_rwlock_unlock(m)
+#define ffi_rwlock_wrlock(m) pthread_rwlock_wrlock(m)
+#define ffi_rwlock_wrunlock(m) pthread_rwlock_unlock(m)
+#endif
+
+// Minimal atomics for counters that are read without taking a lock.
+#ifdef _WIN32
+#define ffi_atomic_load_u64(p) InterlockedCompareExchange64((volatile LONG64 *)(p), 0, 0)
+#define ffi_atomic_store_u64(p, v) InterlockedExchange64((volatile LONG64 *)(p), (LONG64)(v))
+#define ffi_atomic_add_u64(p, v) InterlockedExchangeAdd64((volatile LONG64 *)(p), (LONG64)(v))
+#define ffi_atomic_cas_u64(p, expected, desired) \
+    (InterlockedCompareExchange64((volatile LONG64 *)(p), (LONG64)(desired), (LONG64)(expected)) == (LONG64)(expected))
+#define ffi_atomic_fence() MemoryBarrier()
+#else
+#define ffi_atomic_load_u64(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ffi_atomic_store_u64(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define ffi_atomic_add_u64(p, v) __atomic_fetch_add((p), (v), __ATOMIC_ACQ_REL)
+#define ffi_atomic_cas_u64(p, expected, desired) \
+    ({ uint64_t _expected = (expected); __atomic_compare_exchange_n((p), &_expected, (desired), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE); })
+#define ffi_atomic_fence() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+// Monotonic clock in nanoseconds. The epoch is system-wide (boot time), so
+// timestamps can be compared between processes on the same host.
+static uint64_t _monotonic_ns(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency = {0};
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((counter.QuadPart / frequency.QuadPart) * 1000000000ULL +
+                      (counter.QuadPart % frequency.QuadPart) * 1000000000ULL / frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// --- Logging ---
+
+// Log lines are written by any thread into a bounded lock-free MPSC ring and
+// drained by a single background thread, which hands them to the registered
+// callback in batches. A full ring drops new lines (and counts them) rather
+// than blocking the caller.
+//
+// Each slot carries a sequence number as in Vyukov's bounded queue: a slot at
+// ring position `pos` is free for a producer when its sequence equals `pos`,
+// and holds a message for the consumer when it equals `pos + 1`. Sequences are
+// stored relative to the slot index so that the zero-initialized ring starts
+// out with every slot free.
+#define LOG_RING_CAPACITY 512 // Must be a power of two.
+#define LOG_MESSAGE_MAX 480
+#define LOG_BATCH_MAX 256
+#define LOG_DRAIN_INTERVAL_MS 50
+
+typedef struct
+{
+    uint64_t sequence; // Relative to the slot index, see above.
+    int level;
+    char message[LOG_MESSAGE_MAX];
+} LogSlot;
+
+static LogSlot s_log_ring[LOG_RING_CAPACITY];
+static uint64_t s_log_enqueue_pos = 0;
+static uint64_t s_log_dequeue_pos = 0; // Only touched by the drain thread.
+static uint64_t s_log_dropped = 0;
+static uint64_t s_log_thread_started = 0;
+static log_callback_t volatile s_log_callback = NULL;
+static log_batch_callback_t volatile s_log_batch_callback = NULL;
+// Held while a batch is handed to a callback, so that once a register call
+// returns no delivery to the previous callback is still in flight.
+static ffi_mutex_t s_log_callback_lock = FFI_MUTEX_INITIALIZER;
+
+static const char *const s_log_level_tags[] = {"", "ERROR", "WARN", "INFO", "DEBUG"};
+
+static void _log_sleep_ms(unsigned int ms)
+{
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+#endif
+}
+
+// Hands one batch of lines to the registered callback, or to stderr if none.
+static void _log_deliver(char *batch, size_t length, int count)
+{
+    ffi_mutex_lock(&s_log_callback_lock);
+    log_batch_callback_t batch_callback = s_log_batch_callback;
+    log_callback_t callback = s_log_callback;
+    if (batch_callback)
+    {
+        // Ownership of the batch passes to the callback, which releases it
+        // with free_native_string once it has been consumed.
+        batch_callback(batch, count);
+        ffi_mutex_unlock(&s_log_callback_lock);
+        return;
+    }
+    if (callback)
+    {
+        char *line = batch;
+        for (int i = 0; i < count; i++)
+        {
+            char *end = strchr(line, '\n');
+            if (end)
+                *end = '\0';
+            callback(line);
+            line = end ? end + 1 : line + strlen(line);
+        }
+    }
+    else
+    {
+        fwrite(batch, 1, length, stderr);
+    }
+    ffi_mutex_unlock(&s_log_callback_lock);
+    free(batch);
+}
+
+// Moves every queued line into newline-separated batches of up to LOG_BATCH_MAX lines.
+static void _log_drain(void)
+{
+    for (;;)
+    {
+        size_t capacity = 0, length = 0;
+        char *batch = NULL;
+        int count = 0;
+
+        uint64_t dropped = ffi_atomic_load_u64(&s_log_dropped);
+        if (dropped > 0)
+        {
+            ffi_atomic_add_u64(&s_log_dropped, (uint64_t)0 - dropped);
+            capacity = 128;
+            batch = (char *)malloc(capacity);
+            if (!batch)
+                return;
+            length = (size_t)snprintf(batch, capacity, "[printing_ffi] [WARN] %llu log messages dropped, the log ring was full\n", (unsigned long long)dropped);
+            count = 1;
+        }
+
+        while (count < LOG_BATCH_MAX)
+        {
+            uint64_t pos = s_log_dequeue_pos;
+            LogSlot *slot = &s_log_ring[pos & (LOG_RING_CAPACITY - 1)];
+            uint64_t slot_index = pos & (LOG_RING_CAPACITY - 1);
+            if (ffi_atomic_load_u64(&slot->sequence) + slot_index != pos + 1)
+                break; // Empty, or the producer has not finished writing yet.
+
+            const char *tag = s_log_level_tags[slot->level];
+            size_t needed = strlen("[printing_ffi] [] \n") + strlen(tag) + strlen(slot->message) + 1;
+            if (length + needed > capacity)
+            {
+                size_t new_capacity = capacity ? capacity * 2 : 4096;
+                while (length + needed > new_capacity)
+                    new_capacity *= 2;
+                char *grown = (char *)realloc(batch, new_capacity);
+                if (!grown)
+                    break;
+                batch = grown;
+                capacity = new_capacity;
+            }
+            length += (size_t)snprintf(batch + length, capacity - length, "[printing_ffi] [%s] %s\n", tag, slot->message);
+            count++;
+
+            ffi_atomic_store_u64(&slot->sequence, pos + LOG_RING_CAPACITY - slot_index);
+            s_log_dequeue_pos = pos + 1;
+        }
+
+        if (count == 0)
+        {
+            free(batch);
+            return;
+        }
+        _log_deliver(batch, length, count);
+        if (count < LOG_BATCH_MAX)
+            return;
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI _log_drain_thread(LPVOID arg)
+#else
+static void *_log_drain_thread(void *arg)
+#endif
+{
+    (void)arg;
+    for (;;)
+    {
+        _log_drain();
+        _log_sleep_ms(LOG_DRAIN_INTERVAL_MS);
+    }
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+static void _log_start_drain_thread(void)
+{
+    if (ffi_atomic_load_u64(&s_log_thread_started) || !ffi_atomic_cas_u64(&s_log_thread_started, 0, 1))
+        return;
+#ifdef _WIN32
+    HANDLE thread = CreateThread(NULL, 0, _log_drain_thread, NULL, 0, NULL);
+    if (thread)
+        CloseHandle(thread);
+    else
+        ffi_atomic_store_u64(&s_log_thread_started, 0);
 #else
-#define LOG(...)
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attr, _log_drain_thread, NULL) != 0)
+        ffi_atomic_store_u64(&s_log_thread_started, 0);
+    pthread_attr_destroy(&attr);
 #endif
+}
+
+static void _log_write(int level, const char *format, ...)
+{
+    _log_start_drain_thread();
+
+    uint64_t pos = ffi_atomic_load_u64(&s_log_enqueue_pos);
+    LogSlot *slot;
+    for (;;)
+    {
+        uint64_t slot_index = pos & (LOG_RING_CAPACITY - 1);
+        slot = &s_log_ring[slot_index];
+        int64_t diff = (int64_t)(ffi_atomic_load_u64(&slot->sequence) + slot_index - pos);
+        if (diff == 0)
+        {
+            if (ffi_atomic_cas_u64(&s_log_enqueue_pos, pos, pos + 1))
+                break;
+            pos = ffi_atomic_load_u64(&s_log_enqueue_pos);
+        }
+        else if (diff < 0)
+        {
+            ffi_atomic_add_u64(&s_log_dropped, 1);
+            return;
+        }
+        else
+        {
+            pos = ffi_atomic_load_u64(&s_log_enqueue_pos);
+        }
+    }
+
+    slot->level = level;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(slot->message, sizeof(slot->message), format, args);
+    va_end(args);
+    ffi_atomic_store_u64(&slot->sequence, pos + 1 - (pos & (LOG_RING_CAPACITY - 1)));
+}
+
+FFI_PLUGIN_EXPORT void register_log_callback(log_callback_t callback)
+{
+    ffi_mutex_lock(&s_log_callback_lock);
+    s_log_callback = callback;
+    ffi_mutex_unlock(&s_log_callback_lock);
+}
+
+FFI_PLUGIN_EXPORT void register_log_batch_callback(log_batch_callback_t callback)
+{
+    ffi_mutex_lock(&s_log_callback_lock);
+    log_batch_callback_t previous = s_log_batch_callback;
+    s_log_batch_callback = callback;
+    // Tell the previous callback that it has received its last batch. A
+    // callback that queues batches (a Dart listener) sees this after every
+    // batch it was given and can release itself without leaking any of them.
+    if (previous && previous != callback)
+        previous(NULL, 0);
+    ffi_mutex_unlock(&s_log_callback_lock);
+}
+
+FFI_PLUGIN_EXPORT void set_log_level(int level)
+{
+    if (level < LOG_LEVEL_OFF)
+        level = LOG_LEVEL_OFF;
+    if (level > LOG_LEVEL_DEBUG)
+        level = LOG_LEVEL_DEBUG;
+    s_log_level = level;
+}
+
+FFI_PLUGIN_EXPORT int get_log_level(void)
+{
+    return s_log_level;
+}
 
 // --- Last Error Handling ---
 
 // Use thread-local storage for the last error message to ensure thread safety.
 #ifdef _WIN32
 __declspec(thread) static char *g_last_error_message = NULL;
+__declspec(thread) static int g_last_error_code = PRINTING_ERROR_NONE;
 #else // macOS, Linux
 static __thread char *g_last_error_message = NULL;
+static __thread int g_last_error_code = PRINTING_ERROR_NONE;
 #endif
 
-// Internal helper to set the last error message for the current thread.
-static void set_last_error(const char *format, ...)
+static void _set_last_error_v(int code, const char *format, va_list args)
 {
     // Free the previous error message if it exists
     if (g_last_error_message)
@@ -71,9 +401,7 @@ static void set_last_error(const char *format, ...)
         free(g_last_error_message);
         g_last_error_message = NULL;
     }
-
-    va_list args;
-    va_start(args, format);
+    g_last_error_code = code;
 
     // Determine the required buffer size
     va_list args_copy;
@@ -87,55 +415,29 @@ static void set_last_error(const char *format, ...)
         if (g_last_error_message)
             vsnprintf(g_last_error_message, size + 1, format, args);
     }
-    va_end(args);
-}
-
-FFI_PLUGIN_EXPORT void register_log_callback(log_callback_t callback)
-{
-    s_log_callback = callback;
 }
 
-#ifdef _WIN32
-// Helper to convert UTF-8 char* to wchar_t*
-// The caller is responsible for freeing the returned string.
-static wchar_t *to_utf16(const char *utf8_str)
+// Internal helper to set the last error message for the current thread.
+static void set_last_error(const char *format, ...)
 {
-    if (!utf8_str)
-        return NULL;
-    int len = MultiByteToWideChar(CP_UTF8, 0, utf8_str, -1, NULL, 0);
-    if (len == 0)
-    {
-        LOG("MultiByteToWideChar to get len failed with error %lu", GetLastError());
-        return NULL;
-    }
-    wchar_t *utf16_str = (wchar_t *)malloc(len * sizeof(wchar_t));
-    if (!utf16_str)
-        return NULL;
-    if (MultiByteToWideChar(CP_UTF8, 0, utf8_str, -1, utf16_str, len) == 0)
-    {
-        LOG("MultiByteToWideChar to convert failed with error %lu", GetLastError());
-        free(utf16_str);
-        return NULL;
-    }
-    return utf16_str;
+    va_list args;
+    va_start(args, format);
+    _set_last_error_v(PRINTING_ERROR_FAILED, format, args);
+    va_end(args);
 }
 
-// Helper to convert wchar_t* to UTF-8 char*
-// The caller is responsible for freeing the returned string.
-static char *to_utf8(const wchar_t *utf16_str)
+// Like set_last_error, for failures callers can tell apart by a PRINTING_ERROR_* code.
+static void set_last_error_code(int code, const char *format, ...)
 {
-    if (!utf16_str)
-        return strdup("");
-    int len = WideCharToMultiByte(CP_UTF8, 0, utf16_str, -1, NULL, 0, NULL, NULL);
-    if (len == 0)
-        return strdup("");
-    char *utf8_str = (char *)malloc(len);
-    if (!utf8_str)
-        return strdup(""); // Should not happen
-    WideCharToMultiByte(CP_UTF8, 0, utf16_str, -1, utf8_str, len, NULL, NULL);
-    return utf8_str;
+    va_list args;
+    va_start(args, format);
+    _set_last_error_v(code, format, args);
+    va_end(args);
 }
 
+// Page ranges are only applied by the Windows PDF renderer; the benchmark
+// target also compiles the parser so that it can be measured on every platform.
+#if defined(_WIN32) || defined(PRINTING_FFI_BENCH) || defined(PRINTING_FFI_TEST)
 // Helper function to parse page ranges.
 // `range_str`: e.g., "1-3,5,8-10"
 // `page_flags`: A pre-allocated array of bools of size `total_pages`.
@@ -160,14 +462,14 @@ static bool parse_page_range(const char *range_str, bool *page_flags, int total_
         return false;
     char *to_free = str;
 
-    // Use strtok for non-Windows, strtok_s for Windows
+    // Use the reentrant tokenizers so that concurrent callers do not share state
     char *token;
     char *context = NULL;
 
 #ifdef _WIN32
     token = strtok_s(str, ",", &context);
 #else
-    token = strtok(str, ",");
+    token = strtok_r(str, ",", &context);
 #endif
 
     while (token)
@@ -230,142 +532,553 @@ static bool parse_page_range(const char *range_str, bool *page_flags, int total_
 #ifdef _WIN32
         token = strtok_s(NULL, ",", &context);
 #else
-        token = strtok(NULL, ",");
+        token = strtok_r(NULL, ",", &context);
 #endif
     }
     free(to_free);
     return true;
 }
+#endif
 
-// Helper function to parse Windows-specific print options from the generic key-value array.
-static void parse_windows_options(int num_options, const char** option_keys, const char** option_values,
-                                  int* paper_size_id, int* paper_source_id, int* orientation,
-                                  int* color_mode, int* print_quality, int* media_type_id, double* custom_scale,
-                                  bool* collate, int* duplex_mode) {
-    // Set default values
-    *paper_size_id = 0;
-    *paper_source_id = 0;
-    *orientation = 0;
-    *color_mode = 0;
-    *print_quality = 0;
-    *media_type_id = 0;
-    *custom_scale = 1.0; // Default to 100%
-    *collate = true; // Default to collated (complete copies printed together)
-    *duplex_mode = 0; // Default to single-sided (DMDUP_SIMPLEX)
+// --- Option Normalization ---
+// Translates the generic option keys built by the Dart side (orientation,
+// color-mode, print-quality, duplex, collate and the Windows ids) into their
+// platform forms. Keys are looked up through a perfect hash, so each one costs
+// a single hash and strcmp. Every choice carries both the DEVMODE value used
+// on Windows and the IPP attribute value sent to CUPS, already encoded the way
+// cupsAddOption expects, so nothing is formatted per job.
 
-    for (int i = 0; i < num_options; i++)
+typedef enum
+{
+    OPTION_FIELD_ORIENTATION,
+    OPTION_FIELD_COLOR_MODE,
+    OPTION_FIELD_PRINT_QUALITY,
+    OPTION_FIELD_DUPLEX,
+    OPTION_FIELD_COLLATE,
+    OPTION_FIELD_PAPER_SIZE_ID,
+    OPTION_FIELD_PAPER_SOURCE_ID,
+    OPTION_FIELD_MEDIA_TYPE_ID,
+    OPTION_FIELD_CUSTOM_SCALE,
+} OptionField;
+
+typedef struct
+{
+    const char *value;
+    int native;            // DEVMODE value on Windows.
+    const char *ipp_value; // Value of the key's IPP attribute.
+} OptionChoice;
+
+typedef struct
+{
+    const char *key;
+    OptionField field;
+    const char *ipp_name; // NULL for keys that only mean something on Windows.
+    const OptionChoice *choices;
+    int num_choices;
+    int fallback; // Choice used for an unknown value, or -1 to ignore the option.
+} OptionKey;
+
+static const OptionChoice s_orientation_choices[] = {
+    {"portrait", 1, "3"},  // DMORIENT_PORTRAIT
+    {"landscape", 2, "4"}, // DMORIENT_LANDSCAPE
+};
+
+static const OptionChoice s_color_mode_choices[] = {
+    {"monochrome", 1, "monochrome"}, // DMCOLOR_MONOCHROME
+    {"color", 2, "color"},           // DMCOLOR_COLOR
+};
+
+static const OptionChoice s_print_quality_choices[] = {
+    {"draft", -1, "3"},  // DMRES_DRAFT
+    {"low", -2, "3"},    // DMRES_LOW
+    {"normal", -3, "4"}, // DMRES_MEDIUM
+    {"high", -4, "5"},   // DMRES_HIGH
+};
+
+static const OptionChoice s_duplex_choices[] = {
+    {"singleSided", 1, "one-sided"},               // DMDUP_SIMPLEX
+    {"duplexLongEdge", 2, "two-sided-long-edge"},   // DMDUP_VERTICAL
+    {"duplexShortEdge", 3, "two-sided-short-edge"}, // DMDUP_HORIZONTAL
+};
+
+static const OptionChoice s_collate_choices[] = {
+    {"false", 0, "separate-documents-uncollated-copies"},
+    {"true", 1, "separate-documents-collated-copies"},
+};
+
+#define OPTION_CHOICES(choices) choices, (int)(sizeof(choices) / sizeof(choices[0]))
+
+// The order of this table is mirrored by tool/gen_option_hash.dart.
+static const OptionKey s_option_keys[] = {
+    {"orientation", OPTION_FIELD_ORIENTATION, "orientation-requested", OPTION_CHOICES(s_orientation_choices), 0},
+    {"color-mode", OPTION_FIELD_COLOR_MODE, "print-color-mode", OPTION_CHOICES(s_color_mode_choices), 1},
+    {"print-quality", OPTION_FIELD_PRINT_QUALITY, "print-quality", OPTION_CHOICES(s_print_quality_choices), 2},
+    {"duplex", OPTION_FIELD_DUPLEX, "sides", OPTION_CHOICES(s_duplex_choices), -1},
+    {"collate", OPTION_FIELD_COLLATE, "multiple-document-handling", OPTION_CHOICES(s_collate_choices), 0},
+    {"paper-size-id", OPTION_FIELD_PAPER_SIZE_ID, NULL, NULL, 0, -1},
+    {"paper-source-id", OPTION_FIELD_PAPER_SOURCE_ID, NULL, NULL, 0, -1},
+    {"media-type-id", OPTION_FIELD_MEDIA_TYPE_ID, NULL, NULL, 0, -1},
+    {"custom-scale-factor", OPTION_FIELD_CUSTOM_SCALE, NULL, NULL, 0, -1},
+};
+
+#define OPTION_HASH_BITS 4
+
+// Generated by tool/gen_option_hash.dart; do not edit by hand.
+#define OPTION_HASH_SEED 8u
+static const signed char s_option_slots[1 << OPTION_HASH_BITS] = {-1, -1, 7, 3, 1, 0, -1, 8, -1, 4, -1, 2, 6, 5, -1, -1};
+
+// 32-bit FNV-1a with the seed mixed into the offset basis, keeping the top
+// `bits` bits. The tool/gen_*.dart generators search for seeds that make it
+// collision-free over a fixed key set.
+static unsigned _perfect_hash(const char *key, uint32_t seed, int bits)
+{
+    uint32_t hash = 0x811c9dc5u ^ seed;
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++)
     {
-        if (strcmp(option_keys[i], "paper-size-id") == 0)
-        {
-            *paper_size_id = atoi(option_values[i]);
-        }
-        else if (strcmp(option_keys[i], "paper-source-id") == 0)
-        {
-            *paper_source_id = atoi(option_values[i]);
-        }
-        else if (strcmp(option_keys[i], "orientation") == 0)
-        {
-            if (strcmp(option_values[i], "landscape") == 0)
-                *orientation = 2; // DMORIENT_LANDSCAPE
-            else
-                *orientation = 1; // DMORIENT_PORTRAIT
-        }
-        else if (strcmp(option_keys[i], "color-mode") == 0)
-        {
-            if (strcmp(option_values[i], "monochrome") == 0)
-            {
-                *color_mode = 1; // DMCOLOR_MONOCHROME
-                // For monochrome, also ensure print quality is set to trigger driver update.
-                // If it's not already being set, use a neutral value.
-                if (*print_quality == 0)
-                    *print_quality = -3; // DMRES_MEDIUM
-            }
-            else
-                *color_mode = 2; // DMCOLOR_COLOR
-        }
-        else if (strcmp(option_keys[i], "print-quality") == 0)
-        {
-            if (strcmp(option_values[i], "draft") == 0)
-                *print_quality = -1; // DMRES_DRAFT
-            else if (strcmp(option_values[i], "low") == 0)
-                *print_quality = -2; // DMRES_LOW
-            else if (strcmp(option_values[i], "high") == 0)
-                *print_quality = -4; // DMRES_HIGH
-            else
-                *print_quality = -3; // DMRES_MEDIUM / normal
-        }
-        else if (strcmp(option_keys[i], "media-type-id") == 0)
-        {
-            *media_type_id = atoi(option_values[i]);
-        }
-        else if (strcmp(option_keys[i], "custom-scale-factor") == 0)
-        {
-            *custom_scale = atof(option_values[i]);
-        }
-        else if (strcmp(option_keys[i], "collate") == 0)
-        {
-            // Parse collate option: true = collated (complete copies together), false = non-collated (all copies of each page together)
-            *collate = (strcmp(option_values[i], "true") == 0);
-        } else if (strcmp(option_keys[i], "duplex") == 0) {
-            // Parse duplex option: singleSided, duplexLongEdge, duplexShortEdge
-            if (strcmp(option_values[i], "singleSided") == 0) {
-                *duplex_mode = 1; // DMDUP_SIMPLEX
-            } else if (strcmp(option_values[i], "duplexLongEdge") == 0) {
-                *duplex_mode = 2; // DMDUP_VERTICAL (long edge)
-            } else if (strcmp(option_values[i], "duplexShortEdge") == 0) {
-                *duplex_mode = 3; // DMDUP_HORIZONTAL (short edge)
-            }
-        }
+        hash ^= *p;
+        hash *= 0x01000193u;
     }
+    return hash >> (32 - bits);
 }
-#endif
-
-#ifdef _WIN32
-// Helper to get a modified DEVMODE struct for a printer.
-// The caller is responsible for freeing the returned struct.
-static DEVMODEW* get_modified_devmode(wchar_t* printer_name_w, int paper_size_id, int paper_source_id, int orientation, int color_mode, int print_quality, int media_type_id, bool collate, int duplex_mode) {
-    if (!printer_name_w) return NULL;
-    LOG("get_modified_devmode: Creating DEVMODE for '%ls' with paper_id:%d, source_id:%d, orientation:%d, color:%d, quality:%d, media_id:%d, duplex:%d",
-        printer_name_w, paper_size_id, paper_source_id, orientation, color_mode, print_quality, media_type_id, duplex_mode);
 
-    HANDLE hPrinter;
-    if (!OpenPrinterW(printer_name_w, &hPrinter, NULL))
-    {
-        LOG("get_modified_devmode: OpenPrinterW failed with error %lu", GetLastError());
+// Returns the table entry for a generic option key, or NULL if the key is
+// passed through unchanged.
+static const OptionKey *_lookup_option_key(const char *key)
+{
+    if (!key)
         return NULL;
-    }
+    int index = s_option_slots[_perfect_hash(key, OPTION_HASH_SEED, OPTION_HASH_BITS)];
+    if (index < 0 || strcmp(s_option_keys[index].key, key) != 0)
+        return NULL;
+    return &s_option_keys[index];
+}
 
-    DEVMODEW *pDevMode = NULL;
-    LONG devModeSize = DocumentPropertiesW(NULL, hPrinter, printer_name_w, NULL, NULL, 0);
-    if (devModeSize <= 0)
+// Returns the choice a value selects, the key's fallback for an unknown value,
+// or NULL if the option should be ignored.
+static const OptionChoice *_lookup_option_choice(const OptionKey *option, const char *value)
+{
+    for (int i = 0; i < option->num_choices; i++)
     {
-        LOG("get_modified_devmode: DocumentPropertiesW (get size) failed with error %lu. Size was %ld.", GetLastError(), devModeSize);
-        ClosePrinter(hPrinter);
-        return NULL;
+        if (strcmp(option->choices[i].value, value) == 0)
+            return &option->choices[i];
     }
+    return option->fallback >= 0 ? &option->choices[option->fallback] : NULL;
+}
 
-    pDevMode = (DEVMODEW *)malloc(devModeSize);
-    if (!pDevMode)
+// Resolves one key/value pair to the IPP attribute CUPS should receive. Keys
+// that are not generic options are returned unchanged. Returns false if the
+// option has no IPP form and should not be sent.
+static bool _normalize_ipp_option(const char *key, const char *value, const char **ipp_name, const char **ipp_value)
+{
+    const OptionKey *option = _lookup_option_key(key);
+    if (!option)
     {
-        LOG("get_modified_devmode: Failed to allocate memory for DEVMODE.");
-        ClosePrinter(hPrinter);
-        return NULL;
+        *ipp_name = key;
+        *ipp_value = value;
+        return true;
     }
+    if (!option->ipp_name)
+        return false;
+    const OptionChoice *choice = _lookup_option_choice(option, value);
+    if (!choice)
+        return false;
+    *ipp_name = option->ipp_name;
+    *ipp_value = choice->ipp_value;
+    return true;
+}
 
-    // Get the default DEVMODE for the printer.
-    if (DocumentPropertiesW(NULL, hPrinter, printer_name_w, pDevMode, NULL, DM_OUT_BUFFER) != IDOK)
+#ifndef _WIN32
+// Builds the CUPS option array for a job from the caller's key/value pairs,
+// normalizing generic options on the way. Returns the new option count.
+static int _add_normalized_cups_options(int num_options, const char **option_keys, const char **option_values, int num_cups_options, cups_option_t **options)
+{
+    for (int i = 0; i < num_options; i++)
     {
-        LOG("get_modified_devmode: DocumentPropertiesW (get defaults) failed with error %lu", GetLastError());
-        free(pDevMode);
-        ClosePrinter(hPrinter);
-        return NULL;
+        const char *name;
+        const char *value;
+        if (!option_keys || !option_keys[i] || !option_values || !option_values[i])
+            continue;
+        if (!_normalize_ipp_option(option_keys[i], option_values[i], &name, &value))
+            continue;
+        LOG("Adding CUPS option: %s=%s", name, value);
+        num_cups_options = cupsAddOption(name, value, num_cups_options, options);
     }
-    LOG("get_modified_devmode: Successfully retrieved default DEVMODE.");
+    return num_cups_options;
+}
+#endif
 
-    bool modified = false;
-    // A value <= 0 for IDs/orientation means "use default".
-    if (paper_size_id > 0)
-    {
+// --- Media Sizes ---
+// PWG 5101.1 media sizes with their Windows DMPAPER ids, PPD PageSize names
+// and legacy IPP keywords. A name of any of the three kinds is found through a
+// perfect hash and a DMPAPER id through a direct index. Names that are not in
+// the table but use the PWG self-describing form (class_name_WxHunit), as every
+// IPP media-supported keyword does, are resolved by parsing their dimensions.
+
+typedef struct
+{
+    const char *pwg_name;
+    const char *ppd_name; // NULL if there is no common PPD PageSize name.
+    const char *ipp_name; // NULL if there is no legacy IPP keyword.
+    short windows_id;     // DMPAPER_* id, or 0 if Windows has none.
+    int width;            // Hundredths of a millimeter (PWG units).
+    int height;
+} PwgMedia;
+
+#define MEDIA_HASH_BITS 9
+
+// Generated by tool/gen_pwg_media.dart; do not edit by hand.
+static const PwgMedia s_pwg_media[] = {
+    {"na_letter_8.5x11in", "Letter", "na-letter", 1, 21590, 27940},
+    {"na_legal_8.5x14in", "Legal", "na-legal", 5, 21590, 35560},
+    {"na_ledger_11x17in", "Tabloid", "tabloid", 3, 27940, 43180},
+    {"na_executive_7.25x10.5in", "Executive", "executive", 7, 18415, 26670},
+    {"na_invoice_5.5x8.5in", "Statement", "invoice", 6, 13970, 21590},
+    {"na_foolscap_8.5x13in", "FanFoldGermanLegal", NULL, 14, 21590, 33020},
+    {"na_10x14_10x14in", "10x14", NULL, 16, 25400, 35560},
+    {"na_govt-letter_8x10in", "8x10", "na-8x10", 0, 20320, 25400},
+    {"na_5x7_5x7in", "5x7", "na-5x7", 0, 12700, 17780},
+    {"na_index-4x6_4x6in", "4x6", NULL, 0, 10160, 15240},
+    {"na_index-3x5_3x5in", "3x5", NULL, 0, 7620, 12700},
+    {"oe_photo-l_3.5x5in", "3.5x5", NULL, 0, 8890, 12700},
+    {"na_number-9_3.875x8.875in", "Env9", "na-number-9-envelope", 19, 9843, 22543},
+    {"na_number-10_4.125x9.5in", "Env10", "na-number-10-envelope", 20, 10478, 24130},
+    {"na_monarch_3.875x7.5in", "EnvMonarch", "monarch-envelope", 37, 9843, 19050},
+    {"na_personal_3.625x6.5in", "EnvPersonal", NULL, 38, 9208, 16510},
+    {"iso_a0_841x1189mm", "A0", "iso-a0", 0, 84100, 118900},
+    {"iso_a1_594x841mm", "A1", "iso-a1", 0, 59400, 84100},
+    {"iso_a2_420x594mm", "A2", "iso-a2", 66, 42000, 59400},
+    {"iso_a3_297x420mm", "A3", "iso-a3", 8, 29700, 42000},
+    {"iso_a4_210x297mm", "A4", "iso-a4", 9, 21000, 29700},
+    {"iso_a5_148x210mm", "A5", "iso-a5", 11, 14800, 21000},
+    {"iso_a6_105x148mm", "A6", "iso-a6", 70, 10500, 14800},
+    {"iso_b4_250x353mm", "ISOB4", "iso-b4", 42, 25000, 35300},
+    {"iso_b5_176x250mm", "ISOB5", "iso-b5", 34, 17600, 25000},
+    {"jis_b4_257x364mm", "B4", "jis-b4", 12, 25700, 36400},
+    {"jis_b5_182x257mm", "B5", "jis-b5", 13, 18200, 25700},
+    {"iso_c4_229x324mm", "EnvC4", "iso-c4", 30, 22900, 32400},
+    {"iso_c5_162x229mm", "EnvC5", "iso-c5", 28, 16200, 22900},
+    {"iso_c6_114x162mm", "EnvC6", "iso-c6", 31, 11400, 16200},
+    {"iso_dl_110x220mm", "EnvDL", "iso-designated-long", 27, 11000, 22000},
+    {"jpn_hagaki_100x148mm", "Postcard", NULL, 43, 10000, 14800},
+};
+#define MEDIA_HASH_SEED 5107u
+static const short s_media_slots[1 << MEDIA_HASH_BITS] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 48, 64, -1, -1, 124,
+    -1, -1, -1, -1, 44, 53, 104, 125, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, 117, -1, -1, 12, 109, -1, 113, -1, 94, -1, 98, -1, 17,
+    -1, -1, -1, 118, -1, 114, -1, 110, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 2, -1, -1, -1, -1, 25, -1, -1, -1, -1, -1, -1, -1, -1, 29,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 40, 10, -1,
+    -1, -1, -1, -1, 14, -1, -1, 41, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, 52, -1, -1, 18, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, 120, -1, -1, -1, -1, -1, 112, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, 57, -1, -1, -1, -1, -1, -1, 9, -1,
+    -1, -1, -1, -1, -1, -1, 32, -1, 33, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, 13, 85, 68, 81, -1, -1, 4, 89, -1, 69, -1, 65,
+    -1, 77, 84, 73, -1, -1, -1, -1, 58, -1, -1, -1, -1, -1, -1, -1,
+    -1, 106, -1, 102, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 36, -1, -1, -1, -1, -1, 61, -1, -1, -1, -1, -1, -1, -1, 8,
+    -1, -1, -1, -1, -1, -1, 0, -1, 54, -1, -1, -1, -1, 86, -1, 82,
+    -1, -1, -1, 90, -1, 70, -1, 66, -1, 78, -1, 74, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 92, -1, -1, 116, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 100, -1, -1, -1,
+    20, 34, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 21, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 80, -1, -1, -1, 96, -1, -1, 88, -1, -1, -1, -1, -1, -1, -1,
+    -1, 97, -1, 93, -1, -1, -1, 108, -1, -1, -1, 121, -1, -1, -1, -1,
+    50, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 72, -1, -1, -1,
+    -1, -1, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, 24, -1, -1, -1, 76, -1, -1, -1, -1, -1, -1, -1,
+    5, 30, -1, 49, -1, -1, -1, -1, -1, -1, -1, -1, 1, -1, -1, -1,
+    -1, 56, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, 28, -1, -1, 16, -1, -1, -1,
+    -1, -1, -1, 101, -1, 105, -1, 60, -1, -1, 45, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 37, -1, 122,
+};
+#define MEDIA_MAX_WINDOWS_ID 70
+static const signed char s_media_by_windows_id[MEDIA_MAX_WINDOWS_ID + 1] = {
+    -1, 0, -1, 2, -1, 1, 4, 3, 19, 20, -1, 21, 25, 26, 5, -1,
+    6, -1, -1, 12, 13, -1, -1, -1, -1, -1, -1, 30, 28, -1, 27, 29,
+    -1, -1, 24, -1, -1, 14, 15, -1, -1, -1, 23, 31, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, 18, -1, -1, -1, 22,
+};
+
+static const PwgMedia *_lookup_pwg_media(const char *name)
+{
+    if (!name)
+        return NULL;
+    int slot = s_media_slots[_perfect_hash(name, MEDIA_HASH_SEED, MEDIA_HASH_BITS)];
+    if (slot < 0)
+        return NULL;
+    const PwgMedia *media = &s_pwg_media[slot / 4];
+    const char *key = slot % 4 == 0 ? media->pwg_name : slot % 4 == 1 ? media->ppd_name : media->ipp_name;
+    return strcmp(key, name) == 0 ? media : NULL;
+}
+
+static const PwgMedia *_lookup_pwg_media_by_windows_id(int windows_id)
+{
+    if (windows_id <= 0 || windows_id > MEDIA_MAX_WINDOWS_ID || s_media_by_windows_id[windows_id] < 0)
+        return NULL;
+    return &s_pwg_media[s_media_by_windows_id[windows_id]];
+}
+
+// Parses one decimal dimension such as "8.5" in thousandths, without strtod so
+// that the result does not depend on the process locale.
+static const char *_parse_pwg_dimension(const char *p, long long *thousandths)
+{
+    long long value = 0;
+    int digits = 0;
+    for (; *p >= '0' && *p <= '9' && digits < 9; p++, digits++)
+        value = value * 10 + (*p - '0');
+    if (digits == 0)
+        return NULL;
+    int fraction = 0;
+    if (*p == '.')
+    {
+        for (p++; *p >= '0' && *p <= '9'; p++, fraction++)
+        {
+            if (fraction < 3)
+                value = value * 10 + (*p - '0');
+        }
+    }
+    for (; fraction < 3; fraction++)
+        value *= 10;
+    *thousandths = value;
+    return p;
+}
+
+// Reads the dimensions of a self-describing PWG name such as
+// "oe_4x6-label_4x6in" or "custom_foo_100x150mm" into PWG units.
+static bool _parse_pwg_media_name(const char *name, int *width, int *height)
+{
+    const char *first = strchr(name, '_');
+    const char *size = strrchr(name, '_');
+    if (!first || first == size)
+        return false;
+    long long w, h;
+    const char *p = _parse_pwg_dimension(size + 1, &w);
+    if (!p || *p != 'x' || !(p = _parse_pwg_dimension(p + 1, &h)))
+        return false;
+    long long scale;
+    if (strcmp(p, "in") == 0)
+        scale = 2540;
+    else if (strcmp(p, "mm") == 0)
+        scale = 100;
+    else
+        return false;
+    if (w <= 0 || h <= 0)
+        return false;
+    *width = (int)((w * scale + 500) / 1000);
+    *height = (int)((h * scale + 500) / 1000);
+    return true;
+}
+
+static MediaSizeInfo *_new_media_size_info(const char *pwg_name, const PwgMedia *media, int width, int height)
+{
+    MediaSizeInfo *info = (MediaSizeInfo *)calloc(1, sizeof(MediaSizeInfo));
+    if (!info)
+        return NULL;
+    info->pwg_name = strdup(pwg_name);
+    info->ppd_name = strdup(media && media->ppd_name ? media->ppd_name : "");
+    info->ipp_name = strdup(media && media->ipp_name ? media->ipp_name : "");
+    info->windows_id = media ? media->windows_id : 0;
+    info->width_mm = (float)width / 100.0f;
+    info->height_mm = (float)height / 100.0f;
+    if (!info->pwg_name || !info->ppd_name || !info->ipp_name)
+    {
+        free_media_size_info(info);
+        return NULL;
+    }
+    return info;
+}
+
+// Looks a media size up by PWG name, PPD PageSize name or legacy IPP keyword.
+// Unknown self-describing PWG names are parsed. Returns NULL if the name is
+// not recognized.
+FFI_PLUGIN_EXPORT MediaSizeInfo *get_media_size(const char *name)
+{
+    if (!name)
+        return NULL;
+    const PwgMedia *media = _lookup_pwg_media(name);
+    if (media)
+        return _new_media_size_info(media->pwg_name, media, media->width, media->height);
+    int width, height;
+    if (!_parse_pwg_media_name(name, &width, &height))
+        return NULL;
+    return _new_media_size_info(name, NULL, width, height);
+}
+
+// Looks a media size up by its Windows DMPAPER id. Returns NULL for ids that
+// are not standard sizes, such as driver-defined ids from 256 up.
+FFI_PLUGIN_EXPORT MediaSizeInfo *get_media_size_by_windows_id(int windows_id)
+{
+    const PwgMedia *media = _lookup_pwg_media_by_windows_id(windows_id);
+    return media ? _new_media_size_info(media->pwg_name, media, media->width, media->height) : NULL;
+}
+
+FFI_PLUGIN_EXPORT void free_media_size_info(MediaSizeInfo *info)
+{
+    if (!info)
+        return;
+    free(info->pwg_name);
+    free(info->ppd_name);
+    free(info->ipp_name);
+    free(info);
+}
+
+#ifdef _WIN32
+// Helper to convert UTF-8 char* to wchar_t*
+// The caller is responsible for freeing the returned string.
+static wchar_t *to_utf16(const char *utf8_str)
+{
+    if (!utf8_str)
+        return NULL;
+    int len = MultiByteToWideChar(CP_UTF8, 0, utf8_str, -1, NULL, 0);
+    if (len == 0)
+    {
+        LOG_WARN("MultiByteToWideChar to get len failed with error %lu", GetLastError());
+        return NULL;
+    }
+    wchar_t *utf16_str = (wchar_t *)malloc(len * sizeof(wchar_t));
+    if (!utf16_str)
+        return NULL;
+    if (MultiByteToWideChar(CP_UTF8, 0, utf8_str, -1, utf16_str, len) == 0)
+    {
+        LOG_WARN("MultiByteToWideChar to convert failed with error %lu", GetLastError());
+        free(utf16_str);
+        return NULL;
+    }
+    return utf16_str;
+}
+
+// Helper to convert wchar_t* to UTF-8 char*
+// The caller is responsible for freeing the returned string.
+static char *to_utf8(const wchar_t *utf16_str)
+{
+    if (!utf16_str)
+        return strdup("");
+    int len = WideCharToMultiByte(CP_UTF8, 0, utf16_str, -1, NULL, 0, NULL, NULL);
+    if (len == 0)
+        return strdup("");
+    char *utf8_str = (char *)malloc(len);
+    if (!utf8_str)
+        return strdup(""); // Should not happen
+    WideCharToMultiByte(CP_UTF8, 0, utf16_str, -1, utf8_str, len, NULL, NULL);
+    return utf8_str;
+}
+
+// Helper function to parse Windows-specific print options from the generic key-value array.
+// Keys are resolved through the option normalization table above.
+static void parse_windows_options(int num_options, const char** option_keys, const char** option_values,
+                                  int* paper_size_id, int* paper_source_id, int* orientation,
+                                  int* color_mode, int* print_quality, int* media_type_id, double* custom_scale,
+                                  bool* collate, int* duplex_mode) {
+    // Set default values
+    *paper_size_id = 0;
+    *paper_source_id = 0;
+    *orientation = 0;
+    *color_mode = 0;
+    *print_quality = 0;
+    *media_type_id = 0;
+    *custom_scale = 1.0; // Default to 100%
+    *collate = true; // Default to collated (complete copies printed together)
+    *duplex_mode = 0; // Default to single-sided (DMDUP_SIMPLEX)
+
+    for (int i = 0; i < num_options; i++)
+    {
+        const OptionKey *option = _lookup_option_key(option_keys[i]);
+        if (!option || !option_values[i])
+            continue;
+        const OptionChoice *choice = _lookup_option_choice(option, option_values[i]);
+        switch (option->field)
+        {
+        case OPTION_FIELD_PAPER_SIZE_ID:
+            *paper_size_id = atoi(option_values[i]);
+            break;
+        case OPTION_FIELD_PAPER_SOURCE_ID:
+            *paper_source_id = atoi(option_values[i]);
+            break;
+        case OPTION_FIELD_MEDIA_TYPE_ID:
+            *media_type_id = atoi(option_values[i]);
+            break;
+        case OPTION_FIELD_CUSTOM_SCALE:
+            *custom_scale = atof(option_values[i]);
+            break;
+        case OPTION_FIELD_ORIENTATION:
+            *orientation = choice->native;
+            break;
+        case OPTION_FIELD_COLOR_MODE:
+            *color_mode = choice->native;
+            // For monochrome, also ensure print quality is set to trigger driver update.
+            // If it's not already being set, use a neutral value.
+            if (*color_mode == 1 && *print_quality == 0)
+                *print_quality = -3; // DMRES_MEDIUM
+            break;
+        case OPTION_FIELD_PRINT_QUALITY:
+            *print_quality = choice->native;
+            break;
+        case OPTION_FIELD_COLLATE:
+            // true = collated (complete copies together), false = non-collated (all copies of each page together)
+            *collate = choice->native != 0;
+            break;
+        case OPTION_FIELD_DUPLEX:
+            // An unknown duplex value leaves the driver default in place.
+            if (choice)
+                *duplex_mode = choice->native;
+            break;
+        }
+    }
+}
+#endif
+
+#ifdef _WIN32
+// Helper to get a modified DEVMODE struct for a printer.
+// The caller is responsible for freeing the returned struct.
+static DEVMODEW* get_modified_devmode(wchar_t* printer_name_w, int paper_size_id, int paper_source_id, int orientation, int color_mode, int print_quality, int media_type_id, bool collate, int duplex_mode) {
+    if (!printer_name_w) return NULL;
+    LOG("get_modified_devmode: Creating DEVMODE for '%ls' with paper_id:%d, source_id:%d, orientation:%d, color:%d, quality:%d, media_id:%d, duplex:%d",
+        printer_name_w, paper_size_id, paper_source_id, orientation, color_mode, print_quality, media_type_id, duplex_mode);
+
+    HANDLE hPrinter;
+    if (!OpenPrinterW(printer_name_w, &hPrinter, NULL))
+    {
+        LOG_WARN("get_modified_devmode: OpenPrinterW failed with error %lu", GetLastError());
+        return NULL;
+    }
+
+    DEVMODEW *pDevMode = NULL;
+    LONG devModeSize = DocumentPropertiesW(NULL, hPrinter, printer_name_w, NULL, NULL, 0);
+    if (devModeSize <= 0)
+    {
+        LOG_WARN("get_modified_devmode: DocumentPropertiesW (get size) failed with error %lu. Size was %ld.", GetLastError(), devModeSize);
+        ClosePrinter(hPrinter);
+        return NULL;
+    }
+
+    pDevMode = (DEVMODEW *)malloc(devModeSize);
+    if (!pDevMode)
+    {
+        LOG_WARN("get_modified_devmode: Failed to allocate memory for DEVMODE.");
+        ClosePrinter(hPrinter);
+        return NULL;
+    }
+
+    // Get the default DEVMODE for the printer.
+    if (DocumentPropertiesW(NULL, hPrinter, printer_name_w, pDevMode, NULL, DM_OUT_BUFFER) != IDOK)
+    {
+        LOG_WARN("get_modified_devmode: DocumentPropertiesW (get defaults) failed with error %lu", GetLastError());
+        free(pDevMode);
+        ClosePrinter(hPrinter);
+        return NULL;
+    }
+    LOG("get_modified_devmode: Successfully retrieved default DEVMODE.");
+
+    bool modified = false;
+    // A value <= 0 for IDs/orientation means "use default".
+    if (paper_size_id > 0)
+    {
         LOG("get_modified_devmode: Setting dmPaperSize to %d.", paper_size_id);
         pDevMode->dmFields |= DM_PAPERSIZE;
         pDevMode->dmPaperSize = (short)paper_size_id;
@@ -434,7 +1147,7 @@ static DEVMODEW* get_modified_devmode(wchar_t* printer_name_w, int paper_size_id
         LONG result = DocumentPropertiesW(NULL, hPrinter, printer_name_w, pDevMode, pDevMode, DM_IN_BUFFER | DM_OUT_BUFFER);
         if (result != IDOK)
         {
-            LOG("get_modified_devmode: DocumentPropertiesW (merge) failed with result %ld and error %lu. The driver may have rejected the settings. Continuing anyway.", result, GetLastError());
+            LOG_WARN("get_modified_devmode: DocumentPropertiesW (merge) failed with result %ld and error %lu. The driver may have rejected the settings. Continuing anyway.", result, GetLastError());
         }
         else
         {
@@ -490,1337 +1203,6349 @@ FFI_PLUGIN_EXPORT int sum_long_running(int a, int b)
     return a + b;
 }
 
-FFI_PLUGIN_EXPORT PrinterList *get_printers(void)
+// --- Metrics ---
+
+// Call counts and latency histograms for the expensive native operations.
+// Each thread records into one of METRIC_SHARDS shards so that concurrent
+// isolates do not contend on the same cache lines; snapshots sum the shards.
+//
+// Histograms are log-linear over microseconds: values below 4us get a bucket
+// each, and every power of two above is split into 4 sub-buckets, which bounds
+// the relative error of a reported percentile to 25%.
+#define METRIC_SHARDS 16
+#define METRIC_SUB_BUCKETS 4
+
+typedef struct
 {
-    LOG("get_printers called");
-    PrinterList *list = (PrinterList *)malloc(sizeof(PrinterList));
-    if (!list)
-        return NULL;
-    list->count = 0;
-    list->printers = NULL;
+    uint64_t calls;
+    uint64_t errors;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t buckets[METRIC_HISTOGRAM_BUCKETS];
+} MetricCell;
+
+typedef struct
+{
+    MetricCell ops[METRIC_OP_COUNT];
+} MetricShard;
 
+static MetricShard s_metric_shards[METRIC_SHARDS];
+static uint64_t s_metric_next_shard = 0;
 #ifdef _WIN32
-    DWORD needed, returned;
-    EnumPrintersW(PRINTER_ENUM_LOCAL | PRINTER_ENUM_CONNECTIONS, NULL, 2, NULL, 0, &needed, &returned);
-    LOG("EnumPrintersW needed %lu bytes for printer list", needed);
-    if (needed == 0)
-    {
-        return list; // Return empty list
+__declspec(thread) static int s_metric_shard = -1;
+#else // macOS, Linux
+static __thread int s_metric_shard = -1;
+#endif
+
+static const char *const s_metric_op_names[METRIC_OP_COUNT] = {
+    "get_printers",
+    "get_print_jobs",
+    "print_raw",
+    "print_pdf",
+    "capabilities",
+    "ipp_request",
+};
+
+static int _metric_bucket(uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+    if (us < METRIC_SUB_BUCKETS)
+        return (int)us;
+    int exponent = 63;
+    while (!(us & (1ULL << exponent)))
+        exponent--;
+    int bucket = (exponent - 1) * METRIC_SUB_BUCKETS + (int)((us >> (exponent - 2)) & (METRIC_SUB_BUCKETS - 1));
+    return bucket < METRIC_HISTOGRAM_BUCKETS ? bucket : METRIC_HISTOGRAM_BUCKETS - 1;
+}
+
+// Exclusive upper bound of a histogram bucket, in nanoseconds.
+static uint64_t _metric_bucket_upper_ns(int bucket)
+{
+    if (bucket < METRIC_SUB_BUCKETS)
+        return (uint64_t)(bucket + 1) * 1000;
+    int exponent = bucket / METRIC_SUB_BUCKETS + 1;
+    uint64_t sub = (uint64_t)(bucket % METRIC_SUB_BUCKETS);
+    return ((METRIC_SUB_BUCKETS + sub + 1) << (exponent - 2)) * 1000;
+}
+
+// Records one call of `op` that started at `started_ns` (see _monotonic_ns).
+static void _metrics_record(int op, uint64_t started_ns, bool ok)
+{
+    uint64_t elapsed = _monotonic_ns() - started_ns;
+    if (s_metric_shard < 0)
+        s_metric_shard = (int)(ffi_atomic_add_u64(&s_metric_next_shard, 1) % METRIC_SHARDS);
+    MetricCell *cell = &s_metric_shards[s_metric_shard].ops[op];
+
+    ffi_atomic_add_u64(&cell->calls, 1);
+    if (!ok)
+        ffi_atomic_add_u64(&cell->errors, 1);
+    ffi_atomic_add_u64(&cell->total_ns, elapsed);
+    ffi_atomic_add_u64(&cell->buckets[_metric_bucket(elapsed)], 1);
+    uint64_t max = ffi_atomic_load_u64(&cell->max_ns);
+    while (elapsed > max && !ffi_atomic_cas_u64(&cell->max_ns, max, elapsed))
+        max = ffi_atomic_load_u64(&cell->max_ns);
+}
+
+// Nearest-rank percentile from a histogram, reported as the containing bucket's
+// upper bound but never above the largest recorded value.
+static uint64_t _metric_percentile(const OperationMetrics *op, uint64_t count, double quantile)
+{
+    if (count == 0)
+        return 0;
+    uint64_t rank = (uint64_t)(quantile * (double)count + 0.999999);
+    if (rank == 0)
+        rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += op->buckets[i];
+        if (seen >= rank)
+        {
+            uint64_t upper = _metric_bucket_upper_ns(i);
+            return upper < op->max_ns ? upper : op->max_ns;
+        }
     }
-    BYTE *buffer = (BYTE *)malloc(needed);
-    if (!buffer)
-    {
-        free(list);
+    return op->max_ns;
+}
+
+#ifndef _WIN32
+// cupsDoRequest with the round trip recorded under METRIC_OP_IPP_REQUEST.
+static ipp_t *_ipp_do_request(http_t *http, ipp_t *request, const char *resource)
+{
+    uint64_t started = _monotonic_ns();
+    ipp_t *response = cupsDoRequest(http, request, resource);
+    _metrics_record(METRIC_OP_IPP_REQUEST, started, response && cupsLastError() <= IPP_STATUS_OK_CONFLICTING);
+    return response;
+}
+#endif
+
+FFI_PLUGIN_EXPORT MetricsSnapshot *get_metrics_snapshot(void)
+{
+    MetricsSnapshot *snapshot = (MetricsSnapshot *)calloc(1, sizeof(MetricsSnapshot));
+    if (!snapshot)
         return NULL;
-    }
 
-    if (EnumPrintersW(PRINTER_ENUM_LOCAL | PRINTER_ENUM_CONNECTIONS, NULL, 2, buffer, needed, &needed, &returned))
+    for (int s = 0; s < METRIC_SHARDS; s++)
     {
-        LOG("Found %lu printers on Windows", returned);
-        list->count = (int)returned; // Cast to int for consistency
-        list->printers = (PrinterInfo *)malloc(returned * sizeof(PrinterInfo));
-        if (!list->printers)
-        {
-            free(buffer);
-            free(list);
-            return NULL;
-        }
-        PRINTER_INFO_2W *printers = (PRINTER_INFO_2W *)buffer;
-        for (DWORD i = 0; i < returned; i++)
+        for (int op = 0; op < METRIC_OP_COUNT; op++)
         {
-            list->printers[i].name = to_utf8(printers[i].pPrinterName);
-            list->printers[i].state = (int)printers[i].Status;         // Cast to int
-            list->printers[i].url = to_utf8(printers[i].pPrinterName); // Use printer name as URL for Windows
-            list->printers[i].model = to_utf8(printers[i].pDriverName);
-            list->printers[i].location = to_utf8(printers[i].pLocation);
-            list->printers[i].comment = to_utf8(printers[i].pComment);
-            list->printers[i].is_default = (printers[i].Attributes & PRINTER_ATTRIBUTE_DEFAULT) != 0;
-            list->printers[i].is_available = (printers[i].Status & PRINTER_STATUS_OFFLINE) == 0;
+            MetricCell *cell = &s_metric_shards[s].ops[op];
+            OperationMetrics *out = &snapshot->operations[op];
+            out->calls += ffi_atomic_load_u64(&cell->calls);
+            out->errors += ffi_atomic_load_u64(&cell->errors);
+            out->total_ns += ffi_atomic_load_u64(&cell->total_ns);
+            uint64_t max = ffi_atomic_load_u64(&cell->max_ns);
+            if (max > out->max_ns)
+                out->max_ns = max;
+            for (int b = 0; b < METRIC_HISTOGRAM_BUCKETS; b++)
+                out->buckets[b] += ffi_atomic_load_u64(&cell->buckets[b]);
         }
     }
-    else
-    {
-        LOG("EnumPrintersW failed with error %lu", GetLastError());
-    }
-    free(buffer);
-    return list;
-#else // macOS / Linux
-    cups_dest_t *dests = NULL;
-    LOG("Calling cupsGetDests to find printers");
-    int num_dests = cupsGetDests(&dests);
-    if (num_dests <= 0)
-    {
-        cupsFreeDests(num_dests, dests);
-        return list; // Return empty list
-    }
 
-    LOG("Found %d printers on CUPS-based system", num_dests);
-    list->count = num_dests;
-    list->printers = (PrinterInfo *)malloc(num_dests * sizeof(PrinterInfo));
-    if (!list->printers)
+    for (int op = 0; op < METRIC_OP_COUNT; op++)
     {
-        cupsFreeDests(num_dests, dests);
-        free(list);
-        return NULL;
+        OperationMetrics *out = &snapshot->operations[op];
+        // Counters are read one by one, so a call in flight may be counted in
+        // `calls` but not yet in the histogram. Derive the percentiles from
+        // the histogram's own total to keep them consistent.
+        uint64_t histogram_calls = 0;
+        for (int b = 0; b < METRIC_HISTOGRAM_BUCKETS; b++)
+            histogram_calls += out->buckets[b];
+        out->p50_ns = _metric_percentile(out, histogram_calls, 0.50);
+        out->p90_ns = _metric_percentile(out, histogram_calls, 0.90);
+        out->p99_ns = _metric_percentile(out, histogram_calls, 0.99);
+        out->p999_ns = _metric_percentile(out, histogram_calls, 0.999);
     }
+    return snapshot;
+}
 
-    for (int i = 0; i < num_dests; i++)
-    {
-        list->printers[i].name = strdup(dests[i].name ? dests[i].name : "");
-        list->printers[i].is_default = dests[i].is_default;
-
-        const char *state_str = cupsGetOption("printer-state", dests[i].num_options, dests[i].options);
-        list->printers[i].state = state_str ? atoi(state_str) : 3;     // Default to IPP_PRINTER_IDLE (3)
-        list->printers[i].is_available = list->printers[i].state != 5; // 5 is IPP_PRINTER_STOPPED
-
-        const char *uri_str = cupsGetOption("device-uri", dests[i].num_options, dests[i].options);
-        list->printers[i].url = strdup(uri_str ? uri_str : "");
-
-        const char *model_str = cupsGetOption("printer-make-and-model", dests[i].num_options, dests[i].options);
-        list->printers[i].model = strdup(model_str ? model_str : "");
-
-        const char *location_str = cupsGetOption("printer-location", dests[i].num_options, dests[i].options);
-        list->printers[i].location = strdup(location_str ? location_str : "");
-
-        const char *comment_str = cupsGetOption("printer-info", dests[i].num_options, dests[i].options);
-        list->printers[i].comment = strdup(comment_str ? comment_str : "");
-    }
-    cupsFreeDests(num_dests, dests);
-    return list;
-#endif
+FFI_PLUGIN_EXPORT void free_metrics_snapshot(MetricsSnapshot *snapshot)
+{
+    free(snapshot);
 }
 
-FFI_PLUGIN_EXPORT void free_printer_list(PrinterList *printer_list)
+FFI_PLUGIN_EXPORT void reset_metrics(void)
 {
-    if (!printer_list)
-        return;
-    if (printer_list->printers)
+    for (int s = 0; s < METRIC_SHARDS; s++)
     {
-        for (int i = 0; i < printer_list->count; i++)
+        for (int op = 0; op < METRIC_OP_COUNT; op++)
         {
-            free(printer_list->printers[i].name);
-            free(printer_list->printers[i].url);
-            free(printer_list->printers[i].model);
-            free(printer_list->printers[i].location);
-            free(printer_list->printers[i].comment);
+            MetricCell *cell = &s_metric_shards[s].ops[op];
+            ffi_atomic_store_u64(&cell->calls, 0);
+            ffi_atomic_store_u64(&cell->errors, 0);
+            ffi_atomic_store_u64(&cell->total_ns, 0);
+            ffi_atomic_store_u64(&cell->max_ns, 0);
+            for (int b = 0; b < METRIC_HISTOGRAM_BUCKETS; b++)
+                ffi_atomic_store_u64(&cell->buckets[b], 0);
         }
-        free(printer_list->printers);
     }
-    free(printer_list);
 }
 
-FFI_PLUGIN_EXPORT PrinterInfo *get_default_printer(void)
+// Growable string buffer for the text renderers.
+typedef struct
 {
-    LOG("get_default_printer called");
-#ifdef _WIN32
-    DWORD len = 0;
-    GetDefaultPrinterW(NULL, &len);
-    if (len == 0)
-    {
-        return NULL; // No default printer or an error occurred
-    }
-
-    wchar_t *default_printer_name_w = (wchar_t *)malloc(len * sizeof(wchar_t));
-    if (!default_printer_name_w)
-        return NULL;
+    char *data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} StringBuilder;
 
-    if (!GetDefaultPrinterW(default_printer_name_w, &len))
+static void _sb_appendf(StringBuilder *sb, const char *format, ...)
+{
+    if (sb->failed)
+        return;
+    va_list args;
+    va_start(args, format);
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int size = vsnprintf(NULL, 0, format, args_copy);
+    va_end(args_copy);
+    if (size < 0)
     {
-        LOG("GetDefaultPrinterW failed with error %lu", GetLastError());
-        free(default_printer_name_w);
-        return NULL;
+        sb->failed = true;
+        va_end(args);
+        return;
     }
-
-    HANDLE hPrinter;
-    if (!OpenPrinterW(default_printer_name_w, &hPrinter, NULL))
+    if (sb->length + (size_t)size + 1 > sb->capacity)
     {
-        LOG("OpenPrinterW for default printer failed with error %lu", GetLastError());
-        free(default_printer_name_w);
-        return NULL;
+        size_t capacity = sb->capacity ? sb->capacity : 1024;
+        while (sb->length + (size_t)size + 1 > capacity)
+            capacity *= 2;
+        char *data = (char *)realloc(sb->data, capacity);
+        if (!data)
+        {
+            sb->failed = true;
+            va_end(args);
+            return;
+        }
+        sb->data = data;
+        sb->capacity = capacity;
     }
+    vsnprintf(sb->data + sb->length, (size_t)size + 1, format, args);
+    sb->length += (size_t)size;
+    va_end(args);
+}
 
-    DWORD needed = 0;
-    GetPrinterW(hPrinter, 2, NULL, 0, &needed);
-    if (needed == 0)
-    {
-        LOG("GetPrinterW (to get size) failed with error %lu", GetLastError());
-        ClosePrinter(hPrinter);
-        free(default_printer_name_w);
+// Returns the metrics in the Prometheus text exposition format.
+// The caller must release the string with free_native_string.
+FFI_PLUGIN_EXPORT char *render_metrics_prometheus(void)
+{
+    MetricsSnapshot *snapshot = get_metrics_snapshot();
+    if (!snapshot)
         return NULL;
-    }
 
-    PRINTER_INFO_2W *pinfo2 = (PRINTER_INFO_2W *)malloc(needed);
-    if (!pinfo2)
-    {
-        ClosePrinter(hPrinter);
-        free(default_printer_name_w);
-        return NULL;
-    }
+    StringBuilder sb = {0};
+    _sb_appendf(&sb, "# HELP printing_ffi_calls_total Native calls by operation.\n# TYPE printing_ffi_calls_total counter\n");
+    for (int op = 0; op < METRIC_OP_COUNT; op++)
+        _sb_appendf(&sb, "printing_ffi_calls_total{operation=\"%s\"} %llu\n", s_metric_op_names[op], (unsigned long long)snapshot->operations[op].calls);
 
-    if (!GetPrinterW(hPrinter, 2, (LPBYTE)pinfo2, needed, &needed))
-    {
-        LOG("GetPrinterW (to get data) failed with error %lu", GetLastError());
-        free(pinfo2);
-        ClosePrinter(hPrinter);
-        free(default_printer_name_w);
-        return NULL;
-    }
-    ClosePrinter(hPrinter);
-    free(default_printer_name_w); // We have the info in pinfo2 now
+    _sb_appendf(&sb, "# HELP printing_ffi_call_errors_total Failed native calls by operation.\n# TYPE printing_ffi_call_errors_total counter\n");
+    for (int op = 0; op < METRIC_OP_COUNT; op++)
+        _sb_appendf(&sb, "printing_ffi_call_errors_total{operation=\"%s\"} %llu\n", s_metric_op_names[op], (unsigned long long)snapshot->operations[op].errors);
 
-    PrinterInfo *printer_info = (PrinterInfo *)malloc(sizeof(PrinterInfo));
-    if (!printer_info)
+    _sb_appendf(&sb, "# HELP printing_ffi_call_duration_seconds Latency of native calls by operation.\n# TYPE printing_ffi_call_duration_seconds histogram\n");
+    for (int op = 0; op < METRIC_OP_COUNT; op++)
     {
-        free(pinfo2);
-        return NULL;
+        const OperationMetrics *metrics = &snapshot->operations[op];
+        const char *name = s_metric_op_names[op];
+        uint64_t cumulative = 0;
+        for (int b = 0; b < METRIC_HISTOGRAM_BUCKETS; b++)
+        {
+            // Empty buckets add no information to a cumulative histogram.
+            if (metrics->buckets[b] == 0)
+                continue;
+            cumulative += metrics->buckets[b];
+            _sb_appendf(&sb, "printing_ffi_call_duration_seconds_bucket{operation=\"%s\",le=\"%.6f\"} %llu\n",
+                        name, (double)_metric_bucket_upper_ns(b) / 1e9, (unsigned long long)cumulative);
+        }
+        _sb_appendf(&sb, "printing_ffi_call_duration_seconds_bucket{operation=\"%s\",le=\"+Inf\"} %llu\n", name, (unsigned long long)cumulative);
+        _sb_appendf(&sb, "printing_ffi_call_duration_seconds_sum{operation=\"%s\"} %.9f\n", name, (double)metrics->total_ns / 1e9);
+        _sb_appendf(&sb, "printing_ffi_call_duration_seconds_count{operation=\"%s\"} %llu\n", name, (unsigned long long)cumulative);
     }
-    printer_info->name = to_utf8(pinfo2->pPrinterName);
-    printer_info->state = (int)pinfo2->Status; // Cast to int
-    printer_info->url = to_utf8(pinfo2->pPrinterName);
-    printer_info->model = to_utf8(pinfo2->pDriverName);
-    printer_info->location = to_utf8(pinfo2->pLocation);
-    printer_info->comment = to_utf8(pinfo2->pComment);
-    printer_info->is_default = (pinfo2->Attributes & PRINTER_ATTRIBUTE_DEFAULT) != 0;
-    printer_info->is_available = (pinfo2->Status & PRINTER_STATUS_OFFLINE) == 0;
+    free_metrics_snapshot(snapshot);
 
-    free(pinfo2);
-    return printer_info;
-#else // macOS / Linux
-    const char *default_printer_name = cupsGetDefault();
-    if (!default_printer_name)
+    if (sb.failed)
     {
-        LOG("cupsGetDefault returned null, no default printer found.");
+        free(sb.data);
         return NULL;
     }
-    LOG("CUPS default printer name: %s", default_printer_name);
-
-    cups_dest_t *dests = NULL;
-    int num_dests = cupsGetDests(&dests);
-    cups_dest_t *default_dest = cupsGetDest(default_printer_name, NULL, num_dests, dests);
+    return sb.data;
+}
 
-    if (!default_dest)
-    {
-        cupsFreeDests(num_dests, dests);
-        return NULL;
-    }
+FFI_PLUGIN_EXPORT void free_native_string(char *str)
+{
+    free(str);
+}
 
-    PrinterInfo *printer_info = (PrinterInfo *)malloc(sizeof(PrinterInfo));
-    if (!printer_info)
-    {
-        cupsFreeDests(num_dests, dests);
-        return NULL;
-    }
+// --- Trace Event Recording ---
 
-    printer_info->name = strdup(default_dest->name ? default_dest->name : "");
-    printer_info->is_default = default_dest->is_default;
-    const char *state_str = cupsGetOption("printer-state", default_dest->num_options, default_dest->options);
-    printer_info->state = state_str ? atoi(state_str) : 3;
-    printer_info->is_available = printer_info->state != 5;
-    const char *uri_str = cupsGetOption("device-uri", default_dest->num_options, default_dest->options);
-    printer_info->url = strdup(uri_str ? uri_str : "");
-    const char *model_str = cupsGetOption("printer-make-and-model", default_dest->num_options, default_dest->options);
-    printer_info->model = strdup(model_str ? model_str : "");
-    const char *location_str = cupsGetOption("printer-location", default_dest->num_options, default_dest->options);
-    printer_info->location = strdup(location_str ? location_str : "");
-    const char *comment_str = cupsGetOption("printer-info", default_dest->num_options, default_dest->options);
-    printer_info->comment = strdup(comment_str ? comment_str : "");
+// Opt-in spans around the heavy native operations, written as Chrome trace
+// events (viewable in chrome://tracing or Perfetto) by stop_trace_recording.
+// While no recording is active a span costs one load of s_trace_recording.
+#define TRACE_ARGS_MAX 192
+#define TRACE_MAX_EVENTS (1 << 20)
 
-    cupsFreeDests(num_dests, dests);
-    return printer_info;
+typedef struct
+{
+    const char *name; // Always a string literal.
+    uint64_t started_ns;
+    bool active;
+    size_t args_length;
+    char args[TRACE_ARGS_MAX]; // JSON object members, already escaped.
+} TraceSpan;
+
+typedef struct
+{
+    const char *name;
+    uint64_t tid;
+    uint64_t started_ns;
+    uint64_t duration_ns;
+    char args[TRACE_ARGS_MAX];
+} TraceEvent;
+
+static volatile int s_trace_recording = 0;
+static ffi_mutex_t s_trace_lock = FFI_MUTEX_INITIALIZER;
+static TraceEvent *s_trace_events = NULL;
+static int s_trace_event_count = 0;
+static int s_trace_event_capacity = 0;
+static uint64_t s_trace_dropped = 0;
+static char *s_trace_path = NULL;
+
+static uint64_t _trace_thread_id(void)
+{
+#ifdef _WIN32
+    return (uint64_t)GetCurrentThreadId();
+#elif defined(__APPLE__)
+    uint64_t tid = 0;
+    pthread_threadid_np(NULL, &tid);
+    return tid;
+#elif defined(__linux__)
+    return (uint64_t)syscall(SYS_gettid);
+#else
+    return (uint64_t)(uintptr_t)pthread_self();
 #endif
 }
 
-FFI_PLUGIN_EXPORT void free_printer_info(PrinterInfo *printer_info)
+static void _trace_begin(TraceSpan *span, const char *name)
 {
-    if (!printer_info)
+    span->active = s_trace_recording != 0;
+    if (!span->active)
         return;
-    free(printer_info->name);
-    free(printer_info->url);
-    free(printer_info->model);
-    free(printer_info->location);
-    free(printer_info->comment);
-    free(printer_info);
+    span->name = name;
+    span->args_length = 0;
+    span->args[0] = '\0';
+    span->started_ns = _monotonic_ns();
 }
 
-FFI_PLUGIN_EXPORT bool raw_data_to_printer(const char *printer_name, const uint8_t *data, int length, const char *doc_name, int num_options, const char **option_keys, const char **option_values)
+// Appends `"key":"value"` to the span's args, escaping the value for JSON.
+static void _trace_arg_str(TraceSpan *span, const char *key, const char *value)
 {
-    LOG("raw_data_to_printer called for printer: '%s', doc: '%s', length: %d", printer_name, doc_name, length);
-
-    // Validate input parameters
-    if (!printer_name || !data || length <= 0 || !doc_name)
+    if (!span->active || !value)
+        return;
+    char *out = span->args + span->args_length;
+    char *end = span->args + TRACE_ARGS_MAX - 2; // Room for the closing quote and NUL.
+    int written = snprintf(out, (size_t)(end - out), "%s\"%s\":\"", span->args_length ? "," : "", key);
+    if (written < 0 || out + written >= end)
+        return;
+    out += written;
+    for (const unsigned char *p = (const unsigned char *)value; *p && out < end - 6; p++)
     {
-        LOG("Invalid input parameters");
-        return false;
+        if (*p == '"' || *p == '\\')
+        {
+            *out++ = '\\';
+            *out++ = (char)*p;
+        }
+        else if (*p < 0x20)
+        {
+            out += snprintf(out, 7, "\\u%04x", *p);
+        }
+        else
+        {
+            *out++ = (char)*p;
+        }
     }
+    *out++ = '"';
+    *out = '\0';
+    span->args_length = (size_t)(out - span->args);
+}
 
-#ifdef _WIN32
-    int paper_size_id, paper_source_id, orientation, color_mode, print_quality, media_type_id, duplex_mode;
-    double custom_scale; // Dummy for raw printing
-    bool collate = true; // Default to collated (complete copies printed together)
-    parse_windows_options(num_options, option_keys, option_values, &paper_size_id, &paper_source_id, &orientation, &color_mode, &print_quality, &media_type_id, &custom_scale, &collate, &duplex_mode);
-
-    HANDLE hPrinter;
-    DOC_INFO_1W docInfo;
-    DWORD written;
-    wchar_t *printer_name_w = to_utf16(printer_name);
-    if (!printer_name_w)
-        return false;
+static void _trace_arg_int(TraceSpan *span, const char *key, int64_t value)
+{
+    if (!span->active)
+        return;
+    size_t remaining = TRACE_ARGS_MAX - span->args_length;
+    int written = snprintf(span->args + span->args_length, remaining, "%s\"%s\":%lld", span->args_length ? "," : "", key, (long long)value);
+    if (written > 0 && (size_t)written < remaining)
+        span->args_length += (size_t)written;
+    else
+        span->args[span->args_length] = '\0';
+}
 
-    DEVMODEW *pDevMode = get_modified_devmode(printer_name_w, paper_size_id, paper_source_id, orientation, color_mode, print_quality, media_type_id, collate, duplex_mode);
+static void _trace_end(TraceSpan *span)
+{
+    if (!span->active)
+        return;
+    span->active = false;
+    uint64_t ended_ns = _monotonic_ns();
 
-    PRINTER_DEFAULTSW printerDefaults = {NULL, pDevMode, PRINTER_ACCESS_USE};
-    printerDefaults.pDatatype = L"RAW";
+    ffi_mutex_lock(&s_trace_lock);
+    // The recording may have been stopped (and written) while the span was open.
+    if (s_trace_recording)
+    {
+        if (s_trace_event_count == s_trace_event_capacity && s_trace_event_capacity < TRACE_MAX_EVENTS)
+        {
+            int capacity = s_trace_event_capacity ? s_trace_event_capacity * 2 : 1024;
+            TraceEvent *events = (TraceEvent *)realloc(s_trace_events, (size_t)capacity * sizeof(TraceEvent));
+            if (events)
+            {
+                s_trace_events = events;
+                s_trace_event_capacity = capacity;
+            }
+        }
+        if (s_trace_event_count < s_trace_event_capacity)
+        {
+            TraceEvent *event = &s_trace_events[s_trace_event_count++];
+            event->name = span->name;
+            event->tid = _trace_thread_id();
+            event->started_ns = span->started_ns;
+            event->duration_ns = ended_ns - span->started_ns;
+            memcpy(event->args, span->args, span->args_length + 1);
+        }
+        else
+        {
+            s_trace_dropped++;
+        }
+    }
+    ffi_mutex_unlock(&s_trace_lock);
+}
 
-    if (!OpenPrinterW(printer_name_w, &hPrinter, &printerDefaults))
+// Starts recording spans. Any recording in progress is discarded.
+// Returns false if `output_path` is NULL or memory could not be allocated.
+FFI_PLUGIN_EXPORT bool start_trace_recording(const char *output_path)
+{
+    if (!output_path)
     {
-        LOG("OpenPrinterW failed with error %lu", GetLastError());
-        free(printer_name_w);
-        if (pDevMode)
-            free(pDevMode);
+        set_last_error("A trace output path is required.");
         return false;
     }
+    char *path = strdup(output_path);
+    if (!path)
+        return false;
 
-    wchar_t *doc_name_w = to_utf16(doc_name);
-    docInfo.pDocName = doc_name_w;
-    docInfo.pOutputFile = NULL;
-    docInfo.pDatatype = L"RAW";
+    ffi_mutex_lock(&s_trace_lock);
+    free(s_trace_path);
+    s_trace_path = path;
+    s_trace_event_count = 0;
+    s_trace_dropped = 0;
+    s_trace_recording = 1;
+    ffi_mutex_unlock(&s_trace_lock);
+    LOG_INFO("Trace recording started, writing to '%s' on stop", output_path);
+    return true;
+}
 
-    if (StartDocPrinterW(hPrinter, 1, (LPBYTE)&docInfo) == 0)
+// Stops recording and writes the spans recorded since start_trace_recording
+// to its output path in the Chrome trace event JSON format.
+FFI_PLUGIN_EXPORT bool stop_trace_recording(void)
+{
+    ffi_mutex_lock(&s_trace_lock);
+    if (!s_trace_recording)
     {
-        ClosePrinter(hPrinter);
-        LOG("StartDocPrinterW failed with error %lu", GetLastError());
-        if (doc_name_w)
-            free(doc_name_w);
-        free(printer_name_w);
-        if (pDevMode)
-            free(pDevMode);
+        ffi_mutex_unlock(&s_trace_lock);
+        set_last_error("No trace recording is in progress.");
         return false;
     }
-    if (doc_name_w)
-        free(doc_name_w);
+    s_trace_recording = 0;
 
-    if (!StartPagePrinter(hPrinter))
+    FILE *file = fopen(s_trace_path, "w");
+    if (!file)
     {
-        EndDocPrinter(hPrinter);
-        ClosePrinter(hPrinter);
-        LOG("StartPagePrinter failed with error %lu", GetLastError());
-        free(printer_name_w);
-        if (pDevMode)
-            free(pDevMode);
+        set_last_error("Failed to open trace output file '%s'.", s_trace_path);
+        LOG_WARN("Trace recording: failed to open '%s'", s_trace_path);
+        ffi_mutex_unlock(&s_trace_lock);
         return false;
     }
 
-    bool result = WritePrinter(hPrinter, (LPVOID)data, (DWORD)length, &written);
-    EndPagePrinter(hPrinter);
-    EndDocPrinter(hPrinter);
-    ClosePrinter(hPrinter);
-    free(printer_name_w);
-    if (pDevMode)
-        free(pDevMode);
-
-    bool success = result && written == (DWORD)length;
-    if (!success)
-    {
-        LOG("WritePrinter failed. Result: %d, Bytes written: %lu, Expected: %d", result, written, length);
-    }
-    return success;
-#else // macOS / Linux
-    // Use getenv("TMPDIR") to get the correct temporary directory,
-    // especially important for sandboxed macOS apps where /tmp is not writable.
-    const char *tmpdir = getenv("TMPDIR");
-    if (!tmpdir)
-    {
-        tmpdir = "/tmp"; // Fallback for Linux or non-sandboxed environments
-    }
+#ifdef _WIN32
+    unsigned long pid = GetCurrentProcessId();
+#else
+    unsigned long pid = (unsigned long)getpid();
+#endif
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":%llu},\"traceEvents\":[", (unsigned long long)s_trace_dropped);
+    for (int i = 0; i < s_trace_event_count; i++)
+    {
+        const TraceEvent *event = &s_trace_events[i];
+        // Complete ("X") events carry begin and duration in one record; times are in microseconds.
+        fprintf(file, "%s\n{\"name\":\"%s\",\"cat\":\"printing_ffi\",\"ph\":\"X\",\"pid\":%lu,\"tid\":%llu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{%s}}",
+                i ? "," : "", event->name, pid, (unsigned long long)event->tid,
+                (double)event->started_ns / 1000.0, (double)event->duration_ns / 1000.0, event->args);
+    }
+    fprintf(file, "\n]}\n");
+    bool ok = !ferror(file);
+    if (fclose(file) != 0)
+        ok = false;
+    if (!ok)
+        set_last_error("Failed to write trace output file '%s'.", s_trace_path);
+    LOG_INFO("Trace recording stopped, %d events written to '%s'", s_trace_event_count, s_trace_path);
+
+    free(s_trace_events);
+    s_trace_events = NULL;
+    s_trace_event_count = 0;
+    s_trace_event_capacity = 0;
+    ffi_mutex_unlock(&s_trace_lock);
+    return ok;
+}
 
-    char temp_file[PATH_MAX];
-    snprintf(temp_file, sizeof(temp_file), "%s/printing_ffi_XXXXXX", tmpdir);
-    LOG("Creating temporary file at: %s", temp_file);
+// --- Call Recording ---
 
-    int fd = mkstemp(temp_file);
-    if (fd == -1)
-    {
-        LOG("mkstemp failed to create temporary file");
-        return false;
-    }
+// Opt-in binary log of the calls made through the library, so that real
+// traffic (including its bursts) can be re-issued by `printing_ffi_bench
+// replay`. Payloads are not stored, only their size and FNV-1a hash; PDF
+// calls store the file path and size and leave the hash 0. Job control calls
+// store their job ids, paged listings their arguments and status sweeps the
+// printer names, so that replay can issue them again. While no
+// recording is active a call costs one load of s_call_recording.
+#define CALL_RECORD_MAGIC "PFFIREC1"
+#define CALL_RECORD_NULL_STRING 0xFFFF
 
-    FILE *fp = fdopen(fd, "wb");
-    if (!fp)
+typedef struct
+{
+    int call;
+    const char *printer_name;
+    const char *doc_name;
+    const char *pdf_file_path;
+    const char *page_range;
+    const char *alignment;
+    int copies;
+    int scaling_mode;
+    uint64_t payload_size;
+    uint64_t payload_hash;
+    int num_options;
+    const char **option_keys;
+    const char **option_values;
+    int num_values;
+    const uint32_t *values; // Job ids, or the scope or paging arguments.
+    int num_names;
+    const char **names; // The printers of a status sweep.
+} CallRecordArgs;
+
+static volatile int s_call_recording = 0;
+static ffi_mutex_t s_call_record_lock = FFI_MUTEX_INITIALIZER;
+static FILE *s_call_record_file = NULL;
+static uint64_t s_call_record_epoch_ns = 0;
+static uint64_t s_call_record_count = 0;
+
+static uint64_t _fnv1a64(const uint8_t *data, size_t length)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++)
     {
-        close(fd);
-        unlink(temp_file);
-        return false;
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
     }
+    return hash;
+}
 
-    size_t written = fwrite(data, 1, (size_t)length, fp);
-    fclose(fp);
+static uint8_t *_rec_put(uint8_t *out, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        *out++ = (uint8_t)(value >> (8 * i));
+    return out;
+}
 
-    if (written != (size_t)length)
-    {
-        unlink(temp_file);
-        return false;
-    }
+// Strings are a uint16 length and the bytes, truncated to 64KiB - 2; NULL is
+// written as the length CALL_RECORD_NULL_STRING.
+static size_t _rec_string_length(const char *value)
+{
+    if (!value)
+        return 0;
+    size_t length = strlen(value);
+    return length < CALL_RECORD_NULL_STRING ? length : CALL_RECORD_NULL_STRING - 1;
+}
 
-    // Add the "raw" option to tell CUPS not to filter the data.
-    cups_option_t *options = NULL;
-    int num_cups_options = 0;
-    num_cups_options = cupsAddOption("raw", "true", num_cups_options, &options);
+static uint8_t *_rec_put_string(uint8_t *out, const char *value)
+{
+    if (!value)
+        return _rec_put(out, CALL_RECORD_NULL_STRING, 2);
+    size_t length = _rec_string_length(value);
+    out = _rec_put(out, length, 2);
+    memcpy(out, value, length);
+    return out + length;
+}
 
+// Record layout after the uint32 length: u8 call, u8 ok, u16 option count,
+// u64 start offset from the recording start (ns), u64 duration (ns),
+// i64 result (job id, printer, job or status count, or 0/1), i32 copies,
+// i32 scaling mode, u64 payload size, u64 payload hash, then the strings
+// printer, document name, PDF path, page range and alignment, followed by
+// the option keys and values interleaved. Version 2 appends a u16 count and
+// that many u32 values, and a u16 count and that many printer name strings.
+static void _call_record_write(const CallRecordArgs *args, uint64_t started_ns, bool ok, int64_t result)
+{
+    uint64_t ended_ns = _monotonic_ns();
+    int num_options = args->num_options > 0 && args->option_keys && args->option_values ? args->num_options : 0;
+    if (num_options > 0xFFFF)
+        num_options = 0xFFFF;
+    int num_values = args->num_values > 0 && args->values ? args->num_values : 0;
+    if (num_values > 0xFFFF)
+        num_values = 0xFFFF;
+    int num_names = args->num_names > 0 && args->names ? args->num_names : 0;
+    if (num_names > 0xFFFF)
+        num_names = 0xFFFF;
+
+    const char *strings[] = {args->printer_name, args->doc_name, args->pdf_file_path, args->page_range, args->alignment};
+    size_t length = 4 + 1 + 1 + 2 + 8 + 8 + 8 + 4 + 4 + 8 + 8;
+    for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); i++)
+        length += 2 + _rec_string_length(strings[i]);
     for (int i = 0; i < num_options; i++)
-    {
-        if (option_keys && option_keys[i] && option_values && option_values[i])
+        length += 4 + _rec_string_length(args->option_keys[i]) + _rec_string_length(args->option_values[i]);
+    length += 2 + 4 * (size_t)num_values + 2;
+    for (int i = 0; i < num_names; i++)
+        length += 2 + _rec_string_length(args->names[i]);
+
+    uint8_t *record = (uint8_t *)malloc(length);
+    if (!record)
+        return;
+
+    ffi_mutex_lock(&s_call_record_lock);
+    if (s_call_recording && s_call_record_file)
+    {
+        uint8_t *out = _rec_put(record, length - 4, 4);
+        out = _rec_put(out, (uint64_t)args->call, 1);
+        out = _rec_put(out, ok ? 1 : 0, 1);
+        out = _rec_put(out, (uint64_t)num_options, 2);
+        out = _rec_put(out, started_ns > s_call_record_epoch_ns ? started_ns - s_call_record_epoch_ns : 0, 8);
+        out = _rec_put(out, ended_ns - started_ns, 8);
+        out = _rec_put(out, (uint64_t)result, 8);
+        out = _rec_put(out, (uint32_t)args->copies, 4);
+        out = _rec_put(out, (uint32_t)args->scaling_mode, 4);
+        out = _rec_put(out, args->payload_size, 8);
+        out = _rec_put(out, args->payload_hash, 8);
+        for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); i++)
+            out = _rec_put_string(out, strings[i]);
+        for (int i = 0; i < num_options; i++)
         {
-            num_cups_options = cupsAddOption(option_keys[i], option_values[i], num_cups_options, &options);
+            out = _rec_put_string(out, args->option_keys[i]);
+            out = _rec_put_string(out, args->option_values[i]);
         }
-    }
+        out = _rec_put(out, (uint64_t)num_values, 2);
+        for (int i = 0; i < num_values; i++)
+            out = _rec_put(out, args->values[i], 4);
+        out = _rec_put(out, (uint64_t)num_names, 2);
+        for (int i = 0; i < num_names; i++)
+            out = _rec_put_string(out, args->names[i]);
+        if (fwrite(record, 1, length, s_call_record_file) == length)
+            s_call_record_count++;
+    }
+    ffi_mutex_unlock(&s_call_record_lock);
+    free(record);
+}
 
-    int job_id = cupsPrintFile(printer_name, temp_file, doc_name, num_cups_options, options);
-    if (job_id <= 0)
-    {
-        LOG("cupsPrintFile failed, error: %s", cupsLastErrorString());
-    }
-    cupsFreeOptions(num_cups_options, options);
-    unlink(temp_file);
-    LOG("raw_data_to_printer finished with job_id: %d", job_id);
-    return job_id > 0;
-#endif
+static void _call_record_simple(int call, const char *printer_name, uint64_t started_ns, bool ok, int64_t result)
+{
+    if (!s_call_recording)
+        return;
+    CallRecordArgs args = {0};
+    args.call = call;
+    args.printer_name = printer_name;
+    _call_record_write(&args, started_ns, ok, result);
 }
 
-// Internal helper to calculate the destination rectangle for scaling content to fit a target area.
-static void _scale_to_fit(int src_width, int src_height, int target_width, int target_height, int *dest_width, int *dest_height) {
-    float page_aspect = 1.0f;
-    if (src_height > 0)
+static void _call_record_values(int call, const char *printer_name, const uint32_t *values, int num_values, uint64_t started_ns, bool ok, int64_t result)
+{
+    if (!s_call_recording)
+        return;
+    CallRecordArgs args = {0};
+    args.call = call;
+    args.printer_name = printer_name;
+    args.num_values = num_values;
+    args.values = values;
+    _call_record_write(&args, started_ns, ok, result);
+}
+
+static void _call_record_names(int call, const char **names, int num_names, uint64_t started_ns, bool ok, int64_t result)
+{
+    if (!s_call_recording)
+        return;
+    CallRecordArgs args = {0};
+    args.call = call;
+    args.num_names = num_names;
+    args.names = names;
+    _call_record_write(&args, started_ns, ok, result);
+}
+
+static void _call_record_raw(int call, const char *printer_name, const uint8_t *data, int length, const char *doc_name, int num_options, const char **option_keys, const char **option_values, uint64_t started_ns, bool ok, int64_t result)
+{
+    if (!s_call_recording)
+        return;
+    CallRecordArgs args = {0};
+    args.call = call;
+    args.printer_name = printer_name;
+    args.doc_name = doc_name;
+    args.payload_size = data && length > 0 ? (uint64_t)length : 0;
+    args.payload_hash = args.payload_size ? _fnv1a64(data, (size_t)length) : 0;
+    args.num_options = num_options;
+    args.option_keys = option_keys;
+    args.option_values = option_values;
+    _call_record_write(&args, started_ns, ok, result);
+}
+
+static void _call_record_pdf(int call, const char *printer_name, const char *pdf_file_path, const char *doc_name, int scaling_mode, int copies, const char *page_range, int num_options, const char **option_keys, const char **option_values, const char *alignment, uint64_t started_ns, bool ok, int64_t result)
+{
+    if (!s_call_recording)
+        return;
+    CallRecordArgs args = {0};
+    args.call = call;
+    args.printer_name = printer_name;
+    args.doc_name = doc_name;
+    args.pdf_file_path = pdf_file_path;
+    args.page_range = page_range;
+    args.alignment = alignment;
+    args.copies = copies;
+    args.scaling_mode = scaling_mode;
+    args.num_options = num_options;
+    args.option_keys = option_keys;
+    args.option_values = option_values;
+    if (pdf_file_path)
     {
-        page_aspect = (float)src_width / (float)src_height;
+#ifdef _WIN32
+        wchar_t *path_w = to_utf16(pdf_file_path);
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+        if (path_w && GetFileAttributesExW(path_w, GetFileExInfoStandard, &attributes))
+            args.payload_size = ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+        free(path_w);
+#else
+        struct stat st;
+        if (stat(pdf_file_path, &st) == 0)
+            args.payload_size = (uint64_t)st.st_size;
+#endif
     }
+    _call_record_write(&args, started_ns, ok, result);
+}
 
-    float target_aspect = 1.0f;
-    if (target_height != 0)
+// Starts writing a record of every printer listing, status sweep, job
+// listing, print and job control call to `output_path`, replacing any
+// recording in progress.
+// Returns false if the file could not be created.
+FFI_PLUGIN_EXPORT bool start_call_recording(const char *output_path)
+{
+    if (!output_path)
     {
-        target_aspect = (float)target_width / (float)target_height;
+        set_last_error("A call recording output path is required.");
+        return false;
     }
-
-    if (page_aspect > target_aspect)
+    FILE *file = fopen(output_path, "wb");
+    if (!file)
     {
-        *dest_width = target_width;
-        *dest_height = (int)(target_width / page_aspect);
+        set_last_error("Failed to open call recording file '%s'.", output_path);
+        return false;
     }
-    else
+    uint8_t header[20];
+    memcpy(header, CALL_RECORD_MAGIC, 8);
+    _rec_put(header + 8, CALL_RECORD_VERSION, 4);
+    _rec_put(header + 12, (uint64_t)time(NULL) * 1000, 8);
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header))
     {
-        *dest_height = target_height;
-        *dest_width = (int)(target_height * page_aspect);
+        fclose(file);
+        set_last_error("Failed to write call recording file '%s'.", output_path);
+        return false;
     }
-}
 
-#ifdef _WIN32
+    ffi_mutex_lock(&s_call_record_lock);
+    if (s_call_record_file)
+        fclose(s_call_record_file);
+    s_call_record_file = file;
+    s_call_record_epoch_ns = _monotonic_ns();
+    s_call_record_count = 0;
+    s_call_recording = 1;
+    ffi_mutex_unlock(&s_call_record_lock);
+    LOG_INFO("Call recording started, writing to '%s'", output_path);
+    return true;
+}
 
-// Common internal function for PDF printing on Windows.
-// Returns a job ID if `submit_job` is true, otherwise returns 1 for success or 0 for failure.
-static int32_t _print_pdf_job_win(const char *printer_name, const char *pdf_file_path, const char *doc_name, int scaling_mode, int copies, const char *page_range, const char *alignment, int num_options, const char **option_keys, const char **option_values, bool submit_job)
+// Stops the recording started by start_call_recording and closes its file.
+FFI_PLUGIN_EXPORT bool stop_call_recording(void)
 {
-    LOG("print_pdf_job_win: Initializing for printer '%s', path '%s'", printer_name, pdf_file_path);
-    if (!s_pdfium_initialized)
+    ffi_mutex_lock(&s_call_record_lock);
+    if (!s_call_recording)
     {
-        FPDF_LIBRARY_CONFIG config;
-        memset(&config, 0, sizeof(config));
-        config.version = 2;
-        FPDF_InitLibraryWithConfig(&config);
-        s_pdfium_initialized = true;
-        LOG("Pdfium library initialized for the first time.");
+        ffi_mutex_unlock(&s_call_record_lock);
+        set_last_error("No call recording is in progress.");
+        return false;
     }
-    // Clear any previous errors at the start of an operation.
-    set_last_error("");
+    s_call_recording = 0;
+    bool ok = !ferror(s_call_record_file);
+    if (fclose(s_call_record_file) != 0)
+        ok = false;
+    s_call_record_file = NULL;
+    if (!ok)
+        set_last_error("Failed to write the call recording.");
+    LOG_INFO("Call recording stopped, %llu calls recorded", (unsigned long long)s_call_record_count);
+    ffi_mutex_unlock(&s_call_record_lock);
+    return ok;
+}
 
-    double custom_scale;
-    int paper_size_id, paper_source_id, orientation, color_mode, print_quality, media_type_id, duplex_mode;
-    bool collate = true; // Default to collated (complete copies printed together)
-    parse_windows_options(num_options, option_keys, option_values, &paper_size_id, &paper_source_id, &orientation, &color_mode, &print_quality, &media_type_id, &custom_scale, &collate, &duplex_mode);
+// --- Configuration Change Tracking ---
 
-    wchar_t *printer_name_w = to_utf16(printer_name);
-    if (!printer_name_w)
-    {
-        set_last_error("Failed to convert printer name to UTF-16.");
-        LOG("print_pdf_job_win: Failed to convert printer name to UTF-16");
-        return 0;
-    }
+// Native caches (printer directory, default printer, per-printer options) are
+// invalidated by bumping an epoch. A cache entry is only valid while the epoch
+// it was filled at is still current *and* a watcher is running that would have
+// bumped the epoch on a configuration change. Without a watcher (Windows, macOS,
+// remote CUPS servers) every lookup goes to the printing system as before.
+#define CONFIG_CACHE_DIRECTORY 0
+#define CONFIG_CACHE_DEFAULT 1
+#define CONFIG_CACHE_OPTIONS 2
+#define CONFIG_CACHE_COUNT 3
+#define CONFIG_CACHE_ALL ((1 << CONFIG_CACHE_COUNT) - 1)
 
-    FPDF_DOCUMENT doc = FPDF_LoadDocument(pdf_file_path, NULL);
-    if (!doc)
-    {
-        set_last_error("Failed to load PDF document at path '%s'. Error code: %ld. The file may be missing, corrupt, or password-protected.", pdf_file_path, FPDF_GetLastError());
-        LOG("print_pdf_job_win: FPDF_LoadDocument failed for path: %s. Error: %ld", pdf_file_path, FPDF_GetLastError());
-        free(printer_name_w);
-        return 0;
-    }
-    LOG("print_pdf_job_win: PDF document loaded successfully.");
+// Printer state (printer-state, accepting jobs) changes without any
+// configuration file being written, so caches that hold a PrinterInfo are also
+// refreshed once they are older than this.
+#define CONFIG_STATE_MAX_AGE_NS (2000ULL * 1000000ULL)
 
-    DEVMODEW* pDevMode = get_modified_devmode(printer_name_w, paper_size_id, paper_source_id, orientation, color_mode, print_quality, media_type_id, collate, duplex_mode);
+// Epochs start at 1 so that a cache entry with epoch 0 is never considered valid.
+static uint64_t s_config_epochs[CONFIG_CACHE_COUNT] = {1, 1, 1};
 
-    HDC hdc = CreateDCW(L"WINSPOOL", printer_name_w, NULL, pDevMode);
-    if (pDevMode)
-        free(pDevMode); // DEVMODE is copied by CreateDC, so we can free it now.
+static uint64_t _config_cache_epoch(int cache)
+{
+    return (uint64_t)ffi_atomic_load_u64(&s_config_epochs[cache]);
+}
 
-    if (!hdc)
+static void _invalidate_config_caches(int cache_mask)
+{
+    for (int i = 0; i < CONFIG_CACHE_COUNT; i++)
     {
-        set_last_error("Failed to create device context (CreateDCW) for printer '%s'. Error: %lu. This often indicates an invalid printer name or driver issue.", printer_name, GetLastError());
-        LOG("print_pdf_job_win: CreateDCW failed for printer '%s' with error %lu. This often indicates an invalid DEVMODE.", printer_name, GetLastError());
-        FPDF_CloseDocument(doc);
-        free(printer_name_w);
-        return 0;
+        if (cache_mask & (1 << i))
+            ffi_atomic_add_u64(&s_config_epochs[i], 1);
     }
+}
 
-    wchar_t *doc_name_w = to_utf16(doc_name);
-    DOCINFOW di = {sizeof(DOCINFOW), doc_name_w, NULL, 0};
-    int job_id = StartDocW(hdc, &di);
+#ifdef PRINTING_FFI_INOTIFY
+static pthread_once_t s_config_watch_once = PTHREAD_ONCE_INIT;
+static bool s_config_watch_active = false;
 
-    if (job_id <= 0)
+// Returns true if the CUPS client talks to the scheduler on this machine, so
+// that the files under ServerRoot actually describe the queues we see.
+static bool _cups_server_is_local(void)
+{
+    const char *server = cupsServer();
+    if (!server || server[0] == '/')
+        return true; // Domain socket
+
+    // Strip the port from "host:port" or "[v6-address]:port".
+    const char *host = server;
+    size_t length;
+    if (server[0] == '[')
     {
-        set_last_error("Failed to start print document (StartDocW). Error: %lu.", GetLastError());
-        LOG("print_pdf_job_win: StartDocW failed with error %lu", GetLastError());
-        if (doc_name_w)
-            free(doc_name_w);
-        DeleteDC(hdc);
-        FPDF_CloseDocument(doc);
-        free(printer_name_w);
-        return 0;
+        const char *close = strchr(server, ']');
+        if (!close)
+            return false;
+        host = server + 1;
+        length = (size_t)(close - host);
     }
-    // doc_name_w is used by the system, don't free it until EndDoc.
-    LOG("print_pdf_job_win: StartDocW succeeded with Job ID: %d", job_id);
-
-    int page_count = FPDF_GetPageCount(doc);
-    if (page_count <= 0)
+    else
     {
-        set_last_error("Could not get page count from the PDF document. The file may be empty, corrupt, or in an unsupported format. (Page count: %d)", page_count);
-        LOG("print_pdf_job_win: FPDF_GetPageCount returned %d. Aborting.", page_count);
-        if (doc_name_w)
-            free(doc_name_w);
-        AbortDoc(hdc);
-        DeleteDC(hdc);
-        FPDF_CloseDocument(doc);
-        free(printer_name_w);
-        // We don't need to free pages_to_print as it's not allocated yet.
-        return 0;
+        const char *colon = strchr(server, ':');
+        length = colon && !strchr(colon + 1, ':') ? (size_t)(colon - server) : strlen(server);
     }
-
-    LOG("print_pdf_job_win: PDF has %d pages.", page_count);
-    bool *pages_to_print = (bool *)malloc(page_count * sizeof(bool));
-    if (!pages_to_print)
+    static const char *const local_hosts[] = {"localhost", "127.0.0.1", "::1"};
+    for (size_t i = 0; i < sizeof(local_hosts) / sizeof(local_hosts[0]); i++)
     {
-        set_last_error("Failed to allocate memory for page range flags.");
-        LOG("print_pdf_job_win: Failed to allocate memory for page range flags.");
-        if (doc_name_w)
-            free(doc_name_w);
-        AbortDoc(hdc);
-        DeleteDC(hdc);
-        FPDF_CloseDocument(doc);
-        free(printer_name_w);
-        return 0;
+        if (strlen(local_hosts[i]) == length && strncasecmp(host, local_hosts[i], length) == 0)
+            return true;
     }
+    return false;
+}
 
-    if (!parse_page_range(page_range, pages_to_print, page_count))
-    {
-        // If parse_page_range fails, it now sets a specific error. If it's still empty, provide a generic one.
-        if (g_last_error_message == NULL || strlen(g_last_error_message) == 0)
-            set_last_error("Invalid page range format: '%s'. Use a format like '1-3,5,7-9'.", page_range ? page_range : "");
-        LOG("print_pdf_job_win: Invalid page range string provided: %s", page_range ? page_range : "(null)");
-        free(pages_to_print);
-        if (doc_name_w)
-            free(doc_name_w);
-        AbortDoc(hdc);
-        DeleteDC(hdc);
-        FPDF_CloseDocument(doc);
-        free(printer_name_w);
-        return 0;
+// Maps a file name changed inside ServerRoot or ~/.cups to the caches it affects.
+static int _config_file_cache_mask(const char *name)
+{
+    if (strcmp(name, "printers.conf") == 0 || strcmp(name, "classes.conf") == 0 || strcmp(name, "lpoptions") == 0)
+        return CONFIG_CACHE_ALL;
+    return 0;
+}
+
+static void *_config_watch_thread(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    char user_dir[PATH_MAX] = "";
+    const char *home = getenv("HOME");
+    if (home)
+        snprintf(user_dir, sizeof(user_dir), "%s/.cups", home);
+
+    const char *server_root = getenv("CUPS_SERVERROOT");
+    if (!server_root)
+        server_root = "/etc/cups";
+    char ppd_dir[PATH_MAX];
+    snprintf(ppd_dir, sizeof(ppd_dir), "%s/ppd", server_root);
+
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_DELETE_SELF;
+    int wd_server_root = inotify_add_watch(fd, server_root, mask);
+    int wd_ppd = inotify_add_watch(fd, ppd_dir, mask);
+    int wd_user = user_dir[0] ? inotify_add_watch(fd, user_dir, mask | IN_MOVE_SELF) : -1;
+    // ~/.cups may not exist yet, or be deleted and recreated later; watch $HOME
+    // so that its watch can be (re)added whenever it appears.
+    int wd_home = home ? inotify_add_watch(fd, home, IN_CREATE | IN_MOVED_TO) : -1;
+
+    if (wd_server_root < 0 || wd_ppd < 0)
+    {
+        LOG("Config watcher: cannot watch '%s' or '%s', printer caches disabled", server_root, ppd_dir);
+        close(fd);
+        return NULL;
     }
-    LOG("print_pdf_job_win: Page range parsed successfully. Copies: %d.", copies);
 
-    // --- Alignment ---
-    double align_x_factor = 0.5; // Default to center
-    double align_y_factor = 0.5; // Default to center
+    LOG("Config watcher: watching '%s', '%s' and '%s'", server_root, ppd_dir, user_dir);
+    // Anything cached before the watches were in place may already be stale.
+    _invalidate_config_caches(CONFIG_CACHE_ALL);
+    __atomic_store_n(&s_config_watch_active, true, __ATOMIC_RELEASE);
 
-    if (alignment)
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;)
     {
-        char *alignment_lower = strdup(alignment);
-        if (alignment_lower)
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length <= 0)
         {
-            for (int i = 0; alignment_lower[i]; i++)
+            if (length < 0 && errno == EINTR)
+                continue;
+            break;
+        }
+
+        int cache_mask = 0;
+        for (char *ptr = buffer; ptr < buffer + length;)
+        {
+            const struct inotify_event *event = (const struct inotify_event *)ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
+            const char *name = event->len > 0 ? event->name : "";
+
+            if (event->mask & IN_Q_OVERFLOW)
             {
-                alignment_lower[i] = tolower(alignment_lower[i]);
+                cache_mask |= CONFIG_CACHE_ALL;
             }
-
-            if (strstr(alignment_lower, "left"))
+            else if (event->wd == wd_user && (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)))
             {
-                align_x_factor = 0.0;
+                // ~/.cups is gone; its watch is added again when $HOME reports it.
+                if (!(event->mask & IN_IGNORED))
+                    inotify_rm_watch(fd, wd_user);
+                wd_user = -1;
+                cache_mask |= CONFIG_CACHE_ALL;
             }
-            else if (strstr(alignment_lower, "right"))
+            else if ((event->mask & (IN_DELETE_SELF | IN_IGNORED)) && (event->wd == wd_server_root || event->wd == wd_ppd))
             {
-                align_x_factor = 1.0;
+                // We can no longer see changes; fall back to uncached lookups for good.
+                LOG("Config watcher: lost watch on configuration directory, printer caches disabled");
+                __atomic_store_n(&s_config_watch_active, false, __ATOMIC_RELEASE);
+                _invalidate_config_caches(CONFIG_CACHE_ALL);
+                close(fd);
+                return NULL;
             }
-
-            if (strstr(alignment_lower, "top"))
+            else if (event->wd == wd_server_root || event->wd == wd_user)
             {
-                align_y_factor = 0.0;
+                cache_mask |= _config_file_cache_mask(name);
             }
-            else if (strstr(alignment_lower, "bottom"))
+            else if (event->wd == wd_ppd)
             {
-                align_y_factor = 1.0;
+                cache_mask |= 1 << CONFIG_CACHE_OPTIONS;
+            }
+            else if (event->wd == wd_home && strcmp(name, ".cups") == 0)
+            {
+                wd_user = inotify_add_watch(fd, user_dir, mask | IN_MOVE_SELF);
+                cache_mask |= CONFIG_CACHE_ALL;
             }
+        }
 
-            free(alignment_lower);
+        if (cache_mask)
+        {
+            LOG("Config watcher: configuration changed, invalidating caches (mask 0x%x)", cache_mask);
+            _invalidate_config_caches(cache_mask);
         }
     }
 
-    bool success = true;
-    for (int c = 0; c < copies && success; c++)
+    __atomic_store_n(&s_config_watch_active, false, __ATOMIC_RELEASE);
+    _invalidate_config_caches(CONFIG_CACHE_ALL);
+    close(fd);
+    return NULL;
+}
+
+static void _start_config_watcher(void)
+{
+    if (!_cups_server_is_local())
     {
-        LOG("print_pdf_job_win: Starting copy %d of %d.", c + 1, copies);
-        for (int i = 0; i < page_count && success; ++i)
-        {
-            if (!pages_to_print[i])
-            {
-                continue;
-            }
-            LOG("print_pdf_job_win: Printing page %d (0-indexed).", i);
+        LOG("Config watcher: CUPS server '%s' is remote, printer caches disabled", cupsServer());
+        return;
+    }
 
-            // Declare destination rectangle variables for the current page.
-            int dest_x = 0, dest_y = 0, dest_width = 0, dest_height = 0;
+    int fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0)
+    {
+        LOG_WARN("Config watcher: inotify_init1 failed with errno %d, printer caches disabled", errno);
+        return;
+    }
 
-            FPDF_PAGE page = FPDF_LoadPage(doc, i);
-            if (!page)
-            {
-                set_last_error("Failed to load PDF page %d.", i + 1);
-                LOG("print_pdf_job_win: FPDF_LoadPage failed for page %d", i);
-                success = false;
-                break;
-            }
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attr, _config_watch_thread, (void *)(intptr_t)fd) != 0)
+    {
+        LOG_WARN("Config watcher: pthread_create failed, printer caches disabled");
+        close(fd);
+    }
+    pthread_attr_destroy(&attr);
+}
+#endif
 
-            if (StartPage(hdc) <= 0)
-            {
-                set_last_error("Failed to start page %d. Error: %lu.", i + 1, GetLastError());
-                LOG("print_pdf_job_win: StartPage failed for page %d with error %lu", i, GetLastError());
-                // Clean up the page resource before breaking from the loop.
-                FPDF_ClosePage(page);
-                success = false;
-                break;
-            }
+// Returns true if a cache entry filled at `entry_epoch` may still be served.
+static bool _config_cache_is_valid(int cache, uint64_t entry_epoch)
+{
+#ifdef PRINTING_FFI_INOTIFY
+    pthread_once(&s_config_watch_once, _start_config_watcher);
+    return entry_epoch != 0 &&
+           __atomic_load_n(&s_config_watch_active, __ATOMIC_ACQUIRE) &&
+           entry_epoch == _config_cache_epoch(cache);
+#else
+    (void)cache;
+    (void)entry_epoch;
+    return false;
+#endif
+}
 
-            // --- Get PDF page dimensions and rotation ---
-            float pdf_width_pt = FPDF_GetPageWidthF(page);
-            float pdf_height_pt = FPDF_GetPageHeightF(page);
+FFI_PLUGIN_EXPORT void invalidate_printer_caches(void)
+{
+    LOG("invalidate_printer_caches called");
+    _invalidate_config_caches(CONFIG_CACHE_ALL);
+}
 
-            int rotation = FPDFPage_GetRotation(page);
-            if (rotation == 1 || rotation == 3)
-            { // 90 or 270 degrees, swap dimensions
-                float temp = pdf_width_pt;
-                pdf_width_pt = pdf_height_pt;
-                pdf_height_pt = temp;
-            }
+#ifdef _WIN32
+// Internal helper to fill a PrinterInfo from a PRINTER_INFO_2W record.
+// All strings are newly allocated and owned by `info`.
+static void _printer_info_from_info2(const PRINTER_INFO_2W *pinfo2, PrinterInfo *info)
+{
+    info->name = to_utf8(pinfo2->pPrinterName);
+    info->state = (int)pinfo2->Status;         // Cast to int
+    info->url = to_utf8(pinfo2->pPrinterName); // Use printer name as URL for Windows
+    info->model = to_utf8(pinfo2->pDriverName);
+    info->location = to_utf8(pinfo2->pLocation);
+    info->comment = to_utf8(pinfo2->pComment);
+    info->is_default = (pinfo2->Attributes & PRINTER_ATTRIBUTE_DEFAULT) != 0;
+    info->is_available = (pinfo2->Status & PRINTER_STATUS_OFFLINE) == 0;
+}
+#else
+// Internal helper to fill a PrinterInfo from a CUPS destination.
+// All strings are newly allocated and owned by `info`.
+static void _printer_info_from_dest(const cups_dest_t *dest, PrinterInfo *info)
+{
+    info->name = strdup(dest->name ? dest->name : "");
+    info->is_default = dest->is_default;
 
-            int dpi_x = GetDeviceCaps(hdc, LOGPIXELSX);
-            int dpi_y = GetDeviceCaps(hdc, LOGPIXELSY);
-            int printable_width_pixels = GetDeviceCaps(hdc, HORZRES);
-            int printable_height_pixels = GetDeviceCaps(hdc, VERTRES);
-            int paper_width_pixels = GetDeviceCaps(hdc, PHYSICALWIDTH);
-            int paper_height_pixels = GetDeviceCaps(hdc, PHYSICALHEIGHT);
+    const char *state_str = cupsGetOption("printer-state", dest->num_options, dest->options);
+    info->state = state_str ? atoi(state_str) : 3; // Default to IPP_PRINTER_IDLE (3)
+    info->is_available = info->state != 5;         // 5 is IPP_PRINTER_STOPPED
 
-            LOG("print_pdf_job_win: Page %d: PDF Dimensions (pt): %.2f x %.2f", i, pdf_width_pt, pdf_height_pt);
-            LOG("print_pdf_job_win: Page %d: Device DPI: %d x %d", i, dpi_x, dpi_y);
-            LOG("print_pdf_job_win: Page %d: Printable Area (pixels): %d x %d", i, printable_width_pixels, printable_height_pixels);
-            LOG("print_pdf_job_win: Page %d: Physical Paper (pixels): %d x %d", i, paper_width_pixels, paper_height_pixels);
+    const char *uri_str = cupsGetOption("device-uri", dest->num_options, dest->options);
+    info->url = strdup(uri_str ? uri_str : "");
 
-            // Render the bitmap using the device's specific DPI for each axis to avoid distortion.
-            int bitmap_width = (int)(pdf_width_pt / 72.0f * dpi_x);
-            int bitmap_height = (int)(pdf_height_pt / 72.0f * dpi_y);
-            LOG("print_pdf_job_win: Page %d: Bitmap Dimensions (pixels): %d x %d", i, bitmap_width, bitmap_height);
+    const char *model_str = cupsGetOption("printer-make-and-model", dest->num_options, dest->options);
+    info->model = strdup(model_str ? model_str : "");
 
-            BITMAPINFO bmi;
-            memset(&bmi, 0, sizeof(bmi));
-            bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-            bmi.bmiHeader.biWidth = bitmap_width;
-            bmi.bmiHeader.biHeight = -bitmap_height; // Negative for top-down DIB
-            bmi.bmiHeader.biPlanes = 1;
+    const char *location_str = cupsGetOption("printer-location", dest->num_options, dest->options);
+    info->location = strdup(location_str ? location_str : "");
+
+    const char *comment_str = cupsGetOption("printer-info", dest->num_options, dest->options);
+    info->comment = strdup(comment_str ? comment_str : "");
+}
+#endif
+
+// Internal helper to free the strings owned by a PrinterInfo without freeing the struct itself.
+static void _free_printer_info_fields(PrinterInfo *info)
+{
+    free(info->name);
+    free(info->url);
+    free(info->model);
+    free(info->location);
+    free(info->comment);
+}
+
+// Internal helper to compare two strings that may be NULL.
+static bool _str_equal(const char *a, const char *b)
+{
+    if (!a || !b)
+        return a == b;
+    return strcmp(a, b) == 0;
+}
+
+static bool _printer_info_equal(const PrinterInfo *a, const PrinterInfo *b)
+{
+    return a->state == b->state &&
+           a->is_default == b->is_default &&
+           a->is_available == b->is_available &&
+           _str_equal(a->name, b->name) &&
+           _str_equal(a->url, b->url) &&
+           _str_equal(a->model, b->model) &&
+           _str_equal(a->location, b->location) &&
+           _str_equal(a->comment, b->comment);
+}
+
+// Internal helper to deep-copy a PrinterInfo. The caller owns the copied strings.
+static void _copy_printer_info(const PrinterInfo *src, PrinterInfo *dst)
+{
+    dst->name = strdup(src->name ? src->name : "");
+    dst->state = src->state;
+    dst->url = strdup(src->url ? src->url : "");
+    dst->model = strdup(src->model ? src->model : "");
+    dst->location = strdup(src->location ? src->location : "");
+    dst->comment = strdup(src->comment ? src->comment : "");
+    dst->is_default = src->is_default;
+    dst->is_available = src->is_available;
+}
+
+static PrinterList *_get_printers(void)
+{
+    LOG("get_printers called");
+    PrinterList *list = (PrinterList *)malloc(sizeof(PrinterList));
+    if (!list)
+        return NULL;
+    list->count = 0;
+    list->printers = NULL;
+
+#ifdef _WIN32
+    DWORD needed, returned;
+    EnumPrintersW(PRINTER_ENUM_LOCAL | PRINTER_ENUM_CONNECTIONS, NULL, 2, NULL, 0, &needed, &returned);
+    LOG("EnumPrintersW needed %lu bytes for printer list", needed);
+    if (needed == 0)
+    {
+        return list; // Return empty list
+    }
+    BYTE *buffer = (BYTE *)malloc(needed);
+    if (!buffer)
+    {
+        free(list);
+        return NULL;
+    }
+
+    if (EnumPrintersW(PRINTER_ENUM_LOCAL | PRINTER_ENUM_CONNECTIONS, NULL, 2, buffer, needed, &needed, &returned))
+    {
+        LOG("Found %lu printers on Windows", returned);
+        list->count = (int)returned; // Cast to int for consistency
+        list->printers = (PrinterInfo *)malloc(returned * sizeof(PrinterInfo));
+        if (!list->printers)
+        {
+            free(buffer);
+            free(list);
+            return NULL;
+        }
+        PRINTER_INFO_2W *printers = (PRINTER_INFO_2W *)buffer;
+        for (DWORD i = 0; i < returned; i++)
+        {
+            _printer_info_from_info2(&printers[i], &list->printers[i]);
+        }
+    }
+    else
+    {
+        LOG_WARN("EnumPrintersW failed with error %lu", GetLastError());
+    }
+    free(buffer);
+    return list;
+#else // macOS / Linux
+    cups_dest_t *dests = NULL;
+    LOG("Calling cupsGetDests to find printers");
+    TraceSpan dests_span;
+    _trace_begin(&dests_span, "cupsGetDests");
+    int num_dests = cupsGetDests(&dests);
+    _trace_end(&dests_span);
+    if (num_dests <= 0)
+    {
+        cupsFreeDests(num_dests, dests);
+        return list; // Return empty list
+    }
+
+    LOG("Found %d printers on CUPS-based system", num_dests);
+    list->count = num_dests;
+    list->printers = (PrinterInfo *)malloc(num_dests * sizeof(PrinterInfo));
+    if (!list->printers)
+    {
+        cupsFreeDests(num_dests, dests);
+        free(list);
+        return NULL;
+    }
+
+    for (int i = 0; i < num_dests; i++)
+    {
+        _printer_info_from_dest(&dests[i], &list->printers[i]);
+    }
+    cupsFreeDests(num_dests, dests);
+    return list;
+#endif
+}
+
+FFI_PLUGIN_EXPORT PrinterList *get_printers(void)
+{
+    uint64_t started = _monotonic_ns();
+    PrinterList *list = _get_printers();
+    _metrics_record(METRIC_OP_GET_PRINTERS, started, list != NULL);
+    _call_record_simple(CALL_GET_PRINTERS, NULL, started, list != NULL, list ? list->count : 0);
+    return list;
+}
+
+FFI_PLUGIN_EXPORT void free_printer_list(PrinterList *printer_list)
+{
+    if (!printer_list)
+        return;
+    if (printer_list->printers)
+    {
+        for (int i = 0; i < printer_list->count; i++)
+        {
+            _free_printer_info_fields(&printer_list->printers[i]);
+        }
+        free(printer_list->printers);
+    }
+    free(printer_list);
+}
+
+#ifndef _WIN32
+// Default printer resolution cache, invalidated by configuration changes.
+static ffi_mutex_t s_default_printer_lock = FFI_MUTEX_INITIALIZER;
+static PrinterInfo *s_default_printer = NULL;
+static uint64_t s_default_printer_epoch = 0;
+static uint64_t s_default_printer_refreshed_ns = 0;
+
+// Internal helper that resolves the CUPS default printer without consulting the cache.
+static PrinterInfo *_resolve_default_printer(void)
+{
+    const char *default_printer_name = cupsGetDefault();
+    if (!default_printer_name)
+    {
+        LOG("cupsGetDefault returned null, no default printer found.");
+        return NULL;
+    }
+    LOG("CUPS default printer name: %s", default_printer_name);
+
+    cups_dest_t *dests = NULL;
+    TraceSpan dests_span;
+    _trace_begin(&dests_span, "cupsGetDests");
+    int num_dests = cupsGetDests(&dests);
+    _trace_end(&dests_span);
+    cups_dest_t *default_dest = cupsGetDest(default_printer_name, NULL, num_dests, dests);
+
+    if (!default_dest)
+    {
+        cupsFreeDests(num_dests, dests);
+        return NULL;
+    }
+
+    PrinterInfo *printer_info = (PrinterInfo *)malloc(sizeof(PrinterInfo));
+    if (!printer_info)
+    {
+        cupsFreeDests(num_dests, dests);
+        return NULL;
+    }
+
+    _printer_info_from_dest(default_dest, printer_info);
+
+    cupsFreeDests(num_dests, dests);
+    return printer_info;
+}
+#endif
+
+FFI_PLUGIN_EXPORT PrinterInfo *get_default_printer(void)
+{
+    LOG("get_default_printer called");
+#ifdef _WIN32
+    DWORD len = 0;
+    GetDefaultPrinterW(NULL, &len);
+    if (len == 0)
+    {
+        return NULL; // No default printer or an error occurred
+    }
+
+    wchar_t *default_printer_name_w = (wchar_t *)malloc(len * sizeof(wchar_t));
+    if (!default_printer_name_w)
+        return NULL;
+
+    if (!GetDefaultPrinterW(default_printer_name_w, &len))
+    {
+        LOG_WARN("GetDefaultPrinterW failed with error %lu", GetLastError());
+        free(default_printer_name_w);
+        return NULL;
+    }
+
+    HANDLE hPrinter;
+    if (!OpenPrinterW(default_printer_name_w, &hPrinter, NULL))
+    {
+        LOG_WARN("OpenPrinterW for default printer failed with error %lu", GetLastError());
+        free(default_printer_name_w);
+        return NULL;
+    }
+
+    DWORD needed = 0;
+    GetPrinterW(hPrinter, 2, NULL, 0, &needed);
+    if (needed == 0)
+    {
+        LOG_WARN("GetPrinterW (to get size) failed with error %lu", GetLastError());
+        ClosePrinter(hPrinter);
+        free(default_printer_name_w);
+        return NULL;
+    }
+
+    PRINTER_INFO_2W *pinfo2 = (PRINTER_INFO_2W *)malloc(needed);
+    if (!pinfo2)
+    {
+        ClosePrinter(hPrinter);
+        free(default_printer_name_w);
+        return NULL;
+    }
+
+    if (!GetPrinterW(hPrinter, 2, (LPBYTE)pinfo2, needed, &needed))
+    {
+        LOG_WARN("GetPrinterW (to get data) failed with error %lu", GetLastError());
+        free(pinfo2);
+        ClosePrinter(hPrinter);
+        free(default_printer_name_w);
+        return NULL;
+    }
+    ClosePrinter(hPrinter);
+    free(default_printer_name_w); // We have the info in pinfo2 now
+
+    PrinterInfo *printer_info = (PrinterInfo *)malloc(sizeof(PrinterInfo));
+    if (!printer_info)
+    {
+        free(pinfo2);
+        return NULL;
+    }
+    _printer_info_from_info2(pinfo2, printer_info);
+
+    free(pinfo2);
+    return printer_info;
+#else // macOS / Linux
+    ffi_mutex_lock(&s_default_printer_lock);
+    uint64_t now = _monotonic_ns();
+    if (!_config_cache_is_valid(CONFIG_CACHE_DEFAULT, s_default_printer_epoch) ||
+        now - s_default_printer_refreshed_ns > CONFIG_STATE_MAX_AGE_NS)
+    {
+        uint64_t epoch = _config_cache_epoch(CONFIG_CACHE_DEFAULT);
+        if (s_default_printer)
+        {
+            free_printer_info(s_default_printer);
+            s_default_printer = NULL;
+        }
+        // "No default printer" is cached too, so it is not re-resolved on every call.
+        s_default_printer = _resolve_default_printer();
+        s_default_printer_epoch = epoch;
+        s_default_printer_refreshed_ns = now;
+    }
+    else
+    {
+        LOG("Serving default printer from cache");
+    }
+
+    PrinterInfo *printer_info = NULL;
+    if (s_default_printer)
+    {
+        printer_info = (PrinterInfo *)malloc(sizeof(PrinterInfo));
+        if (printer_info)
+            _copy_printer_info(s_default_printer, printer_info);
+    }
+    ffi_mutex_unlock(&s_default_printer_lock);
+    return printer_info;
+#endif
+}
+
+FFI_PLUGIN_EXPORT void free_printer_info(PrinterInfo *printer_info)
+{
+    if (!printer_info)
+        return;
+    _free_printer_info_fields(printer_info);
+    free(printer_info);
+}
+
+// --- Printer Directory Cache ---
+
+// A cached printer plus the generations at which it last changed. Removed
+// printers are kept as tombstones so that callers holding an older generation
+// can still be told about the removal. Tombstones older than
+// PRINTER_DIRECTORY_HISTORY generations are compacted away; a caller holding a
+// generation from before the newest compacted tombstone gets a full reset.
+#define PRINTER_DIRECTORY_HISTORY 64
+
+typedef struct
+{
+    PrinterInfo info;
+    uint64_t added_generation;   // Generation at which the printer (re)appeared.
+    uint64_t changed_generation; // Generation of the most recent add, change or removal.
+    bool removed;
+} PrinterDirectoryEntry;
+
+static ffi_mutex_t s_directory_lock = FFI_MUTEX_INITIALIZER;
+static PrinterDirectoryEntry *s_directory_entries = NULL;
+static int s_directory_count = 0;
+static int s_directory_capacity = 0;
+static uint64_t s_directory_generation = 0;
+static uint64_t s_directory_floor = 0; // Callers below this generation may have missed a compacted removal.
+static uint64_t s_directory_epoch = 0; // Config epoch the directory was last refreshed at.
+static uint64_t s_directory_refreshed_ns = 0;
+
+static PrinterDirectoryEntry *_find_directory_entry(const char *name)
+{
+    for (int i = 0; i < s_directory_count; i++)
+    {
+        if (_str_equal(s_directory_entries[i].info.name, name))
+            return &s_directory_entries[i];
+    }
+    return NULL;
+}
+
+// Re-enumerates the printers and folds the result into the directory cache,
+// bumping the generation if anything was added, changed or removed.
+// Must be called with `s_directory_lock` held. Returns false if enumeration failed.
+static bool _refresh_printer_directory_locked(void)
+{
+    PrinterList *current = get_printers();
+    if (!current)
+    {
+        LOG_WARN("_refresh_printer_directory_locked: get_printers failed");
+        return false;
+    }
+
+    uint64_t next_generation = s_directory_generation + 1;
+    bool changed = false;
+
+    // Entries present before this refresh that were not seen in the new enumeration are removals.
+    int previous_count = s_directory_count;
+    bool *seen = previous_count > 0 ? (bool *)calloc(previous_count, sizeof(bool)) : NULL;
+    if (previous_count > 0 && !seen)
+    {
+        free_printer_list(current);
+        return false;
+    }
+
+    // Room for every enumerated printer to be new is reserved up front, so that
+    // running out of memory fails the refresh before the directory is touched.
+    if (s_directory_count + current->count > s_directory_capacity)
+    {
+        int new_capacity = s_directory_capacity > 0 ? s_directory_capacity : 16;
+        while (new_capacity < s_directory_count + current->count)
+            new_capacity *= 2;
+        PrinterDirectoryEntry *grown = (PrinterDirectoryEntry *)realloc(s_directory_entries, new_capacity * sizeof(PrinterDirectoryEntry));
+        if (!grown)
+        {
+            LOG_WARN("_refresh_printer_directory_locked: out of memory");
+            free(seen);
+            free_printer_list(current);
+            return false;
+        }
+        s_directory_entries = grown;
+        s_directory_capacity = new_capacity;
+    }
+
+    for (int i = 0; i < current->count; i++)
+    {
+        PrinterInfo *info = &current->printers[i];
+        PrinterDirectoryEntry *entry = _find_directory_entry(info->name);
+        if (!entry)
+        {
+            entry = &s_directory_entries[s_directory_count++];
+            _copy_printer_info(info, &entry->info);
+            entry->added_generation = next_generation;
+            entry->changed_generation = next_generation;
+            entry->removed = false;
+            changed = true;
+            LOG("Printer directory: '%s' added", info->name);
+            continue;
+        }
+
+        int index = (int)(entry - s_directory_entries);
+        if (index < previous_count)
+            seen[index] = true;
+
+        if (entry->removed)
+        {
+            _free_printer_info_fields(&entry->info);
+            _copy_printer_info(info, &entry->info);
+            entry->added_generation = next_generation;
+            entry->changed_generation = next_generation;
+            entry->removed = false;
+            changed = true;
+            LOG("Printer directory: '%s' re-added", info->name);
+        }
+        else if (!_printer_info_equal(&entry->info, info))
+        {
+            _free_printer_info_fields(&entry->info);
+            _copy_printer_info(info, &entry->info);
+            entry->changed_generation = next_generation;
+            changed = true;
+            LOG("Printer directory: '%s' changed", info->name);
+        }
+    }
+
+    for (int i = 0; i < previous_count; i++)
+    {
+        if (!seen[i] && !s_directory_entries[i].removed)
+        {
+            s_directory_entries[i].removed = true;
+            s_directory_entries[i].changed_generation = next_generation;
+            changed = true;
+            LOG("Printer directory: '%s' removed", s_directory_entries[i].info.name);
+        }
+    }
+
+    if (changed)
+        s_directory_generation = next_generation;
+
+    // Drop tombstones that fell out of the history window.
+    if (s_directory_generation > PRINTER_DIRECTORY_HISTORY)
+    {
+        uint64_t horizon = s_directory_generation - PRINTER_DIRECTORY_HISTORY;
+        int kept = 0;
+        for (int i = 0; i < s_directory_count; i++)
+        {
+            PrinterDirectoryEntry *entry = &s_directory_entries[i];
+            if (entry->removed && entry->changed_generation <= horizon)
+            {
+                if (entry->changed_generation > s_directory_floor)
+                    s_directory_floor = entry->changed_generation;
+                _free_printer_info_fields(&entry->info);
+                continue;
+            }
+            s_directory_entries[kept++] = *entry;
+        }
+        s_directory_count = kept;
+    }
+
+    free(seen);
+    free_printer_list(current);
+    return true;
+}
+
+FFI_PLUGIN_EXPORT PrinterChangeList *get_printer_changes(uint64_t since_generation)
+{
+    LOG("get_printer_changes called with since_generation: %llu", (unsigned long long)since_generation);
+    PrinterChangeList *list = (PrinterChangeList *)malloc(sizeof(PrinterChangeList));
+    if (!list)
+        return NULL;
+    list->generation = 0;
+    list->reset = false;
+    list->count = 0;
+    list->changes = NULL;
+
+    ffi_mutex_lock(&s_directory_lock);
+    // While the configuration watcher reports no changes the cached directory is
+    // served as-is until its printer states are too old; otherwise (or without
+    // a watcher) it is re-enumerated.
+    bool refreshed = true;
+    uint64_t now = _monotonic_ns();
+    if (!_config_cache_is_valid(CONFIG_CACHE_DIRECTORY, s_directory_epoch) ||
+        now - s_directory_refreshed_ns > CONFIG_STATE_MAX_AGE_NS)
+    {
+        uint64_t epoch = _config_cache_epoch(CONFIG_CACHE_DIRECTORY);
+        refreshed = _refresh_printer_directory_locked();
+        if (refreshed)
+        {
+            s_directory_epoch = epoch;
+            s_directory_refreshed_ns = now;
+        }
+    }
+    if (!refreshed)
+    {
+        // Report the last known generation with no changes rather than failing the caller.
+        list->generation = s_directory_generation;
+        ffi_mutex_unlock(&s_directory_lock);
+        return list;
+    }
+
+    // A generation from the future can only come from a previous process, and
+    // one below the floor may have missed a compacted removal; resynchronize.
+    if (since_generation > s_directory_generation || since_generation < s_directory_floor)
+        since_generation = 0;
+    list->reset = since_generation == 0;
+    list->generation = s_directory_generation;
+
+    int capacity = 0;
+    for (int i = 0; i < s_directory_count; i++)
+    {
+        if (s_directory_entries[i].changed_generation > since_generation)
+            capacity++;
+    }
+
+    if (capacity > 0)
+    {
+        list->changes = (PrinterChange *)malloc(capacity * sizeof(PrinterChange));
+        if (!list->changes)
+        {
+            ffi_mutex_unlock(&s_directory_lock);
+            free(list);
+            return NULL;
+        }
+    }
+
+    for (int i = 0; i < s_directory_count; i++)
+    {
+        PrinterDirectoryEntry *entry = &s_directory_entries[i];
+        if (entry->changed_generation <= since_generation)
+            continue;
+
+        int32_t change_type;
+        if (entry->removed)
+        {
+            // A printer that appeared and vanished after `since_generation` was never seen by the caller.
+            if (entry->added_generation > since_generation)
+                continue;
+            change_type = PRINTER_CHANGE_REMOVED;
+        }
+        else
+        {
+            change_type = entry->added_generation > since_generation ? PRINTER_CHANGE_ADDED : PRINTER_CHANGE_MODIFIED;
+        }
+
+        list->changes[list->count].change_type = change_type;
+        _copy_printer_info(&entry->info, &list->changes[list->count].printer);
+        list->count++;
+    }
+    ffi_mutex_unlock(&s_directory_lock);
+
+    LOG("get_printer_changes returning %d changes at generation %llu", list->count, (unsigned long long)list->generation);
+    return list;
+}
+
+FFI_PLUGIN_EXPORT void free_printer_change_list(PrinterChangeList *change_list)
+{
+    if (!change_list)
+        return;
+    if (change_list->changes)
+    {
+        for (int i = 0; i < change_list->count; i++)
+        {
+            _free_printer_info_fields(&change_list->changes[i].printer);
+        }
+        free(change_list->changes);
+    }
+    free(change_list);
+}
+
+// --- Shared Printer Snapshot ---
+
+// Processes on the same host can share one copy of the printer list through a
+// named, memory-mapped segment. Whichever process finds the snapshot too old
+// takes a short refresh lease, queries the printing system once and publishes
+// the result; every other process reads it without talking to cupsd/spooler.
+// Readers are lock-free: the writer bumps `sequence` to an odd value while it
+// writes and back to an even value when done (a seqlock), and readers retry if
+// the sequence changed underneath them.
+#define SHARED_SNAPSHOT_MAGIC 0x5346465031ULL // "PFFS1"
+#define SHARED_SNAPSHOT_LAYOUT_VERSION 1
+#define SHARED_SNAPSHOT_MAX_PRINTERS 256
+#define SHARED_SNAPSHOT_NAME_MAX 256
+#define SHARED_SNAPSHOT_URL_MAX 512
+#define SHARED_SNAPSHOT_TEXT_MAX 256
+#define SHARED_SNAPSHOT_LEASE_MS 10000 // A writer that crashes mid-refresh blocks others for at most this long.
+#define SHARED_SNAPSHOT_READ_RETRIES 64
+
+typedef struct
+{
+    char name[SHARED_SNAPSHOT_NAME_MAX];
+    char url[SHARED_SNAPSHOT_URL_MAX];
+    char model[SHARED_SNAPSHOT_TEXT_MAX];
+    char location[SHARED_SNAPSHOT_TEXT_MAX];
+    char comment[SHARED_SNAPSHOT_TEXT_MAX];
+    uint32_t state;
+    uint8_t is_default;
+    uint8_t is_available;
+    uint8_t reserved[2];
+} SharedPrinterRecord;
+
+typedef struct
+{
+    uint64_t magic; // Written last by the creating process.
+    uint32_t layout_version;
+    uint32_t record_size;
+    uint32_t max_printers;
+    uint32_t reserved;
+    uint64_t sequence;        // Seqlock; odd while a write is in progress. 0 until the first publish.
+    uint64_t lease_until_ms;  // Refresh lease expiry on the system monotonic clock; 0 when free.
+    uint64_t refreshed_at_ms; // When the current snapshot was taken.
+    uint32_t count;
+    uint32_t overflow; // Non-zero if the host has more printers than fit; readers fall back to get_printers.
+    SharedPrinterRecord printers[SHARED_SNAPSHOT_MAX_PRINTERS];
+} SharedPrinterSnapshot;
+
+// Held shared while the mapping is in use and exclusively to (un)map it. Refreshes
+// are serialized by the lease in the segment, not by this lock.
+static ffi_rwlock_t s_snapshot_lock = FFI_RWLOCK_INITIALIZER;
+static SharedPrinterSnapshot *s_snapshot = NULL;
+#ifdef _WIN32
+static HANDLE s_snapshot_mapping = NULL;
+#endif
+
+// Copies `src` into a fixed-size field, truncating on a UTF-8 character boundary.
+static void _snapshot_copy_string(char *dst, size_t dst_size, const char *src)
+{
+    size_t length = src ? strlen(src) : 0;
+    if (length >= dst_size)
+    {
+        length = dst_size - 1;
+        while (length > 0 && ((unsigned char)src[length] & 0xC0) == 0x80)
+            length--;
+    }
+    if (length > 0)
+        memcpy(dst, src, length);
+    memset(dst + length, 0, dst_size - length);
+}
+
+// Opens or creates the segment. Must be called with `s_snapshot_lock` held.
+static SharedPrinterSnapshot *_map_shared_snapshot_locked(const char *name)
+{
+    const size_t size = sizeof(SharedPrinterSnapshot);
+    char segment_name[64];
+#ifdef _WIN32
+    snprintf(segment_name, sizeof(segment_name), "Local\\printing_ffi.%s", name);
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)size, segment_name);
+    if (!mapping)
+    {
+        set_last_error("CreateFileMapping failed for '%s'. Error: %lu", segment_name, GetLastError());
+        return NULL;
+    }
+    bool created = GetLastError() != ERROR_ALREADY_EXISTS;
+    SharedPrinterSnapshot *snapshot = (SharedPrinterSnapshot *)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!snapshot)
+    {
+        set_last_error("MapViewOfFile failed for '%s'. Error: %lu", segment_name, GetLastError());
+        CloseHandle(mapping);
+        return NULL;
+    }
+    s_snapshot_mapping = mapping;
+#else
+    // macOS limits POSIX shm names to 31 characters including the leading slash.
+    snprintf(segment_name, sizeof(segment_name), "/pffi.%s", name);
+    if (strlen(segment_name) > 31)
+    {
+        set_last_error("Shared snapshot name '%s' is too long.", name);
+        return NULL;
+    }
+    bool created = true;
+    int fd = shm_open(segment_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST)
+    {
+        created = false;
+        fd = shm_open(segment_name, O_RDWR, 0600);
+    }
+    if (fd < 0)
+    {
+        set_last_error("shm_open failed for '%s'. Error: %s", segment_name, strerror(errno));
+        return NULL;
+    }
+    if (created && ftruncate(fd, (off_t)size) != 0)
+    {
+        set_last_error("ftruncate failed for '%s'. Error: %s", segment_name, strerror(errno));
+        close(fd);
+        shm_unlink(segment_name);
+        return NULL;
+    }
+    // The creator may not have sized the segment yet; give it a moment.
+    struct stat st;
+    for (int attempt = 0; !created && attempt < 50; attempt++)
+    {
+        if (fstat(fd, &st) == 0 && (size_t)st.st_size >= size)
+            break;
+        usleep(1000);
+    }
+    if (!created && (fstat(fd, &st) != 0 || (size_t)st.st_size < size))
+    {
+        set_last_error("Shared snapshot '%s' has an unexpected size.", segment_name);
+        close(fd);
+        return NULL;
+    }
+    SharedPrinterSnapshot *snapshot = (SharedPrinterSnapshot *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (snapshot == MAP_FAILED)
+    {
+        set_last_error("mmap failed for '%s'. Error: %s", segment_name, strerror(errno));
+        return NULL;
+    }
+#endif
+
+    if (created)
+    {
+        snapshot->layout_version = SHARED_SNAPSHOT_LAYOUT_VERSION;
+        snapshot->record_size = sizeof(SharedPrinterRecord);
+        snapshot->max_printers = SHARED_SNAPSHOT_MAX_PRINTERS;
+        ffi_atomic_store_u64(&snapshot->magic, SHARED_SNAPSHOT_MAGIC);
+    }
+    LOG("Mapped shared printer snapshot '%s' (%s)", segment_name, created ? "created" : "existing");
+    return snapshot;
+}
+
+static void _unmap_shared_snapshot_locked(void)
+{
+    if (!s_snapshot)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(s_snapshot);
+    CloseHandle(s_snapshot_mapping);
+    s_snapshot_mapping = NULL;
+#else
+    munmap(s_snapshot, sizeof(SharedPrinterSnapshot));
+#endif
+    s_snapshot = NULL;
+}
+
+// Returns true if the segment was created by a compatible build of this library.
+static bool _shared_snapshot_is_compatible(const SharedPrinterSnapshot *snapshot)
+{
+    return ffi_atomic_load_u64(&snapshot->magic) == SHARED_SNAPSHOT_MAGIC &&
+           snapshot->layout_version == SHARED_SNAPSHOT_LAYOUT_VERSION &&
+           snapshot->record_size == sizeof(SharedPrinterRecord) &&
+           snapshot->max_printers == SHARED_SNAPSHOT_MAX_PRINTERS;
+}
+
+// Reads a consistent copy of the snapshot. Returns NULL if nothing usable has been
+// published yet, the snapshot overflowed (`*overflow` is set) or the writer kept
+// the sequence busy; `*refreshed_at_ms` gets the snapshot time.
+static PrinterList *_read_shared_snapshot(SharedPrinterSnapshot *snapshot, uint64_t *refreshed_at_ms, bool *overflow)
+{
+    // Only the published records are copied, so a typical host costs a few KB here.
+    SharedPrinterRecord *records = NULL;
+    uint32_t capacity = 0;
+    uint32_t count = 0;
+    bool consistent = false;
+    *overflow = false;
+    for (int attempt = 0; attempt < SHARED_SNAPSHOT_READ_RETRIES && !consistent; attempt++)
+    {
+        uint64_t before = ffi_atomic_load_u64(&snapshot->sequence);
+        if (before == 0)
+            break; // Never published.
+        if (before & 1)
+            continue; // Write in progress.
+
+        count = snapshot->count;
+        uint32_t snapshot_overflow = snapshot->overflow;
+        *refreshed_at_ms = snapshot->refreshed_at_ms;
+        if (count > SHARED_SNAPSHOT_MAX_PRINTERS)
+            count = SHARED_SNAPSHOT_MAX_PRINTERS;
+        if (count > capacity)
+        {
+            SharedPrinterRecord *grown = (SharedPrinterRecord *)realloc(records, count * sizeof(SharedPrinterRecord));
+            if (!grown)
+                break;
+            records = grown;
+            capacity = count;
+        }
+        if (count > 0)
+            memcpy(records, snapshot->printers, count * sizeof(SharedPrinterRecord));
+        ffi_atomic_fence();
+        if (ffi_atomic_load_u64(&snapshot->sequence) != before)
+            continue;
+        if (snapshot_overflow)
+        {
+            *overflow = true;
+            break;
+        }
+        consistent = true;
+    }
+
+    if (!consistent)
+    {
+        free(records);
+        return NULL;
+    }
+
+    PrinterList *list = (PrinterList *)malloc(sizeof(PrinterList));
+    if (!list)
+    {
+        free(records);
+        return NULL;
+    }
+    list->count = (int)count;
+    list->printers = count > 0 ? (PrinterInfo *)calloc(count, sizeof(PrinterInfo)) : NULL;
+    if (count > 0 && !list->printers)
+    {
+        free(list);
+        free(records);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const SharedPrinterRecord *record = &records[i];
+        PrinterInfo *info = &list->printers[i];
+        info->name = strdup(record->name);
+        info->url = strdup(record->url);
+        info->model = strdup(record->model);
+        info->location = strdup(record->location);
+        info->comment = strdup(record->comment);
+        info->state = record->state;
+        info->is_default = record->is_default != 0;
+        info->is_available = record->is_available != 0;
+    }
+    free(records);
+    return list;
+}
+
+// While the host has more printers than the snapshot holds, each process keeps
+// the list from its last refresh here instead of re-enumerating on every call.
+static ffi_mutex_t s_overflow_list_lock = FFI_MUTEX_INITIALIZER;
+static PrinterList *s_overflow_list = NULL;
+static uint64_t s_overflow_refreshed_at_ms = 0;
+
+static PrinterList *_copy_printer_list(const PrinterList *src)
+{
+    PrinterList *list = (PrinterList *)malloc(sizeof(PrinterList));
+    if (!list)
+        return NULL;
+    list->count = src->count;
+    list->printers = src->count > 0 ? (PrinterInfo *)malloc(src->count * sizeof(PrinterInfo)) : NULL;
+    if (src->count > 0 && !list->printers)
+    {
+        free(list);
+        return NULL;
+    }
+    for (int i = 0; i < src->count; i++)
+        _copy_printer_info(&src->printers[i], &list->printers[i]);
+    return list;
+}
+
+// Returns a copy of this process's overflow list, or NULL if there is none;
+// `*refreshed_at_ms` gets the time it was enumerated.
+static PrinterList *_overflow_list_copy(uint64_t *refreshed_at_ms)
+{
+    ffi_mutex_lock(&s_overflow_list_lock);
+    PrinterList *list = s_overflow_list ? _copy_printer_list(s_overflow_list) : NULL;
+    *refreshed_at_ms = s_overflow_refreshed_at_ms;
+    ffi_mutex_unlock(&s_overflow_list_lock);
+    return list;
+}
+
+static void _overflow_list_store(const PrinterList *list, uint64_t refreshed_at_ms)
+{
+    PrinterList *copy = _copy_printer_list(list);
+    ffi_mutex_lock(&s_overflow_list_lock);
+    free_printer_list(s_overflow_list);
+    s_overflow_list = copy;
+    s_overflow_refreshed_at_ms = refreshed_at_ms;
+    ffi_mutex_unlock(&s_overflow_list_lock);
+}
+
+// Publishes `list` into the snapshot. The caller must hold the refresh lease.
+static void _write_shared_snapshot(SharedPrinterSnapshot *snapshot, const PrinterList *list, uint64_t now_ms)
+{
+    // A writer that died mid-publish leaves the sequence odd; keep it odd and finish the write.
+    uint64_t sequence = ffi_atomic_load_u64(&snapshot->sequence);
+    if ((sequence & 1) == 0)
+        ffi_atomic_store_u64(&snapshot->sequence, ++sequence);
+    ffi_atomic_fence();
+
+    uint32_t count = (uint32_t)list->count;
+    snapshot->overflow = count > SHARED_SNAPSHOT_MAX_PRINTERS;
+    if (count > SHARED_SNAPSHOT_MAX_PRINTERS)
+        count = SHARED_SNAPSHOT_MAX_PRINTERS;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const PrinterInfo *info = &list->printers[i];
+        SharedPrinterRecord *record = &snapshot->printers[i];
+        _snapshot_copy_string(record->name, sizeof(record->name), info->name);
+        _snapshot_copy_string(record->url, sizeof(record->url), info->url);
+        _snapshot_copy_string(record->model, sizeof(record->model), info->model);
+        _snapshot_copy_string(record->location, sizeof(record->location), info->location);
+        _snapshot_copy_string(record->comment, sizeof(record->comment), info->comment);
+        record->state = info->state;
+        record->is_default = info->is_default;
+        record->is_available = info->is_available;
+        // A truncated name would not identify the printer; serve nothing rather than a wrong name.
+        if (info->name && strlen(info->name) >= sizeof(record->name))
+            snapshot->overflow = 1;
+    }
+    snapshot->count = count;
+    snapshot->refreshed_at_ms = now_ms;
+
+    ffi_atomic_fence();
+    ffi_atomic_store_u64(&snapshot->sequence, sequence + 1);
+}
+
+// Maps (creating if needed) the shared printer snapshot named `name`, e.g. "printing_ffi".
+// Every process that should share printer enumeration must open the same name.
+FFI_PLUGIN_EXPORT bool open_shared_printer_snapshot(const char *name)
+{
+    if (!name || !name[0])
+    {
+        set_last_error("Invalid shared snapshot name.");
+        return false;
+    }
+    LOG("open_shared_printer_snapshot called with name: '%s'", name);
+
+    ffi_rwlock_wrlock(&s_snapshot_lock);
+    _unmap_shared_snapshot_locked();
+    s_snapshot = _map_shared_snapshot_locked(name);
+    bool ok = s_snapshot != NULL;
+    ffi_rwlock_wrunlock(&s_snapshot_lock);
+    return ok;
+}
+
+FFI_PLUGIN_EXPORT void close_shared_printer_snapshot(void)
+{
+    LOG("close_shared_printer_snapshot called");
+    ffi_rwlock_wrlock(&s_snapshot_lock);
+    _unmap_shared_snapshot_locked();
+    ffi_rwlock_wrunlock(&s_snapshot_lock);
+}
+
+// Like get_printers, but served from the shared snapshot when it is at most
+// `max_age_ms` old. If it is older, this process refreshes it unless another
+// process already is, in which case the slightly stale snapshot is returned.
+// Falls back to get_printers when no snapshot is open or usable. Free with free_printer_list.
+FFI_PLUGIN_EXPORT PrinterList *get_printers_shared(uint32_t max_age_ms)
+{
+    ffi_rwlock_rdlock(&s_snapshot_lock);
+    SharedPrinterSnapshot *snapshot = s_snapshot;
+    if (!snapshot || !_shared_snapshot_is_compatible(snapshot))
+    {
+        ffi_rwlock_rdunlock(&s_snapshot_lock);
+        return get_printers();
+    }
+
+    uint64_t now_ms = _monotonic_ns() / 1000000ULL;
+    uint64_t refreshed_at_ms = 0;
+    bool overflow = false;
+    PrinterList *cached = _read_shared_snapshot(snapshot, &refreshed_at_ms, &overflow);
+    if (!cached && overflow)
+        cached = _overflow_list_copy(&refreshed_at_ms);
+    if (cached && now_ms - refreshed_at_ms <= max_age_ms)
+    {
+        ffi_rwlock_rdunlock(&s_snapshot_lock);
+        return cached;
+    }
+
+    uint64_t lease = ffi_atomic_load_u64(&snapshot->lease_until_ms);
+    if (lease > now_ms || !ffi_atomic_cas_u64(&snapshot->lease_until_ms, lease, now_ms + SHARED_SNAPSHOT_LEASE_MS))
+    {
+        // Another process is refreshing. Serve what we have rather than adding load on the spooler.
+        ffi_rwlock_rdunlock(&s_snapshot_lock);
+        LOG("get_printers_shared: refresh in progress elsewhere, serving %s", cached ? "stale snapshot" : "direct query");
+        return cached ? cached : get_printers();
+    }
+
+    free_printer_list(cached);
+    PrinterList *list = get_printers();
+    if (list)
+    {
+        uint64_t published_at_ms = _monotonic_ns() / 1000000ULL;
+        _write_shared_snapshot(snapshot, list, published_at_ms);
+        if (snapshot->overflow)
+            _overflow_list_store(list, published_at_ms);
+        LOG("get_printers_shared: published %d printers", list->count);
+    }
+    ffi_atomic_store_u64(&snapshot->lease_until_ms, 0);
+    ffi_rwlock_rdunlock(&s_snapshot_lock);
+    return list;
+}
+
+// --- Job Lifecycle Tracing ---
+
+// Every job submitted through this library gets a trace of monotonic timestamps
+// for the stages the library can see. Stages up to JOB_STAGE_JOB_ID_RETURNED are
+// recorded during submission; later ones are recorded when a job listing or a
+// job operation first observes the job in that state, so their resolution is
+// bounded by how often the application polls. On CUPS, cupsPrintFile spools
+// the document and returns the job id in one call, so JOB_STAGE_SPOOLED is only
+// recorded on Windows. The CUPS active-jobs listing never shows a finished job,
+// so a listing only notes when a traced job drops out of it, and
+// get_job_timings looks the job's final state up once.
+//
+// Traces live in a fixed, direct-mapped table indexed by job id. Job ids are
+// sequential per spooler, so recent jobs rarely evict each other and lookups
+// from the listing paths stay O(1).
+#define JOB_TRACE_CAPACITY 1024
+#define JOB_TRACE_PRINTER_MAX 128
+
+typedef struct
+{
+    uint64_t started_ns;
+    uint64_t stage_ns[JOB_STAGE_COUNT]; // Absolute monotonic time; 0 = not reached.
+} JobTraceBuilder;
+
+typedef struct
+{
+    uint32_t job_id; // 0 = empty slot
+    char printer_name[JOB_TRACE_PRINTER_MAX];
+    JobTraceBuilder times;
+    uint64_t departed_ns; // CUPS: when a listing first missed the job; 0 = not yet.
+    bool settled;         // CUPS: the final state was looked up, whatever the outcome.
+} JobTraceSlot;
+
+static ffi_mutex_t s_job_trace_lock = FFI_MUTEX_INITIALIZER;
+static JobTraceSlot s_job_traces[JOB_TRACE_CAPACITY];
+
+static void _job_trace_begin(JobTraceBuilder *trace)
+{
+    memset(trace, 0, sizeof(*trace));
+    trace->started_ns = _monotonic_ns();
+}
+
+static void _job_trace_mark(JobTraceBuilder *trace, int stage)
+{
+    trace->stage_ns[stage] = _monotonic_ns();
+}
+
+// Stores a submission trace once the spooler has assigned `job_id`.
+static void _job_trace_commit(const JobTraceBuilder *trace, const char *printer_name, uint32_t job_id)
+{
+    if (job_id == 0 || !printer_name)
+        return;
+    ffi_mutex_lock(&s_job_trace_lock);
+    JobTraceSlot *slot = &s_job_traces[job_id % JOB_TRACE_CAPACITY];
+    slot->job_id = job_id;
+    snprintf(slot->printer_name, sizeof(slot->printer_name), "%s", printer_name);
+    slot->times = *trace;
+    slot->departed_ns = 0;
+    slot->settled = false;
+    ffi_mutex_unlock(&s_job_trace_lock);
+}
+
+// Records that a traced job was in `stage` at `now`, unless it already was
+// seen in it. Jobs not submitted through this library have no trace and are ignored.
+static void _job_trace_observe_at(const char *printer_name, uint32_t job_id, int stage, uint64_t now)
+{
+    if (job_id == 0 || !printer_name || stage < 0)
+        return;
+    ffi_mutex_lock(&s_job_trace_lock);
+    JobTraceSlot *slot = &s_job_traces[job_id % JOB_TRACE_CAPACITY];
+    if (slot->job_id == job_id && strncmp(slot->printer_name, printer_name, sizeof(slot->printer_name) - 1) == 0 &&
+        slot->times.stage_ns[stage] == 0)
+    {
+        slot->times.stage_ns[stage] = now;
+        // A job that finished between two polls was processing at some point in between.
+        if (stage >= JOB_STAGE_COMPLETED && slot->times.stage_ns[JOB_STAGE_FIRST_PROCESSING] == 0)
+            slot->times.stage_ns[JOB_STAGE_FIRST_PROCESSING] = now;
+    }
+    ffi_mutex_unlock(&s_job_trace_lock);
+}
+
+// Records the first time a traced job was seen in `stage`.
+static void _job_trace_observe(const char *printer_name, uint32_t job_id, int stage)
+{
+    _job_trace_observe_at(printer_name, job_id, stage, _monotonic_ns());
+}
+
+#ifndef _WIN32
+// Returns true if a traced job has a job id but no terminal stage, and its
+// final state has not been looked up. The caller must hold s_job_trace_lock.
+static bool _job_trace_is_open(const JobTraceSlot *slot)
+{
+    const uint64_t *stages = slot->times.stage_ns;
+    return slot->job_id != 0 && !slot->settled && stages[JOB_STAGE_JOB_ID_RETURNED] != 0 &&
+           stages[JOB_STAGE_COMPLETED] == 0 && stages[JOB_STAGE_CANCELED] == 0 && stages[JOB_STAGE_ABORTED] == 0;
+}
+
+// Notes the open traces on `printer_name` that an active-jobs listing no
+// longer shows. This costs no request; get_job_timings settles them later.
+static void _job_trace_mark_departed(const char *printer_name, const cups_job_t *jobs, int num_jobs)
+{
+    uint64_t now = _monotonic_ns();
+    ffi_mutex_lock(&s_job_trace_lock);
+    for (int i = 0; i < JOB_TRACE_CAPACITY; i++)
+    {
+        JobTraceSlot *slot = &s_job_traces[i];
+        if (slot->departed_ns != 0 || !_job_trace_is_open(slot) ||
+            strncmp(slot->printer_name, printer_name, sizeof(slot->printer_name) - 1) != 0)
+            continue;
+        bool active = false;
+        for (int j = 0; j < num_jobs && !active; j++)
+            active = (uint32_t)jobs[j].id == slot->job_id;
+        if (!active)
+            slot->departed_ns = now;
+    }
+    ffi_mutex_unlock(&s_job_trace_lock);
+}
+#endif
+
+// Maps a platform job state (IPP job-state, or Windows JOB_STATUS_* flags) to a trace stage, or -1.
+static int _job_stage_from_state(uint32_t state)
+{
+#ifdef _WIN32
+    if (state & (JOB_STATUS_PRINTED | JOB_STATUS_COMPLETE))
+        return JOB_STAGE_COMPLETED;
+    if (state & JOB_STATUS_DELETED)
+        return JOB_STAGE_CANCELED;
+    if (state & JOB_STATUS_PRINTING)
+        return JOB_STAGE_FIRST_PROCESSING;
+    return -1;
+#else
+    switch (state)
+    {
+    case IPP_JSTATE_PROCESSING:
+        return JOB_STAGE_FIRST_PROCESSING;
+    case IPP_JSTATE_COMPLETED:
+        return JOB_STAGE_COMPLETED;
+    case IPP_JSTATE_CANCELED:
+        return JOB_STAGE_CANCELED;
+    case IPP_JSTATE_ABORTED:
+        return JOB_STAGE_ABORTED;
+    default:
+        return -1;
+    }
+#endif
+}
+
+#ifndef _WIN32
+// Caps the Get-Job-Attributes requests one get_job_timings call spends on settling traces.
+#define JOB_TRACE_SETTLE_MAX 32
+
+// Looks up the final job-state of traced jobs that dropped out of the active
+// listing, at most once per job, and dates it to the listing that first
+// missed the job. A job the scheduler no longer knows about (job history
+// disabled) is taken as completed; after any other failure the trace is left
+// without a terminal stage. Jobs beyond JOB_TRACE_SETTLE_MAX wait for the next call.
+static void _job_trace_settle_cups(const char *printer_name)
+{
+    struct
+    {
+        uint32_t job_id;
+        char printer_name[JOB_TRACE_PRINTER_MAX];
+        uint64_t departed_ns;
+    } pending[JOB_TRACE_SETTLE_MAX];
+    int count = 0;
+    ffi_mutex_lock(&s_job_trace_lock);
+    for (int i = 0; i < JOB_TRACE_CAPACITY && count < JOB_TRACE_SETTLE_MAX; i++)
+    {
+        JobTraceSlot *slot = &s_job_traces[i];
+        if (slot->departed_ns == 0 || !_job_trace_is_open(slot) || (printer_name && strcmp(slot->printer_name, printer_name) != 0))
+            continue;
+        // Claimed before the lookup so that concurrent callers do not repeat it.
+        slot->settled = true;
+        pending[count].job_id = slot->job_id;
+        memcpy(pending[count].printer_name, slot->printer_name, sizeof(slot->printer_name));
+        pending[count].departed_ns = slot->departed_ns;
+        count++;
+    }
+    ffi_mutex_unlock(&s_job_trace_lock);
+
+    for (int i = 0; i < count; i++)
+    {
+        char job_uri[HTTP_MAX_URI];
+        httpAssembleURIf(HTTP_URI_CODING_ALL, job_uri, sizeof(job_uri), "ipp", NULL, "localhost", ippPort(), "/jobs/%u", pending[i].job_id);
+        static const char *const requested[] = {"job-state"};
+        ipp_t *request = ippNewRequest(IPP_OP_GET_JOB_ATTRIBUTES);
+        ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "job-uri", NULL, job_uri);
+        ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
+        ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", 1, NULL, requested);
+        ipp_t *response = _ipp_do_request(CUPS_HTTP_DEFAULT, request, "/jobs/");
+
+        int stage = -1;
+        ipp_attribute_t *attr = response ? ippFindAttribute(response, "job-state", IPP_TAG_ENUM) : NULL;
+        if (attr)
+            stage = _job_stage_from_state((uint32_t)ippGetInteger(attr, 0));
+        else if (cupsLastError() == IPP_STATUS_ERROR_NOT_FOUND)
+            stage = JOB_STAGE_COMPLETED;
+        else
+            LOG_WARN("Could not settle the trace of job %u on '%s': %s", pending[i].job_id, pending[i].printer_name, cupsLastErrorString());
+        ippDelete(response);
+        _job_trace_observe_at(pending[i].printer_name, pending[i].job_id, stage, pending[i].departed_ns);
+    }
+}
+#endif
+
+static int _compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Nearest-rank percentile of a sorted sample.
+static uint64_t _percentile(const uint64_t *sorted, int count, int percent)
+{
+    int rank = (count * percent + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// Returns the duration of `interval` for a trace, or 0 if either end was not observed.
+static uint64_t _job_interval_ns(const JobTraceBuilder *t, int interval)
+{
+    uint64_t from = 0, to = 0;
+    switch (interval)
+    {
+    case JOB_INTERVAL_SUBMIT:
+        from = t->started_ns;
+        to = t->stage_ns[JOB_STAGE_JOB_ID_RETURNED];
+        break;
+    case JOB_INTERVAL_QUEUED:
+        from = t->stage_ns[JOB_STAGE_JOB_ID_RETURNED];
+        to = t->stage_ns[JOB_STAGE_FIRST_PROCESSING];
+        break;
+    case JOB_INTERVAL_PRINTING:
+        from = t->stage_ns[JOB_STAGE_FIRST_PROCESSING];
+        to = t->stage_ns[JOB_STAGE_COMPLETED];
+        break;
+    case JOB_INTERVAL_TOTAL:
+        from = t->started_ns;
+        to = t->stage_ns[JOB_STAGE_COMPLETED];
+        break;
+    }
+    return from && to && to >= from ? to - from : 0;
+}
+
+// Returns the retained job traces and p50/p95/p99 summaries per printer and interval.
+// Pass NULL to include every printer. Free with free_job_timings.
+FFI_PLUGIN_EXPORT JobTimings *get_job_timings(const char *printer_name)
+{
+    LOG("get_job_timings called for printer: '%s'", printer_name ? printer_name : "(all)");
+#ifndef _WIN32
+    _job_trace_settle_cups(printer_name);
+#endif
+    JobTimings *timings = (JobTimings *)calloc(1, sizeof(JobTimings));
+    if (!timings)
+        return NULL;
+
+    // Copy the matching slots so the summaries can be computed without holding the lock.
+    JobTraceSlot *slots = (JobTraceSlot *)malloc(sizeof(s_job_traces));
+    if (!slots)
+    {
+        free(timings);
+        return NULL;
+    }
+    int count = 0;
+    ffi_mutex_lock(&s_job_trace_lock);
+    for (int i = 0; i < JOB_TRACE_CAPACITY; i++)
+    {
+        if (s_job_traces[i].job_id != 0 && (!printer_name || strcmp(s_job_traces[i].printer_name, printer_name) == 0))
+            slots[count++] = s_job_traces[i];
+    }
+    ffi_mutex_unlock(&s_job_trace_lock);
+
+    timings->traces = count > 0 ? (JobTrace *)calloc(count, sizeof(JobTrace)) : NULL;
+    // At most one summary per (printer, interval); every trace can be its own printer.
+    timings->summaries = count > 0 ? (JobTimingSummary *)calloc((size_t)count * JOB_INTERVAL_COUNT, sizeof(JobTimingSummary)) : NULL;
+    uint64_t *samples = count > 0 ? (uint64_t *)malloc(count * sizeof(uint64_t)) : NULL;
+    bool *summarized = count > 0 ? (bool *)calloc(count, sizeof(bool)) : NULL;
+    if (count > 0 && (!timings->traces || !timings->summaries || !samples || !summarized))
+    {
+        free(samples);
+        free(summarized);
+        free(slots);
+        free_job_timings(timings);
+        return NULL;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        JobTrace *trace = &timings->traces[timings->trace_count++];
+        trace->job_id = slots[i].job_id;
+        trace->printer_name = strdup(slots[i].printer_name);
+        trace->started_ns = slots[i].times.started_ns;
+        for (int stage = 0; stage < JOB_STAGE_COUNT; stage++)
+        {
+            uint64_t at = slots[i].times.stage_ns[stage];
+            trace->stage_ns[stage] = at ? at - slots[i].times.started_ns : 0;
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if (summarized[i])
+            continue;
+        const char *name = slots[i].printer_name;
+        for (int interval = 0; interval < JOB_INTERVAL_COUNT; interval++)
+        {
+            int num_samples = 0;
+            for (int j = i; j < count; j++)
+            {
+                if (strcmp(slots[j].printer_name, name) != 0)
+                    continue;
+                summarized[j] = true;
+                uint64_t duration = _job_interval_ns(&slots[j].times, interval);
+                if (duration)
+                    samples[num_samples++] = duration;
+            }
+            if (num_samples == 0)
+                continue;
+            qsort(samples, num_samples, sizeof(uint64_t), _compare_u64);
+            JobTimingSummary *summary = &timings->summaries[timings->summary_count++];
+            summary->printer_name = strdup(name);
+            summary->interval = interval;
+            summary->samples = (uint32_t)num_samples;
+            summary->p50_ns = _percentile(samples, num_samples, 50);
+            summary->p95_ns = _percentile(samples, num_samples, 95);
+            summary->p99_ns = _percentile(samples, num_samples, 99);
+            summary->max_ns = samples[num_samples - 1];
+        }
+    }
+
+    free(samples);
+    free(summarized);
+    free(slots);
+    return timings;
+}
+
+FFI_PLUGIN_EXPORT void free_job_timings(JobTimings *timings)
+{
+    if (!timings)
+        return;
+    for (int i = 0; i < timings->trace_count; i++)
+        free(timings->traces[i].printer_name);
+    for (int i = 0; i < timings->summary_count; i++)
+        free(timings->summaries[i].printer_name);
+    free(timings->traces);
+    free(timings->summaries);
+    free(timings);
+}
+
+FFI_PLUGIN_EXPORT void reset_job_timings(void)
+{
+    LOG("reset_job_timings called");
+    ffi_mutex_lock(&s_job_trace_lock);
+    memset(s_job_traces, 0, sizeof(s_job_traces));
+    ffi_mutex_unlock(&s_job_trace_lock);
+}
+
+// Defined under "Admission Control", after the printer status queries they use.
+static bool _admit_job(const char **printer_name);
+static void _admission_remember(const PrinterStatus *status);
+
+static bool _raw_data_to_printer(const char *printer_name, const uint8_t *data, int length, const char *doc_name, int num_options, const char **option_keys, const char **option_values)
+{
+    LOG("raw_data_to_printer called for printer: '%s', doc: '%s', length: %d", printer_name, doc_name, length);
+
+    // Validate input parameters
+    if (!printer_name || !data || length <= 0 || !doc_name)
+    {
+        LOG("Invalid input parameters");
+        return false;
+    }
+
+    JobTraceBuilder trace;
+    _job_trace_begin(&trace);
+#ifdef _WIN32
+    int paper_size_id, paper_source_id, orientation, color_mode, print_quality, media_type_id, duplex_mode;
+    double custom_scale; // Dummy for raw printing
+    bool collate = true; // Default to collated (complete copies printed together)
+    parse_windows_options(num_options, option_keys, option_values, &paper_size_id, &paper_source_id, &orientation, &color_mode, &print_quality, &media_type_id, &custom_scale, &collate, &duplex_mode);
+    _job_trace_mark(&trace, JOB_STAGE_OPTIONS_PARSED);
+
+    HANDLE hPrinter;
+    DOC_INFO_1W docInfo;
+    DWORD written;
+    wchar_t *printer_name_w = to_utf16(printer_name);
+    if (!printer_name_w)
+        return false;
+
+    DEVMODEW *pDevMode = get_modified_devmode(printer_name_w, paper_size_id, paper_source_id, orientation, color_mode, print_quality, media_type_id, collate, duplex_mode);
+
+    PRINTER_DEFAULTSW printerDefaults = {NULL, pDevMode, PRINTER_ACCESS_USE};
+    printerDefaults.pDatatype = L"RAW";
+
+    if (!OpenPrinterW(printer_name_w, &hPrinter, &printerDefaults))
+    {
+        LOG_WARN("OpenPrinterW failed with error %lu", GetLastError());
+        free(printer_name_w);
+        if (pDevMode)
+            free(pDevMode);
+        return false;
+    }
+
+    wchar_t *doc_name_w = to_utf16(doc_name);
+    docInfo.pDocName = doc_name_w;
+    docInfo.pOutputFile = NULL;
+    docInfo.pDatatype = L"RAW";
+
+    _job_trace_mark(&trace, JOB_STAGE_REQUEST_SENT);
+    DWORD job_id = StartDocPrinterW(hPrinter, 1, (LPBYTE)&docInfo);
+    if (job_id == 0)
+    {
+        ClosePrinter(hPrinter);
+        LOG_WARN("StartDocPrinterW failed with error %lu", GetLastError());
+        if (doc_name_w)
+            free(doc_name_w);
+        free(printer_name_w);
+        if (pDevMode)
+            free(pDevMode);
+        return false;
+    }
+    _job_trace_mark(&trace, JOB_STAGE_JOB_ID_RETURNED);
+    if (doc_name_w)
+        free(doc_name_w);
+
+    if (!StartPagePrinter(hPrinter))
+    {
+        EndDocPrinter(hPrinter);
+        ClosePrinter(hPrinter);
+        LOG_WARN("StartPagePrinter failed with error %lu", GetLastError());
+        free(printer_name_w);
+        if (pDevMode)
+            free(pDevMode);
+        return false;
+    }
+
+    TraceSpan spool_span;
+    _trace_begin(&spool_span, "WritePrinter");
+    _trace_arg_int(&spool_span, "bytes", length);
+    bool result = WritePrinter(hPrinter, (LPVOID)data, (DWORD)length, &written);
+    _trace_end(&spool_span);
+    EndPagePrinter(hPrinter);
+    EndDocPrinter(hPrinter);
+    _job_trace_mark(&trace, JOB_STAGE_SPOOLED);
+    _job_trace_commit(&trace, printer_name, job_id);
+    ClosePrinter(hPrinter);
+    free(printer_name_w);
+    if (pDevMode)
+        free(pDevMode);
+
+    bool success = result && written == (DWORD)length;
+    if (!success)
+    {
+        LOG_WARN("WritePrinter failed. Result: %d, Bytes written: %lu, Expected: %d", result, written, length);
+    }
+    return success;
+#else // macOS / Linux
+    // Use getenv("TMPDIR") to get the correct temporary directory,
+    // especially important for sandboxed macOS apps where /tmp is not writable.
+    const char *tmpdir = getenv("TMPDIR");
+    if (!tmpdir)
+    {
+        tmpdir = "/tmp"; // Fallback for Linux or non-sandboxed environments
+    }
+
+    char temp_file[PATH_MAX];
+    snprintf(temp_file, sizeof(temp_file), "%s/printing_ffi_XXXXXX", tmpdir);
+    LOG("Creating temporary file at: %s", temp_file);
+
+    int fd = mkstemp(temp_file);
+    if (fd == -1)
+    {
+        LOG_WARN("mkstemp failed to create temporary file");
+        return false;
+    }
+
+    FILE *fp = fdopen(fd, "wb");
+    if (!fp)
+    {
+        close(fd);
+        unlink(temp_file);
+        return false;
+    }
+
+    TraceSpan spool_span;
+    _trace_begin(&spool_span, "spool_write");
+    _trace_arg_int(&spool_span, "bytes", length);
+    size_t written = fwrite(data, 1, (size_t)length, fp);
+    fclose(fp);
+    _trace_end(&spool_span);
+
+    if (written != (size_t)length)
+    {
+        unlink(temp_file);
+        return false;
+    }
+
+    // Add the "raw" option to tell CUPS not to filter the data.
+    cups_option_t *options = NULL;
+    int num_cups_options = 0;
+    num_cups_options = cupsAddOption("raw", "true", num_cups_options, &options);
+
+    num_cups_options = _add_normalized_cups_options(num_options, option_keys, option_values, num_cups_options, &options);
+    _job_trace_mark(&trace, JOB_STAGE_OPTIONS_PARSED);
+
+    // cupsPrintFile sends the request and streams the payload before returning the job id.
+    _job_trace_mark(&trace, JOB_STAGE_REQUEST_SENT);
+    TraceSpan submit_span;
+    _trace_begin(&submit_span, "cupsPrintFile");
+    _trace_arg_str(&submit_span, "printer", printer_name);
+    _trace_arg_str(&submit_span, "file", temp_file);
+    int job_id = cupsPrintFile(printer_name, temp_file, doc_name, num_cups_options, options);
+    _trace_end(&submit_span);
+    if (job_id > 0)
+    {
+        _job_trace_mark(&trace, JOB_STAGE_JOB_ID_RETURNED);
+        _job_trace_commit(&trace, printer_name, (uint32_t)job_id);
+    }
+    if (job_id <= 0)
+    {
+        LOG_WARN("cupsPrintFile failed, error: %s", cupsLastErrorString());
+    }
+    cupsFreeOptions(num_cups_options, options);
+    unlink(temp_file);
+    LOG("raw_data_to_printer finished with job_id: %d", job_id);
+    return job_id > 0;
+#endif
+}
+
+FFI_PLUGIN_EXPORT bool raw_data_to_printer(const char *printer_name, const uint8_t *data, int length, const char *doc_name, int num_options, const char **option_keys, const char **option_values)
+{
+    uint64_t started = _monotonic_ns();
+    const char *target = printer_name;
+    bool result = _admit_job(&target) && _raw_data_to_printer(target, data, length, doc_name, num_options, option_keys, option_values);
+    _metrics_record(METRIC_OP_PRINT_RAW, started, result);
+    _call_record_raw(CALL_PRINT_RAW, printer_name, data, length, doc_name, num_options, option_keys, option_values, started, result, result);
+    return result;
+}
+
+// Internal helper to calculate the destination rectangle for scaling content to fit a target area.
+static void _scale_to_fit(int src_width, int src_height, int target_width, int target_height, int *dest_width, int *dest_height) {
+    float page_aspect = 1.0f;
+    if (src_height > 0)
+    {
+        page_aspect = (float)src_width / (float)src_height;
+    }
+
+    float target_aspect = 1.0f;
+    if (target_height != 0)
+    {
+        target_aspect = (float)target_width / (float)target_height;
+    }
+
+    if (page_aspect > target_aspect)
+    {
+        *dest_width = target_width;
+        *dest_height = (int)(target_width / page_aspect);
+    }
+    else
+    {
+        *dest_height = target_height;
+        *dest_width = (int)(target_height * page_aspect);
+    }
+}
+
+#ifdef _WIN32
+
+// Common internal function for PDF printing on Windows.
+// Returns a job ID if `submit_job` is true, otherwise returns 1 for success or 0 for failure.
+static int32_t _print_pdf_job_win(const char *printer_name, const char *pdf_file_path, const char *doc_name, int scaling_mode, int copies, const char *page_range, const char *alignment, int num_options, const char **option_keys, const char **option_values, bool submit_job)
+{
+    LOG("print_pdf_job_win: Initializing for printer '%s', path '%s'", printer_name, pdf_file_path);
+    if (!s_pdfium_initialized)
+    {
+        FPDF_LIBRARY_CONFIG config;
+        memset(&config, 0, sizeof(config));
+        config.version = 2;
+        FPDF_InitLibraryWithConfig(&config);
+        s_pdfium_initialized = true;
+        LOG("Pdfium library initialized for the first time.");
+    }
+    // Clear any previous errors at the start of an operation.
+    set_last_error("");
+
+    JobTraceBuilder trace;
+    _job_trace_begin(&trace);
+    double custom_scale;
+    int paper_size_id, paper_source_id, orientation, color_mode, print_quality, media_type_id, duplex_mode;
+    bool collate = true; // Default to collated (complete copies printed together)
+    parse_windows_options(num_options, option_keys, option_values, &paper_size_id, &paper_source_id, &orientation, &color_mode, &print_quality, &media_type_id, &custom_scale, &collate, &duplex_mode);
+    _job_trace_mark(&trace, JOB_STAGE_OPTIONS_PARSED);
+
+    wchar_t *printer_name_w = to_utf16(printer_name);
+    if (!printer_name_w)
+    {
+        set_last_error("Failed to convert printer name to UTF-16.");
+        LOG_WARN("print_pdf_job_win: Failed to convert printer name to UTF-16");
+        return 0;
+    }
+
+    TraceSpan span;
+    _trace_begin(&span, "pdf_load_document");
+    _trace_arg_str(&span, "file", pdf_file_path);
+    FPDF_DOCUMENT doc = FPDF_LoadDocument(pdf_file_path, NULL);
+    _trace_end(&span);
+    if (!doc)
+    {
+        set_last_error("Failed to load PDF document at path '%s'. Error code: %ld. The file may be missing, corrupt, or password-protected.", pdf_file_path, FPDF_GetLastError());
+        LOG_WARN("print_pdf_job_win: FPDF_LoadDocument failed for path: %s. Error: %ld", pdf_file_path, FPDF_GetLastError());
+        free(printer_name_w);
+        return 0;
+    }
+    LOG("print_pdf_job_win: PDF document loaded successfully.");
+
+    DEVMODEW* pDevMode = get_modified_devmode(printer_name_w, paper_size_id, paper_source_id, orientation, color_mode, print_quality, media_type_id, collate, duplex_mode);
+
+    HDC hdc = CreateDCW(L"WINSPOOL", printer_name_w, NULL, pDevMode);
+    if (pDevMode)
+        free(pDevMode); // DEVMODE is copied by CreateDC, so we can free it now.
+
+    if (!hdc)
+    {
+        set_last_error("Failed to create device context (CreateDCW) for printer '%s'. Error: %lu. This often indicates an invalid printer name or driver issue.", printer_name, GetLastError());
+        LOG_WARN("print_pdf_job_win: CreateDCW failed for printer '%s' with error %lu. This often indicates an invalid DEVMODE.", printer_name, GetLastError());
+        FPDF_CloseDocument(doc);
+        free(printer_name_w);
+        return 0;
+    }
+
+    wchar_t *doc_name_w = to_utf16(doc_name);
+    DOCINFOW di = {sizeof(DOCINFOW), doc_name_w, NULL, 0};
+    _job_trace_mark(&trace, JOB_STAGE_REQUEST_SENT);
+    int job_id = StartDocW(hdc, &di);
+
+    if (job_id <= 0)
+    {
+        set_last_error("Failed to start print document (StartDocW). Error: %lu.", GetLastError());
+        LOG_WARN("print_pdf_job_win: StartDocW failed with error %lu", GetLastError());
+        if (doc_name_w)
+            free(doc_name_w);
+        DeleteDC(hdc);
+        FPDF_CloseDocument(doc);
+        free(printer_name_w);
+        return 0;
+    }
+    _job_trace_mark(&trace, JOB_STAGE_JOB_ID_RETURNED);
+    // doc_name_w is used by the system, don't free it until EndDoc.
+    LOG("print_pdf_job_win: StartDocW succeeded with Job ID: %d", job_id);
+
+    int page_count = FPDF_GetPageCount(doc);
+    if (page_count <= 0)
+    {
+        set_last_error("Could not get page count from the PDF document. The file may be empty, corrupt, or in an unsupported format. (Page count: %d)", page_count);
+        LOG("print_pdf_job_win: FPDF_GetPageCount returned %d. Aborting.", page_count);
+        if (doc_name_w)
+            free(doc_name_w);
+        AbortDoc(hdc);
+        DeleteDC(hdc);
+        FPDF_CloseDocument(doc);
+        free(printer_name_w);
+        // We don't need to free pages_to_print as it's not allocated yet.
+        return 0;
+    }
+
+    LOG("print_pdf_job_win: PDF has %d pages.", page_count);
+    bool *pages_to_print = (bool *)malloc(page_count * sizeof(bool));
+    if (!pages_to_print)
+    {
+        set_last_error("Failed to allocate memory for page range flags.");
+        LOG_WARN("print_pdf_job_win: Failed to allocate memory for page range flags.");
+        if (doc_name_w)
+            free(doc_name_w);
+        AbortDoc(hdc);
+        DeleteDC(hdc);
+        FPDF_CloseDocument(doc);
+        free(printer_name_w);
+        return 0;
+    }
+
+    if (!parse_page_range(page_range, pages_to_print, page_count))
+    {
+        // If parse_page_range fails, it now sets a specific error. If it's still empty, provide a generic one.
+        if (g_last_error_message == NULL || strlen(g_last_error_message) == 0)
+            set_last_error("Invalid page range format: '%s'. Use a format like '1-3,5,7-9'.", page_range ? page_range : "");
+        LOG("print_pdf_job_win: Invalid page range string provided: %s", page_range ? page_range : "(null)");
+        free(pages_to_print);
+        if (doc_name_w)
+            free(doc_name_w);
+        AbortDoc(hdc);
+        DeleteDC(hdc);
+        FPDF_CloseDocument(doc);
+        free(printer_name_w);
+        return 0;
+    }
+    LOG("print_pdf_job_win: Page range parsed successfully. Copies: %d.", copies);
+
+    // --- Alignment ---
+    double align_x_factor = 0.5; // Default to center
+    double align_y_factor = 0.5; // Default to center
+
+    if (alignment)
+    {
+        char *alignment_lower = strdup(alignment);
+        if (alignment_lower)
+        {
+            for (int i = 0; alignment_lower[i]; i++)
+            {
+                alignment_lower[i] = tolower(alignment_lower[i]);
+            }
+
+            if (strstr(alignment_lower, "left"))
+            {
+                align_x_factor = 0.0;
+            }
+            else if (strstr(alignment_lower, "right"))
+            {
+                align_x_factor = 1.0;
+            }
+
+            if (strstr(alignment_lower, "top"))
+            {
+                align_y_factor = 0.0;
+            }
+            else if (strstr(alignment_lower, "bottom"))
+            {
+                align_y_factor = 1.0;
+            }
+
+            free(alignment_lower);
+        }
+    }
+
+    bool success = true;
+    for (int c = 0; c < copies && success; c++)
+    {
+        LOG("print_pdf_job_win: Starting copy %d of %d.", c + 1, copies);
+        for (int i = 0; i < page_count && success; ++i)
+        {
+            if (!pages_to_print[i])
+            {
+                continue;
+            }
+            LOG("print_pdf_job_win: Printing page %d (0-indexed).", i);
+
+            // Declare destination rectangle variables for the current page.
+            int dest_x = 0, dest_y = 0, dest_width = 0, dest_height = 0;
+
+            _trace_begin(&span, "pdf_load_page");
+            _trace_arg_int(&span, "page", i + 1);
+            FPDF_PAGE page = FPDF_LoadPage(doc, i);
+            _trace_end(&span);
+            if (!page)
+            {
+                set_last_error("Failed to load PDF page %d.", i + 1);
+                LOG_WARN("print_pdf_job_win: FPDF_LoadPage failed for page %d", i);
+                success = false;
+                break;
+            }
+
+            if (StartPage(hdc) <= 0)
+            {
+                set_last_error("Failed to start page %d. Error: %lu.", i + 1, GetLastError());
+                LOG_WARN("print_pdf_job_win: StartPage failed for page %d with error %lu", i, GetLastError());
+                // Clean up the page resource before breaking from the loop.
+                FPDF_ClosePage(page);
+                success = false;
+                break;
+            }
+
+            // --- Get PDF page dimensions and rotation ---
+            float pdf_width_pt = FPDF_GetPageWidthF(page);
+            float pdf_height_pt = FPDF_GetPageHeightF(page);
+
+            int rotation = FPDFPage_GetRotation(page);
+            if (rotation == 1 || rotation == 3)
+            { // 90 or 270 degrees, swap dimensions
+                float temp = pdf_width_pt;
+                pdf_width_pt = pdf_height_pt;
+                pdf_height_pt = temp;
+            }
+
+            int dpi_x = GetDeviceCaps(hdc, LOGPIXELSX);
+            int dpi_y = GetDeviceCaps(hdc, LOGPIXELSY);
+            int printable_width_pixels = GetDeviceCaps(hdc, HORZRES);
+            int printable_height_pixels = GetDeviceCaps(hdc, VERTRES);
+            int paper_width_pixels = GetDeviceCaps(hdc, PHYSICALWIDTH);
+            int paper_height_pixels = GetDeviceCaps(hdc, PHYSICALHEIGHT);
+
+            LOG("print_pdf_job_win: Page %d: PDF Dimensions (pt): %.2f x %.2f", i, pdf_width_pt, pdf_height_pt);
+            LOG("print_pdf_job_win: Page %d: Device DPI: %d x %d", i, dpi_x, dpi_y);
+            LOG("print_pdf_job_win: Page %d: Printable Area (pixels): %d x %d", i, printable_width_pixels, printable_height_pixels);
+            LOG("print_pdf_job_win: Page %d: Physical Paper (pixels): %d x %d", i, paper_width_pixels, paper_height_pixels);
+
+            // Render the bitmap using the device's specific DPI for each axis to avoid distortion.
+            int bitmap_width = (int)(pdf_width_pt / 72.0f * dpi_x);
+            int bitmap_height = (int)(pdf_height_pt / 72.0f * dpi_y);
+            LOG("print_pdf_job_win: Page %d: Bitmap Dimensions (pixels): %d x %d", i, bitmap_width, bitmap_height);
+
+            BITMAPINFO bmi;
+            memset(&bmi, 0, sizeof(bmi));
+            bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+            bmi.bmiHeader.biWidth = bitmap_width;
+            bmi.bmiHeader.biHeight = -bitmap_height; // Negative for top-down DIB
+            bmi.bmiHeader.biPlanes = 1;
             bmi.bmiHeader.biBitCount = 32; // Using 32-bit BGRA for alignment safety, as in the original working code.
             bmi.bmiHeader.biCompression = BI_RGB;
 
-            void *pBitmapData = NULL;
-            HBITMAP hBitmap = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, &pBitmapData, NULL, 0);
-            if (!hBitmap || !pBitmapData)
+            void *pBitmapData = NULL;
+            HBITMAP hBitmap = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, &pBitmapData, NULL, 0);
+            if (!hBitmap || !pBitmapData)
+            {
+                set_last_error("Failed to create bitmap for rendering page %d. Error: %lu.", i + 1, GetLastError());
+                LOG_WARN("print_pdf_job_win: CreateDIBSection failed for page %d with error %lu", i, GetLastError());
+                FPDF_ClosePage(page);
+                EndPage(hdc);
+                success = false;
+                break;
+            }
+
+            FPDF_BITMAP pdfBitmap = FPDFBitmap_CreateEx(bitmap_width, bitmap_height, FPDFBitmap_BGRA, pBitmapData, bitmap_width * 4);
+            if (!pdfBitmap)
+            {
+                set_last_error("Failed to create PDFium bitmap for page %d.", i + 1);
+                LOG_WARN("print_pdf_job_win: FPDFBitmap_CreateEx failed for page %d", i);
+                DeleteObject(hBitmap);
+                FPDF_ClosePage(page);
+                EndPage(hdc);
+                success = false;
+                break;
+            }
+
+            _trace_begin(&span, "pdf_render_page");
+            _trace_arg_int(&span, "page", i + 1);
+            _trace_arg_int(&span, "width", bitmap_width);
+            _trace_arg_int(&span, "height", bitmap_height);
+            FPDFBitmap_FillRect(pdfBitmap, 0, 0, bitmap_width, bitmap_height, 0xFFFFFFFF); // Fill with white
+            // Pass the rotation value to PDFium so it handles rendering the page correctly.
+            // IMPORTANT: We have already swapped the width/height to create a correctly-oriented
+            // bitmap. We must now render the page with NO additional rotation, so we pass 0.
+            // The page content itself will be correctly oriented within the unrotated bitmap.
+            FPDF_RenderPageBitmap(pdfBitmap, page, 0, 0, bitmap_width, bitmap_height, 0, FPDF_ANNOT);
+            FPDFBitmap_Destroy(pdfBitmap);
+            _trace_end(&span);
+
+            if (scaling_mode == 0)
+            { // Fit to Printable Area (formerly Fit Page)
+                _scale_to_fit(bitmap_width, bitmap_height, printable_width_pixels, printable_height_pixels, &dest_width, &dest_height);
+                LOG("print_pdf_job_win: Page %d: ScalingMode=FitToPrintableArea, Dest=(%d,%d)", i, dest_width, dest_height);
+            }
+            else if (scaling_mode == 1)
+            { // Actual Size
+                // Calculate actual size in device pixels
+                dest_width = (int)(pdf_width_pt / 72.0f * dpi_x);
+                dest_height = (int)(pdf_height_pt / 72.0f * dpi_y);
+                LOG("print_pdf_job_win: Page %d: ScalingMode=ActualSize, Dest=(%d,%d)", i, dest_width, dest_height);
+            }
+            else if (scaling_mode == 2)
+            { // Shrink to Fit
+                // If the PDF page is larger than the printable area, scale down to fit.
+                // Otherwise, print at actual size.
+                int pdf_pixel_width = (int)(pdf_width_pt / 72.0f * dpi_x);
+                int pdf_pixel_height = (int)(pdf_height_pt / 72.0f * dpi_y);
+
+                if (pdf_pixel_width > printable_width_pixels || pdf_pixel_height > printable_height_pixels)
+                {
+                    _scale_to_fit(bitmap_width, bitmap_height, printable_width_pixels, printable_height_pixels, &dest_width, &dest_height);
+                    LOG("print_pdf_job_win: Page %d: ScalingMode=ShrinkToFit (scaled), Dest=(%d,%d)", i, dest_width, dest_height);
+                }
+                else
+                {
+                    dest_width = pdf_pixel_width;
+                    dest_height = pdf_pixel_height;
+                    LOG("print_pdf_job_win: Page %d: ScalingMode=ShrinkToFit (actual size), Dest=(%d,%d)", i, dest_width, dest_height);
+                }
+            }
+            else if (scaling_mode == 3)
+            { // Fit to Paper
+                int paper_width = GetDeviceCaps(hdc, PHYSICALWIDTH);
+                int paper_height = GetDeviceCaps(hdc, PHYSICALHEIGHT);
+                _scale_to_fit(bitmap_width, bitmap_height, paper_width, paper_height, &dest_width, &dest_height);
+                LOG("print_pdf_job_win: Page %d: ScalingMode=FitToPaper, Dest=(%d,%d)", i, dest_width, dest_height);
+            }
+            else if (scaling_mode == 4)
+            { // Custom Scale
+                // Calculate actual size in device pixels first
+                int pdf_pixel_width = (int)(pdf_width_pt / 72.0f * dpi_x);
+                int pdf_pixel_height = (int)(pdf_height_pt / 72.0f * dpi_y);
+                // Apply custom scale factor
+                dest_width = (int)(pdf_pixel_width * custom_scale);
+                dest_height = (int)(pdf_pixel_height * custom_scale);
+                LOG("print_pdf_job_win: Page %d: ScalingMode=CustomScale (%.2f), Dest=(%d,%d)", i, custom_scale, dest_width, dest_height);
+            }
+            else
+            { // Default to Fit to Printable Area
+                _scale_to_fit(bitmap_width, bitmap_height, printable_width_pixels, printable_height_pixels, &dest_width, &dest_height);
+                LOG("print_pdf_job_win: Page %d: ScalingMode=Default (FitToPrintableArea), Dest=(%d,%d)", i, dest_width, dest_height);
+            }
+
+            if (scaling_mode == 3)
+            { // Fit to Paper alignment is relative to physical paper
+                int paper_width = GetDeviceCaps(hdc, PHYSICALWIDTH);
+                int paper_height = GetDeviceCaps(hdc, PHYSICALHEIGHT);
+                int offset_x = GetDeviceCaps(hdc, PHYSICALOFFSETX);
+                int offset_y = GetDeviceCaps(hdc, PHYSICALOFFSETY);
+                dest_x = (int)((paper_width - dest_width) * align_x_factor) - offset_x;
+                dest_y = (int)((paper_height - dest_height) * align_y_factor) - offset_y;
+            }
+            else
+            { // All other modes are relative to the printable area
+                dest_x = (int)((printable_width_pixels - dest_width) * align_x_factor);
+                dest_y = (int)((printable_height_pixels - dest_height) * align_y_factor);
+            }
+
+            LOG("print_pdf_job_win: Page %d: Final DestRect=(%d,%d, %dx%d)", i, dest_x, dest_y, dest_width, dest_height);
+            // Transmission covers drawing into the spool and the driver's work at EndPage.
+            _trace_begin(&span, "pdf_transmit_page");
+            _trace_arg_int(&span, "page", i + 1);
+            if (StretchDIBits(hdc, dest_x, dest_y, dest_width, dest_height, 0, 0, bitmap_width, bitmap_height, pBitmapData, &bmi, DIB_RGB_COLORS, SRCCOPY) == GDI_ERROR)
+            {
+                set_last_error("Failed to draw page %d to the printer device context. Error: %lu.", i + 1, GetLastError());
+                LOG_WARN("print_pdf_job_win: StretchDIBits failed for page %d with error %lu", i, GetLastError());
+                success = false;
+            }
+
+            DeleteObject(hBitmap);
+            FPDF_ClosePage(page);
+
+            if (EndPage(hdc) <= 0)
+            {
+                set_last_error("Failed to end page %d. Error: %lu.", i + 1, GetLastError());
+                LOG_WARN("print_pdf_job_win: EndPage failed for page %d with error %lu", i, GetLastError());
+                success = false;
+            }
+            _trace_end(&span);
+
+            // Manually pump the message queue. This is critical when running on an
+            // STA thread without a traditional message loop. Some printer drivers
+            // send messages and will time out if they are not processed. This prevents
+            // the extreme slowdown seen when printing from a background thread.
+            MSG msg;
+            while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE)) {
+                TranslateMessage(&msg);
+                DispatchMessageW(&msg);
+            }
+        }
+    }
+
+    free(pages_to_print);
+    if (doc_name_w)
+        free(doc_name_w);
+
+    if (success)
+    {
+        LOG("print_pdf_job_win: All pages processed successfully. Calling EndDoc.");
+        EndDoc(hdc);
+        _job_trace_mark(&trace, JOB_STAGE_SPOOLED);
+        _job_trace_commit(&trace, printer_name, (uint32_t)job_id);
+    }
+    else
+    {
+        LOG("print_pdf_job_win: A failure occurred. Calling AbortDoc.");
+        AbortDoc(hdc);
+    }
+
+    DeleteDC(hdc);
+    FPDF_CloseDocument(doc);
+    free(printer_name_w);
+
+    if (submit_job)
+    {
+        LOG("_print_pdf_job_win (submit) finished with result: %d, job_id: %d", success, job_id);
+        return success ? job_id : 0;
+    }
+    else
+    {
+        LOG("_print_pdf_job_win (print) finished with result: %d", success);
+        return success ? 1 : 0;
+    }
+}
+#endif
+
+FFI_PLUGIN_EXPORT const char *get_last_error()
+{
+    return g_last_error_message ? g_last_error_message : "";
+}
+
+FFI_PLUGIN_EXPORT int get_last_error_code(void)
+{
+    return g_last_error_code;
+}
+
+static bool _print_pdf(const char *printer_name, const char *pdf_file_path, const char *doc_name, int scaling_mode, int copies, const char *page_range, int num_options, const char **option_keys, const char **option_values, const char *alignment)
+{
+    LOG("print_pdf called for printer: '%s', path: '%s', doc: '%s'", printer_name, pdf_file_path, doc_name);
+
+    // Validate input parameters
+    if (!printer_name || !pdf_file_path || !doc_name || copies <= 0)
+    {
+        LOG("Invalid input parameters");
+        return false;
+    }
+
+#ifdef _WIN32
+    return _print_pdf_job_win(printer_name, pdf_file_path, doc_name, scaling_mode, copies, page_range, alignment, num_options, option_keys, option_values, false) == 1;
+#else // macOS / Linux (CUPS)
+    JobTraceBuilder trace;
+    _job_trace_begin(&trace);
+    cups_option_t *options = NULL;
+    int num_cups_options = 0;
+
+    num_cups_options = _add_normalized_cups_options(num_options, option_keys, option_values, num_cups_options, &options);
+    _job_trace_mark(&trace, JOB_STAGE_OPTIONS_PARSED);
+
+    // cupsPrintFile sends the request and streams the payload before returning the job id.
+    _job_trace_mark(&trace, JOB_STAGE_REQUEST_SENT);
+    TraceSpan submit_span;
+    _trace_begin(&submit_span, "cupsPrintFile");
+    _trace_arg_str(&submit_span, "printer", printer_name);
+    _trace_arg_str(&submit_span, "file", pdf_file_path);
+    int job_id = cupsPrintFile(printer_name, pdf_file_path, doc_name, num_cups_options, options);
+    _trace_end(&submit_span);
+    if (job_id > 0)
+    {
+        _job_trace_mark(&trace, JOB_STAGE_JOB_ID_RETURNED);
+        _job_trace_commit(&trace, printer_name, (uint32_t)job_id);
+    }
+    if (job_id <= 0)
+    {
+        LOG_WARN("cupsPrintFile failed, error: %s", cupsLastErrorString());
+    }
+    cupsFreeOptions(num_cups_options, options);
+    LOG("print_pdf finished with job_id: %d", job_id);
+    return job_id > 0;
+#endif
+}
+
+FFI_PLUGIN_EXPORT bool print_pdf(const char *printer_name, const char *pdf_file_path, const char *doc_name, int scaling_mode, int copies, const char *page_range, int num_options, const char **option_keys, const char **option_values, const char *alignment)
+{
+    uint64_t started = _monotonic_ns();
+    const char *target = printer_name;
+    bool result = _admit_job(&target) && _print_pdf(target, pdf_file_path, doc_name, scaling_mode, copies, page_range, num_options, option_keys, option_values, alignment);
+    _metrics_record(METRIC_OP_PRINT_PDF, started, result);
+    _call_record_pdf(CALL_PRINT_PDF, printer_name, pdf_file_path, doc_name, scaling_mode, copies, page_range, num_options, option_keys, option_values, alignment, started, result, result);
+    return result;
+}
+
+// --- Printer Handles ---
+
+// A PrinterHandle keeps what every job operation on a printer would otherwise
+// set up and tear down again: the spooler handle on Windows, and on CUPS the
+// resolved printer-uri plus a dedicated connection to the scheduler.
+struct PrinterHandle
+{
+    char *name;
+    ffi_mutex_t lock; // Serializes use of the native handle/connection, which are not thread-safe.
+#ifdef _WIN32
+    HANDLE printer;
+#else
+    char printer_uri[HTTP_MAX_URI];
+    http_t *http;
+#endif
+};
+
+#ifdef _WIN32
+// Internal helper to fill `list` with the jobs queued on an open printer.
+// Returns false on allocation failure.
+static bool _fill_job_list_win(HANDLE hPrinter, const char *printer_name, JobList *list)
+{
+    DWORD needed, returned;
+    EnumJobsW(hPrinter, 0, 0xFFFFFFFF, 2, NULL, 0, &needed, &returned);
+    if (needed == 0)
+        return true;
+    BYTE *buffer = (BYTE *)malloc(needed);
+    if (!buffer)
+        return false;
+
+    if (EnumJobsW(hPrinter, 0, 0xFFFFFFFF, 2, buffer, needed, &needed, &returned))
+    {
+        LOG("Found %lu jobs on Windows", returned);
+        list->jobs = (JobInfo *)malloc(returned * sizeof(JobInfo));
+        if (!list->jobs)
+        {
+            free(buffer);
+            return false;
+        }
+        list->count = (int)returned;
+        JOB_INFO_2W *jobs = (JOB_INFO_2W *)buffer;
+        for (DWORD i = 0; i < returned; i++)
+        {
+            list->jobs[i].id = jobs[i].JobId;
+            list->jobs[i].title = to_utf8(jobs[i].pDocument);
+            list->jobs[i].status = (int)jobs[i].Status;
+            _job_trace_observe(printer_name, jobs[i].JobId, _job_stage_from_state(jobs[i].Status));
+        }
+    }
+    else
+    {
+        LOG_WARN("EnumJobsW failed with error %lu", GetLastError());
+    }
+    free(buffer);
+    return true;
+}
+
+// Internal helper to apply a JOB_CONTROL_* command to a job on an open printer.
+static bool _set_job_win(HANDLE hPrinter, uint32_t job_id, DWORD command, const char *label)
+{
+    bool result = SetJobW(hPrinter, job_id, 0, NULL, command);
+    if (!result)
+        LOG_WARN("SetJobW(%s) failed with error %lu", label, GetLastError());
+    return result;
+}
+#else
+// Internal helper to fill `list` with the active jobs of a CUPS queue.
+// Returns false on allocation failure.
+static bool _fill_job_list_cups(http_t *http, const char *printer_name, JobList *list)
+{
+    cups_job_t *jobs;
+    LOG("Calling cupsGetJobs2 for active jobs");
+    uint64_t started = _monotonic_ns();
+    int num_jobs = cupsGetJobs2(http, &jobs, printer_name, 1, CUPS_WHICHJOBS_ACTIVE);
+    _metrics_record(METRIC_OP_IPP_REQUEST, started, num_jobs >= 0 && cupsLastError() <= IPP_STATUS_OK_CONFLICTING);
+    if (num_jobs >= 0)
+        _job_trace_mark_departed(printer_name, jobs, num_jobs);
+    if (num_jobs <= 0)
+    {
+        cupsFreeJobs(num_jobs, jobs);
+        return true;
+    }
+
+    LOG("Found %d active jobs on CUPS-based system", num_jobs);
+    list->jobs = (JobInfo *)malloc(num_jobs * sizeof(JobInfo));
+    if (!list->jobs)
+    {
+        cupsFreeJobs(num_jobs, jobs);
+        return false;
+    }
+    list->count = num_jobs;
+    for (int i = 0; i < num_jobs; i++)
+    {
+        list->jobs[i].id = (uint32_t)jobs[i].id;
+        list->jobs[i].title = strdup(jobs[i].title ? jobs[i].title : "Unknown");
+        list->jobs[i].status = jobs[i].state;
+        _job_trace_observe(printer_name, (uint32_t)jobs[i].id, _job_stage_from_state(jobs[i].state));
+    }
+    cupsFreeJobs(num_jobs, jobs);
+    return true;
+}
+
+// Internal helper to build the printer-uri the local scheduler uses for a queue.
+static void _local_printer_uri(const char *printer_name, char *uri, size_t uri_size)
+{
+    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, (int)uri_size, "ipp", NULL, "localhost", ippPort(), "/printers/%s", printer_name);
+}
+
+// Internal helper to send a job operation (Hold-Job, Release-Job, ...) that
+// addresses the job by printer-uri and job-id.
+static bool _cups_job_operation(http_t *http, const char *printer_uri, uint32_t job_id, ipp_op_t op, const char *label)
+{
+    ipp_t *request = ippNewRequest(op);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, printer_uri);
+    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "job-id", (int)job_id);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
+    ippDelete(_ipp_do_request(http, request, "/jobs/"));
+
+    bool result = cupsLastError() <= IPP_STATUS_OK_CONFLICTING;
+    if (!result)
+        LOG_WARN("%s failed for job %u, error: %s", label, job_id, cupsLastErrorString());
+    return result;
+}
+#endif
+
+FFI_PLUGIN_EXPORT PrinterHandle *open_printer_handle(const char *printer_name)
+{
+    if (!printer_name)
+    {
+        set_last_error("Invalid printer name.");
+        return NULL;
+    }
+
+    LOG("open_printer_handle called for printer: '%s'", printer_name);
+    PrinterHandle *handle = (PrinterHandle *)calloc(1, sizeof(PrinterHandle));
+    if (!handle)
+        return NULL;
+    handle->name = strdup(printer_name);
+    if (!handle->name)
+    {
+        free(handle);
+        return NULL;
+    }
+
+#ifdef _WIN32
+    wchar_t *printer_name_w = to_utf16(printer_name);
+    if (!printer_name_w || !OpenPrinterW(printer_name_w, &handle->printer, NULL))
+    {
+        set_last_error("Failed to open printer '%s'. Error: %lu", printer_name, GetLastError());
+        free(printer_name_w);
+        free(handle->name);
+        free(handle);
+        return NULL;
+    }
+    free(printer_name_w);
+#else
+    handle->http = httpConnect2(cupsServer(), ippPort(), NULL, AF_UNSPEC, cupsEncryption(), 1, 30000, NULL);
+    if (!handle->http)
+    {
+        set_last_error("Failed to connect to CUPS server '%s'. Error: %s", cupsServer(), cupsLastErrorString());
+        free(handle->name);
+        free(handle);
+        return NULL;
+    }
+
+    cups_dest_t *dest = cupsGetNamedDest(handle->http, printer_name, NULL);
+    if (!dest)
+    {
+        set_last_error("Printer '%s' not found.", printer_name);
+        httpClose(handle->http);
+        free(handle->name);
+        free(handle);
+        return NULL;
+    }
+    const char *uri = cupsGetOption("printer-uri-supported", dest->num_options, dest->options);
+    if (uri)
+        snprintf(handle->printer_uri, sizeof(handle->printer_uri), "%s", uri);
+    else
+        _local_printer_uri(printer_name, handle->printer_uri, sizeof(handle->printer_uri));
+    cupsFreeDests(1, dest);
+    LOG("Resolved printer '%s' to '%s'", printer_name, handle->printer_uri);
+#endif
+
+    ffi_mutex_init(&handle->lock);
+    return handle;
+}
+
+FFI_PLUGIN_EXPORT void close_printer_handle(PrinterHandle *handle)
+{
+    if (!handle)
+        return;
+    LOG("close_printer_handle called for printer: '%s'", handle->name);
+#ifdef _WIN32
+    ClosePrinter(handle->printer);
+#else
+    httpClose(handle->http);
+#endif
+    ffi_mutex_destroy(&handle->lock);
+    free(handle->name);
+    free(handle);
+}
+
+static JobList *_get_print_jobs(const char *printer_name)
+{
+    JobList *list = (JobList *)malloc(sizeof(JobList));
+    if (!list)
+        return NULL;
+    list->count = 0;
+    list->jobs = NULL;
+
+    if (!printer_name)
+    {
+        LOG("get_print_jobs called with null printer name");
+        return list; // Return empty list
+    }
+
+    LOG("get_print_jobs called for printer: '%s'", printer_name);
+#ifdef _WIN32
+    HANDLE hPrinter;
+    wchar_t *printer_name_w = to_utf16(printer_name);
+    if (!printer_name_w)
+    {
+        free(list);
+        return NULL;
+    }
+    if (!OpenPrinterW(printer_name_w, &hPrinter, NULL))
+    {
+        free(list);
+        LOG_WARN("OpenPrinterW failed with error %lu", GetLastError());
+        free(printer_name_w);
+        return NULL;
+    }
+    free(printer_name_w);
+
+    bool ok = _fill_job_list_win(hPrinter, printer_name, list);
+    ClosePrinter(hPrinter);
+#else // macOS / Linux
+    bool ok = _fill_job_list_cups(CUPS_HTTP_DEFAULT, printer_name, list);
+#endif
+    if (!ok)
+    {
+        free_job_list(list);
+        return NULL;
+    }
+    return list;
+}
+
+FFI_PLUGIN_EXPORT JobList *get_print_jobs(const char *printer_name)
+{
+    uint64_t started = _monotonic_ns();
+    JobList *list = _get_print_jobs(printer_name);
+    _metrics_record(METRIC_OP_GET_PRINT_JOBS, started, list != NULL);
+    _call_record_simple(CALL_GET_PRINT_JOBS, printer_name, started, list != NULL, list ? list->count : 0);
+    return list;
+}
+
+// Same as get_print_jobs, reusing the handle's spooler handle or scheduler connection.
+static JobList *_get_print_jobs_h(PrinterHandle *handle)
+{
+    if (!handle)
+    {
+        LOG("get_print_jobs_h called with null handle");
+        return NULL;
+    }
+    JobList *list = (JobList *)calloc(1, sizeof(JobList));
+    if (!list)
+        return NULL;
+
+    ffi_mutex_lock(&handle->lock);
+#ifdef _WIN32
+    bool ok = _fill_job_list_win(handle->printer, handle->name, list);
+#else
+    bool ok = _fill_job_list_cups(handle->http, handle->name, list);
+#endif
+    ffi_mutex_unlock(&handle->lock);
+    if (!ok)
+    {
+        free_job_list(list);
+        return NULL;
+    }
+    return list;
+}
+
+FFI_PLUGIN_EXPORT JobList *get_print_jobs_h(PrinterHandle *handle)
+{
+    uint64_t started = _monotonic_ns();
+    JobList *list = _get_print_jobs_h(handle);
+    _metrics_record(METRIC_OP_GET_PRINT_JOBS, started, list != NULL);
+    _call_record_simple(CALL_GET_PRINT_JOBS, handle ? handle->name : NULL, started, list != NULL, list ? list->count : 0);
+    return list;
+}
+
+FFI_PLUGIN_EXPORT void free_job_list(JobList *job_list)
+{
+    if (!job_list)
+        return;
+    if (job_list->jobs)
+    {
+        for (int i = 0; i < job_list->count; i++)
+        {
+            free(job_list->jobs[i].title);
+        }
+        free(job_list->jobs);
+    }
+    free(job_list);
+}
+
+FFI_PLUGIN_EXPORT int open_printer_properties(const char *printer_name, intptr_t hwnd)
+{
+    LOG("open_printer_properties called for printer: '%s'", printer_name);
+#ifdef _WIN32
+    if (!printer_name)
+    {
+        LOG("Printer name is null");
+        return 0; // Error
+    }
+
+    wchar_t *printer_name_w = to_utf16(printer_name);
+    if (!printer_name_w)
+    {
+        LOG_WARN("Failed to convert printer name to UTF-16");
+        return 0; // Error
+    }
+
+    HANDLE hPrinter;
+    PRINTER_DEFAULTSW printerDefaults = {NULL, NULL, PRINTER_ALL_ACCESS};
+    if (!OpenPrinterW(printer_name_w, &hPrinter, &printerDefaults))
+    {
+        LOG_WARN("OpenPrinterW failed with error %lu", GetLastError());
+        free(printer_name_w);
+        return 0; // Error
+    }
+
+    // The modern and recommended way to show the printer properties dialog is
+    // by using DocumentProperties with the DM_PROMPT flag.
+
+    // First, get the size of the DEVMODE structure for the printer.
+    LONG devModeSize = DocumentPropertiesW(NULL, hPrinter, printer_name_w, NULL, NULL, 0);
+    if (devModeSize <= 0)
+    {
+        LOG_WARN("DocumentProperties (get size) failed with error %lu", GetLastError());
+        ClosePrinter(hPrinter);
+        free(printer_name_w);
+        return 0; // Error
+    }
+
+    DEVMODEW *pDevMode = (DEVMODEW *)malloc(devModeSize);
+    if (!pDevMode)
+    {
+        LOG_WARN("Failed to allocate memory for DEVMODE structure.");
+        ClosePrinter(hPrinter);
+        free(printer_name_w);
+        return 0; // Error
+    }
+
+    // Get the current printer settings to populate the dialog.
+    if (DocumentPropertiesW(NULL, hPrinter, printer_name_w, pDevMode, NULL, DM_OUT_BUFFER) != IDOK)
+    {
+        LOG_WARN("DocumentProperties (get defaults) failed with error %lu", GetLastError());
+        free(pDevMode);
+        ClosePrinter(hPrinter);
+        free(printer_name_w);
+        return 0; // Error
+    }
+
+    // Display the properties dialog. The user's changes will be written back to pDevMode.
+    LONG result = DocumentPropertiesW((HWND)hwnd, hPrinter, printer_name_w, pDevMode, pDevMode, DM_IN_BUFFER | DM_OUT_BUFFER | DM_PROMPT);
+
+    int return_status = 0; // Default to error
+
+    if (result == IDOK)
+    {
+        LOG("Printer properties dialog closed with OK. Applying changes to printer defaults.");
+
+        // To apply the changes, we need to use SetPrinter with PRINTER_INFO_2.
+        DWORD needed = 0;
+        // Get the size needed for PRINTER_INFO_2
+        GetPrinterW(hPrinter, 2, NULL, 0, &needed);
+        if (needed > 0)
+        {
+            PRINTER_INFO_2W *pinfo2 = (PRINTER_INFO_2W *)malloc(needed);
+            if (pinfo2)
+            {
+                // Get the current printer info
+                if (GetPrinterW(hPrinter, 2, (LPBYTE)pinfo2, needed, &needed))
+                {
+                    // Update the DEVMODE pointer in the PRINTER_INFO_2 struct with the user's changes.
+                    pinfo2->pDevMode = pDevMode;
+                    // Security descriptor must be NULL for SetPrinter.
+                    pinfo2->pSecurityDescriptor = NULL;
+
+                    // Apply the changes to the printer's defaults.
+                    if (!SetPrinterW(hPrinter, 2, (LPBYTE)pinfo2, 0))
+                    {
+                        LOG_WARN("SetPrinterW failed with error %lu", GetLastError());
+                    }
+                    else
+                    {
+                        LOG("SetPrinterW succeeded. Broadcasting change.");
+                        SendMessageTimeout(HWND_BROADCAST, WM_WININICHANGE, 0, (LPARAM)L"windows", SMTO_NORMAL, 1000, NULL);
+                    }
+                }
+                free(pinfo2);
+            }
+        }
+        return_status = 1; // OK
+    }
+    else if (result == IDCANCEL)
+    {
+        LOG("Printer properties dialog was cancelled.");
+        return_status = 2; // Cancel
+    }
+    else
+    {
+        LOG_WARN("DocumentProperties (prompt) failed with result: %ld, error: %lu", result, GetLastError());
+        return_status = 0; // Error
+    }
+
+    free(pDevMode);
+    ClosePrinter(hPrinter);
+    free(printer_name_w);
+    return return_status;
+#else
+    (void)hwnd; // hwnd is Windows-specific
+    if (!printer_name)
+    {
+        LOG("Printer name is null");
+        return 0; // Error
+    }
+    char command[PATH_MAX];
+    snprintf(command, sizeof(command),
+#ifdef __APPLE__
+             "open http://localhost:631/printers/\"%s\"",
+#else // Linux
+             "xdg-open http://localhost:631/printers/\"%s\"",
+#endif
+             printer_name);
+    LOG("Executing command: %s", command);
+    int cmd_result = system(command);
+    if (cmd_result != 0)
+    {
+        LOG_WARN("Command '%s' failed with exit code %d", command, cmd_result);
+        return 0; // Error
+    }
+    return 1; // Dispatched
+#endif
+}
+
+static bool _pause_print_job(const char *printer_name, uint32_t job_id)
+{
+    if (!printer_name)
+    {
+        LOG("pause_print_job called with null printer name");
+        return false;
+    }
+
+    LOG("pause_print_job called for printer: '%s', job_id: %u", printer_name, job_id);
+#ifdef _WIN32
+    HANDLE hPrinter;
+    wchar_t *printer_name_w = to_utf16(printer_name);
+    if (!printer_name_w)
+        return false;
+    if (!OpenPrinterW(printer_name_w, &hPrinter, NULL))
+    {
+        free(printer_name_w);
+        return false;
+    }
+    free(printer_name_w);
+
+    bool result = _set_job_win(hPrinter, job_id, JOB_CONTROL_PAUSE, "PAUSE");
+    ClosePrinter(hPrinter);
+    return result;
+#else
+    // Hold-Job/Release-Job must be sent as IPP operations; cupsCancelJob2 only cancels or purges.
+    char printer_uri[HTTP_MAX_URI];
+    _local_printer_uri(printer_name, printer_uri, sizeof(printer_uri));
+    return _cups_job_operation(CUPS_HTTP_DEFAULT, printer_uri, job_id, IPP_OP_HOLD_JOB, "Hold-Job");
+#endif
+}
+
+FFI_PLUGIN_EXPORT bool pause_print_job(const char *printer_name, uint32_t job_id)
+{
+    uint64_t started = _monotonic_ns();
+    bool result = _pause_print_job(printer_name, job_id);
+    _call_record_values(CALL_PAUSE_JOB, printer_name, &job_id, 1, started, result, result);
+    return result;
+}
+
+static bool _pause_print_job_h(PrinterHandle *handle, uint32_t job_id)
+{
+    if (!handle)
+    {
+        LOG("pause_print_job_h called with null handle");
+        return false;
+    }
+
+    LOG("pause_print_job_h called for printer: '%s', job_id: %u", handle->name, job_id);
+    ffi_mutex_lock(&handle->lock);
+#ifdef _WIN32
+    bool result = _set_job_win(handle->printer, job_id, JOB_CONTROL_PAUSE, "PAUSE");
+#else
+    bool result = _cups_job_operation(handle->http, handle->printer_uri, job_id, IPP_OP_HOLD_JOB, "Hold-Job");
+#endif
+    ffi_mutex_unlock(&handle->lock);
+    return result;
+}
+
+FFI_PLUGIN_EXPORT bool pause_print_job_h(PrinterHandle *handle, uint32_t job_id)
+{
+    uint64_t started = _monotonic_ns();
+    bool result = _pause_print_job_h(handle, job_id);
+    _call_record_values(CALL_PAUSE_JOB, handle ? handle->name : NULL, &job_id, 1, started, result, result);
+    return result;
+}
+
+static bool _resume_print_job(const char *printer_name, uint32_t job_id)
+{
+    if (!printer_name)
+    {
+        LOG("resume_print_job called with null printer name");
+        return false;
+    }
+
+    LOG("resume_print_job called for printer: '%s', job_id: %u", printer_name, job_id);
+#ifdef _WIN32
+    HANDLE hPrinter;
+    wchar_t *printer_name_w = to_utf16(printer_name);
+    if (!printer_name_w)
+        return false;
+    if (!OpenPrinterW(printer_name_w, &hPrinter, NULL))
+    {
+        free(printer_name_w);
+        return false;
+    }
+    free(printer_name_w);
+
+    bool result = _set_job_win(hPrinter, job_id, JOB_CONTROL_RESUME, "RESUME");
+    ClosePrinter(hPrinter);
+    return result;
+#else
+    char printer_uri[HTTP_MAX_URI];
+    _local_printer_uri(printer_name, printer_uri, sizeof(printer_uri));
+    return _cups_job_operation(CUPS_HTTP_DEFAULT, printer_uri, job_id, IPP_OP_RELEASE_JOB, "Release-Job");
+#endif
+}
+
+FFI_PLUGIN_EXPORT bool resume_print_job(const char *printer_name, uint32_t job_id)
+{
+    uint64_t started = _monotonic_ns();
+    bool result = _resume_print_job(printer_name, job_id);
+    _call_record_values(CALL_RESUME_JOB, printer_name, &job_id, 1, started, result, result);
+    return result;
+}
+
+static bool _resume_print_job_h(PrinterHandle *handle, uint32_t job_id)
+{
+    if (!handle)
+    {
+        LOG("resume_print_job_h called with null handle");
+        return false;
+    }
+
+    LOG("resume_print_job_h called for printer: '%s', job_id: %u", handle->name, job_id);
+    ffi_mutex_lock(&handle->lock);
+#ifdef _WIN32
+    bool result = _set_job_win(handle->printer, job_id, JOB_CONTROL_RESUME, "RESUME");
+#else
+    bool result = _cups_job_operation(handle->http, handle->printer_uri, job_id, IPP_OP_RELEASE_JOB, "Release-Job");
+#endif
+    ffi_mutex_unlock(&handle->lock);
+    return result;
+}
+
+FFI_PLUGIN_EXPORT bool resume_print_job_h(PrinterHandle *handle, uint32_t job_id)
+{
+    uint64_t started = _monotonic_ns();
+    bool result = _resume_print_job_h(handle, job_id);
+    _call_record_values(CALL_RESUME_JOB, handle ? handle->name : NULL, &job_id, 1, started, result, result);
+    return result;
+}
+
+static bool _cancel_print_job(const char *printer_name, uint32_t job_id)
+{
+    if (!printer_name)
+    {
+        LOG("cancel_print_job called with null printer name");
+        return false;
+    }
+
+    LOG("cancel_print_job called for printer: '%s', job_id: %u", printer_name, job_id);
+#ifdef _WIN32
+    HANDLE hPrinter;
+    wchar_t *printer_name_w = to_utf16(printer_name);
+    if (!printer_name_w)
+        return false;
+    if (!OpenPrinterW(printer_name_w, &hPrinter, NULL))
+    {
+        free(printer_name_w);
+        return false;
+    }
+    free(printer_name_w);
+
+    bool result = _set_job_win(hPrinter, job_id, JOB_CONTROL_CANCEL, "CANCEL");
+    ClosePrinter(hPrinter);
+    if (result)
+        _job_trace_observe(printer_name, job_id, JOB_STAGE_CANCELED);
+    return result;
+#else
+    bool result = cupsCancelJob(printer_name, (int)job_id) == 1;
+    if (!result)
+        LOG_WARN("cupsCancelJob failed, error: %s", cupsLastErrorString());
+    else
+        _job_trace_observe(printer_name, job_id, JOB_STAGE_CANCELED);
+    return result;
+#endif
+}
+
+FFI_PLUGIN_EXPORT bool cancel_print_job(const char *printer_name, uint32_t job_id)
+{
+    uint64_t started = _monotonic_ns();
+    bool result = _cancel_print_job(printer_name, job_id);
+    _call_record_values(CALL_CANCEL_JOB, printer_name, &job_id, 1, started, result, result);
+    return result;
+}
+
+static bool _cancel_print_job_h(PrinterHandle *handle, uint32_t job_id)
+{
+    if (!handle)
+    {
+        LOG("cancel_print_job_h called with null handle");
+        return false;
+    }
+
+    LOG("cancel_print_job_h called for printer: '%s', job_id: %u", handle->name, job_id);
+    ffi_mutex_lock(&handle->lock);
+#ifdef _WIN32
+    bool result = _set_job_win(handle->printer, job_id, JOB_CONTROL_CANCEL, "CANCEL");
+#else
+    bool result = _cups_job_operation(handle->http, handle->printer_uri, job_id, IPP_OP_CANCEL_JOB, "Cancel-Job");
+#endif
+    ffi_mutex_unlock(&handle->lock);
+    if (result)
+        _job_trace_observe(handle->name, job_id, JOB_STAGE_CANCELED);
+    return result;
+}
+
+FFI_PLUGIN_EXPORT bool cancel_print_job_h(PrinterHandle *handle, uint32_t job_id)
+{
+    uint64_t started = _monotonic_ns();
+    bool result = _cancel_print_job_h(handle, job_id);
+    _call_record_values(CALL_CANCEL_JOB, handle ? handle->name : NULL, &job_id, 1, started, result, result);
+    return result;
+}
+
+// --- Bulk Job Control ---
+
+#ifdef _WIN32
+// Internal helper to apply one JOB_CONTROL_* command to many jobs on an open printer.
+// Returns the number of jobs the spooler accepted the command for.
+static int _set_jobs_win(HANDLE hPrinter, const char *printer_name, const uint32_t *job_ids, int count, DWORD command, const char *label)
+{
+    int succeeded = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (!_set_job_win(hPrinter, job_ids[i], command, label))
+            continue;
+        succeeded++;
+        if (command == JOB_CONTROL_CANCEL)
+            _job_trace_observe(printer_name, job_ids[i], JOB_STAGE_CANCELED);
+    }
+    return succeeded;
+}
+
+// Internal helper to cancel every job on an open printer, or only the caller's when `my_jobs_only`.
+static bool _cancel_all_jobs_win(HANDLE hPrinter, bool my_jobs_only)
+{
+    // PRINTER_CONTROL_PURGE clears the queue in one call but needs administer access;
+    // without it, fall back to cancelling job by job.
+    if (!my_jobs_only && SetPrinterW(hPrinter, 0, NULL, PRINTER_CONTROL_PURGE))
+        return true;
+
+    wchar_t user_name[UNLEN + 1];
+    DWORD user_name_len = sizeof(user_name) / sizeof(user_name[0]);
+    if (my_jobs_only && !GetUserNameW(user_name, &user_name_len))
+    {
+        set_last_error("GetUserNameW failed. Error: %lu", GetLastError());
+        return false;
+    }
+
+    DWORD needed = 0, returned = 0;
+    EnumJobsW(hPrinter, 0, 0xFFFFFFFF, 1, NULL, 0, &needed, &returned);
+    if (needed == 0)
+        return true;
+    BYTE *buffer = (BYTE *)malloc(needed);
+    if (!buffer)
+        return false;
+    bool result = EnumJobsW(hPrinter, 0, 0xFFFFFFFF, 1, buffer, needed, &needed, &returned);
+    if (result)
+    {
+        JOB_INFO_1W *jobs = (JOB_INFO_1W *)buffer;
+        for (DWORD i = 0; i < returned; i++)
+        {
+            if (my_jobs_only && (!jobs[i].pUserName || _wcsicmp(jobs[i].pUserName, user_name) != 0))
+                continue;
+            if (!_set_job_win(hPrinter, jobs[i].JobId, JOB_CONTROL_DELETE, "DELETE"))
+                result = false;
+        }
+    }
+    else
+    {
+        set_last_error("EnumJobsW failed. Error: %lu", GetLastError());
+    }
+    free(buffer);
+    return result;
+}
+
+// Internal helper to open a printer by name for job control, falling back to default access.
+static HANDLE _open_printer_for_jobs(const char *printer_name, DWORD access)
+{
+    HANDLE hPrinter = NULL;
+    wchar_t *printer_name_w = to_utf16(printer_name);
+    if (!printer_name_w)
+        return NULL;
+    PRINTER_DEFAULTSW defaults = {NULL, NULL, access};
+    if (!OpenPrinterW(printer_name_w, &hPrinter, &defaults))
+    {
+        // Administer access is only needed for the purge shortcut; retry with the default access.
+        if (access == PRINTER_ACCESS_USE || !OpenPrinterW(printer_name_w, &hPrinter, NULL))
+        {
+            set_last_error("Failed to open printer '%s'. Error: %lu", printer_name, GetLastError());
+            hPrinter = NULL;
+        }
+    }
+    free(printer_name_w);
+    return hPrinter;
+}
+#else
+// Largest number of job-ids sent in one Cancel-Jobs request.
+#define BULK_JOB_IDS_PER_REQUEST 500
+
+// Internal helper to send Cancel-My-Jobs or Cancel-Jobs for an explicit list of ids.
+static bool _cancel_job_ids_cups(http_t *http, const char *printer_uri, ipp_op_t op, const int *ids, int count)
+{
+    ipp_t *request = ippNewRequest(op);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, printer_uri);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
+    ippAddIntegers(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "job-ids", count, ids);
+    ippDelete(_ipp_do_request(http, request, op == IPP_OP_CANCEL_MY_JOBS ? "/jobs/" : "/admin/"));
+    return cupsLastError() <= IPP_STATUS_OK_CONFLICTING;
+}
+
+// Internal helper to cancel a list of jobs. Each chunk of ids is sent as one
+// Cancel-My-Jobs request, which the default cupsd policy allows for the job
+// owner, then as Cancel-Jobs, which it limits to administrators. If both are
+// rejected (e.g. because one of the jobs already finished, or the server
+// supports neither) it falls back to Cancel-Job per id on the same connection.
+// Returns the number of jobs cancelled.
+static int _cancel_jobs_cups(http_t *http, const char *printer_name, const char *printer_uri, const uint32_t *job_ids, int count)
+{
+    int succeeded = 0;
+    int ids[BULK_JOB_IDS_PER_REQUEST];
+    for (int start = 0; start < count; start += BULK_JOB_IDS_PER_REQUEST)
+    {
+        int chunk = count - start < BULK_JOB_IDS_PER_REQUEST ? count - start : BULK_JOB_IDS_PER_REQUEST;
+        for (int i = 0; i < chunk; i++)
+            ids[i] = (int)job_ids[start + i];
+
+        if (_cancel_job_ids_cups(http, printer_uri, IPP_OP_CANCEL_MY_JOBS, ids, chunk) ||
+            _cancel_job_ids_cups(http, printer_uri, IPP_OP_CANCEL_JOBS, ids, chunk))
+        {
+            for (int i = 0; i < chunk; i++)
+                _job_trace_observe(printer_name, (uint32_t)ids[i], JOB_STAGE_CANCELED);
+            succeeded += chunk;
+            continue;
+        }
+
+        LOG_WARN("Cancel-My-Jobs and Cancel-Jobs failed for %d jobs (%s), cancelling one by one", chunk, cupsLastErrorString());
+        for (int i = 0; i < chunk; i++)
+        {
+            if (_cups_job_operation(http, printer_uri, (uint32_t)ids[i], IPP_OP_CANCEL_JOB, "Cancel-Job"))
+            {
+                _job_trace_observe(printer_name, (uint32_t)ids[i], JOB_STAGE_CANCELED);
+                succeeded++;
+            }
+        }
+    }
+    return succeeded;
+}
+
+// Internal helper to send Hold-Job or Release-Job for many jobs over one connection.
+// IPP has no list form of these operations. Returns the number of jobs updated.
+static int _job_operation_cups(http_t *http, const char *printer_uri, const uint32_t *job_ids, int count, ipp_op_t op, const char *label)
+{
+    int succeeded = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (_cups_job_operation(http, printer_uri, job_ids[i], op, label))
+            succeeded++;
+    }
+    return succeeded;
+}
+
+// Internal helper for Cancel-Jobs (all jobs), Cancel-My-Jobs and Purge-Jobs.
+static bool _cancel_all_jobs_cups(http_t *http, const char *printer_uri, int scope)
+{
+    ipp_op_t op = scope == CANCEL_SCOPE_ALL_JOBS ? IPP_OP_CANCEL_JOBS : scope == CANCEL_SCOPE_MY_JOBS ? IPP_OP_CANCEL_MY_JOBS : IPP_OP_PURGE_JOBS;
+    ipp_t *request = ippNewRequest(op);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, printer_uri);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
+    // Operations on other users' jobs are authorized against the admin location.
+    ippDelete(_ipp_do_request(http, request, scope == CANCEL_SCOPE_MY_JOBS ? "/jobs/" : "/admin/"));
+
+    if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+    {
+        set_last_error("Failed to cancel jobs on '%s': %s", printer_uri, cupsLastErrorString());
+        return false;
+    }
+    return true;
+}
+#endif
+
+// Applies JOB_CONTROL_* / IPP job operation `kind` to every id in `job_ids` on a printer
+// opened by name. `kind` is 0 for cancel, 1 for hold and 2 for release.
+static int _bulk_job_action(const char *printer_name, const uint32_t *job_ids, int count, int kind)
+{
+    if (!printer_name || !job_ids || count <= 0)
+        return 0;
+#ifdef _WIN32
+    static const DWORD commands[] = {JOB_CONTROL_CANCEL, JOB_CONTROL_PAUSE, JOB_CONTROL_RESUME};
+    static const char *labels[] = {"CANCEL", "PAUSE", "RESUME"};
+    HANDLE hPrinter = _open_printer_for_jobs(printer_name, PRINTER_ACCESS_USE);
+    if (!hPrinter)
+        return 0;
+    int succeeded = _set_jobs_win(hPrinter, printer_name, job_ids, count, commands[kind], labels[kind]);
+    ClosePrinter(hPrinter);
+    return succeeded;
+#else
+    char printer_uri[HTTP_MAX_URI];
+    _local_printer_uri(printer_name, printer_uri, sizeof(printer_uri));
+    if (kind == 0)
+        return _cancel_jobs_cups(CUPS_HTTP_DEFAULT, printer_name, printer_uri, job_ids, count);
+    return _job_operation_cups(CUPS_HTTP_DEFAULT, printer_uri, job_ids, count, kind == 1 ? IPP_OP_HOLD_JOB : IPP_OP_RELEASE_JOB, kind == 1 ? "Hold-Job" : "Release-Job");
+#endif
+}
+
+// Same as _bulk_job_action, reusing the handle's spooler handle or scheduler connection.
+static int _bulk_job_action_h(PrinterHandle *handle, const uint32_t *job_ids, int count, int kind)
+{
+    if (!handle || !job_ids || count <= 0)
+        return 0;
+    ffi_mutex_lock(&handle->lock);
+#ifdef _WIN32
+    static const DWORD commands[] = {JOB_CONTROL_CANCEL, JOB_CONTROL_PAUSE, JOB_CONTROL_RESUME};
+    static const char *labels[] = {"CANCEL", "PAUSE", "RESUME"};
+    int succeeded = _set_jobs_win(handle->printer, handle->name, job_ids, count, commands[kind], labels[kind]);
+#else
+    int succeeded = kind == 0
+                        ? _cancel_jobs_cups(handle->http, handle->name, handle->printer_uri, job_ids, count)
+                        : _job_operation_cups(handle->http, handle->printer_uri, job_ids, count, kind == 1 ? IPP_OP_HOLD_JOB : IPP_OP_RELEASE_JOB, kind == 1 ? "Hold-Job" : "Release-Job");
+#endif
+    ffi_mutex_unlock(&handle->lock);
+    return succeeded;
+}
+
+// Cancels `count` jobs in as few requests as the platform allows. Returns the number cancelled.
+FFI_PLUGIN_EXPORT int cancel_jobs(const char *printer_name, const uint32_t *job_ids, int count)
+{
+    LOG("cancel_jobs called for printer: '%s', count: %d", printer_name ? printer_name : "(null)", count);
+    uint64_t started = _monotonic_ns();
+    int succeeded = _bulk_job_action(printer_name, job_ids, count, 0);
+    _call_record_values(CALL_CANCEL_JOBS, printer_name, job_ids, count, started, succeeded == count, succeeded);
+    return succeeded;
+}
+
+// Holds (pauses) `count` jobs. Returns the number held.
+FFI_PLUGIN_EXPORT int hold_jobs(const char *printer_name, const uint32_t *job_ids, int count)
+{
+    LOG("hold_jobs called for printer: '%s', count: %d", printer_name ? printer_name : "(null)", count);
+    uint64_t started = _monotonic_ns();
+    int succeeded = _bulk_job_action(printer_name, job_ids, count, 1);
+    _call_record_values(CALL_HOLD_JOBS, printer_name, job_ids, count, started, succeeded == count, succeeded);
+    return succeeded;
+}
+
+// Releases (resumes) `count` jobs. Returns the number released.
+FFI_PLUGIN_EXPORT int release_jobs(const char *printer_name, const uint32_t *job_ids, int count)
+{
+    LOG("release_jobs called for printer: '%s', count: %d", printer_name ? printer_name : "(null)", count);
+    uint64_t started = _monotonic_ns();
+    int succeeded = _bulk_job_action(printer_name, job_ids, count, 2);
+    _call_record_values(CALL_RELEASE_JOBS, printer_name, job_ids, count, started, succeeded == count, succeeded);
+    return succeeded;
+}
+
+FFI_PLUGIN_EXPORT int cancel_jobs_h(PrinterHandle *handle, const uint32_t *job_ids, int count)
+{
+    LOG("cancel_jobs_h called, count: %d", count);
+    uint64_t started = _monotonic_ns();
+    int succeeded = _bulk_job_action_h(handle, job_ids, count, 0);
+    _call_record_values(CALL_CANCEL_JOBS, handle ? handle->name : NULL, job_ids, count, started, succeeded == count, succeeded);
+    return succeeded;
+}
+
+FFI_PLUGIN_EXPORT int hold_jobs_h(PrinterHandle *handle, const uint32_t *job_ids, int count)
+{
+    LOG("hold_jobs_h called, count: %d", count);
+    uint64_t started = _monotonic_ns();
+    int succeeded = _bulk_job_action_h(handle, job_ids, count, 1);
+    _call_record_values(CALL_HOLD_JOBS, handle ? handle->name : NULL, job_ids, count, started, succeeded == count, succeeded);
+    return succeeded;
+}
+
+FFI_PLUGIN_EXPORT int release_jobs_h(PrinterHandle *handle, const uint32_t *job_ids, int count)
+{
+    LOG("release_jobs_h called, count: %d", count);
+    uint64_t started = _monotonic_ns();
+    int succeeded = _bulk_job_action_h(handle, job_ids, count, 2);
+    _call_record_values(CALL_RELEASE_JOBS, handle ? handle->name : NULL, job_ids, count, started, succeeded == count, succeeded);
+    return succeeded;
+}
+
+// Internal helper that rejects anything but a CANCEL_SCOPE_* value, so that an
+// unknown scope never turns into the broadest cancel or a purge.
+static bool _check_cancel_scope(int scope)
+{
+    if (scope == CANCEL_SCOPE_ALL_JOBS || scope == CANCEL_SCOPE_MY_JOBS || scope == CANCEL_SCOPE_PURGE)
+        return true;
+    set_last_error("Invalid cancel scope: %d.", scope);
+    return false;
+}
+
+// Cancels every job on a printer in a single request. `scope` is one of the
+// CANCEL_SCOPE_* values: all jobs, only the calling user's jobs, or a purge that
+// also discards job history (CUPS) / clears the queue with PRINTER_CONTROL_PURGE (Windows).
+static bool _cancel_all_jobs(const char *printer_name, int scope)
+{
+    if (!printer_name)
+    {
+        set_last_error("Invalid printer name.");
+        return false;
+    }
+    if (!_check_cancel_scope(scope))
+        return false;
+
+    LOG("cancel_all_jobs called for printer: '%s', scope: %d", printer_name, scope);
+#ifdef _WIN32
+    HANDLE hPrinter = _open_printer_for_jobs(printer_name, scope == CANCEL_SCOPE_MY_JOBS ? PRINTER_ACCESS_USE : PRINTER_ALL_ACCESS);
+    if (!hPrinter)
+        return false;
+    bool result = _cancel_all_jobs_win(hPrinter, scope == CANCEL_SCOPE_MY_JOBS);
+    ClosePrinter(hPrinter);
+    return result;
+#else
+    char printer_uri[HTTP_MAX_URI];
+    _local_printer_uri(printer_name, printer_uri, sizeof(printer_uri));
+    return _cancel_all_jobs_cups(CUPS_HTTP_DEFAULT, printer_uri, scope);
+#endif
+}
+
+FFI_PLUGIN_EXPORT bool cancel_all_jobs(const char *printer_name, int scope)
+{
+    uint64_t started = _monotonic_ns();
+    bool result = _cancel_all_jobs(printer_name, scope);
+    uint32_t recorded_scope = (uint32_t)scope;
+    _call_record_values(CALL_CANCEL_ALL_JOBS, printer_name, &recorded_scope, 1, started, result, result);
+    return result;
+}
+
+static bool _cancel_all_jobs_h(PrinterHandle *handle, int scope)
+{
+    if (!handle)
+    {
+        set_last_error("Invalid printer handle.");
+        return false;
+    }
+    if (!_check_cancel_scope(scope))
+        return false;
+
+    LOG("cancel_all_jobs_h called for printer: '%s', scope: %d", handle->name, scope);
+    ffi_mutex_lock(&handle->lock);
+#ifdef _WIN32
+    bool result = _cancel_all_jobs_win(handle->printer, scope == CANCEL_SCOPE_MY_JOBS);
+#else
+    bool result = _cancel_all_jobs_cups(handle->http, handle->printer_uri, scope);
+#endif
+    ffi_mutex_unlock(&handle->lock);
+    return result;
+}
+
+FFI_PLUGIN_EXPORT bool cancel_all_jobs_h(PrinterHandle *handle, int scope)
+{
+    uint64_t started = _monotonic_ns();
+    bool result = _cancel_all_jobs_h(handle, scope);
+    uint32_t recorded_scope = (uint32_t)scope;
+    _call_record_values(CALL_CANCEL_ALL_JOBS, handle ? handle->name : NULL, &recorded_scope, 1, started, result, result);
+    return result;
+}
+
+// --- Paginated Job Listing ---
+
+#ifdef _WIN32
+// Converts a spooler SYSTEMTIME (UTC) to seconds since the Unix epoch.
+static int64_t _systemtime_to_unix(const SYSTEMTIME *st)
+{
+    FILETIME ft;
+    if (!SystemTimeToFileTime(st, &ft))
+        return 0;
+    ULARGE_INTEGER ticks;
+    ticks.LowPart = ft.dwLowDateTime;
+    ticks.HighPart = ft.dwHighDateTime;
+    return (int64_t)((ticks.QuadPart - 116444736000000000ULL) / 10000000ULL);
+}
+
+static bool _job_matches_filter_win(DWORD status, const wchar_t *user, int which_jobs, const wchar_t *my_user)
+{
+    bool completed = (status & (JOB_STATUS_PRINTED | JOB_STATUS_COMPLETE | JOB_STATUS_DELETED)) != 0;
+    if (which_jobs == WHICH_JOBS_ACTIVE && completed)
+        return false;
+    if (which_jobs == WHICH_JOBS_COMPLETED && !completed)
+        return false;
+    if (my_user && (!user || _wcsicmp(user, my_user) != 0))
+        return false;
+    return true;
+}
+
+// Internal helper to fill `page` from an open printer. EnumJobsW pages natively,
+// so unfiltered listings only fetch `limit + 1` records; filtered listings have
+// to enumerate the (short) spooler queue and page on this side.
+static bool _fill_job_page_win(HANDLE hPrinter, const char *printer_name, int first_index, int limit, int which_jobs, bool my_jobs, uint32_t attributes, JobPage *page)
+{
+    wchar_t my_user[UNLEN + 1];
+    DWORD my_user_len = sizeof(my_user) / sizeof(my_user[0]);
+    if (my_jobs && !GetUserNameW(my_user, &my_user_len))
+    {
+        set_last_error("GetUserNameW failed. Error: %lu", GetLastError());
+        return false;
+    }
+
+    bool filtered = which_jobs != WHICH_JOBS_ALL || my_jobs;
+    DWORD first = filtered ? 0 : (DWORD)first_index;
+    DWORD wanted = filtered ? 0xFFFFFFFF : (DWORD)limit + 1;
+    // Level 1 is lighter; only level 2 carries the spool size.
+    DWORD level = (attributes & JOB_ATTR_SIZE) ? 2 : 1;
+
+    DWORD needed = 0, returned = 0;
+    EnumJobsW(hPrinter, first, wanted, level, NULL, 0, &needed, &returned);
+    if (needed == 0)
+        return true;
+    BYTE *buffer = (BYTE *)malloc(needed);
+    if (!buffer)
+        return false;
+    if (!EnumJobsW(hPrinter, first, wanted, level, buffer, needed, &needed, &returned))
+    {
+        set_last_error("EnumJobsW failed. Error: %lu", GetLastError());
+        free(buffer);
+        return false;
+    }
+
+    int skip = filtered ? first_index : 0;
+    int matched = 0;
+    for (DWORD i = 0; i < returned; i++)
+    {
+        DWORD id, status, pages_printed, size = 0;
+        const wchar_t *document, *user;
+        const SYSTEMTIME *submitted;
+        if (level == 2)
+        {
+            const JOB_INFO_2W *job = &((const JOB_INFO_2W *)buffer)[i];
+            id = job->JobId;
+            status = job->Status;
+            pages_printed = job->PagesPrinted;
+            document = job->pDocument;
+            user = job->pUserName;
+            submitted = &job->Submitted;
+            size = job->Size;
+        }
+        else
+        {
+            const JOB_INFO_1W *job = &((const JOB_INFO_1W *)buffer)[i];
+            id = job->JobId;
+            status = job->Status;
+            pages_printed = job->PagesPrinted;
+            document = job->pDocument;
+            user = job->pUserName;
+            submitted = &job->Submitted;
+        }
+
+        _job_trace_observe(printer_name, id, _job_stage_from_state(status));
+        if (filtered && !_job_matches_filter_win(status, user, which_jobs, my_jobs ? my_user : NULL))
+            continue;
+        if (matched++ < skip)
+            continue;
+        if (page->count == limit)
+        {
+            page->has_more = true;
+            break;
+        }
+
+        JobEntry *entry = &page->jobs[page->count++];
+        entry->id = id;
+        if (attributes & JOB_ATTR_STATE)
+            entry->state = status;
+        if (attributes & JOB_ATTR_TITLE)
+            entry->title = to_utf8(document);
+        if (attributes & JOB_ATTR_USER)
+            entry->user = to_utf8(user);
+        if (attributes & JOB_ATTR_SIZE)
+            entry->size_kb = (size + 1023) / 1024;
+        if (attributes & JOB_ATTR_PAGES)
+            entry->pages_completed = (int32_t)pages_printed;
+        if (attributes & JOB_ATTR_TIMES)
+            entry->created_at = _systemtime_to_unix(submitted);
+    }
+    free(buffer);
+    return true;
+}
+#else
+// Returns true if the server listed `name` in the unsupported-attributes group.
+static bool _ipp_attribute_unsupported(ipp_t *response, const char *name)
+{
+    for (ipp_attribute_t *attr = ippFirstAttribute(response); attr; attr = ippNextAttribute(response))
+    {
+        if (ippGetGroupTag(attr) == IPP_TAG_UNSUPPORTED_GROUP && ippGetName(attr) && strcmp(ippGetName(attr), name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Internal helper to fill `page` with one IPP Get-Jobs request that asks only for the
+// requested columns and lets the server apply `first-index`/`limit`. Servers without
+// `first-index` support get `limit` widened to cover the skipped rows instead.
+static bool _fill_job_page_cups(http_t *http, const char *printer_name, const char *printer_uri, int first_index, int limit, int which_jobs, bool my_jobs, uint32_t attributes, JobPage *page)
+{
+    static const char *which_keywords[] = {"not-completed", "completed", "all"};
+    const char *requested[9];
+    int num_requested = 0;
+    requested[num_requested++] = "job-id";
+    if (attributes & JOB_ATTR_TITLE)
+        requested[num_requested++] = "job-name";
+    if (attributes & JOB_ATTR_STATE)
+        requested[num_requested++] = "job-state";
+    if (attributes & JOB_ATTR_USER)
+        requested[num_requested++] = "job-originating-user-name";
+    if (attributes & JOB_ATTR_SIZE)
+        requested[num_requested++] = "job-k-octets";
+    if (attributes & JOB_ATTR_PAGES)
+        requested[num_requested++] = "job-impressions-completed";
+    if (attributes & JOB_ATTR_TIMES)
+    {
+        requested[num_requested++] = "time-at-creation";
+        requested[num_requested++] = "time-at-processing";
+        requested[num_requested++] = "time-at-completed";
+    }
+
+    bool server_paging = first_index > 0;
+    ipp_t *response = NULL;
+    for (;;)
+    {
+        ipp_t *request = ippNewRequest(IPP_OP_GET_JOBS);
+        ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, printer_uri);
+        ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
+        ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "which-jobs", NULL, which_keywords[which_jobs]);
+        ippAddBoolean(request, IPP_TAG_OPERATION, "my-jobs", my_jobs);
+        ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", num_requested, NULL, requested);
+        // One extra row tells us whether another page exists.
+        ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "limit", server_paging || first_index == 0 ? limit + 1 : first_index + limit + 1);
+        if (server_paging)
+            ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "first-index", first_index + 1); // 1-based
+
+        response = _ipp_do_request(http, request, "/");
+        if (!response || cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+        {
+            set_last_error("Get-Jobs failed for '%s': %s", printer_uri, cupsLastErrorString());
+            ippDelete(response);
+            return false;
+        }
+        if (server_paging && _ipp_attribute_unsupported(response, "first-index"))
+        {
+            LOG("Server does not support first-index, paging on the client");
+            ippDelete(response);
+            server_paging = false;
+            continue;
+        }
+        break;
+    }
+
+    int skip = server_paging ? 0 : first_index;
+    int seen = 0;
+    ipp_attribute_t *attr = ippFirstAttribute(response);
+    while (attr)
+    {
+        while (attr && ippGetGroupTag(attr) != IPP_TAG_JOB)
+            attr = ippNextAttribute(response);
+        if (!attr)
+            break;
+
+        JobEntry entry = {0};
+        for (; attr && ippGetGroupTag(attr) == IPP_TAG_JOB; attr = ippNextAttribute(response))
+        {
+            const char *name = ippGetName(attr);
+            if (!name)
+                continue;
+            if (strcmp(name, "job-id") == 0)
+                entry.id = (uint32_t)ippGetInteger(attr, 0);
+            else if (strcmp(name, "job-state") == 0)
+                entry.state = (uint32_t)ippGetInteger(attr, 0);
+            else if (strcmp(name, "job-name") == 0 && !entry.title)
+            {
+                // Out-of-band values (no-value, unknown) have no string.
+                const char *value = ippGetString(attr, 0, NULL);
+                entry.title = value ? strdup(value) : NULL;
+            }
+            else if (strcmp(name, "job-originating-user-name") == 0 && !entry.user)
+            {
+                const char *value = ippGetString(attr, 0, NULL);
+                entry.user = value ? strdup(value) : NULL;
+            }
+            else if (strcmp(name, "job-k-octets") == 0)
+                entry.size_kb = (uint32_t)ippGetInteger(attr, 0);
+            else if (strcmp(name, "job-impressions-completed") == 0)
+                entry.pages_completed = ippGetInteger(attr, 0);
+            else if (strcmp(name, "time-at-creation") == 0)
+                entry.created_at = ippGetInteger(attr, 0);
+            else if (strcmp(name, "time-at-processing") == 0)
+                entry.processing_at = ippGetInteger(attr, 0);
+            else if (strcmp(name, "time-at-completed") == 0)
+                entry.completed_at = ippGetInteger(attr, 0);
+        }
+
+        if (entry.state != 0)
+            _job_trace_observe(printer_name, entry.id, _job_stage_from_state(entry.state));
+        if (entry.id == 0 || seen++ < skip || page->count == limit)
+        {
+            if (entry.id != 0 && seen > skip + limit)
+                page->has_more = true;
+            free(entry.title);
+            free(entry.user);
+            continue;
+        }
+        page->jobs[page->count++] = entry;
+    }
+    ippDelete(response);
+    return true;
+}
+#endif
+
+static JobPage *_new_job_page(int limit)
+{
+    JobPage *page = (JobPage *)calloc(1, sizeof(JobPage));
+    if (!page)
+        return NULL;
+    if (limit > 0)
+    {
+        page->jobs = (JobEntry *)calloc((size_t)limit, sizeof(JobEntry));
+        if (!page->jobs)
+        {
+            free(page);
+            return NULL;
+        }
+    }
+    return page;
+}
+
+static bool _job_page_args_valid(int first_index, int limit, int which_jobs)
+{
+    if (first_index < 0 || limit < 0 || which_jobs < WHICH_JOBS_ACTIVE || which_jobs > WHICH_JOBS_ALL)
+    {
+        set_last_error("Invalid job page arguments.");
+        return false;
+    }
+    return true;
+}
+
+// Returns up to `limit` jobs starting at `first_index` (0-based) among the jobs selected by
+// `which_jobs` (WHICH_JOBS_*) and `my_jobs`. Only the fields in `attributes` (JOB_ATTR_* bits)
+// are fetched; the others are left zero/NULL. Free with free_job_page.
+static JobPage *_get_print_jobs_paged(const char *printer_name, int first_index, int limit, int which_jobs, bool my_jobs, uint32_t attributes)
+{
+    if (!printer_name)
+    {
+        set_last_error("Invalid printer name.");
+        return NULL;
+    }
+    if (!_job_page_args_valid(first_index, limit, which_jobs))
+        return NULL;
+
+    LOG("get_print_jobs_paged called for printer: '%s', first: %d, limit: %d, which: %d", printer_name, first_index, limit, which_jobs);
+    JobPage *page = _new_job_page(limit);
+    if (!page || limit == 0)
+        return page;
+
+#ifdef _WIN32
+    HANDLE hPrinter = _open_printer_for_jobs(printer_name, PRINTER_ACCESS_USE);
+    bool ok = hPrinter && _fill_job_page_win(hPrinter, printer_name, first_index, limit, which_jobs, my_jobs, attributes, page);
+    if (hPrinter)
+        ClosePrinter(hPrinter);
+#else
+    char printer_uri[HTTP_MAX_URI];
+    _local_printer_uri(printer_name, printer_uri, sizeof(printer_uri));
+    bool ok = _fill_job_page_cups(CUPS_HTTP_DEFAULT, printer_name, printer_uri, first_index, limit, which_jobs, my_jobs, attributes, page);
+#endif
+    if (!ok)
+    {
+        free_job_page(page);
+        return NULL;
+    }
+    return page;
+}
+
+FFI_PLUGIN_EXPORT JobPage *get_print_jobs_paged(const char *printer_name, int first_index, int limit, int which_jobs, bool my_jobs, uint32_t attributes)
+{
+    uint64_t started = _monotonic_ns();
+    JobPage *page = _get_print_jobs_paged(printer_name, first_index, limit, which_jobs, my_jobs, attributes);
+    uint32_t args[] = {(uint32_t)first_index, (uint32_t)limit, (uint32_t)which_jobs, my_jobs ? 1u : 0u, attributes};
+    _call_record_values(CALL_GET_PRINT_JOBS_PAGED, printer_name, args, 5, started, page != NULL, page ? page->count : 0);
+    return page;
+}
+
+static JobPage *_get_print_jobs_paged_h(PrinterHandle *handle, int first_index, int limit, int which_jobs, bool my_jobs, uint32_t attributes)
+{
+    if (!handle)
+    {
+        set_last_error("Invalid printer handle.");
+        return NULL;
+    }
+    if (!_job_page_args_valid(first_index, limit, which_jobs))
+        return NULL;
+
+    LOG("get_print_jobs_paged_h called for printer: '%s', first: %d, limit: %d, which: %d", handle->name, first_index, limit, which_jobs);
+    JobPage *page = _new_job_page(limit);
+    if (!page || limit == 0)
+        return page;
+
+    ffi_mutex_lock(&handle->lock);
+#ifdef _WIN32
+    bool ok = _fill_job_page_win(handle->printer, handle->name, first_index, limit, which_jobs, my_jobs, attributes, page);
+#else
+    bool ok = _fill_job_page_cups(handle->http, handle->name, handle->printer_uri, first_index, limit, which_jobs, my_jobs, attributes, page);
+#endif
+    ffi_mutex_unlock(&handle->lock);
+    if (!ok)
+    {
+        free_job_page(page);
+        return NULL;
+    }
+    return page;
+}
+
+FFI_PLUGIN_EXPORT JobPage *get_print_jobs_paged_h(PrinterHandle *handle, int first_index, int limit, int which_jobs, bool my_jobs, uint32_t attributes)
+{
+    uint64_t started = _monotonic_ns();
+    JobPage *page = _get_print_jobs_paged_h(handle, first_index, limit, which_jobs, my_jobs, attributes);
+    uint32_t args[] = {(uint32_t)first_index, (uint32_t)limit, (uint32_t)which_jobs, my_jobs ? 1u : 0u, attributes};
+    _call_record_values(CALL_GET_PRINT_JOBS_PAGED, handle ? handle->name : NULL, args, 5, started, page != NULL, page ? page->count : 0);
+    return page;
+}
+
+FFI_PLUGIN_EXPORT void free_job_page(JobPage *page)
+{
+    if (!page)
+        return;
+    if (page->jobs)
+    {
+        for (int i = 0; i < page->count; i++)
+        {
+            free(page->jobs[i].title);
+            free(page->jobs[i].user);
+        }
+        free(page->jobs);
+    }
+    free(page);
+}
+
+// --- Printer Status ---
+// A cheap health sweep over many printers: state, reasons, whether jobs are
+// accepted, queue depth and supply levels. On CUPS all printers are read with
+// one CUPS-Get-Printers request limited to those attributes, instead of a
+// full printer listing plus one job listing per printer. On Windows each
+// printer is read with GetPrinterW level 2.
+
+static void _free_printer_status_fields(PrinterStatus *status)
+{
+    free(status->name);
+    free(status->state_reasons);
+    if (status->supplies)
+    {
+        for (int i = 0; i < status->supply_count; i++)
+            free(status->supplies[i].name);
+        free(status->supplies);
+    }
+    memset(status, 0, sizeof(*status));
+}
+
+static PrinterStatusList *_alloc_printer_status_list(int count)
+{
+    PrinterStatusList *list = (PrinterStatusList *)calloc(1, sizeof(PrinterStatusList));
+    if (!list)
+        return NULL;
+    if (count > 0)
+    {
+        list->statuses = (PrinterStatus *)calloc((size_t)count, sizeof(PrinterStatus));
+        if (!list->statuses)
+        {
+            free(list);
+            return NULL;
+        }
+    }
+    list->count = count;
+    return list;
+}
+
+#ifdef _WIN32
+// printer-state-reasons keywords for the PRINTER_STATUS_* bits that have one.
+static const struct
+{
+    DWORD bit;
+    const char *reason;
+} s_windows_status_reasons[] = {
+    {PRINTER_STATUS_PAUSED, "paused"},
+    {PRINTER_STATUS_ERROR, "other-error"},
+    {PRINTER_STATUS_PAPER_JAM, "media-jam"},
+    {PRINTER_STATUS_PAPER_OUT, "media-empty"},
+    {PRINTER_STATUS_PAPER_PROBLEM, "media-needed"},
+    {PRINTER_STATUS_OFFLINE, "offline-report"},
+    {PRINTER_STATUS_OUTPUT_BIN_FULL, "output-area-full"},
+    {PRINTER_STATUS_TONER_LOW, "toner-low"},
+    {PRINTER_STATUS_NO_TONER, "toner-empty"},
+    {PRINTER_STATUS_DOOR_OPEN, "door-open"},
+    {PRINTER_STATUS_USER_INTERVENTION, "other-warning"},
+    {PRINTER_STATUS_OUT_OF_MEMORY, "other-error"},
+    {PRINTER_STATUS_NOT_AVAILABLE, "offline-report"},
+    {PRINTER_STATUS_SERVER_UNKNOWN, "offline-report"},
+};
+
+static void _fill_printer_status_win(PrinterStatus *status, const PRINTER_INFO_2W *info)
+{
+    char reasons[256] = "";
+    size_t used = 0;
+    for (size_t i = 0; i < sizeof(s_windows_status_reasons) / sizeof(s_windows_status_reasons[0]); i++)
+    {
+        const char *reason = s_windows_status_reasons[i].reason;
+        if (!(info->Status & s_windows_status_reasons[i].bit) || strstr(reasons, reason) || used >= sizeof(reasons))
+            continue;
+        used += (size_t)snprintf(reasons + used, sizeof(reasons) - used, "%s%s", used ? "," : "", reason);
+    }
+    status->found = true;
+    status->state = (uint32_t)info->Status; // Same as PrinterInfo.state on Windows.
+    status->state_reasons = strdup(used ? reasons : "none");
+    // The spooler queues jobs for paused and offline printers; it only turns
+    // them away while the printer is being deleted.
+    status->is_accepting_jobs = (info->Status & PRINTER_STATUS_PENDING_DELETION) == 0;
+    status->queued_job_count = (int)info->cJobs;
+}
+
+static bool _printer_status_win(const char *printer_name, PrinterStatus *status)
+{
+    HANDLE hPrinter = _open_printer_for_jobs(printer_name, PRINTER_ACCESS_USE);
+    if (!hPrinter)
+        return false;
+    DWORD needed = 0;
+    GetPrinterW(hPrinter, 2, NULL, 0, &needed);
+    BYTE *buffer = needed ? (BYTE *)malloc(needed) : NULL;
+    bool ok = buffer && GetPrinterW(hPrinter, 2, buffer, needed, &needed);
+    if (ok)
+        _fill_printer_status_win(status, (PRINTER_INFO_2W *)buffer);
+    else
+        LOG_WARN("GetPrinterW failed for '%s'. Error: %lu", printer_name, GetLastError());
+    free(buffer);
+    ClosePrinter(hPrinter);
+    return ok;
+}
+
+static PrinterStatusList *_all_printer_statuses_win(void)
+{
+    DWORD needed = 0, returned = 0;
+    DWORD flags = PRINTER_ENUM_LOCAL | PRINTER_ENUM_CONNECTIONS;
+    EnumPrintersW(flags, NULL, 2, NULL, 0, &needed, &returned);
+    BYTE *buffer = needed ? (BYTE *)malloc(needed) : NULL;
+    if (needed && (!buffer || !EnumPrintersW(flags, NULL, 2, buffer, needed, &needed, &returned)))
+    {
+        set_last_error("EnumPrintersW failed. Error: %lu", GetLastError());
+        free(buffer);
+        return NULL;
+    }
+    PrinterStatusList *list = _alloc_printer_status_list(needed ? (int)returned : 0);
+    if (list)
+    {
+        PRINTER_INFO_2W *printers = (PRINTER_INFO_2W *)buffer;
+        for (int i = 0; i < list->count; i++)
+        {
+            list->statuses[i].name = to_utf8(printers[i].pPrinterName);
+            _fill_printer_status_win(&list->statuses[i], &printers[i]);
+        }
+    }
+    free(buffer);
+    return list;
+}
+#else
+static const char *const s_printer_status_attributes[] = {
+    "printer-name",
+    "printer-state",
+    "printer-state-reasons",
+    "printer-is-accepting-jobs",
+    "queued-job-count",
+    "marker-names",
+    "marker-levels",
+};
+
+#define PRINTER_STATUS_ATTRIBUTE_COUNT ((int)(sizeof(s_printer_status_attributes) / sizeof(s_printer_status_attributes[0])))
+
+// Reads one printer's attribute group, starting at `attr`, into `status`.
+// Returns the attribute that ended the group (a separator), or NULL at the end
+// of the response.
+static ipp_attribute_t *_read_printer_status_group(ipp_t *response, ipp_attribute_t *attr, PrinterStatus *status)
+{
+    ipp_attribute_t *marker_names = NULL, *marker_levels = NULL;
+    status->found = true;
+    status->state = IPP_PSTATE_IDLE;
+    status->is_accepting_jobs = true;
+    for (; attr && ippGetGroupTag(attr) == IPP_TAG_PRINTER && ippGetName(attr); attr = ippNextAttribute(response))
+    {
+        const char *name = ippGetName(attr);
+        if (strcmp(name, "printer-name") == 0 && !status->name)
+        {
+            const char *value = ippGetString(attr, 0, NULL);
+            status->name = value ? strdup(value) : NULL;
+        }
+        else if (strcmp(name, "printer-state") == 0)
+            status->state = (uint32_t)ippGetInteger(attr, 0);
+        else if (strcmp(name, "printer-is-accepting-jobs") == 0)
+            status->is_accepting_jobs = ippGetBoolean(attr, 0) != 0;
+        else if (strcmp(name, "queued-job-count") == 0)
+            status->queued_job_count = ippGetInteger(attr, 0);
+        else if (strcmp(name, "marker-names") == 0)
+            marker_names = attr;
+        else if (strcmp(name, "marker-levels") == 0)
+            marker_levels = attr;
+        else if (strcmp(name, "printer-state-reasons") == 0 && !status->state_reasons)
+        {
+            char reasons[1024] = "";
+            size_t used = 0;
+            for (int i = 0; i < ippGetCount(attr) && used < sizeof(reasons); i++)
             {
-                set_last_error("Failed to create bitmap for rendering page %d. Error: %lu.", i + 1, GetLastError());
-                LOG("print_pdf_job_win: CreateDIBSection failed for page %d with error %lu", i, GetLastError());
-                FPDF_ClosePage(page);
-                EndPage(hdc);
-                success = false;
-                break;
+                const char *reason = ippGetString(attr, i, NULL);
+                used += (size_t)snprintf(reasons + used, sizeof(reasons) - used, "%s%s", i ? "," : "", reason ? reason : "");
             }
+            status->state_reasons = strdup(reasons);
+        }
+    }
 
-            FPDF_BITMAP pdfBitmap = FPDFBitmap_CreateEx(bitmap_width, bitmap_height, FPDFBitmap_BGRA, pBitmapData, bitmap_width * 4);
-            if (!pdfBitmap)
+    int supplies = marker_names ? ippGetCount(marker_names) : 0;
+    if (supplies > 0)
+    {
+        status->supplies = (SupplyLevel *)calloc((size_t)supplies, sizeof(SupplyLevel));
+        if (status->supplies)
+        {
+            status->supply_count = supplies;
+            int levels = marker_levels ? ippGetCount(marker_levels) : 0;
+            for (int i = 0; i < supplies; i++)
             {
-                set_last_error("Failed to create PDFium bitmap for page %d.", i + 1);
-                LOG("print_pdf_job_win: FPDFBitmap_CreateEx failed for page %d", i);
-                DeleteObject(hBitmap);
-                FPDF_ClosePage(page);
-                EndPage(hdc);
-                success = false;
-                break;
+                const char *supply = ippGetString(marker_names, i, NULL);
+                status->supplies[i].name = strdup(supply ? supply : "");
+                // -2 is IPP's "unknown" level.
+                status->supplies[i].level = i < levels ? ippGetInteger(marker_levels, i) : -2;
             }
+        }
+    }
+    if (!status->state_reasons)
+        status->state_reasons = strdup("none");
+    return attr;
+}
 
-            FPDFBitmap_FillRect(pdfBitmap, 0, 0, bitmap_width, bitmap_height, 0xFFFFFFFF); // Fill with white
-            // Pass the rotation value to PDFium so it handles rendering the page correctly.
-            // IMPORTANT: We have already swapped the width/height to create a correctly-oriented
-            // bitmap. We must now render the page with NO additional rotation, so we pass 0.
-            // The page content itself will be correctly oriented within the unrotated bitmap.
-            FPDF_RenderPageBitmap(pdfBitmap, page, 0, 0, bitmap_width, bitmap_height, 0, FPDF_ANNOT);
-            FPDFBitmap_Destroy(pdfBitmap);
+typedef struct
+{
+    const char *name;
+    int index;
+} PrinterStatusSlot;
 
-            if (scaling_mode == 0)
-            { // Fit to Printable Area (formerly Fit Page)
-                _scale_to_fit(bitmap_width, bitmap_height, printable_width_pixels, printable_height_pixels, &dest_width, &dest_height);
-                LOG("print_pdf_job_win: Page %d: ScalingMode=FitToPrintableArea, Dest=(%d,%d)", i, dest_width, dest_height);
-            }
-            else if (scaling_mode == 1)
-            { // Actual Size
-                // Calculate actual size in device pixels
-                dest_width = (int)(pdf_width_pt / 72.0f * dpi_x);
-                dest_height = (int)(pdf_height_pt / 72.0f * dpi_y);
-                LOG("print_pdf_job_win: Page %d: ScalingMode=ActualSize, Dest=(%d,%d)", i, dest_width, dest_height);
-            }
-            else if (scaling_mode == 2)
-            { // Shrink to Fit
-                // If the PDF page is larger than the printable area, scale down to fit.
-                // Otherwise, print at actual size.
-                int pdf_pixel_width = (int)(pdf_width_pt / 72.0f * dpi_x);
-                int pdf_pixel_height = (int)(pdf_height_pt / 72.0f * dpi_y);
+static int _compare_printer_status_slots(const void *a, const void *b)
+{
+    return strcmp(((const PrinterStatusSlot *)a)->name, ((const PrinterStatusSlot *)b)->name);
+}
 
-                if (pdf_pixel_width > printable_width_pixels || pdf_pixel_height > printable_height_pixels)
-                {
-                    _scale_to_fit(bitmap_width, bitmap_height, printable_width_pixels, printable_height_pixels, &dest_width, &dest_height);
-                    LOG("print_pdf_job_win: Page %d: ScalingMode=ShrinkToFit (scaled), Dest=(%d,%d)", i, dest_width, dest_height);
-                }
-                else
-                {
-                    dest_width = pdf_pixel_width;
-                    dest_height = pdf_pixel_height;
-                    LOG("print_pdf_job_win: Page %d: ScalingMode=ShrinkToFit (actual size), Dest=(%d,%d)", i, dest_width, dest_height);
-                }
-            }
-            else if (scaling_mode == 3)
-            { // Fit to Paper
-                int paper_width = GetDeviceCaps(hdc, PHYSICALWIDTH);
-                int paper_height = GetDeviceCaps(hdc, PHYSICALHEIGHT);
-                _scale_to_fit(bitmap_width, bitmap_height, paper_width, paper_height, &dest_width, &dest_height);
-                LOG("print_pdf_job_win: Page %d: ScalingMode=FitToPaper, Dest=(%d,%d)", i, dest_width, dest_height);
-            }
-            else if (scaling_mode == 4)
-            { // Custom Scale
-                // Calculate actual size in device pixels first
-                int pdf_pixel_width = (int)(pdf_width_pt / 72.0f * dpi_x);
-                int pdf_pixel_height = (int)(pdf_height_pt / 72.0f * dpi_y);
-                // Apply custom scale factor
-                dest_width = (int)(pdf_pixel_width * custom_scale);
-                dest_height = (int)(pdf_pixel_height * custom_scale);
-                LOG("print_pdf_job_win: Page %d: ScalingMode=CustomScale (%.2f), Dest=(%d,%d)", i, custom_scale, dest_width, dest_height);
-            }
-            else
-            { // Default to Fit to Printable Area
-                _scale_to_fit(bitmap_width, bitmap_height, printable_width_pixels, printable_height_pixels, &dest_width, &dest_height);
-                LOG("print_pdf_job_win: Page %d: ScalingMode=Default (FitToPrintableArea), Dest=(%d,%d)", i, dest_width, dest_height);
+// Deep-copies a found status into the slot of a duplicate requested name.
+static void _copy_printer_status(const PrinterStatus *src, PrinterStatus *dst)
+{
+    *dst = *src;
+    dst->name = src->name ? strdup(src->name) : NULL;
+    dst->state_reasons = src->state_reasons ? strdup(src->state_reasons) : NULL;
+    dst->supplies = NULL;
+    dst->supply_count = 0;
+    if (src->supply_count > 0)
+    {
+        dst->supplies = (SupplyLevel *)calloc((size_t)src->supply_count, sizeof(SupplyLevel));
+        if (dst->supplies)
+        {
+            dst->supply_count = src->supply_count;
+            for (int i = 0; i < src->supply_count; i++)
+            {
+                dst->supplies[i].name = src->supplies[i].name ? strdup(src->supplies[i].name) : NULL;
+                dst->supplies[i].level = src->supplies[i].level;
             }
+        }
+    }
+}
 
-            if (scaling_mode == 3)
-            { // Fit to Paper alignment is relative to physical paper
-                int paper_width = GetDeviceCaps(hdc, PHYSICALWIDTH);
-                int paper_height = GetDeviceCaps(hdc, PHYSICALHEIGHT);
-                int offset_x = GetDeviceCaps(hdc, PHYSICALOFFSETX);
-                int offset_y = GetDeviceCaps(hdc, PHYSICALOFFSETY);
-                dest_x = (int)((paper_width - dest_width) * align_x_factor) - offset_x;
-                dest_y = (int)((paper_height - dest_height) * align_y_factor) - offset_y;
-            }
-            else
-            { // All other modes are relative to the printable area
-                dest_x = (int)((printable_width_pixels - dest_width) * align_x_factor);
-                dest_y = (int)((printable_height_pixels - dest_height) * align_y_factor);
-            }
+// Sends CUPS-Get-Printers or CUPS-Get-Classes for the status attributes of
+// every queue and stores each returned queue in `list`: in the slot of its
+// requested name when `count` > 0, otherwise appended. Returns false if the
+// request failed.
+static bool _collect_printer_statuses_cups(ipp_op_t op, const PrinterStatusSlot *slots, int count, PrinterStatusList *list, int *capacity)
+{
+    const char *label = op == IPP_OP_CUPS_GET_CLASSES ? "CUPS-Get-Classes" : "CUPS-Get-Printers";
+    TraceSpan span;
+    _trace_begin(&span, label);
+    _trace_arg_int(&span, "printers", count);
+    ipp_t *request = ippNewRequest(op);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
+    ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", PRINTER_STATUS_ATTRIBUTE_COUNT, NULL, s_printer_status_attributes);
+    ipp_t *response = _ipp_do_request(CUPS_HTTP_DEFAULT, request, "/");
+    _trace_end(&span);
+    if (!response || cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+    {
+        set_last_error("%s failed: %s", label, cupsLastErrorString());
+        ippDelete(response);
+        return false;
+    }
 
-            LOG("print_pdf_job_win: Page %d: Final DestRect=(%d,%d, %dx%d)", i, dest_x, dest_y, dest_width, dest_height);
-            if (StretchDIBits(hdc, dest_x, dest_y, dest_width, dest_height, 0, 0, bitmap_width, bitmap_height, pBitmapData, &bmi, DIB_RGB_COLORS, SRCCOPY) == GDI_ERROR)
+    ipp_attribute_t *attr = ippFirstAttribute(response);
+    while (attr)
+    {
+        if (ippGetGroupTag(attr) != IPP_TAG_PRINTER || !ippGetName(attr))
+        {
+            attr = ippNextAttribute(response);
+            continue;
+        }
+        PrinterStatus status;
+        memset(&status, 0, sizeof(status));
+        attr = _read_printer_status_group(response, attr, &status);
+        if (!status.name)
+        {
+            _free_printer_status_fields(&status);
+            continue;
+        }
+        if (count > 0)
+        {
+            PrinterStatusSlot key = {status.name, 0};
+            const PrinterStatusSlot *slot = (const PrinterStatusSlot *)bsearch(&key, slots, (size_t)count, sizeof(PrinterStatusSlot), _compare_printer_status_slots);
+            if (!slot || list->statuses[slot->index].found)
             {
-                set_last_error("Failed to draw page %d to the printer device context. Error: %lu.", i + 1, GetLastError());
-                LOG("print_pdf_job_win: StretchDIBits failed for page %d with error %lu", i, GetLastError());
-                success = false;
+                _free_printer_status_fields(&status);
+                continue;
             }
-
-            DeleteObject(hBitmap);
-            FPDF_ClosePage(page);
-
-            if (EndPage(hdc) <= 0)
+            list->statuses[slot->index] = status;
+            continue;
+        }
+        if (list->count == *capacity)
+        {
+            PrinterStatus *grown = (PrinterStatus *)realloc(list->statuses, (size_t)*capacity * 2 * sizeof(PrinterStatus));
+            if (!grown)
             {
-                set_last_error("Failed to end page %d. Error: %lu.", i + 1, GetLastError());
-                LOG("print_pdf_job_win: EndPage failed for page %d with error %lu", i, GetLastError());
-                success = false;
+                _free_printer_status_fields(&status);
+                break;
             }
+            list->statuses = grown;
+            *capacity *= 2;
+        }
+        list->statuses[list->count++] = status;
+    }
+    ippDelete(response);
+    return true;
+}
 
-            // Manually pump the message queue. This is critical when running on an
-            // STA thread without a traditional message loop. Some printer drivers
-            // send messages and will time out if they are not processed. This prevents
-            // the extreme slowdown seen when printing from a background thread.
-            MSG msg;
-            while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE)) {
-                TranslateMessage(&msg);
-                DispatchMessageW(&msg);
-            }
+// Reads the status attributes of every queue with CUPS-Get-Printers, plus
+// CUPS-Get-Classes for printer classes when all printers are wanted or some
+// requested names were not printers. When `printer_names` is given, only those
+// printers are kept, in that order (a name requested twice fills both slots);
+// names the scheduler did not return are left with found = false.
+static PrinterStatusList *_printer_statuses_cups(const char **printer_names, int count)
+{
+    // Requested names are sorted once so that each returned printer is
+    // matched with a binary search.
+    PrinterStatusSlot *slots = NULL;
+    if (count > 0)
+    {
+        slots = (PrinterStatusSlot *)malloc((size_t)count * sizeof(PrinterStatusSlot));
+        if (!slots)
+            return NULL;
+        for (int i = 0; i < count; i++)
+        {
+            slots[i].name = printer_names[i];
+            slots[i].index = i;
+        }
+        qsort(slots, (size_t)count, sizeof(PrinterStatusSlot), _compare_printer_status_slots);
+    }
+
+    int capacity = count > 0 ? count : 16;
+    PrinterStatusList *list = _alloc_printer_status_list(capacity);
+    if (!list)
+    {
+        free(slots);
+        return NULL;
+    }
+    if (count == 0)
+        list->count = 0;
+
+    if (!_collect_printer_statuses_cups(IPP_OP_CUPS_GET_PRINTERS, slots, count, list, &capacity))
+    {
+        for (int i = 0; i < list->count; i++)
+            _free_printer_status_fields(&list->statuses[i]);
+        free(list->statuses);
+        free(list);
+        free(slots);
+        return NULL;
+    }
+
+    bool unmatched = count == 0;
+    for (int i = 0; i < count && !unmatched; i++)
+        unmatched = !list->statuses[i].found;
+    // A scheduler without classes answers CUPS-Get-Classes with not-found, which only means there is nothing to add.
+    if (unmatched)
+        _collect_printer_statuses_cups(IPP_OP_CUPS_GET_CLASSES, slots, count, list, &capacity);
+
+    // bsearch filled one slot per name; copy it into the slots of duplicates,
+    // which sort next to it.
+    for (int start = 0, end; start < count; start = end)
+    {
+        const PrinterStatus *found = NULL;
+        for (end = start; end < count && strcmp(slots[end].name, slots[start].name) == 0; end++)
+        {
+            if (list->statuses[slots[end].index].found)
+                found = &list->statuses[slots[end].index];
+        }
+        for (int i = start; found && i < end; i++)
+        {
+            if (!list->statuses[slots[i].index].found)
+                _copy_printer_status(found, &list->statuses[slots[i].index]);
+        }
+    }
+    free(slots);
+
+    // Printers the scheduler does not know keep their requested name.
+    for (int i = 0; i < count; i++)
+    {
+        if (!list->statuses[i].found)
+            list->statuses[i].name = strdup(printer_names[i]);
+    }
+    return list;
+}
+#endif
+
+// Returns the status of each printer in `printer_names`, in the same order,
+// or of every printer when `count` is 0. A printer that could not be read has
+// found = false. Returns NULL if the sweep itself failed.
+static PrinterStatusList *_get_printer_statuses(const char **printer_names, int count)
+{
+    if (count < 0 || (count > 0 && !printer_names))
+    {
+        set_last_error("Invalid arguments for get_printer_statuses.");
+        return NULL;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (!printer_names[i])
+        {
+            set_last_error("Invalid arguments for get_printer_statuses.");
+            return NULL;
         }
     }
+    LOG("get_printer_statuses called for %d printers", count);
+#ifdef _WIN32
+    PrinterStatusList *list = count == 0 ? _all_printer_statuses_win() : _alloc_printer_status_list(count);
+    for (int i = 0; list && i < count; i++)
+    {
+        list->statuses[i].name = strdup(printer_names[i]);
+        _printer_status_win(printer_names[i], &list->statuses[i]);
+    }
+#else
+    PrinterStatusList *list = _printer_statuses_cups(printer_names, count);
+#endif
+    // The sweep has just read every printer, so it refreshes their admission state too.
+    for (int i = 0; list && i < list->count; i++)
+        _admission_remember(&list->statuses[i]);
+    return list;
+}
+
+FFI_PLUGIN_EXPORT PrinterStatusList *get_printer_statuses(const char **printer_names, int count)
+{
+    uint64_t started = _monotonic_ns();
+    PrinterStatusList *list = _get_printer_statuses(printer_names, count);
+    _call_record_names(CALL_GET_PRINTER_STATUSES, printer_names, count, started, list != NULL, list ? list->count : 0);
+    return list;
+}
+
+FFI_PLUGIN_EXPORT void free_printer_status_list(PrinterStatusList *list)
+{
+    if (!list)
+        return;
+    for (int i = 0; i < list->count; i++)
+        _free_printer_status_fields(&list->statuses[i]);
+    free(list->statuses);
+    free(list);
+}
+// --- Admission Control ---
+
+// Before any payload is spooled, the submit functions check that the printer
+// can take the job: a stopped (CUPS) or paused (Windows) queue, or one that is
+// rejecting jobs, fails immediately with a PRINTING_ERROR_* code instead of
+// after the whole document has been uploaded. If a fallback printer is
+// configured and can take the job, the job is rerouted to it instead.
+// Without admission control the spooler queues such jobs, so the check is
+// off until set_admission_control enables it.
+//
+// The state is cached per printer for s_admission_max_age_ns, and refreshed
+// early whenever the printer directory epoch moves (see "Configuration Change
+// Tracking") or get_printer_statuses reads the printer anyway.
+#define ADMISSION_DEFAULT_MAX_AGE_MS 2000
+
+typedef struct
+{
+    char *printer_name;
+    char *fallback; // NULL if none is configured.
+    uint64_t checked_ns; // 0 = state not read yet.
+    uint64_t epoch;
+    int verdict; // PRINTING_ERROR_NONE, _PRINTER_STOPPED or _NOT_ACCEPTING_JOBS.
+} AdmissionEntry;
+
+static ffi_mutex_t s_admission_lock = FFI_MUTEX_INITIALIZER;
+static AdmissionEntry *s_admission = NULL;
+static int s_admission_count = 0;
+static int s_admission_capacity = 0;
+static bool s_admission_enabled = false;
+static uint64_t s_admission_max_age_ns = (uint64_t)ADMISSION_DEFAULT_MAX_AGE_MS * 1000000;
+
+// The fallback printer that took the last job submitted on this thread.
+#ifdef _WIN32
+__declspec(thread) static char *g_rerouted_printer = NULL;
+#else
+static __thread char *g_rerouted_printer = NULL;
+#endif
+
+static int _admission_verdict(uint32_t state, bool is_accepting_jobs)
+{
+    if (!is_accepting_jobs)
+        return PRINTING_ERROR_NOT_ACCEPTING_JOBS;
+#ifdef _WIN32
+    if (state & PRINTER_STATUS_PAUSED)
+        return PRINTING_ERROR_PRINTER_STOPPED;
+#else
+    if (state == IPP_PSTATE_STOPPED)
+        return PRINTING_ERROR_PRINTER_STOPPED;
+#endif
+    return PRINTING_ERROR_NONE;
+}
+
+// Returns the entry for `printer_name`, adding it if `create` is set. The
+// caller must hold s_admission_lock.
+static AdmissionEntry *_admission_entry(const char *printer_name, bool create)
+{
+    for (int i = 0; i < s_admission_count; i++)
+    {
+        if (strcmp(s_admission[i].printer_name, printer_name) == 0)
+            return &s_admission[i];
+    }
+    if (!create)
+        return NULL;
+    if (s_admission_count == s_admission_capacity)
+    {
+        int new_capacity = s_admission_capacity > 0 ? s_admission_capacity * 2 : 8;
+        AdmissionEntry *grown = (AdmissionEntry *)realloc(s_admission, new_capacity * sizeof(AdmissionEntry));
+        if (!grown)
+            return NULL;
+        s_admission = grown;
+        s_admission_capacity = new_capacity;
+    }
+    char *name_copy = strdup(printer_name);
+    if (!name_copy)
+        return NULL;
+    AdmissionEntry *entry = &s_admission[s_admission_count++];
+    memset(entry, 0, sizeof(*entry));
+    entry->printer_name = name_copy;
+    return entry;
+}
+
+// Records the state of `status` for later admission checks.
+static void _admission_remember(const PrinterStatus *status)
+{
+    if (!status->found || !status->name)
+        return;
+    ffi_mutex_lock(&s_admission_lock);
+    AdmissionEntry *entry = _admission_entry(status->name, true);
+    if (entry)
+    {
+        entry->verdict = _admission_verdict(status->state, status->is_accepting_jobs);
+        entry->checked_ns = _monotonic_ns();
+        entry->epoch = _config_cache_epoch(CONFIG_CACHE_DIRECTORY);
+    }
+    ffi_mutex_unlock(&s_admission_lock);
+}
+
+// Reads the current state of one printer. Returns false if it could not be read.
+static bool _admission_read(const char *printer_name, PrinterStatus *status)
+{
+#ifdef _WIN32
+    return _printer_status_win(printer_name, status);
+#else
+    static const char *const attributes[] = {"printer-name", "printer-state", "printer-is-accepting-jobs"};
+    char printer_uri[HTTP_MAX_URI];
+    _local_printer_uri(printer_name, printer_uri, sizeof(printer_uri));
+    TraceSpan span;
+    _trace_begin(&span, "Get-Printer-Attributes");
+    _trace_arg_str(&span, "printer", printer_name);
+    ipp_t *request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, printer_uri);
+    ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", 3, NULL, attributes);
+    ipp_t *response = _ipp_do_request(CUPS_HTTP_DEFAULT, request, "/");
+    _trace_end(&span);
+    bool ok = response && cupsLastError() <= IPP_STATUS_OK_CONFLICTING;
+    if (ok)
+    {
+        ipp_attribute_t *attr = ippFirstAttribute(response);
+        while (attr && ippGetGroupTag(attr) != IPP_TAG_PRINTER)
+            attr = ippNextAttribute(response);
+        ok = attr != NULL;
+        if (ok)
+            _read_printer_status_group(response, attr, status);
+    }
+    else
+        LOG_WARN("Get-Printer-Attributes failed for '%s', error: %s", printer_name, cupsLastErrorString());
+    ippDelete(response);
+    return ok;
+#endif
+}
+
+// Returns whether `printer_name` can take a job, from the cache or else from
+// the printing system, and sets `*fallback` to a copy of its fallback printer
+// (or NULL). A printer whose state cannot be read is admitted, so that the
+// submit itself reports why it failed.
+static int _admission_check(const char *printer_name, char **fallback)
+{
+    uint64_t now = _monotonic_ns();
+    uint64_t epoch = _config_cache_epoch(CONFIG_CACHE_DIRECTORY);
+    int verdict = PRINTING_ERROR_NONE;
+    bool fresh = false;
+    ffi_mutex_lock(&s_admission_lock);
+    AdmissionEntry *entry = _admission_entry(printer_name, false);
+    if (entry)
+    {
+        fresh = entry->checked_ns && entry->epoch == epoch && now - entry->checked_ns < s_admission_max_age_ns;
+        verdict = entry->verdict;
+        if (fallback && entry->fallback)
+            *fallback = strdup(entry->fallback);
+    }
+    ffi_mutex_unlock(&s_admission_lock);
+    if (fresh)
+        return verdict;
+
+    PrinterStatus status;
+    memset(&status, 0, sizeof(status));
+    if (!_admission_read(printer_name, &status))
+    {
+        _free_printer_status_fields(&status);
+        return PRINTING_ERROR_NONE;
+    }
+    if (!status.name)
+        status.name = strdup(printer_name);
+    _admission_remember(&status);
+    verdict = _admission_verdict(status.state, status.is_accepting_jobs);
+    _free_printer_status_fields(&status);
+    return verdict;
+}
+
+static bool _admit_job(const char **printer_name)
+{
+    // A failure further down that sets no error must not report a stale code.
+    g_last_error_code = PRINTING_ERROR_NONE;
+    free(g_rerouted_printer);
+    g_rerouted_printer = NULL;
+    ffi_mutex_lock(&s_admission_lock);
+    bool enabled = s_admission_enabled;
+    ffi_mutex_unlock(&s_admission_lock);
+    if (!enabled || !*printer_name)
+        return true;
+
+    char *fallback = NULL;
+    int verdict = _admission_check(*printer_name, &fallback);
+    if (verdict == PRINTING_ERROR_NONE)
+    {
+        free(fallback);
+        return true;
+    }
+    // Fallbacks are not chained, so a cycle of fallbacks cannot loop.
+    if (fallback && _admission_check(fallback, NULL) == PRINTING_ERROR_NONE)
+    {
+        LOG("Printer '%s' cannot take jobs; rerouting to '%s'", *printer_name, fallback);
+        g_rerouted_printer = fallback;
+        *printer_name = fallback;
+        return true;
+    }
+    free(fallback);
+    if (verdict == PRINTING_ERROR_PRINTER_STOPPED)
+        set_last_error_code(verdict, "Printer '%s' is stopped.", *printer_name);
+    else
+        set_last_error_code(verdict, "Printer '%s' is not accepting jobs.", *printer_name);
+    LOG_WARN("Rejected job for '%s' before spooling (error code %d)", *printer_name, verdict);
+    return false;
+}
+
+// Turns admission checks on or off and sets how long a printer's state is
+// trusted before it is read again. `max_age_ms` 0 reads it on every submit.
+FFI_PLUGIN_EXPORT void set_admission_control(bool enabled, uint32_t max_age_ms)
+{
+    LOG("set_admission_control called: enabled=%d, max_age_ms=%u", enabled, max_age_ms);
+    ffi_mutex_lock(&s_admission_lock);
+    s_admission_enabled = enabled;
+    s_admission_max_age_ns = (uint64_t)max_age_ms * 1000000;
+    ffi_mutex_unlock(&s_admission_lock);
+}
+
+// Routes jobs for `printer_name` to `fallback_printer` while `printer_name`
+// cannot take them. Pass NULL as `fallback_printer` to remove the fallback.
+FFI_PLUGIN_EXPORT bool set_fallback_printer(const char *printer_name, const char *fallback_printer)
+{
+    if (!printer_name || (fallback_printer && strcmp(printer_name, fallback_printer) == 0))
+    {
+        set_last_error("Invalid arguments for set_fallback_printer.");
+        return false;
+    }
+    char *fallback_copy = NULL;
+    if (fallback_printer && !(fallback_copy = strdup(fallback_printer)))
+    {
+        set_last_error("Out of memory.");
+        return false;
+    }
+    ffi_mutex_lock(&s_admission_lock);
+    AdmissionEntry *entry = _admission_entry(printer_name, fallback_copy != NULL);
+    if (entry)
+    {
+        free(entry->fallback);
+        entry->fallback = fallback_copy;
+    }
+    ffi_mutex_unlock(&s_admission_lock);
+    if (fallback_copy && !entry)
+    {
+        free(fallback_copy);
+        set_last_error("Out of memory.");
+        return false;
+    }
+    return true;
+}
 
-    free(pages_to_print);
-    if (doc_name_w)
-        free(doc_name_w);
+// Returns the fallback printer that took the last job submitted on this
+// thread, or NULL if that job went to the printer it was submitted to.
+FFI_PLUGIN_EXPORT const char *get_last_rerouted_printer(void)
+{
+    return g_rerouted_printer;
+}
 
-    if (success)
+// Conflicting option values, compiled from job-constraints-supported into
+// bitsets with one bit per (option, choice) of an option list, in list order.
+// An option set selects at most one bit per option and violates a constraint
+// when it selects a constrained value of every option the constraint names.
+typedef struct
+{
+    int num_words;  // uint64_t words per bitset.
+    int count;
+    uint64_t *sets; // `count` bitsets of `num_words` words each.
+    uint8_t *arity; // Number of options named by each constraint.
+    char **names;   // resolver-name of each constraint, for error messages.
+} OptionConstraints;
+
+static void _free_option_constraints(OptionConstraints *constraints)
+{
+    if (!constraints)
+        return;
+    if (constraints->names)
     {
-        LOG("print_pdf_job_win: All pages processed successfully. Calling EndDoc.");
-        EndDoc(hdc);
+        for (int i = 0; i < constraints->count; i++)
+            free(constraints->names[i]);
+        free(constraints->names);
     }
-    else
+    free(constraints->sets);
+    free(constraints->arity);
+    free(constraints);
+}
+
+#ifndef _WIN32
+static int _find_option(const CupsOptionList *list, const char *name)
+{
+    for (int i = 0; i < list->count; i++)
     {
-        LOG("print_pdf_job_win: A failure occurred. Calling AbortDoc.");
-        AbortDoc(hdc);
+        if (list->options[i].name && strcmp(list->options[i].name, name) == 0)
+            return i;
     }
+    return -1;
+}
 
-    DeleteDC(hdc);
-    FPDF_CloseDocument(doc);
-    free(printer_name_w);
-
-    if (submit_job)
+static int _find_option_choice(const CupsOption *option, const char *value)
+{
+    for (int i = 0; i < option->supported_values.count; i++)
     {
-        LOG("_print_pdf_job_win (submit) finished with result: %d, job_id: %d", success, job_id);
-        return success ? job_id : 0;
+        if (option->supported_values.choices[i].choice && strcmp(option->supported_values.choices[i].choice, value) == 0)
+            return i;
     }
-    else
+    return -1;
+}
+
+// Like _find_option_choice for `media`, but a value that does not match
+// literally also matches a choice naming the same PWG media size, so that
+// `A4`, `iso-a4` and `iso_a4_210x297mm` are interchangeable.
+static int _find_media_choice(const CupsOption *option, const char *value)
+{
+    int index = _find_option_choice(option, value);
+    const PwgMedia *media = index < 0 ? _lookup_pwg_media(value) : NULL;
+    for (int i = 0; media && i < option->supported_values.count; i++)
     {
-        LOG("_print_pdf_job_win (print) finished with result: %d", success);
-        return success ? 1 : 0;
+        if (_lookup_pwg_media(option->supported_values.choices[i].choice) == media)
+            return i;
     }
+    return index;
 }
-#endif
 
-FFI_PLUGIN_EXPORT const char *get_last_error()
+// Returns the constraint bit of the first choice of option `index`.
+static int _option_bit_base(const CupsOptionList *list, int index)
 {
-    return g_last_error_message ? g_last_error_message : "";
+    int base = 0;
+    for (int i = 0; i < index; i++)
+        base += list->options[i].supported_values.count;
+    return base;
 }
+#endif
 
-FFI_PLUGIN_EXPORT bool print_pdf(const char *printer_name, const char *pdf_file_path, const char *doc_name, int scaling_mode, int copies, const char *page_range, int num_options, const char **option_keys, const char **option_values, const char *alignment)
+// Option lists returned by get_supported_cups_options are immutable and shared
+// with the option cache; free_cups_option_list drops one reference.
+typedef struct
 {
-    LOG("print_pdf called for printer: '%s', path: '%s', doc: '%s'", printer_name, pdf_file_path, doc_name);
+    CupsOptionList list; // Must stay first: callers only see &shared->list.
+    uint64_t refs;
+    OptionConstraints *constraints; // NULL if the printer reports none.
+} SharedCupsOptionList;
 
-    // Validate input parameters
-    if (!printer_name || !pdf_file_path || !doc_name || copies <= 0)
-    {
-        LOG("Invalid input parameters");
-        return false;
-    }
+// Returns an empty list holding one reference, or NULL on allocation failure.
+static CupsOptionList *_alloc_cups_option_list(void)
+{
+    SharedCupsOptionList *shared = (SharedCupsOptionList *)calloc(1, sizeof(SharedCupsOptionList));
+    if (!shared)
+        return NULL;
+    shared->refs = 1;
+    return &shared->list;
+}
 
-#ifdef _WIN32
-    return _print_pdf_job_win(printer_name, pdf_file_path, doc_name, scaling_mode, copies, page_range, alignment, num_options, option_keys, option_values, false) == 1;
-#else // macOS / Linux (CUPS)
-    cups_option_t *options = NULL;
-    int num_cups_options = 0;
+static CupsOptionList *_retain_cups_option_list(CupsOptionList *list)
+{
+    if (list)
+        ffi_atomic_add_u64(&((SharedCupsOptionList *)list)->refs, 1);
+    return list;
+}
 
-    for (int i = 0; i < num_options; i++)
+// --- Persistent Capabilities Cache ---
+
+// Optional on-disk copy of each printer's capabilities (its CUPS options, or
+// its Windows capabilities), so that a restarted app does not have to query
+// every printer again before its UI is usable. Each printer has one file in
+// the directory set with set_capabilities_cache_dir, named by the FNV-1a hash
+// of the printer name. Files are memory-mapped and decoded on first use, and
+// only used if their validator still matches the printer:
+// printer-config-change-time on CUPS, the spooler's ChangeID on Windows.
+//
+// File layout (little-endian): magic, u32 version, u32 kind, i64 validator,
+// u64 payload size, u64 payload FNV-1a hash, then the printer name and the
+// payload. Strings are a u32 length and the bytes; NULL is written as the
+// length CAPS_CACHE_NULL_STRING.
+#define CAPS_CACHE_MAGIC "PFFICAP1"
+#define CAPS_CACHE_VERSION 2
+#define CAPS_CACHE_KIND_CUPS_OPTIONS 1
+#define CAPS_CACHE_KIND_WINDOWS 2
+#define CAPS_CACHE_NULL_STRING 0xFFFFFFFFu
+#define CAPS_CACHE_HEADER_SIZE (8 + 4 + 4 + 8 + 8 + 8)
+
+static ffi_mutex_t s_caps_cache_lock = FFI_MUTEX_INITIALIZER;
+static char *s_caps_cache_dir = NULL;
+
+typedef struct
+{
+    uint8_t *data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} CapsWriter;
+
+static void _caps_put_bytes(CapsWriter *writer, const void *bytes, size_t length)
+{
+    if (writer->failed)
+        return;
+    if (writer->length + length > writer->capacity)
     {
-        if (option_keys && option_keys[i] && option_values && option_values[i])
+        size_t capacity = writer->capacity > 0 ? writer->capacity * 2 : 4096;
+        while (capacity < writer->length + length)
+            capacity *= 2;
+        uint8_t *grown = (uint8_t *)realloc(writer->data, capacity);
+        if (!grown)
         {
-            LOG("Adding CUPS option: %s=%s", option_keys[i], option_values[i]);
-            num_cups_options = cupsAddOption(option_keys[i], option_values[i], num_cups_options, &options);
+            writer->failed = true;
+            return;
         }
+        writer->data = grown;
+        writer->capacity = capacity;
     }
+    memcpy(writer->data + writer->length, bytes, length);
+    writer->length += length;
+}
 
-    int job_id = cupsPrintFile(printer_name, pdf_file_path, doc_name, num_cups_options, options);
-    if (job_id <= 0)
+static void _caps_put(CapsWriter *writer, uint64_t value, int bytes)
+{
+    uint8_t buffer[8];
+    _rec_put(buffer, value, bytes);
+    _caps_put_bytes(writer, buffer, (size_t)bytes);
+}
+
+static void _caps_put_string(CapsWriter *writer, const char *value)
+{
+    if (!value)
     {
-        LOG("cupsPrintFile failed, error: %s", cupsLastErrorString());
+        _caps_put(writer, CAPS_CACHE_NULL_STRING, 4);
+        return;
     }
-    cupsFreeOptions(num_cups_options, options);
-    LOG("print_pdf finished with job_id: %d", job_id);
-    return job_id > 0;
-#endif
+    size_t length = strlen(value);
+    _caps_put(writer, length, 4);
+    _caps_put_bytes(writer, value, length);
 }
 
-FFI_PLUGIN_EXPORT JobList *get_print_jobs(const char *printer_name)
+typedef struct
 {
-    JobList *list = (JobList *)malloc(sizeof(JobList));
-    if (!list)
-        return NULL;
-    list->count = 0;
-    list->jobs = NULL;
+    const uint8_t *cursor;
+    const uint8_t *end;
+    bool ok; // Cleared by a truncated or malformed file, or an allocation failure.
+} CapsReader;
 
-    if (!printer_name)
+static uint64_t _caps_get(CapsReader *reader, int bytes)
+{
+    if (!reader->ok || (size_t)(reader->end - reader->cursor) < (size_t)bytes)
     {
-        LOG("get_print_jobs called with null printer name");
-        return list; // Return empty list
+        reader->ok = false;
+        return 0;
     }
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++)
+        value |= (uint64_t)reader->cursor[i] << (8 * i);
+    reader->cursor += bytes;
+    return value;
+}
 
-    LOG("get_print_jobs called for printer: '%s'", printer_name);
-#ifdef _WIN32
-    HANDLE hPrinter;
-    DWORD needed, returned;
+// Reads an element count, rejecting counts the remaining bytes cannot hold.
+static int _caps_get_count(CapsReader *reader)
+{
+    uint32_t count = (uint32_t)_caps_get(reader, 4);
+    if (count > (size_t)(reader->end - reader->cursor) || count > INT32_MAX)
+    {
+        reader->ok = false;
+        return 0;
+    }
+    return (int)count;
+}
 
-    wchar_t *printer_name_w = to_utf16(printer_name);
-    if (!printer_name_w)
+// Returns a malloc'd copy of the next string, or NULL for a NULL string or on failure.
+static char *_caps_get_string(CapsReader *reader)
+{
+    uint32_t length = (uint32_t)_caps_get(reader, 4);
+    if (!reader->ok || length == CAPS_CACHE_NULL_STRING)
+        return NULL;
+    if ((size_t)(reader->end - reader->cursor) < length)
     {
-        free(list);
+        reader->ok = false;
         return NULL;
     }
-    if (!OpenPrinterW(printer_name_w, &hPrinter, NULL))
+    char *value = (char *)malloc((size_t)length + 1);
+    if (!value)
     {
-        free(list);
-        LOG("OpenPrinterW failed with error %lu", GetLastError());
-        free(printer_name_w);
+        reader->ok = false;
         return NULL;
     }
+    memcpy(value, reader->cursor, length);
+    value[length] = '\0';
+    reader->cursor += length;
+    return value;
+}
 
-    EnumJobsW(hPrinter, 0, 0xFFFFFFFF, 2, NULL, 0, &needed, &returned);
-    if (needed == 0)
-    {
-        ClosePrinter(hPrinter);
-        free(printer_name_w);
-        return list;
-    }
-    BYTE *buffer = (BYTE *)malloc(needed);
-    if (!buffer)
-    {
-        ClosePrinter(hPrinter);
-        free(printer_name_w);
-        free(list);
+// Internal helper that writes the cache file path of `printer_name` into `path`.
+// Returns false if the persistent cache is disabled.
+static bool _caps_cache_path(const char *printer_name, char *path, size_t path_size)
+{
+    ffi_mutex_lock(&s_caps_cache_lock);
+    bool enabled = s_caps_cache_dir != NULL;
+    if (enabled)
+        snprintf(path, path_size, "%s/%016llx.caps", s_caps_cache_dir, (unsigned long long)_fnv1a64((const uint8_t *)printer_name, strlen(printer_name)));
+    ffi_mutex_unlock(&s_caps_cache_lock);
+    return enabled;
+}
+
+// Maps the file at `path` read-only. Returns NULL if it is missing or empty.
+static const uint8_t *_caps_map_file(const char *path, size_t *size)
+{
+#ifdef _WIN32
+    wchar_t *path_w = to_utf16(path);
+    if (!path_w)
+        return NULL;
+    HANDLE file = CreateFileW(path_w, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    free(path_w);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+    LARGE_INTEGER file_size;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0 && (uint64_t)file_size.QuadPart <= SIZE_MAX)
+        mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping)
+        return NULL;
+    const uint8_t *data = (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping); // The view keeps the mapping alive.
+    if (!data)
+        return NULL;
+    *size = (size_t)file_size.QuadPart;
+    return data;
+#else // macOS, Linux
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping outlives the descriptor.
+    if (data == MAP_FAILED)
+        return NULL;
+    *size = (size_t)st.st_size;
+    return (const uint8_t *)data;
+#endif
+}
+
+static void _caps_unmap_file(const uint8_t *data, size_t size)
+{
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(data);
+#else // macOS, Linux
+    munmap((void *)data, size);
+#endif
+}
+
+// Maps the cache file of `printer_name` and checks its header, name and
+// checksum. On success `reader` covers the payload, `*validator` holds the
+// stored validator, and the returned mapping must be released with
+// _caps_unmap_file(mapping, *mapping_size).
+static const uint8_t *_caps_cache_open(const char *printer_name, uint32_t kind, CapsReader *reader, int64_t *validator, size_t *mapping_size)
+{
+    char path[1024];
+    if (!_caps_cache_path(printer_name, path, sizeof(path)))
+        return NULL;
+    size_t size = 0;
+    const uint8_t *data = _caps_map_file(path, &size);
+    if (!data)
+        return NULL;
+
+    CapsReader header = {data, data + size, size >= CAPS_CACHE_HEADER_SIZE && memcmp(data, CAPS_CACHE_MAGIC, 8) == 0};
+    header.cursor += header.ok ? 8 : 0;
+    uint32_t version = (uint32_t)_caps_get(&header, 4);
+    uint32_t file_kind = (uint32_t)_caps_get(&header, 4);
+    int64_t stored_validator = (int64_t)_caps_get(&header, 8);
+    uint64_t payload_size = _caps_get(&header, 8);
+    uint64_t payload_hash = _caps_get(&header, 8);
+    uint32_t name_length = (uint32_t)_caps_get(&header, 4);
+    bool valid = header.ok && version == CAPS_CACHE_VERSION && file_kind == kind &&
+                 name_length == strlen(printer_name) && (size_t)(header.end - header.cursor) >= name_length &&
+                 memcmp(header.cursor, printer_name, name_length) == 0;
+    if (valid)
+    {
+        header.cursor += name_length;
+        valid = (uint64_t)(header.end - header.cursor) == payload_size &&
+                _fnv1a64(header.cursor, (size_t)payload_size) == payload_hash;
+    }
+    if (!valid)
+    {
+        LOG_WARN("Ignoring unusable capabilities cache file '%s'", path);
+        _caps_unmap_file(data, size);
         return NULL;
     }
 
-    if (EnumJobsW(hPrinter, 0, 0xFFFFFFFF, 2, buffer, needed, &needed, &returned))
+    *reader = header;
+    *validator = stored_validator;
+    *mapping_size = size;
+    return data;
+}
+
+// Writes `payload` as the cache file of `printer_name`. The file is written
+// under a temporary name and renamed into place, so readers in this or
+// another process never map a partial file.
+static void _caps_cache_write(const char *printer_name, uint32_t kind, int64_t validator, const CapsWriter *payload)
+{
+    char path[1024];
+    if (payload->failed || !_caps_cache_path(printer_name, path, sizeof(path)))
+        return;
+
+    CapsWriter file = {0};
+    _caps_put_bytes(&file, CAPS_CACHE_MAGIC, 8);
+    _caps_put(&file, CAPS_CACHE_VERSION, 4);
+    _caps_put(&file, kind, 4);
+    _caps_put(&file, (uint64_t)validator, 8);
+    _caps_put(&file, payload->length, 8);
+    _caps_put(&file, _fnv1a64(payload->data, payload->length), 8);
+    _caps_put_string(&file, printer_name);
+    _caps_put_bytes(&file, payload->data, payload->length);
+    if (file.failed)
+    {
+        free(file.data);
+        return;
+    }
+
+    char temp_path[1100];
+    bool written = false;
+#ifdef _WIN32
+    snprintf(temp_path, sizeof(temp_path), "%s.%lu.tmp", path, GetCurrentProcessId());
+    wchar_t *temp_path_w = to_utf16(temp_path);
+    wchar_t *path_w = to_utf16(path);
+    if (temp_path_w && path_w)
     {
-        LOG("Found %lu jobs on Windows", returned);
-        list->count = (int)returned;
-        list->jobs = (JobInfo *)malloc(returned * sizeof(JobInfo));
-        if (!list->jobs)
+        HANDLE handle = CreateFileW(temp_path_w, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (handle != INVALID_HANDLE_VALUE)
         {
-            free(buffer);
-            ClosePrinter(hPrinter);
-            free(printer_name_w);
-            free(list);
-            return NULL;
+            DWORD done = 0;
+            written = WriteFile(handle, file.data, (DWORD)file.length, &done, NULL) && done == file.length;
+            CloseHandle(handle);
+            written = written && MoveFileExW(temp_path_w, path_w, MOVEFILE_REPLACE_EXISTING);
+            if (!written)
+                DeleteFileW(temp_path_w);
         }
-        JOB_INFO_2W *jobs = (JOB_INFO_2W *)buffer;
-        for (DWORD i = 0; i < returned; i++)
+    }
+    free(temp_path_w);
+    free(path_w);
+#else // macOS, Linux
+    snprintf(temp_path, sizeof(temp_path), "%s.%ld.tmp", path, (long)getpid());
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd >= 0)
+    {
+        size_t done = 0;
+        while (done < file.length)
         {
-            list->jobs[i].id = jobs[i].JobId;
-            list->jobs[i].title = to_utf8(jobs[i].pDocument);
-            list->jobs[i].status = (int)jobs[i].Status;
+            ssize_t n = write(fd, file.data + done, file.length - done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            done += (size_t)n;
         }
+        written = close(fd) == 0 && done == file.length;
+        written = written && rename(temp_path, path) == 0;
+        if (!written)
+            unlink(temp_path);
     }
+#endif
+    if (written)
+        LOG("Wrote capabilities cache file '%s' (%llu bytes)", path, (unsigned long long)file.length);
     else
-    {
-        LOG("EnumJobsW failed with error %lu", GetLastError());
+        LOG_WARN("Failed to write capabilities cache file '%s'", path);
+    free(file.data);
+}
+
+#ifndef _WIN32
+// Persists the CUPS options of `printer_name` with their printer-config-change-time.
+static void _caps_cache_store_cups_options(const char *printer_name, const CupsOptionList *list, time_t config_change_time)
+{
+    CapsWriter payload = {0};
+    _caps_put(&payload, (uint64_t)list->count, 4);
+    for (int i = 0; i < list->count; i++)
+    {
+        const CupsOption *option = &list->options[i];
+        _caps_put_string(&payload, option->name);
+        _caps_put_string(&payload, option->default_value);
+        _caps_put(&payload, (uint64_t)option->supported_values.count, 4);
+        for (int j = 0; j < option->supported_values.count; j++)
+        {
+            _caps_put_string(&payload, option->supported_values.choices[j].choice);
+            _caps_put_string(&payload, option->supported_values.choices[j].text);
+        }
     }
-    free(buffer);
-    free(printer_name_w);
-    ClosePrinter(hPrinter);
-    return list;
-#else // macOS / Linux
-    cups_job_t *jobs;
-    LOG("Calling cupsGetJobs for active jobs");
-    int num_jobs = cupsGetJobs(&jobs, printer_name, 1, CUPS_WHICHJOBS_ACTIVE);
-    if (num_jobs <= 0)
+    const OptionConstraints *constraints = ((const SharedCupsOptionList *)list)->constraints;
+    _caps_put(&payload, constraints ? (uint64_t)constraints->count : 0, 4);
+    if (constraints)
     {
-        cupsFreeJobs(num_jobs, jobs);
-        return list;
+        _caps_put(&payload, (uint64_t)constraints->num_words, 4);
+        for (int i = 0; i < constraints->count; i++)
+        {
+            _caps_put_string(&payload, constraints->names[i]);
+            _caps_put(&payload, constraints->arity[i], 1);
+            for (int w = 0; w < constraints->num_words; w++)
+                _caps_put(&payload, constraints->sets[(size_t)i * constraints->num_words + w], 8);
+        }
     }
+    _caps_cache_write(printer_name, CAPS_CACHE_KIND_CUPS_OPTIONS, (int64_t)config_change_time, &payload);
+    free(payload.data);
+}
 
-    LOG("Found %d active jobs on CUPS-based system", num_jobs);
-    list->count = num_jobs;
-    list->jobs = (JobInfo *)malloc(num_jobs * sizeof(JobInfo));
-    if (!list->jobs)
-    {
-        cupsFreeJobs(num_jobs, jobs);
-        free(list);
+// Loads the persisted CUPS options of `printer_name`, which the caller must
+// still validate against `*config_change_time`. Returns NULL if there are none.
+static CupsOptionList *_caps_cache_load_cups_options(const char *printer_name, time_t *config_change_time)
+{
+    CapsReader reader;
+    int64_t validator = 0;
+    size_t mapping_size = 0;
+    const uint8_t *mapping = _caps_cache_open(printer_name, CAPS_CACHE_KIND_CUPS_OPTIONS, &reader, &validator, &mapping_size);
+    if (!mapping)
         return NULL;
-    }
 
-    for (int i = 0; i < num_jobs; i++)
+    CupsOptionList *list = _alloc_cups_option_list();
+    int count = _caps_get_count(&reader);
+    if (list && count > 0)
     {
-        list->jobs[i].id = (uint32_t)jobs[i].id;
-        list->jobs[i].title = strdup(jobs[i].title ? jobs[i].title : "Unknown");
-        list->jobs[i].status = jobs[i].state;
+        list->options = (CupsOption *)calloc((size_t)count, sizeof(CupsOption));
+        reader.ok = reader.ok && list->options;
     }
-    cupsFreeJobs(num_jobs, jobs);
-    return list;
-#endif
-}
-
-FFI_PLUGIN_EXPORT void free_job_list(JobList *job_list)
-{
-    if (!job_list)
-        return;
-    if (job_list->jobs)
+    for (int i = 0; list && reader.ok && i < count; i++)
     {
-        for (int i = 0; i < job_list->count; i++)
+        CupsOption *option = &list->options[list->count++];
+        option->name = _caps_get_string(&reader);
+        option->default_value = _caps_get_string(&reader);
+        int choices = _caps_get_count(&reader);
+        if (choices == 0)
+            continue;
+        option->supported_values.choices = (CupsOptionChoice *)calloc((size_t)choices, sizeof(CupsOptionChoice));
+        reader.ok = reader.ok && option->supported_values.choices;
+        for (int j = 0; reader.ok && j < choices; j++)
         {
-            free(job_list->jobs[i].title);
+            CupsOptionChoice *choice = &option->supported_values.choices[option->supported_values.count++];
+            choice->choice = _caps_get_string(&reader);
+            choice->text = _caps_get_string(&reader);
         }
-        free(job_list->jobs);
     }
-    free(job_list);
+    int num_constraints = _caps_get_count(&reader);
+    if (list && reader.ok && num_constraints > 0)
+    {
+        OptionConstraints *constraints = (OptionConstraints *)calloc(1, sizeof(OptionConstraints));
+        ((SharedCupsOptionList *)list)->constraints = constraints;
+        int num_words = _caps_get_count(&reader);
+        int bits = _option_bit_base(list, list->count);
+        reader.ok = reader.ok && constraints && num_words == (bits > 0 ? (bits + 63) / 64 : 1);
+        if (reader.ok)
+        {
+            constraints->num_words = num_words;
+            constraints->sets = (uint64_t *)calloc((size_t)num_constraints * num_words, sizeof(uint64_t));
+            constraints->arity = (uint8_t *)calloc((size_t)num_constraints, sizeof(uint8_t));
+            constraints->names = (char **)calloc((size_t)num_constraints, sizeof(char *));
+            reader.ok = constraints->sets && constraints->arity && constraints->names;
+        }
+        for (int i = 0; reader.ok && i < num_constraints; i++)
+        {
+            constraints->names[constraints->count++] = _caps_get_string(&reader);
+            constraints->arity[i] = (uint8_t)_caps_get(&reader, 1);
+            for (int w = 0; w < num_words; w++)
+                constraints->sets[(size_t)i * num_words + w] = _caps_get(&reader, 8);
+        }
+    }
+    _caps_unmap_file(mapping, mapping_size);
+    if (!list || !reader.ok)
+    {
+        free_cups_option_list(list);
+        return NULL;
+    }
+    *config_change_time = (time_t)validator;
+    LOG("Loaded %d persisted options for '%s'", list->count, printer_name);
+    return list;
 }
-
-FFI_PLUGIN_EXPORT int open_printer_properties(const char *printer_name, intptr_t hwnd)
+#else
+// Windows capabilities are also kept in memory, encoded as they are on disk,
+// so that repeated and prefetched lookups skip DeviceCapabilities.
+typedef struct
 {
-    LOG("open_printer_properties called for printer: '%s'", printer_name);
-#ifdef _WIN32
-    if (!printer_name)
-    {
-        LOG("Printer name is null");
-        return 0; // Error
+    char *printer_name;
+    DWORD change_id;
+    uint8_t *data;
+    size_t length;
+} WindowsCapsCacheEntry;
+
+static ffi_mutex_t s_windows_caps_lock = FFI_MUTEX_INITIALIZER;
+static WindowsCapsCacheEntry *s_windows_caps = NULL;
+static int s_windows_caps_count = 0;
+static int s_windows_caps_capacity = 0;
+
+static void _caps_encode_windows(CapsWriter *payload, const WindowsPrinterCapabilities *caps)
+{
+    _caps_put(payload, caps->is_color_supported, 1);
+    _caps_put(payload, caps->is_monochrome_supported, 1);
+    _caps_put(payload, caps->supports_landscape, 1);
+    int sizes_count = caps->paper_sizes.papers ? caps->paper_sizes.count : 0;
+    _caps_put(payload, (uint64_t)sizes_count, 4);
+    for (int i = 0; i < sizes_count; i++)
+    {
+        const PaperSize *paper = &caps->paper_sizes.papers[i];
+        uint32_t width_bits, height_bits;
+        memcpy(&width_bits, &paper->width_mm, 4);
+        memcpy(&height_bits, &paper->height_mm, 4);
+        _caps_put(payload, (uint16_t)paper->id, 2);
+        _caps_put(payload, width_bits, 4);
+        _caps_put(payload, height_bits, 4);
+        _caps_put_string(payload, paper->name);
+    }
+    int sources_count = caps->paper_sources.sources ? caps->paper_sources.count : 0;
+    _caps_put(payload, (uint64_t)sources_count, 4);
+    for (int i = 0; i < sources_count; i++)
+    {
+        _caps_put(payload, (uint16_t)caps->paper_sources.sources[i].id, 2);
+        _caps_put_string(payload, caps->paper_sources.sources[i].name);
+    }
+    int resolutions_count = caps->resolutions.resolutions ? caps->resolutions.count : 0;
+    _caps_put(payload, (uint64_t)resolutions_count, 4);
+    for (int i = 0; i < resolutions_count; i++)
+    {
+        _caps_put(payload, (uint32_t)caps->resolutions.resolutions[i].x_dpi, 4);
+        _caps_put(payload, (uint32_t)caps->resolutions.resolutions[i].y_dpi, 4);
+    }
+    int types_count = caps->media_types.types ? caps->media_types.count : 0;
+    _caps_put(payload, (uint64_t)types_count, 4);
+    for (int i = 0; i < types_count; i++)
+    {
+        _caps_put(payload, (uint16_t)caps->media_types.types[i].id, 2);
+        _caps_put_string(payload, caps->media_types.types[i].name);
     }
+}
 
-    wchar_t *printer_name_w = to_utf16(printer_name);
-    if (!printer_name_w)
+// Decodes capabilities written by _caps_encode_windows. Returns NULL if the
+// payload is malformed or memory runs out.
+static WindowsPrinterCapabilities *_caps_decode_windows(CapsReader *reader)
+{
+    WindowsPrinterCapabilities *caps = (WindowsPrinterCapabilities *)calloc(1, sizeof(WindowsPrinterCapabilities));
+    if (!caps)
+        return NULL;
+    caps->is_color_supported = _caps_get(reader, 1) != 0;
+    caps->is_monochrome_supported = _caps_get(reader, 1) != 0;
+    caps->supports_landscape = _caps_get(reader, 1) != 0;
+
+    int count = _caps_get_count(reader);
+    if (reader->ok && count > 0)
     {
-        LOG("Failed to convert printer name to UTF-16");
-        return 0; // Error
+        caps->paper_sizes.papers = (PaperSize *)calloc((size_t)count, sizeof(PaperSize));
+        reader->ok = caps->paper_sizes.papers != NULL;
     }
-
-    HANDLE hPrinter;
-    PRINTER_DEFAULTSW printerDefaults = {NULL, NULL, PRINTER_ALL_ACCESS};
-    if (!OpenPrinterW(printer_name_w, &hPrinter, &printerDefaults))
+    for (int i = 0; reader->ok && i < count; i++)
     {
-        LOG("OpenPrinterW failed with error %lu", GetLastError());
-        free(printer_name_w);
-        return 0; // Error
+        PaperSize *paper = &caps->paper_sizes.papers[caps->paper_sizes.count++];
+        paper->id = (short)_caps_get(reader, 2);
+        uint32_t width_bits = (uint32_t)_caps_get(reader, 4);
+        uint32_t height_bits = (uint32_t)_caps_get(reader, 4);
+        memcpy(&paper->width_mm, &width_bits, 4);
+        memcpy(&paper->height_mm, &height_bits, 4);
+        paper->name = _caps_get_string(reader);
     }
 
-    // The modern and recommended way to show the printer properties dialog is
-    // by using DocumentProperties with the DM_PROMPT flag.
-
-    // First, get the size of the DEVMODE structure for the printer.
-    LONG devModeSize = DocumentPropertiesW(NULL, hPrinter, printer_name_w, NULL, NULL, 0);
-    if (devModeSize <= 0)
+    count = _caps_get_count(reader);
+    if (reader->ok && count > 0)
     {
-        LOG("DocumentProperties (get size) failed with error %lu", GetLastError());
-        ClosePrinter(hPrinter);
-        free(printer_name_w);
-        return 0; // Error
+        caps->paper_sources.sources = (PaperSource *)calloc((size_t)count, sizeof(PaperSource));
+        reader->ok = caps->paper_sources.sources != NULL;
     }
-
-    DEVMODEW *pDevMode = (DEVMODEW *)malloc(devModeSize);
-    if (!pDevMode)
+    for (int i = 0; reader->ok && i < count; i++)
     {
-        LOG("Failed to allocate memory for DEVMODE structure.");
-        ClosePrinter(hPrinter);
-        free(printer_name_w);
-        return 0; // Error
+        PaperSource *source = &caps->paper_sources.sources[caps->paper_sources.count++];
+        source->id = (short)_caps_get(reader, 2);
+        source->name = _caps_get_string(reader);
     }
 
-    // Get the current printer settings to populate the dialog.
-    if (DocumentPropertiesW(NULL, hPrinter, printer_name_w, pDevMode, NULL, DM_OUT_BUFFER) != IDOK)
+    count = _caps_get_count(reader);
+    if (reader->ok && count > 0)
     {
-        LOG("DocumentProperties (get defaults) failed with error %lu", GetLastError());
-        free(pDevMode);
-        ClosePrinter(hPrinter);
-        free(printer_name_w);
-        return 0; // Error
+        caps->resolutions.resolutions = (Resolution *)calloc((size_t)count, sizeof(Resolution));
+        reader->ok = caps->resolutions.resolutions != NULL;
     }
-
-    // Display the properties dialog. The user's changes will be written back to pDevMode.
-    LONG result = DocumentPropertiesW((HWND)hwnd, hPrinter, printer_name_w, pDevMode, pDevMode, DM_IN_BUFFER | DM_OUT_BUFFER | DM_PROMPT);
-
-    int return_status = 0; // Default to error
-
-    if (result == IDOK)
+    for (int i = 0; reader->ok && i < count; i++)
     {
-        LOG("Printer properties dialog closed with OK. Applying changes to printer defaults.");
-
-        // To apply the changes, we need to use SetPrinter with PRINTER_INFO_2.
-        DWORD needed = 0;
-        // Get the size needed for PRINTER_INFO_2
-        GetPrinterW(hPrinter, 2, NULL, 0, &needed);
-        if (needed > 0)
-        {
-            PRINTER_INFO_2W *pinfo2 = (PRINTER_INFO_2W *)malloc(needed);
-            if (pinfo2)
-            {
-                // Get the current printer info
-                if (GetPrinterW(hPrinter, 2, (LPBYTE)pinfo2, needed, &needed))
-                {
-                    // Update the DEVMODE pointer in the PRINTER_INFO_2 struct with the user's changes.
-                    pinfo2->pDevMode = pDevMode;
-                    // Security descriptor must be NULL for SetPrinter.
-                    pinfo2->pSecurityDescriptor = NULL;
-
-                    // Apply the changes to the printer's defaults.
-                    if (!SetPrinterW(hPrinter, 2, (LPBYTE)pinfo2, 0))
-                    {
-                        LOG("SetPrinterW failed with error %lu", GetLastError());
-                    }
-                    else
-                    {
-                        LOG("SetPrinterW succeeded. Broadcasting change.");
-                        SendMessageTimeout(HWND_BROADCAST, WM_WININICHANGE, 0, (LPARAM)L"windows", SMTO_NORMAL, 1000, NULL);
-                    }
-                }
-                free(pinfo2);
-            }
-        }
-        return_status = 1; // OK
+        Resolution *resolution = &caps->resolutions.resolutions[caps->resolutions.count++];
+        resolution->x_dpi = (long)(int32_t)_caps_get(reader, 4);
+        resolution->y_dpi = (long)(int32_t)_caps_get(reader, 4);
     }
-    else if (result == IDCANCEL)
+
+    count = _caps_get_count(reader);
+    if (reader->ok && count > 0)
     {
-        LOG("Printer properties dialog was cancelled.");
-        return_status = 2; // Cancel
+        caps->media_types.types = (MediaType *)calloc((size_t)count, sizeof(MediaType));
+        reader->ok = caps->media_types.types != NULL;
     }
-    else
+    for (int i = 0; reader->ok && i < count; i++)
     {
-        LOG("DocumentProperties (prompt) failed with result: %ld, error: %lu", result, GetLastError());
-        return_status = 0; // Error
+        MediaType *type = &caps->media_types.types[caps->media_types.count++];
+        type->id = (short)_caps_get(reader, 2);
+        type->name = _caps_get_string(reader);
     }
 
-    free(pDevMode);
-    ClosePrinter(hPrinter);
-    free(printer_name_w);
-    return return_status;
-#else
-    (void)hwnd; // hwnd is Windows-specific
-    if (!printer_name)
+    if (!reader->ok)
     {
-        LOG("Printer name is null");
-        return 0; // Error
+        free_windows_printer_capabilities(caps);
+        return NULL;
     }
-    char command[PATH_MAX];
-    snprintf(command, sizeof(command),
-#ifdef __APPLE__
-             "open http://localhost:631/printers/\"%s\"",
-#else // Linux
-             "xdg-open http://localhost:631/printers/\"%s\"",
-#endif
-             printer_name);
-    LOG("Executing command: %s", command);
-    int cmd_result = system(command);
-    if (cmd_result != 0)
+    return caps;
+}
+
+// Keeps the encoded capabilities of `printer_name` in memory, taking ownership of `data`.
+static void _windows_caps_remember(const char *printer_name, DWORD change_id, uint8_t *data, size_t length)
+{
+    ffi_mutex_lock(&s_windows_caps_lock);
+    WindowsCapsCacheEntry *entry = NULL;
+    for (int i = 0; i < s_windows_caps_count; i++)
     {
-        LOG("Command '%s' failed with exit code %d", command, cmd_result);
-        return 0; // Error
+        if (strcmp(s_windows_caps[i].printer_name, printer_name) == 0)
+        {
+            entry = &s_windows_caps[i];
+            break;
+        }
     }
-    return 1; // Dispatched
-#endif
+    if (!entry)
+    {
+        char *name_copy = NULL;
+        if (s_windows_caps_count == s_windows_caps_capacity)
+        {
+            int new_capacity = s_windows_caps_capacity > 0 ? s_windows_caps_capacity * 2 : 8;
+            WindowsCapsCacheEntry *grown = (WindowsCapsCacheEntry *)realloc(s_windows_caps, new_capacity * sizeof(WindowsCapsCacheEntry));
+            if (grown)
+            {
+                s_windows_caps = grown;
+                s_windows_caps_capacity = new_capacity;
+            }
+        }
+        if (s_windows_caps_count < s_windows_caps_capacity)
+            name_copy = strdup(printer_name);
+        if (!name_copy)
+        {
+            ffi_mutex_unlock(&s_windows_caps_lock);
+            free(data);
+            return;
+        }
+        entry = &s_windows_caps[s_windows_caps_count++];
+        entry->printer_name = name_copy;
+        entry->data = NULL;
+    }
+    free(entry->data);
+    entry->change_id = change_id;
+    entry->data = data;
+    entry->length = length;
+    ffi_mutex_unlock(&s_windows_caps_lock);
 }
 
-FFI_PLUGIN_EXPORT bool pause_print_job(const char *printer_name, uint32_t job_id)
+// Caches the capabilities of `printer_name` with the spooler's ChangeID, in
+// memory and, if enabled, on disk.
+static void _caps_cache_store_windows(const char *printer_name, const WindowsPrinterCapabilities *caps, DWORD change_id)
 {
-    if (!printer_name)
+    CapsWriter payload = {0};
+    _caps_encode_windows(&payload, caps);
+    if (payload.failed)
     {
-        LOG("pause_print_job called with null printer name");
-        return false;
+        free(payload.data);
+        return;
     }
+    _caps_cache_write(printer_name, CAPS_CACHE_KIND_WINDOWS, (int64_t)change_id, &payload);
+    _windows_caps_remember(printer_name, change_id, payload.data, payload.length);
+}
 
-    LOG("pause_print_job called for printer: '%s', job_id: %u", printer_name, job_id);
-#ifdef _WIN32
-    HANDLE hPrinter;
-    wchar_t *printer_name_w = to_utf16(printer_name);
-    if (!printer_name_w)
-        return false;
-    if (!OpenPrinterW(printer_name_w, &hPrinter, NULL))
-    {
-        free(printer_name_w);
-        return false;
+// Loads the capabilities of `printer_name` cached with `change_id`, from
+// memory or else from disk. Returns NULL if there are none.
+static WindowsPrinterCapabilities *_caps_cache_load_windows(const char *printer_name, DWORD change_id)
+{
+    ffi_mutex_lock(&s_windows_caps_lock);
+    for (int i = 0; i < s_windows_caps_count; i++)
+    {
+        WindowsCapsCacheEntry *entry = &s_windows_caps[i];
+        if (strcmp(entry->printer_name, printer_name) != 0)
+            continue;
+        WindowsPrinterCapabilities *caps = NULL;
+        if (entry->change_id == change_id)
+        {
+            CapsReader reader = {entry->data, entry->data + entry->length, true};
+            caps = _caps_decode_windows(&reader);
+        }
+        ffi_mutex_unlock(&s_windows_caps_lock);
+        if (caps)
+            LOG("Served capabilities for '%s' from memory", printer_name);
+        return caps;
     }
-    free(printer_name_w);
+    ffi_mutex_unlock(&s_windows_caps_lock);
 
-    bool result = SetJobW(hPrinter, job_id, 0, NULL, JOB_CONTROL_PAUSE);
-    if (!result)
-        LOG("SetJobW(PAUSE) failed with error %lu", GetLastError());
-    ClosePrinter(hPrinter);
-    return result;
-#else
-    bool result = cupsCancelJob2(CUPS_HTTP_DEFAULT, printer_name, (int)job_id, IPP_HOLD_JOB) == 1;
-    if (!result)
-        LOG("cupsCancelJob2(IPP_HOLD_JOB) failed, error: %s", cupsLastErrorString());
-    return result;
-#endif
+    CapsReader reader;
+    int64_t validator = 0;
+    size_t mapping_size = 0;
+    const uint8_t *mapping = _caps_cache_open(printer_name, CAPS_CACHE_KIND_WINDOWS, &reader, &validator, &mapping_size);
+    if (!mapping)
+        return NULL;
+    WindowsPrinterCapabilities *caps = NULL;
+    if (validator == (int64_t)change_id)
+    {
+        size_t length = (size_t)(reader.end - reader.cursor);
+        uint8_t *copy = (uint8_t *)malloc(length > 0 ? length : 1);
+        if (copy)
+            memcpy(copy, reader.cursor, length);
+        caps = _caps_decode_windows(&reader);
+        if (caps && copy)
+            _windows_caps_remember(printer_name, change_id, copy, length);
+        else
+            free(copy);
+    }
+    _caps_unmap_file(mapping, mapping_size);
+    if (caps)
+        LOG("Loaded persisted capabilities for '%s'", printer_name);
+    return caps;
 }
 
-FFI_PLUGIN_EXPORT bool resume_print_job(const char *printer_name, uint32_t job_id)
+// Internal helper that reads the spooler's ChangeID of an open printer, which
+// changes whenever the printer or its driver is reconfigured.
+static bool _windows_printer_change_id(HANDLE printer, DWORD *change_id)
 {
-    if (!printer_name)
+    DWORD type = 0;
+    DWORD needed = 0;
+    return GetPrinterDataW(printer, L"ChangeID", &type, (LPBYTE)change_id, sizeof(DWORD), &needed) == ERROR_SUCCESS && type == REG_DWORD;
+}
+#endif
+
+// Enables the persistent capabilities cache in `directory`, creating it if
+// needed, or disables it when `directory` is NULL. Files are only read and
+// written by get_supported_cups_options and get_windows_printer_capabilities.
+FFI_PLUGIN_EXPORT bool set_capabilities_cache_dir(const char *directory)
+{
+    char *copy = NULL;
+    if (directory)
     {
-        LOG("resume_print_job called with null printer name");
-        return false;
+#ifdef _WIN32
+        wchar_t *directory_w = to_utf16(directory);
+        bool created = directory_w && (CreateDirectoryW(directory_w, NULL) || GetLastError() == ERROR_ALREADY_EXISTS);
+        free(directory_w);
+#else // macOS, Linux
+        bool created = mkdir(directory, 0700) == 0 || errno == EEXIST;
+#endif
+        if (!created)
+        {
+            set_last_error("Failed to create capabilities cache directory '%s'.", directory);
+            return false;
+        }
+        copy = strdup(directory);
+        if (!copy)
+        {
+            set_last_error("Out of memory.");
+            return false;
+        }
     }
 
-    LOG("resume_print_job called for printer: '%s', job_id: %u", printer_name, job_id);
-#ifdef _WIN32
-    HANDLE hPrinter;
-    wchar_t *printer_name_w = to_utf16(printer_name);
-    if (!printer_name_w)
-        return false;
-    if (!OpenPrinterW(printer_name_w, &hPrinter, NULL))
-    {
-        free(printer_name_w);
-        return false;
+    ffi_mutex_lock(&s_caps_cache_lock);
+    free(s_caps_cache_dir);
+    s_caps_cache_dir = copy;
+    ffi_mutex_unlock(&s_caps_cache_lock);
+    if (directory)
+        LOG_INFO("Persistent capabilities cache enabled in '%s'", directory);
+    else
+        LOG_INFO("Persistent capabilities cache disabled");
+    return true;
+}
+
+#ifndef _WIN32
+// IPP attributes that become options, named as they are passed back to
+// cupsAddOption. Each is requested as "<name>-supported" and "<name>-default".
+static const char *const s_capability_options[] = {
+    "media",
+    "media-source",
+    "media-type",
+    "sides",
+    "print-color-mode",
+    "print-quality",
+    "printer-resolution",
+    "finishings",
+    "output-bin",
+};
+#define CAPABILITY_OPTION_COUNT ((int)(sizeof(s_capability_options) / sizeof(s_capability_options[0])))
+
+static ipp_t *_new_printer_attributes_request(const char *printer_uri, int num_requested, const char *const *requested)
+{
+    ipp_t *request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, printer_uri);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsUser());
+    ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", num_requested, NULL, requested);
+    return request;
+}
+
+// Internal helper that sends Get-Printer-Attributes to a destination without
+// a local queue: a driverless (IPP Everywhere) printer that cupsGetDests
+// discovered but the scheduler has not created a queue for yet. The request
+// goes straight to the printer through cupsConnectDest.
+static ipp_t *_get_device_attributes(const char *printer_name, int num_requested, const char *const *requested)
+{
+    cups_dest_t *dest = cupsGetNamedDest(CUPS_HTTP_DEFAULT, printer_name, NULL);
+    const char *uri = dest ? cupsGetOption("printer-uri-supported", dest->num_options, dest->options) : NULL;
+    char resource[HTTP_MAX_URI];
+    http_t *http = uri ? cupsConnectDest(dest, CUPS_DEST_FLAGS_DEVICE, 30000, NULL, resource, sizeof(resource), NULL, NULL) : NULL;
+    ipp_t *response = NULL;
+    if (http)
+    {
+        LOG("Querying '%s' directly at '%s'", printer_name, uri);
+        response = _ipp_do_request(http, _new_printer_attributes_request(uri, num_requested, requested), resource);
+        httpClose(http);
+    }
+    cupsFreeDests(dest ? 1 : 0, dest);
+    return response;
+}
+
+// Internal helper that sends Get-Printer-Attributes for `printer_name`, asking
+// only for the `requested` attributes. Local queues are asked through the
+// scheduler; destinations it has no queue for are asked directly. Returns
+// NULL if the request fails.
+static ipp_t *_get_printer_attributes(const char *printer_name, int num_requested, const char *const *requested)
+{
+    char printer_uri[HTTP_MAX_URI];
+    _local_printer_uri(printer_name, printer_uri, sizeof(printer_uri));
+
+    TraceSpan span;
+    _trace_begin(&span, "Get-Printer-Attributes");
+    _trace_arg_str(&span, "printer", printer_name);
+    _trace_arg_int(&span, "attributes", num_requested);
+    uint64_t started = _monotonic_ns();
+    ipp_t *response = _ipp_do_request(CUPS_HTTP_DEFAULT, _new_printer_attributes_request(printer_uri, num_requested, requested), "/");
+    if (cupsLastError() == IPP_STATUS_ERROR_NOT_FOUND)
+    {
+        ippDelete(response);
+        response = _get_device_attributes(printer_name, num_requested, requested);
+    }
+    bool ok = response && cupsLastError() <= IPP_STATUS_OK_CONFLICTING;
+    _metrics_record(METRIC_OP_CAPABILITIES, started, ok);
+    _trace_end(&span);
+    if (!ok)
+    {
+        LOG_WARN("Get-Printer-Attributes failed for '%s', error: %s", printer_name, cupsLastErrorString());
+        ippDelete(response);
+        return NULL;
     }
-    free(printer_name_w);
+    return response;
+}
 
-    bool result = SetJobW(hPrinter, job_id, 0, NULL, JOB_CONTROL_RESUME);
-    if (!result)
-        LOG("SetJobW(RESUME) failed with error %lu", GetLastError());
-    ClosePrinter(hPrinter);
-    return result;
-#else
-    bool result = cupsCancelJob2(CUPS_HTTP_DEFAULT, printer_name, (int)job_id, IPP_RELEASE_JOB) == 1;
-    if (!result)
-        LOG("cupsCancelJob2(IPP_RELEASE_JOB) failed, error: %s", cupsLastErrorString());
-    return result;
-#endif
+// Internal helper that returns the printer-config-change-time of `printer_name`,
+// or 0 if the scheduler does not report it.
+static time_t _printer_config_change_time(const char *printer_name)
+{
+    static const char *const requested[] = {"printer-config-change-time"};
+    ipp_t *response = _get_printer_attributes(printer_name, 1, requested);
+    if (!response)
+        return 0;
+    time_t change_time = (time_t)ippGetInteger(ippFindAttribute(response, "printer-config-change-time", IPP_TAG_INTEGER), 0);
+    ippDelete(response);
+    return change_time;
 }
 
-FFI_PLUGIN_EXPORT bool cancel_print_job(const char *printer_name, uint32_t job_id)
+// Internal helper that formats value `index` of a capability attribute as an
+// option value and a display text. Enums are passed as their number and shown
+// by keyword, resolutions are written the way cupsAddOption parses them.
+static void _capability_value(const char *option, ipp_attribute_t *attr, int index, char *value, size_t value_size, char *text, size_t text_size)
 {
-    if (!printer_name)
+    switch (ippGetValueTag(attr))
     {
-        LOG("cancel_print_job called with null printer name");
-        return false;
+    case IPP_TAG_ENUM:
+    {
+        int number = ippGetInteger(attr, index);
+        snprintf(value, value_size, "%d", number);
+        snprintf(text, text_size, "%s", ippEnumString(option, number));
+        return;
     }
-
-    LOG("cancel_print_job called for printer: '%s', job_id: %u", printer_name, job_id);
-#ifdef _WIN32
-    HANDLE hPrinter;
-    wchar_t *printer_name_w = to_utf16(printer_name);
-    if (!printer_name_w)
-        return false;
-    if (!OpenPrinterW(printer_name_w, &hPrinter, NULL))
+    case IPP_TAG_INTEGER:
+        snprintf(value, value_size, "%d", ippGetInteger(attr, index));
+        break;
+    case IPP_TAG_RESOLUTION:
+    {
+        int yres = 0;
+        ipp_res_t units = IPP_RES_PER_INCH;
+        int xres = ippGetResolution(attr, index, &yres, &units);
+        const char *suffix = units == IPP_RES_PER_CM ? "dpcm" : "dpi";
+        if (xres == yres)
+            snprintf(value, value_size, "%d%s", xres, suffix);
+        else
+            snprintf(value, value_size, "%dx%d%s", xres, yres, suffix);
+        break;
+    }
+    default:
     {
-        free(printer_name_w);
-        return false;
+        const char *string = ippGetString(attr, index, NULL);
+        snprintf(value, value_size, "%s", string ? string : "");
+        break;
     }
-    free(printer_name_w);
-
-    bool result = SetJobW(hPrinter, job_id, 0, NULL, JOB_CONTROL_CANCEL);
-    if (!result)
-        LOG("SetJobW(CANCEL) failed with error %lu", GetLastError());
-    ClosePrinter(hPrinter);
-    return result;
-#else
-    bool result = cupsCancelJob(printer_name, (int)job_id) == 1;
-    if (!result)
-        LOG("cupsCancelJob failed, error: %s", cupsLastErrorString());
-    return result;
-#endif
+    }
+    snprintf(text, text_size, "%s", value);
 }
 
-FFI_PLUGIN_EXPORT CupsOptionList *get_supported_cups_options(const char *printer_name)
+// Internal helper that compiles the job-constraints-supported collections of
+// `response` against `list`. Constraints on attributes or values that are not
+// in the list cannot be selected through it and are dropped. Returns NULL if
+// no constraint applies or memory runs out.
+static OptionConstraints *_compile_option_constraints(const CupsOptionList *list, ipp_t *response)
 {
-    if (!printer_name)
+    ipp_attribute_t *attr = ippFindAttribute(response, "job-constraints-supported", IPP_TAG_BEGIN_COLLECTION);
+    int total = attr ? ippGetCount(attr) : 0;
+    if (total == 0)
+        return NULL;
+
+    OptionConstraints *constraints = (OptionConstraints *)calloc(1, sizeof(OptionConstraints));
+    if (!constraints)
+        return NULL;
+    int bits = _option_bit_base(list, list->count);
+    constraints->num_words = bits > 0 ? (bits + 63) / 64 : 1;
+    constraints->sets = (uint64_t *)calloc((size_t)total * constraints->num_words, sizeof(uint64_t));
+    constraints->arity = (uint8_t *)calloc((size_t)total, sizeof(uint8_t));
+    constraints->names = (char **)calloc((size_t)total, sizeof(char *));
+    if (!constraints->sets || !constraints->arity || !constraints->names)
+    {
+        _free_option_constraints(constraints);
+        return NULL;
+    }
+
+    char value[256];
+    char text[256];
+    for (int i = 0; i < total; i++)
     {
-        LOG("get_supported_cups_options called with null printer name");
-        CupsOptionList *list = (CupsOptionList *)malloc(sizeof(CupsOptionList));
-        if (list)
+        ipp_t *collection = ippGetCollection(attr, i);
+        uint64_t *set = constraints->sets + (size_t)constraints->count * constraints->num_words;
+        const char *name = NULL;
+        int arity = 0;
+        bool usable = collection != NULL;
+        for (ipp_attribute_t *member = usable ? ippFirstAttribute(collection) : NULL; member && usable; member = ippNextAttribute(collection))
+        {
+            const char *member_name = ippGetName(member);
+            if (!member_name)
+                continue;
+            if (strcmp(member_name, "resolver-name") == 0)
+            {
+                name = ippGetString(member, 0, NULL);
+                continue;
+            }
+            int option = _find_option(list, member_name);
+            if (option < 0)
+            {
+                usable = false;
+                break;
+            }
+            int base = _option_bit_base(list, option);
+            bool matched = false;
+            for (int j = 0; j < ippGetCount(member); j++)
+            {
+                _capability_value(member_name, member, j, value, sizeof(value), text, sizeof(text));
+                int choice = _find_option_choice(&list->options[option], value);
+                if (choice < 0)
+                    continue;
+                set[(base + choice) / 64] |= 1ULL << ((base + choice) % 64);
+                matched = true;
+            }
+            usable = matched && arity < UINT8_MAX;
+            arity++;
+        }
+        if (!usable || arity == 0)
         {
-            list->count = 0;
-            list->options = NULL;
+            memset(set, 0, (size_t)constraints->num_words * sizeof(uint64_t));
+            continue;
         }
-        return list;
+        constraints->arity[constraints->count] = (uint8_t)arity;
+        constraints->names[constraints->count] = strdup(name ? name : "");
+        constraints->count++;
+    }
+    if (constraints->count == 0)
+    {
+        _free_option_constraints(constraints);
+        return NULL;
     }
+    LOG("Compiled %d of %d option constraints", constraints->count, total);
+    return constraints;
+}
 
-    LOG("get_supported_cups_options called for printer: '%s'", printer_name);
-    CupsOptionList *list = (CupsOptionList *)malloc(sizeof(CupsOptionList));
+// Internal helper that builds the option list of `printer_name` from one
+// Get-Printer-Attributes request. This works for driverless (IPP Everywhere)
+// queues, which have no PPD, and costs far less than downloading and parsing
+// a PPD. `*config_change_time` receives printer-config-change-time, or 0 if
+// the request failed. Returns NULL on allocation failure.
+static CupsOptionList *_load_ipp_options(const char *printer_name, time_t *config_change_time)
+{
+    *config_change_time = 0;
+    CupsOptionList *list = _alloc_cups_option_list();
     if (!list)
         return NULL;
-    list->count = 0;
-    list->options = NULL;
 
-#ifdef _WIN32
-    // Not supported on Windows
-    return list;
-#else // macOS / Linux (CUPS)
-    const char *ppd_filename = cupsGetPPD(printer_name);
-    if (!ppd_filename)
+    char names[CAPABILITY_OPTION_COUNT * 2][64];
+    const char *requested[CAPABILITY_OPTION_COUNT * 2 + 2];
+    for (int i = 0; i < CAPABILITY_OPTION_COUNT; i++)
     {
-        LOG("cupsGetPPD failed for '%s', error: %s", printer_name, cupsLastErrorString());
+        snprintf(names[2 * i], sizeof(names[0]), "%s-supported", s_capability_options[i]);
+        snprintf(names[2 * i + 1], sizeof(names[0]), "%s-default", s_capability_options[i]);
+        requested[2 * i] = names[2 * i];
+        requested[2 * i + 1] = names[2 * i + 1];
+    }
+    requested[CAPABILITY_OPTION_COUNT * 2] = "printer-config-change-time";
+    requested[CAPABILITY_OPTION_COUNT * 2 + 1] = "job-constraints-supported";
+
+    ipp_t *response = _get_printer_attributes(printer_name, CAPABILITY_OPTION_COUNT * 2 + 2, requested);
+    if (!response)
         return list;
-    }
-    LOG("Found PPD file: %s", ppd_filename);
+    *config_change_time = (time_t)ippGetInteger(ippFindAttribute(response, "printer-config-change-time", IPP_TAG_INTEGER), 0);
 
-    ppd_file_t *ppd = ppdOpenFile(ppd_filename);
-    if (!ppd)
+    list->options = (CupsOption *)calloc(CAPABILITY_OPTION_COUNT, sizeof(CupsOption));
+    if (!list->options)
     {
-        LOG("ppdOpenFile failed for '%s'", ppd_filename);
-        unlink(ppd_filename); // Clean up temporary PPD file
-        return list;
+        ippDelete(response);
+        free_cups_option_list(list);
+        return NULL;
     }
 
-    ppdMarkDefaults(ppd);
+    char value[256];
+    char text[256];
+    for (int i = 0; i < CAPABILITY_OPTION_COUNT; i++)
+    {
+        ipp_attribute_t *supported = ippFindAttribute(response, names[2 * i], IPP_TAG_ZERO);
+        int count = supported ? ippGetCount(supported) : 0;
+        // Ranges and collections (e.g. custom media) are not choice lists.
+        if (count == 0 || ippGetValueTag(supported) == IPP_TAG_RANGE || ippGetValueTag(supported) == IPP_TAG_BEGIN_COLLECTION)
+            continue;
+
+        const char *option = s_capability_options[i];
+        CupsOption *entry = &list->options[list->count++];
+        entry->name = strdup(option);
+        ipp_attribute_t *fallback = ippFindAttribute(response, names[2 * i + 1], IPP_TAG_ZERO);
+        value[0] = '\0';
+        if (fallback && ippGetCount(fallback) > 0 && ippGetValueTag(fallback) == ippGetValueTag(supported))
+            _capability_value(option, fallback, 0, value, sizeof(value), text, sizeof(text));
+        entry->default_value = strdup(value);
+
+        entry->supported_values.choices = (CupsOptionChoice *)malloc(count * sizeof(CupsOptionChoice));
+        if (!entry->supported_values.choices)
+            continue;
+        entry->supported_values.count = count;
+        for (int j = 0; j < count; j++)
+        {
+            _capability_value(option, supported, j, value, sizeof(value), text, sizeof(text));
+            entry->supported_values.choices[j].choice = strdup(value);
+            entry->supported_values.choices[j].text = strdup(text);
+        }
+    }
+    ((SharedCupsOptionList *)list)->constraints = _compile_option_constraints(list, response);
+    ippDelete(response);
+    LOG("Loaded %d options for '%s' from Get-Printer-Attributes", list->count, printer_name);
+    return list;
+}
 
-    int num_ui_options = 0;
-    for (int i = 0; i < ppd->num_groups; i++)
+// Per-printer option cache. An entry is served without asking the scheduler
+// while the config watcher reports no changes; otherwise it is revalidated
+// with a Get-Printer-Attributes request for printer-config-change-time alone,
+// so the capabilities of an unchanged queue are not fetched again.
+typedef struct
+{
+    char *printer_name;
+    CupsOptionList *options;   // The cache's reference.
+    time_t config_change_time; // 0 if unknown, which always reloads.
+    uint64_t epoch;
+} CupsOptionCacheEntry;
+
+static ffi_mutex_t s_option_cache_lock = FFI_MUTEX_INITIALIZER;
+static CupsOptionCacheEntry *s_option_cache = NULL;
+static int s_option_cache_count = 0;
+static int s_option_cache_capacity = 0;
+
+static CupsOptionCacheEntry *_find_option_cache_entry(const char *printer_name)
+{
+    for (int i = 0; i < s_option_cache_count; i++)
     {
-        num_ui_options += ppd->groups[i].num_options;
+        if (strcmp(s_option_cache[i].printer_name, printer_name) == 0)
+            return &s_option_cache[i];
     }
+    return NULL;
+}
 
-    if (num_ui_options == 0)
+// Stores `options` (taking a reference) in the cache. Must be called with `s_option_cache_lock` held.
+static void _store_option_cache_entry_locked(const char *printer_name, CupsOptionList *options, time_t config_change_time, uint64_t epoch)
+{
+    CupsOptionCacheEntry *entry = _find_option_cache_entry(printer_name);
+    if (entry)
     {
-        ppdClose(ppd);
-        unlink(ppd_filename);
-        LOG("No UI options found in PPD");
-        return list;
+        free_cups_option_list(entry->options);
+        entry->options = _retain_cups_option_list(options);
+        entry->config_change_time = config_change_time;
+        entry->epoch = epoch;
+        return;
     }
 
-    list->count = num_ui_options;
-    LOG("Found %d UI options in PPD", num_ui_options);
-    list->options = (CupsOption *)malloc(num_ui_options * sizeof(CupsOption));
-    if (!list->options)
+    if (s_option_cache_count == s_option_cache_capacity)
     {
-        ppdClose(ppd);
-        unlink(ppd_filename);
-        free(list);
-        return NULL;
+        int new_capacity = s_option_cache_capacity > 0 ? s_option_cache_capacity * 2 : 8;
+        CupsOptionCacheEntry *grown = (CupsOptionCacheEntry *)realloc(s_option_cache, new_capacity * sizeof(CupsOptionCacheEntry));
+        if (!grown)
+            return;
+        s_option_cache = grown;
+        s_option_cache_capacity = new_capacity;
     }
+    char *name_copy = strdup(printer_name);
+    if (!name_copy)
+        return;
+    entry = &s_option_cache[s_option_cache_count++];
+    entry->printer_name = name_copy;
+    entry->options = _retain_cups_option_list(options);
+    entry->config_change_time = config_change_time;
+    entry->epoch = epoch;
+}
+#endif
 
-    int current_option_index = 0;
-    ppd_option_t *option;
-    for (int i = 0; i < ppd->num_groups; i++)
+// The returned list is shared and must not be modified; release it with free_cups_option_list.
+FFI_PLUGIN_EXPORT CupsOptionList *get_supported_cups_options(const char *printer_name)
+{
+    if (!printer_name)
     {
-        ppd_group_t *group = ppd->groups + i;
-        for (int j = 0; j < group->num_options; j++)
-        {
-            option = group->options + j;
-
-            list->options[current_option_index].name = strdup(option->keyword ? option->keyword : "");
-            list->options[current_option_index].default_value = strdup(option->defchoice ? option->defchoice : "");
+        LOG("get_supported_cups_options called with null printer name");
+        return _alloc_cups_option_list();
+    }
 
-            list->options[current_option_index].supported_values.count = option->num_choices;
-            if (option->num_choices > 0)
-            {
-                list->options[current_option_index].supported_values.choices = (CupsOptionChoice *)malloc(option->num_choices * sizeof(CupsOptionChoice));
-                if (list->options[current_option_index].supported_values.choices)
-                {
-                    for (int k = 0; k < option->num_choices; k++)
-                    {
-                        list->options[current_option_index].supported_values.choices[k].choice = strdup(option->choices[k].choice ? option->choices[k].choice : "");
-                        list->options[current_option_index].supported_values.choices[k].text = strdup(option->choices[k].text ? option->choices[k].text : "");
-                    }
-                }
-                else
-                {
-                    list->options[current_option_index].supported_values.count = 0;
-                }
-            }
-            else
-            {
-                list->options[current_option_index].supported_values.choices = NULL;
-            }
-            current_option_index++;
+    LOG("get_supported_cups_options called for printer: '%s'", printer_name);
+#ifdef _WIN32
+    // Not supported on Windows
+    return _alloc_cups_option_list();
+#else // macOS / Linux (CUPS)
+    ffi_mutex_lock(&s_option_cache_lock);
+    CupsOptionCacheEntry *entry = _find_option_cache_entry(printer_name);
+    if (entry && entry->config_change_time != 0 && _config_cache_is_valid(CONFIG_CACHE_OPTIONS, entry->epoch))
+    {
+        CupsOptionList *cached = _retain_cups_option_list(entry->options);
+        ffi_mutex_unlock(&s_option_cache_lock);
+        LOG("get_supported_cups_options served '%s' from cache", printer_name);
+        return cached;
+    }
+    bool cached_in_memory = entry != NULL;
+    time_t change_time = entry ? entry->config_change_time : 0;
+    ffi_mutex_unlock(&s_option_cache_lock);
+
+    // Query outside the lock so a slow scheduler does not block other printers.
+    uint64_t epoch = _config_cache_epoch(CONFIG_CACHE_OPTIONS);
+    // On a cold start, options persisted by an earlier run stand in for the cache entry.
+    CupsOptionList *persisted = cached_in_memory ? NULL : _caps_cache_load_cups_options(printer_name, &change_time);
+    if (change_time != 0 && _printer_config_change_time(printer_name) == change_time)
+    {
+        CupsOptionList *cached = persisted;
+        ffi_mutex_lock(&s_option_cache_lock);
+        entry = _find_option_cache_entry(printer_name);
+        if (persisted)
+            _store_option_cache_entry_locked(printer_name, persisted, change_time, epoch);
+        else if (entry && entry->config_change_time == change_time)
+        {
+            cached = _retain_cups_option_list(entry->options);
+            entry->epoch = epoch;
+        }
+        ffi_mutex_unlock(&s_option_cache_lock);
+        if (cached)
+        {
+            LOG("get_supported_cups_options: '%s' not reconfigured, served from cache", printer_name);
+            return cached;
         }
     }
+    free_cups_option_list(persisted);
+
+    CupsOptionList *list = _load_ipp_options(printer_name, &change_time);
+    if (!list)
+        return NULL;
 
-    ppdClose(ppd);
-    unlink(ppd_filename); // Clean up temporary PPD file
+    // A failed load (change time 0) is returned but not cached, so the next call retries.
+    if (change_time != 0)
+    {
+        ffi_mutex_lock(&s_option_cache_lock);
+        _store_option_cache_entry_locked(printer_name, list, change_time, epoch);
+        ffi_mutex_unlock(&s_option_cache_lock);
+        _caps_cache_store_cups_options(printer_name, list, change_time);
+    }
     LOG("get_supported_cups_options finished");
     return list;
 #endif
@@ -1830,6 +7555,9 @@ FFI_PLUGIN_EXPORT void free_cups_option_list(CupsOptionList *option_list)
 {
     if (!option_list)
         return;
+    // Only the last reference frees the list.
+    if (ffi_atomic_add_u64(&((SharedCupsOptionList *)option_list)->refs, (uint64_t)-1) != 1)
+        return;
     if (option_list->options)
     {
         for (int i = 0; i < option_list->count; i++)
@@ -1848,6 +7576,7 @@ FFI_PLUGIN_EXPORT void free_cups_option_list(CupsOptionList *option_list)
         }
         free(option_list->options);
     }
+    _free_option_constraints(((SharedCupsOptionList *)option_list)->constraints);
     free(option_list);
 }
 
@@ -1866,23 +7595,37 @@ FFI_PLUGIN_EXPORT WindowsPrinterCapabilities *get_windows_printer_capabilities(c
     wchar_t *printer_name_w = to_utf16(printer_name);
     if (!printer_name_w)
     {
-        LOG("Failed to convert printer name to UTF-16");
+        LOG_WARN("Failed to convert printer name to UTF-16");
         return (WindowsPrinterCapabilities *)calloc(1, sizeof(WindowsPrinterCapabilities));
     }
 
     HANDLE hPrinter;
     if (!OpenPrinterW(printer_name_w, &hPrinter, NULL))
     {
-        LOG("OpenPrinterW failed with error %lu", GetLastError());
+        LOG_WARN("OpenPrinterW failed with error %lu", GetLastError());
         free(printer_name_w);
         return (WindowsPrinterCapabilities *)calloc(1, sizeof(WindowsPrinterCapabilities));
     }
 
+    // Capabilities persisted by an earlier run are valid while the ChangeID is unchanged.
+    DWORD change_id = 0;
+    bool has_change_id = _windows_printer_change_id(hPrinter, &change_id);
+    if (has_change_id)
+    {
+        WindowsPrinterCapabilities *persisted = _caps_cache_load_windows(printer_name, change_id);
+        if (persisted)
+        {
+            ClosePrinter(hPrinter);
+            free(printer_name_w);
+            return persisted;
+        }
+    }
+
     // First, get the size of the DEVMODE structure.
     LONG devModeSize = DocumentPropertiesW(NULL, hPrinter, printer_name_w, NULL, NULL, 0);
     if (devModeSize <= 0)
     {
-        LOG("DocumentProperties (get size) failed with error %lu", GetLastError());
+        LOG_WARN("DocumentProperties (get size) failed with error %lu", GetLastError());
         ClosePrinter(hPrinter);
         free(printer_name_w);
         return (WindowsPrinterCapabilities *)calloc(1, sizeof(WindowsPrinterCapabilities));
@@ -1891,7 +7634,7 @@ FFI_PLUGIN_EXPORT WindowsPrinterCapabilities *get_windows_printer_capabilities(c
     DEVMODEW *pDevMode = (DEVMODEW *)malloc(devModeSize);
     if (!pDevMode)
     {
-        LOG("Failed to allocate memory for DEVMODE structure.");
+        LOG_WARN("Failed to allocate memory for DEVMODE structure.");
         ClosePrinter(hPrinter);
         free(printer_name_w);
         return (WindowsPrinterCapabilities *)calloc(1, sizeof(WindowsPrinterCapabilities));
@@ -1900,7 +7643,7 @@ FFI_PLUGIN_EXPORT WindowsPrinterCapabilities *get_windows_printer_capabilities(c
     // Get the default DEVMODE for the printer.
     if (DocumentPropertiesW(NULL, hPrinter, printer_name_w, pDevMode, NULL, DM_OUT_BUFFER) != IDOK)
     {
-        LOG("DocumentProperties (get defaults) failed with error %lu", GetLastError());
+        LOG_WARN("DocumentProperties (get defaults) failed with error %lu", GetLastError());
         free(pDevMode);
         ClosePrinter(hPrinter);
         free(printer_name_w);
@@ -1943,7 +7686,7 @@ FFI_PLUGIN_EXPORT WindowsPrinterCapabilities *get_windows_printer_capabilities(c
     GetPrinterW(hPrinter, 2, NULL, 0, &needed);
     if (needed == 0)
     {
-        LOG("GetPrinterW (to get size) failed with error %lu", GetLastError());
+        LOG_WARN("GetPrinterW (to get size) failed with error %lu", GetLastError());
         // We can still return the basic caps from DEVMODE
         free(pDevMode);
         ClosePrinter(hPrinter);
@@ -1953,7 +7696,7 @@ FFI_PLUGIN_EXPORT WindowsPrinterCapabilities *get_windows_printer_capabilities(c
     PRINTER_INFO_2W *pinfo2 = (PRINTER_INFO_2W *)malloc(needed);
     if (!pinfo2)
     {
-        LOG("Failed to allocate memory for PRINTER_INFO_2W");
+        LOG_WARN("Failed to allocate memory for PRINTER_INFO_2W");
         free(pDevMode);
         ClosePrinter(hPrinter);
         free(printer_name_w);
@@ -1961,7 +7704,7 @@ FFI_PLUGIN_EXPORT WindowsPrinterCapabilities *get_windows_printer_capabilities(c
     }
     if (!GetPrinterW(hPrinter, 2, (LPBYTE)pinfo2, needed, &needed))
     {
-        LOG("GetPrinterW failed with error %lu", GetLastError());
+        LOG_WARN("GetPrinterW failed with error %lu", GetLastError());
         // Fallback to DEVMODE if GetPrinterW fails
         caps->supports_landscape = (pDevMode->dmFields & DM_ORIENTATION) != 0;
         caps->is_color_supported = (pDevMode->dmFields & DM_COLOR) && (pDevMode->dmColor == DMCOLOR_COLOR);
@@ -2000,7 +7743,13 @@ FFI_PLUGIN_EXPORT WindowsPrinterCapabilities *get_windows_printer_capabilities(c
             {
                 DeviceCapabilitiesW(printer_name_w, port_w, DC_PAPERS, (LPWSTR)papers, NULL);
                 DeviceCapabilitiesW(printer_name_w, port_w, DC_PAPERNAMES, (LPWSTR)paper_names_w, NULL);
-                DeviceCapabilitiesW(printer_name_w, port_w, DC_PAPERSIZE, (LPWSTR)paper_sizes_points, NULL);
+                // Standard sizes come from the PWG media table; the driver is only
+                // asked for dimensions when it reports a size the table lacks.
+                bool all_standard = true;
+                for (long i = 0; i < num_papers && all_standard; i++)
+                    all_standard = _lookup_pwg_media_by_windows_id(papers[i]) != NULL;
+                if (!all_standard)
+                    DeviceCapabilitiesW(printer_name_w, port_w, DC_PAPERSIZE, (LPWSTR)paper_sizes_points, NULL);
 
                 caps->paper_sizes.count = (int)num_papers;
                 caps->paper_sizes.papers = (PaperSize *)malloc(num_papers * sizeof(PaperSize));
@@ -2008,10 +7757,11 @@ FFI_PLUGIN_EXPORT WindowsPrinterCapabilities *get_windows_printer_capabilities(c
                 {
                     for (long i = 0; i < num_papers; i++)
                     {
+                        const PwgMedia *media = _lookup_pwg_media_by_windows_id(papers[i]);
                         caps->paper_sizes.papers[i].id = papers[i];
                         caps->paper_sizes.papers[i].name = to_utf8(paper_names_w[i]);
-                        caps->paper_sizes.papers[i].width_mm = (float)paper_sizes_points[i].x / 10.0f;
-                        caps->paper_sizes.papers[i].height_mm = (float)paper_sizes_points[i].y / 10.0f;
+                        caps->paper_sizes.papers[i].width_mm = media ? (float)media->width / 100.0f : (float)paper_sizes_points[i].x / 10.0f;
+                        caps->paper_sizes.papers[i].height_mm = media ? (float)media->height / 100.0f : (float)paper_sizes_points[i].y / 10.0f;
                     }
                 }
             }
@@ -2053,6 +7803,8 @@ FFI_PLUGIN_EXPORT WindowsPrinterCapabilities *get_windows_printer_capabilities(c
         }
     }
 
+    if (has_change_id)
+        _caps_cache_store_windows(printer_name, caps, change_id);
     free(pinfo2);
     free(pDevMode);
     ClosePrinter(hPrinter);
@@ -2096,7 +7848,544 @@ FFI_PLUGIN_EXPORT void free_windows_printer_capabilities(WindowsPrinterCapabilit
     free(capabilities);
 }
 
-FFI_PLUGIN_EXPORT int32_t submit_raw_data_job(const char *printer_name, const uint8_t *data, int length, const char *doc_name, int num_options, const char **option_keys, const char **option_values)
+// --- Option Validation ---
+
+static int _popcount64(uint64_t value)
+{
+    value = value - ((value >> 1) & 0x5555555555555555ULL);
+    value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((value * 0x0101010101010101ULL) >> 56);
+}
+
+#ifdef _WIN32
+static bool _windows_id_supported(int id, const void *items, int count, size_t stride)
+{
+    // An empty list means the driver did not report any, so nothing can be ruled out.
+    if (!items || count == 0)
+        return true;
+    for (int i = 0; i < count; i++)
+    {
+        if (*(const short *)((const uint8_t *)items + i * stride) == id)
+            return true;
+    }
+    return false;
+}
+#endif
+
+#ifndef _WIN32
+// Checks option values against the options of a CUPS printer and the
+// constraints compiled into `list`. Returns an OPTION_VALIDATION_* code.
+static int _validate_cups_options(const CupsOptionList *list, const char *printer_name, int num_options, const char **option_keys, const char **option_values)
+{
+    int *selected = list->count > 0 ? (int *)malloc((size_t)list->count * sizeof(int)) : NULL;
+    if (list->count > 0 && !selected)
+    {
+        set_last_error("Out of memory.");
+        return OPTION_VALIDATION_ERROR;
+    }
+    for (int i = 0; i < list->count; i++)
+        selected[i] = -1;
+
+    int result = OPTION_VALIDATION_OK;
+    for (int i = 0; i < num_options && result == OPTION_VALIDATION_OK; i++)
+    {
+        const char *name;
+        const char *value;
+        if (!option_keys[i] || !option_values[i] || !_normalize_ipp_option(option_keys[i], option_values[i], &name, &value))
+            continue;
+        int option = _find_option(list, name);
+        if (option < 0)
+            continue;
+        selected[option] = strcmp(name, "media") == 0 ? _find_media_choice(&list->options[option], value) : _find_option_choice(&list->options[option], value);
+        if (selected[option] < 0)
+        {
+            set_last_error("'%s' is not a supported value of '%s' on '%s'.", value, name, printer_name);
+            result = OPTION_VALIDATION_UNSUPPORTED;
+        }
+    }
+
+    const OptionConstraints *constraints = ((const SharedCupsOptionList *)list)->constraints;
+    if (result == OPTION_VALIDATION_OK && constraints)
+    {
+        uint64_t *bits = (uint64_t *)calloc((size_t)constraints->num_words, sizeof(uint64_t));
+        if (!bits)
+        {
+            set_last_error("Out of memory.");
+            result = OPTION_VALIDATION_ERROR;
+        }
+        for (int i = 0, base = 0; bits && i < list->count; base += list->options[i].supported_values.count, i++)
+        {
+            if (selected[i] >= 0)
+                bits[(base + selected[i]) / 64] |= 1ULL << ((base + selected[i]) % 64);
+        }
+        for (int c = 0; bits && c < constraints->count; c++)
+        {
+            const uint64_t *set = constraints->sets + (size_t)c * constraints->num_words;
+            int matched = 0;
+            for (int w = 0; w < constraints->num_words; w++)
+                matched += _popcount64(bits[w] & set[w]);
+            if (matched != constraints->arity[c])
+                continue;
+
+            char conflict[512] = "";
+            size_t used = 0;
+            for (int i = 0, base = 0; i < list->count; base += list->options[i].supported_values.count, i++)
+            {
+                int bit = base + selected[i];
+                if (selected[i] < 0 || !(set[bit / 64] & (1ULL << (bit % 64))) || used >= sizeof(conflict))
+                    continue;
+                used += (size_t)snprintf(conflict + used, sizeof(conflict) - used, "%s%s=%s", used ? ", " : "", list->options[i].name, list->options[i].supported_values.choices[selected[i]].choice);
+            }
+            set_last_error("Options conflict on '%s': %s (%s).", printer_name, conflict, constraints->names[c] && constraints->names[c][0] ? constraints->names[c] : "constraint");
+            result = OPTION_VALIDATION_CONFLICT;
+            break;
+        }
+        free(bits);
+    }
+    free(selected);
+    return result;
+}
+#endif
+
+// Checks a proposed option set against the printer's cached capabilities
+// before anything is spooled. On CUPS generic options are normalized first,
+// then every key that is a supported option (see get_supported_cups_options)
+// must use one of its values, and the values must not match one of the
+// printer's job-constraints-supported. On Windows paper-size-id,
+// paper-source-id, media-type-id, color-mode and orientation are checked
+// against get_windows_printer_capabilities. Other keys are not checked. Returns an OPTION_VALIDATION_* code; get_last_error describes a
+// failure.
+FFI_PLUGIN_EXPORT int validate_options(const char *printer_name, int num_options, const char **option_keys, const char **option_values)
+{
+    if (!printer_name || num_options < 0 || (num_options > 0 && (!option_keys || !option_values)))
+    {
+        set_last_error("Invalid arguments for validate_options.");
+        return OPTION_VALIDATION_ERROR;
+    }
+
+#ifdef _WIN32
+    WindowsPrinterCapabilities *caps = get_windows_printer_capabilities(printer_name);
+    if (!caps)
+    {
+        set_last_error("Failed to load the capabilities of '%s'.", printer_name);
+        return OPTION_VALIDATION_ERROR;
+    }
+    int result = OPTION_VALIDATION_OK;
+    for (int i = 0; i < num_options && result == OPTION_VALIDATION_OK; i++)
+    {
+        const char *key = option_keys[i];
+        const char *value = option_values[i];
+        if (!key || !value)
+            continue;
+        bool supported = true;
+        if (strcmp(key, "paper-size-id") == 0)
+            supported = _windows_id_supported(atoi(value), caps->paper_sizes.papers, caps->paper_sizes.count, sizeof(PaperSize));
+        else if (strcmp(key, "paper-source-id") == 0)
+            supported = _windows_id_supported(atoi(value), caps->paper_sources.sources, caps->paper_sources.count, sizeof(PaperSource));
+        else if (strcmp(key, "media-type-id") == 0)
+            supported = _windows_id_supported(atoi(value), caps->media_types.types, caps->media_types.count, sizeof(MediaType));
+        else if (strcmp(key, "color-mode") == 0)
+            supported = strcmp(value, "color") != 0 || caps->is_color_supported;
+        else if (strcmp(key, "orientation") == 0)
+            supported = strcmp(value, "landscape") != 0 || caps->supports_landscape;
+        if (!supported)
+        {
+            set_last_error("'%s' is not a supported value of '%s' on '%s'.", value, key, printer_name);
+            result = OPTION_VALIDATION_UNSUPPORTED;
+        }
+    }
+    free_windows_printer_capabilities(caps);
+    return result;
+#else // macOS / Linux (CUPS)
+    CupsOptionList *list = get_supported_cups_options(printer_name);
+    if (!list)
+    {
+        set_last_error("Failed to load the options of '%s'.", printer_name);
+        return OPTION_VALIDATION_ERROR;
+    }
+    int result = _validate_cups_options(list, printer_name, num_options, option_keys, option_values);
+    free_cups_option_list(list);
+    return result;
+#endif
+}
+
+// --- Capability Snapshot ---
+// Serializes capabilities into the flat layout documented in printing_ffi.h,
+// so that a caller can read them from one buffer with plain offsets instead
+// of walking nested structs and converting every string up front.
+
+#define CAPABILITY_SNAPSHOT_MAGIC "PFCS"
+#define SNAPSHOT_HEADER_SIZE 20
+#define SNAPSHOT_SECTION_SIZE 12
+
+typedef struct
+{
+    uint8_t *base;
+    uint8_t *strings; // Next free byte of the string area.
+} SnapshotWriter;
+
+static size_t _snapshot_string_size(const char *value)
+{
+    return value ? 4 + strlen(value) + 1 : 0;
+}
+
+static uint32_t _snapshot_put_string(SnapshotWriter *writer, const char *value)
+{
+    if (!value)
+        return 0;
+    uint32_t offset = (uint32_t)(writer->strings - writer->base);
+    size_t length = strlen(value);
+    writer->strings = _rec_put(writer->strings, (uint64_t)length, 4);
+    memcpy(writer->strings, value, length + 1);
+    writer->strings += length + 1;
+    return offset;
+}
+
+static uint8_t *_snapshot_put_float(uint8_t *out, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return _rec_put(out, bits, 4);
+}
+
+// Allocates a snapshot for `num_sections` sections of counts[i] records of
+// record_sizes[i] bytes followed by `string_bytes` of strings, and writes the
+// header and section table. records[i] receives where section i starts.
+static CapabilitySnapshot *_snapshot_alloc(int kind, uint32_t flags, int num_sections, const uint32_t *counts, const uint32_t *record_sizes, size_t string_bytes, uint8_t **records, SnapshotWriter *writer)
+{
+    size_t size = SNAPSHOT_HEADER_SIZE + (size_t)num_sections * SNAPSHOT_SECTION_SIZE;
+    for (int i = 0; i < num_sections; i++)
+        size += (size_t)counts[i] * record_sizes[i];
+    size += string_bytes;
+    if ((uint64_t)size > 0xFFFFFFFFull)
+        return NULL;
+    CapabilitySnapshot *snapshot = (CapabilitySnapshot *)malloc(sizeof(CapabilitySnapshot) + size);
+    if (!snapshot)
+        return NULL;
+    snapshot->data = (uint8_t *)(snapshot + 1);
+    snapshot->size = (uint32_t)size;
+
+    uint8_t *out = snapshot->data;
+    memcpy(out, CAPABILITY_SNAPSHOT_MAGIC, 4);
+    out = _rec_put(out + 4, CAPABILITY_SNAPSHOT_VERSION, 2);
+    out = _rec_put(out, (uint64_t)kind, 2);
+    out = _rec_put(out, (uint64_t)size, 4);
+    out = _rec_put(out, flags, 4);
+    out = _rec_put(out, (uint64_t)num_sections, 4);
+    uint32_t offset = SNAPSHOT_HEADER_SIZE + (uint32_t)num_sections * SNAPSHOT_SECTION_SIZE;
+    for (int i = 0; i < num_sections; i++)
+    {
+        out = _rec_put(out, offset, 4);
+        out = _rec_put(out, counts[i], 4);
+        out = _rec_put(out, record_sizes[i], 4);
+        records[i] = snapshot->data + offset;
+        offset += counts[i] * record_sizes[i];
+    }
+    writer->base = snapshot->data;
+    writer->strings = snapshot->data + offset;
+    return snapshot;
+}
+
+static CapabilitySnapshot *_snapshot_cups_options(const CupsOptionList *list)
+{
+    uint32_t counts[2] = {(uint32_t)list->count, 0};
+    const uint32_t record_sizes[2] = {16, 8};
+    size_t string_bytes = 0;
+    for (int i = 0; i < list->count; i++)
+    {
+        const CupsOption *option = &list->options[i];
+        string_bytes += _snapshot_string_size(option->name) + _snapshot_string_size(option->default_value);
+        counts[1] += (uint32_t)option->supported_values.count;
+        for (int j = 0; j < option->supported_values.count; j++)
+        {
+            const CupsOptionChoice *choice = &option->supported_values.choices[j];
+            string_bytes += _snapshot_string_size(choice->choice);
+            // Most choices are their own text; those share one string.
+            if (choice->text && (!choice->choice || strcmp(choice->text, choice->choice) != 0))
+                string_bytes += _snapshot_string_size(choice->text);
+        }
+    }
+
+    uint8_t *records[2];
+    SnapshotWriter writer;
+    CapabilitySnapshot *snapshot = _snapshot_alloc(CAPABILITY_SNAPSHOT_CUPS, 0, 2, counts, record_sizes, string_bytes, records, &writer);
+    if (!snapshot)
+        return NULL;
+    uint32_t first_choice = 0;
+    for (int i = 0; i < list->count; i++)
+    {
+        const CupsOption *option = &list->options[i];
+        records[0] = _rec_put(records[0], _snapshot_put_string(&writer, option->name), 4);
+        records[0] = _rec_put(records[0], _snapshot_put_string(&writer, option->default_value), 4);
+        records[0] = _rec_put(records[0], first_choice, 4);
+        records[0] = _rec_put(records[0], (uint64_t)option->supported_values.count, 4);
+        for (int j = 0; j < option->supported_values.count; j++)
+        {
+            const CupsOptionChoice *choice = &option->supported_values.choices[j];
+            uint32_t value = _snapshot_put_string(&writer, choice->choice);
+            uint32_t text = choice->text && (!choice->choice || strcmp(choice->text, choice->choice) != 0) ? _snapshot_put_string(&writer, choice->text) : choice->text ? value : 0;
+            records[1] = _rec_put(records[1], value, 4);
+            records[1] = _rec_put(records[1], text, 4);
+        }
+        first_choice += (uint32_t)option->supported_values.count;
+    }
+    return snapshot;
+}
+
+#ifdef _WIN32
+static CapabilitySnapshot *_snapshot_windows_capabilities(const WindowsPrinterCapabilities *caps)
+{
+    uint32_t counts[4] = {(uint32_t)caps->paper_sizes.count, (uint32_t)caps->paper_sources.count, (uint32_t)caps->resolutions.count, (uint32_t)caps->media_types.count};
+    const uint32_t record_sizes[4] = {16, 8, 8, 8};
+    if (!caps->paper_sizes.papers)
+        counts[0] = 0;
+    if (!caps->paper_sources.sources)
+        counts[1] = 0;
+    if (!caps->resolutions.resolutions)
+        counts[2] = 0;
+    if (!caps->media_types.types)
+        counts[3] = 0;
+    size_t string_bytes = 0;
+    for (uint32_t i = 0; i < counts[0]; i++)
+        string_bytes += _snapshot_string_size(caps->paper_sizes.papers[i].name);
+    for (uint32_t i = 0; i < counts[1]; i++)
+        string_bytes += _snapshot_string_size(caps->paper_sources.sources[i].name);
+    for (uint32_t i = 0; i < counts[3]; i++)
+        string_bytes += _snapshot_string_size(caps->media_types.types[i].name);
+
+    uint32_t flags = (caps->is_color_supported ? CAPABILITY_SNAPSHOT_FLAG_COLOR : 0) |
+                     (caps->is_monochrome_supported ? CAPABILITY_SNAPSHOT_FLAG_MONOCHROME : 0) |
+                     (caps->supports_landscape ? CAPABILITY_SNAPSHOT_FLAG_LANDSCAPE : 0);
+    uint8_t *records[4];
+    SnapshotWriter writer;
+    CapabilitySnapshot *snapshot = _snapshot_alloc(CAPABILITY_SNAPSHOT_WINDOWS, flags, 4, counts, record_sizes, string_bytes, records, &writer);
+    if (!snapshot)
+        return NULL;
+    for (uint32_t i = 0; i < counts[0]; i++)
+    {
+        const PaperSize *paper = &caps->paper_sizes.papers[i];
+        records[0] = _rec_put(records[0], _snapshot_put_string(&writer, paper->name), 4);
+        records[0] = _rec_put(records[0], (uint32_t)(int32_t)paper->id, 4);
+        records[0] = _snapshot_put_float(records[0], paper->width_mm);
+        records[0] = _snapshot_put_float(records[0], paper->height_mm);
+    }
+    for (uint32_t i = 0; i < counts[1]; i++)
+    {
+        records[1] = _rec_put(records[1], _snapshot_put_string(&writer, caps->paper_sources.sources[i].name), 4);
+        records[1] = _rec_put(records[1], (uint32_t)(int32_t)caps->paper_sources.sources[i].id, 4);
+    }
+    for (uint32_t i = 0; i < counts[2]; i++)
+    {
+        records[2] = _rec_put(records[2], (uint32_t)(int32_t)caps->resolutions.resolutions[i].x_dpi, 4);
+        records[2] = _rec_put(records[2], (uint32_t)(int32_t)caps->resolutions.resolutions[i].y_dpi, 4);
+    }
+    for (uint32_t i = 0; i < counts[3]; i++)
+    {
+        records[3] = _rec_put(records[3], _snapshot_put_string(&writer, caps->media_types.types[i].name), 4);
+        records[3] = _rec_put(records[3], (uint32_t)(int32_t)caps->media_types.types[i].id, 4);
+    }
+    return snapshot;
+}
+#endif
+
+// Returns the printer's capabilities as one flat buffer: its CUPS options on
+// macOS and Linux, its Windows capabilities on Windows. Reads through the
+// same caches as get_supported_cups_options and
+// get_windows_printer_capabilities.
+FFI_PLUGIN_EXPORT CapabilitySnapshot *get_capability_snapshot(const char *printer_name)
+{
+    if (!printer_name)
+    {
+        set_last_error("Invalid arguments for get_capability_snapshot.");
+        return NULL;
+    }
+#ifdef _WIN32
+    WindowsPrinterCapabilities *caps = get_windows_printer_capabilities(printer_name);
+    if (!caps)
+        return NULL;
+    CapabilitySnapshot *snapshot = _snapshot_windows_capabilities(caps);
+    free_windows_printer_capabilities(caps);
+#else // macOS / Linux (CUPS)
+    CupsOptionList *list = get_supported_cups_options(printer_name);
+    if (!list)
+        return NULL;
+    CapabilitySnapshot *snapshot = _snapshot_cups_options(list);
+    free_cups_option_list(list);
+#endif
+    if (!snapshot)
+        set_last_error("Failed to build the capability snapshot of '%s'.", printer_name);
+    return snapshot;
+}
+
+FFI_PLUGIN_EXPORT void free_capability_snapshot(CapabilitySnapshot *snapshot)
+{
+    // The buffer shares the struct's allocation.
+    free(snapshot);
+}
+
+// --- Capability Prefetch ---
+
+// prefetch_capabilities warms the option and capability caches for many
+// printers at once on a small set of detached worker threads. Each worker
+// claims the next printer with an atomic index; the last worker to finish
+// reports the outcome through the callback and frees the job.
+#define PREFETCH_MAX_CONCURRENCY 32
+
+typedef struct
+{
+    char **printers;
+    int count;
+    uint64_t next;      // Index of the next unclaimed printer.
+    uint64_t succeeded;
+    uint64_t refs;      // One per running worker, plus one held while starting them.
+    int64_t request_id;
+    prefetch_callback_t callback;
+} PrefetchJob;
+
+static bool _prefetch_one(const char *printer_name)
+{
+#ifdef _WIN32
+    WindowsPrinterCapabilities *caps = get_windows_printer_capabilities(printer_name);
+    bool ok = caps && (caps->paper_sizes.count > 0 || caps->paper_sources.count > 0 || caps->resolutions.count > 0);
+    free_windows_printer_capabilities(caps);
+#else // macOS, Linux
+    CupsOptionList *options = get_supported_cups_options(printer_name);
+    bool ok = options && options->count > 0;
+    free_cups_option_list(options);
+#endif
+    return ok;
+}
+
+static void _prefetch_release(PrefetchJob *job)
+{
+    if (ffi_atomic_add_u64(&job->refs, (uint64_t)-1) != 1)
+        return;
+    int succeeded = (int)ffi_atomic_load_u64(&job->succeeded);
+    LOG_INFO("Prefetched capabilities for %d of %d printers", succeeded, job->count);
+    if (job->callback)
+        job->callback(job->request_id, succeeded, job->count - succeeded);
+    for (int i = 0; i < job->count; i++)
+        free(job->printers[i]);
+    free(job->printers);
+    free(job);
+}
+
+static void _prefetch_run(PrefetchJob *job)
+{
+    for (;;)
+    {
+        uint64_t index = ffi_atomic_add_u64(&job->next, 1);
+        if (index >= (uint64_t)job->count)
+            break;
+        if (_prefetch_one(job->printers[index]))
+            ffi_atomic_add_u64(&job->succeeded, 1);
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI _prefetch_thread(LPVOID arg)
+#else
+static void *_prefetch_thread(void *arg)
+#endif
+{
+    PrefetchJob *job = (PrefetchJob *)arg;
+    _prefetch_run(job);
+    _prefetch_release(job);
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+static bool _prefetch_start_thread(PrefetchJob *job)
+{
+#ifdef _WIN32
+    HANDLE thread = CreateThread(NULL, 0, _prefetch_thread, job, 0, NULL);
+    if (!thread)
+        return false;
+    CloseHandle(thread);
+    return true;
+#else
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    bool started = pthread_create(&thread, &attr, _prefetch_thread, job) == 0;
+    pthread_attr_destroy(&attr);
+    return started;
+#endif
+}
+
+// Fetches the CUPS options (macOS, Linux) or Windows capabilities of `count`
+// printers with up to `concurrency` worker threads, leaving them in the native
+// caches. Returns immediately; `callback` is invoked once from a worker thread
+// when every printer has been fetched. The printer names are copied.
+FFI_PLUGIN_EXPORT bool prefetch_capabilities(const char **printers, int count, int concurrency, int64_t request_id, prefetch_callback_t callback)
+{
+    if (count < 0 || (count > 0 && !printers))
+    {
+        set_last_error("Invalid printer list for prefetch_capabilities.");
+        return false;
+    }
+
+    PrefetchJob *job = (PrefetchJob *)calloc(1, sizeof(PrefetchJob));
+    if (!job)
+    {
+        set_last_error("Out of memory.");
+        return false;
+    }
+    job->printers = count > 0 ? (char **)calloc((size_t)count, sizeof(char *)) : NULL;
+    bool ok = count == 0 || job->printers;
+    for (int i = 0; ok && i < count; i++)
+    {
+        job->printers[i] = strdup(printers[i] ? printers[i] : "");
+        ok = job->printers[i] != NULL;
+        job->count = i + 1;
+    }
+    if (!ok)
+    {
+        for (int i = 0; i < job->count; i++)
+            free(job->printers[i]);
+        free(job->printers);
+        free(job);
+        set_last_error("Out of memory.");
+        return false;
+    }
+    job->request_id = request_id;
+    job->callback = callback;
+    job->refs = 1;
+
+    if (concurrency < 1)
+        concurrency = 1;
+    if (concurrency > PREFETCH_MAX_CONCURRENCY)
+        concurrency = PREFETCH_MAX_CONCURRENCY;
+    if (concurrency > count)
+        concurrency = count;
+    LOG("prefetch_capabilities: %d printers with %d workers", count, concurrency);
+
+    int started = 0;
+    for (int i = 0; i < concurrency; i++)
+    {
+        ffi_atomic_add_u64(&job->refs, 1);
+        if (!_prefetch_start_thread(job))
+        {
+            ffi_atomic_add_u64(&job->refs, (uint64_t)-1);
+            break;
+        }
+        started++;
+    }
+    if (started == 0 && count > 0)
+    {
+        LOG_WARN("prefetch_capabilities: no worker thread could be started, fetching on the calling thread");
+        _prefetch_run(job);
+    }
+    _prefetch_release(job);
+    return true;
+}
+
+static int32_t _submit_raw_data_job(const char *printer_name, const uint8_t *data, int length, const char *doc_name, int num_options, const char **option_keys, const char **option_values)
 {
     LOG("submit_raw_data_job called for printer: '%s', doc: '%s', length: %d", printer_name, doc_name, length);
 
@@ -2107,11 +8396,14 @@ FFI_PLUGIN_EXPORT int32_t submit_raw_data_job(const char *printer_name, const ui
         return 0;
     }
 
+    JobTraceBuilder trace;
+    _job_trace_begin(&trace);
 #ifdef _WIN32
     int paper_size_id, paper_source_id, orientation, color_mode, print_quality, media_type_id, duplex_mode;
     double custom_scale; // Dummy
     bool collate = true; // Default to collated (complete copies printed together)
     parse_windows_options(num_options, option_keys, option_values, &paper_size_id, &paper_source_id, &orientation, &color_mode, &print_quality, &media_type_id, &custom_scale, &collate, &duplex_mode);
+    _job_trace_mark(&trace, JOB_STAGE_OPTIONS_PARSED);
 
     HANDLE hPrinter;
     DOC_INFO_1W docInfo;
@@ -2129,7 +8421,7 @@ FFI_PLUGIN_EXPORT int32_t submit_raw_data_job(const char *printer_name, const ui
 
     if (!OpenPrinterW(printer_name_w, &hPrinter, &printerDefaults))
     {
-        LOG("OpenPrinterW failed with error %lu", GetLastError());
+        LOG_WARN("OpenPrinterW failed with error %lu", GetLastError());
         free(printer_name_w);
         if (pDevMode)
             free(pDevMode);
@@ -2141,11 +8433,12 @@ FFI_PLUGIN_EXPORT int32_t submit_raw_data_job(const char *printer_name, const ui
     docInfo.pOutputFile = NULL;
     docInfo.pDatatype = L"RAW";
 
+    _job_trace_mark(&trace, JOB_STAGE_REQUEST_SENT);
     job_id = StartDocPrinterW(hPrinter, 1, (LPBYTE)&docInfo);
     if (job_id == 0)
     {
         ClosePrinter(hPrinter);
-        LOG("StartDocPrinterW failed with error %lu", GetLastError());
+        LOG_WARN("StartDocPrinterW failed with error %lu", GetLastError());
         if (doc_name_w)
             free(doc_name_w);
         free(printer_name_w);
@@ -2153,13 +8446,14 @@ FFI_PLUGIN_EXPORT int32_t submit_raw_data_job(const char *printer_name, const ui
             free(pDevMode);
         return 0;
     }
+    _job_trace_mark(&trace, JOB_STAGE_JOB_ID_RETURNED);
     if (doc_name_w)
         free(doc_name_w);
 
     if (!StartPagePrinter(hPrinter))
     {
         EndDocPrinter(hPrinter);
-        LOG("StartPagePrinter failed with error %lu", GetLastError());
+        LOG_WARN("StartPagePrinter failed with error %lu", GetLastError());
         ClosePrinter(hPrinter);
         free(printer_name_w);
         if (pDevMode)
@@ -2167,9 +8461,15 @@ FFI_PLUGIN_EXPORT int32_t submit_raw_data_job(const char *printer_name, const ui
         return 0;
     }
 
+    TraceSpan spool_span;
+    _trace_begin(&spool_span, "WritePrinter");
+    _trace_arg_int(&spool_span, "bytes", length);
     bool result = WritePrinter(hPrinter, (LPVOID)data, (DWORD)length, &written);
+    _trace_end(&spool_span);
     EndPagePrinter(hPrinter);
     EndDocPrinter(hPrinter);
+    _job_trace_mark(&trace, JOB_STAGE_SPOOLED);
+    _job_trace_commit(&trace, printer_name, job_id);
     ClosePrinter(hPrinter);
     free(printer_name_w);
     if (pDevMode)
@@ -2177,7 +8477,7 @@ FFI_PLUGIN_EXPORT int32_t submit_raw_data_job(const char *printer_name, const ui
 
     if (!result || written != (DWORD)length)
     {
-        LOG("WritePrinter failed. Result: %d, Bytes written: %lu, Expected: %d", result, written, length);
+        LOG_WARN("WritePrinter failed. Result: %d, Bytes written: %lu, Expected: %d", result, written, length);
         // The job might have been created but failed to write. The caller can still track this job ID to see its error state.
     }
     return (int32_t)job_id;
@@ -2195,7 +8495,7 @@ FFI_PLUGIN_EXPORT int32_t submit_raw_data_job(const char *printer_name, const ui
     int fd = mkstemp(temp_file);
     if (fd == -1)
     {
-        LOG("mkstemp failed to create temporary file");
+        LOG_WARN("mkstemp failed to create temporary file");
         return 0;
     }
 
@@ -2207,8 +8507,12 @@ FFI_PLUGIN_EXPORT int32_t submit_raw_data_job(const char *printer_name, const ui
         return 0;
     }
 
+    TraceSpan spool_span;
+    _trace_begin(&spool_span, "spool_write");
+    _trace_arg_int(&spool_span, "bytes", length);
     size_t written = fwrite(data, 1, (size_t)length, fp);
     fclose(fp);
+    _trace_end(&spool_span);
 
     if (written != (size_t)length)
     {
@@ -2220,18 +8524,25 @@ FFI_PLUGIN_EXPORT int32_t submit_raw_data_job(const char *printer_name, const ui
     int num_cups_options = 0;
     num_cups_options = cupsAddOption("raw", "true", num_cups_options, &options);
 
-    for (int i = 0; i < num_options; i++)
-    {
-        if (option_keys && option_keys[i] && option_values && option_values[i])
-        {
-            num_cups_options = cupsAddOption(option_keys[i], option_values[i], num_cups_options, &options);
-        }
-    }
+    num_cups_options = _add_normalized_cups_options(num_options, option_keys, option_values, num_cups_options, &options);
+    _job_trace_mark(&trace, JOB_STAGE_OPTIONS_PARSED);
 
+    // cupsPrintFile sends the request and streams the payload before returning the job id.
+    _job_trace_mark(&trace, JOB_STAGE_REQUEST_SENT);
+    TraceSpan submit_span;
+    _trace_begin(&submit_span, "cupsPrintFile");
+    _trace_arg_str(&submit_span, "printer", printer_name);
+    _trace_arg_str(&submit_span, "file", temp_file);
     int job_id = cupsPrintFile(printer_name, temp_file, doc_name, num_cups_options, options);
+    _trace_end(&submit_span);
+    if (job_id > 0)
+    {
+        _job_trace_mark(&trace, JOB_STAGE_JOB_ID_RETURNED);
+        _job_trace_commit(&trace, printer_name, (uint32_t)job_id);
+    }
     if (job_id <= 0)
     {
-        LOG("cupsPrintFile failed, error: %s", cupsLastErrorString());
+        LOG_WARN("cupsPrintFile failed, error: %s", cupsLastErrorString());
     }
     cupsFreeOptions(num_cups_options, options);
     unlink(temp_file);
@@ -2240,7 +8551,17 @@ FFI_PLUGIN_EXPORT int32_t submit_raw_data_job(const char *printer_name, const ui
 #endif
 }
 
-FFI_PLUGIN_EXPORT int32_t submit_pdf_job(const char *printer_name, const char *pdf_file_path, const char *doc_name, int scaling_mode, int copies, const char *page_range, int num_options, const char **option_keys, const char **option_values, const char *alignment)
+FFI_PLUGIN_EXPORT int32_t submit_raw_data_job(const char *printer_name, const uint8_t *data, int length, const char *doc_name, int num_options, const char **option_keys, const char **option_values)
+{
+    uint64_t started = _monotonic_ns();
+    const char *target = printer_name;
+    int32_t job_id = _admit_job(&target) ? _submit_raw_data_job(target, data, length, doc_name, num_options, option_keys, option_values) : 0;
+    _metrics_record(METRIC_OP_PRINT_RAW, started, job_id > 0);
+    _call_record_raw(CALL_SUBMIT_RAW, printer_name, data, length, doc_name, num_options, option_keys, option_values, started, job_id > 0, job_id);
+    return job_id;
+}
+
+static int32_t _submit_pdf_job(const char *printer_name, const char *pdf_file_path, const char *doc_name, int scaling_mode, int copies, const char *page_range, int num_options, const char **option_keys, const char **option_values, const char *alignment)
 {
     LOG("submit_pdf_job called for printer: '%s', path: '%s', doc: '%s'", printer_name, pdf_file_path, doc_name);
 
@@ -2254,23 +8575,42 @@ FFI_PLUGIN_EXPORT int32_t submit_pdf_job(const char *printer_name, const char *p
 #ifdef _WIN32
     return _print_pdf_job_win(printer_name, pdf_file_path, doc_name, scaling_mode, copies, page_range, alignment, num_options, option_keys, option_values, true);
 #else // macOS / Linux (CUPS)
+    JobTraceBuilder trace;
+    _job_trace_begin(&trace);
     cups_option_t *options = NULL;
     int num_cups_options = 0;
-    for (int i = 0; i < num_options; i++)
+    num_cups_options = _add_normalized_cups_options(num_options, option_keys, option_values, num_cups_options, &options);
+    _job_trace_mark(&trace, JOB_STAGE_OPTIONS_PARSED);
+
+    // cupsPrintFile sends the request and streams the payload before returning the job id.
+    _job_trace_mark(&trace, JOB_STAGE_REQUEST_SENT);
+    TraceSpan submit_span;
+    _trace_begin(&submit_span, "cupsPrintFile");
+    _trace_arg_str(&submit_span, "printer", printer_name);
+    _trace_arg_str(&submit_span, "file", pdf_file_path);
+    int job_id = cupsPrintFile(printer_name, pdf_file_path, doc_name, num_cups_options, options);
+    _trace_end(&submit_span);
+    if (job_id > 0)
     {
-        if (option_keys && option_keys[i] && option_values && option_values[i])
-        {
-            num_cups_options = cupsAddOption(option_keys[i], option_values[i], num_cups_options, &options);
-        }
+        _job_trace_mark(&trace, JOB_STAGE_JOB_ID_RETURNED);
+        _job_trace_commit(&trace, printer_name, (uint32_t)job_id);
     }
-
-    int job_id = cupsPrintFile(printer_name, pdf_file_path, doc_name, num_cups_options, options);
     if (job_id <= 0)
     {
-        LOG("cupsPrintFile failed, error: %s", cupsLastErrorString());
+        LOG_WARN("cupsPrintFile failed, error: %s", cupsLastErrorString());
     }
     cupsFreeOptions(num_cups_options, options);
     LOG("submit_pdf_job finished with job_id: %d", job_id);
     return job_id > 0 ? job_id : 0;
 #endif
+}
+
+FFI_PLUGIN_EXPORT int32_t submit_pdf_job(const char *printer_name, const char *pdf_file_path, const char *doc_name, int scaling_mode, int copies, const char *page_range, int num_options, const char **option_keys, const char **option_values, const char *alignment)
+{
+    uint64_t started = _monotonic_ns();
+    const char *target = printer_name;
+    int32_t job_id = _admit_job(&target) ? _submit_pdf_job(target, pdf_file_path, doc_name, scaling_mode, copies, page_range, num_options, option_keys, option_values, alignment) : 0;
+    _metrics_record(METRIC_OP_PRINT_PDF, started, job_id > 0);
+    _call_record_pdf(CALL_SUBMIT_PDF, printer_name, pdf_file_path, doc_name, scaling_mode, copies, page_range, num_options, option_keys, option_values, alignment, started, job_id > 0, job_id);
+    return job_id;
 }
\ No newline at end of file
@@ -16,6 +16,31 @@
 // Define a function pointer type for the log callback.
 typedef void (*log_callback_t)(const char* message);
 
+// Callback for batches of `count` newline-separated log lines. The callback
+// owns `messages` and must release it with free_native_string. When it is
+// replaced or unregistered it is called once more with NULL and 0, after
+// which it is never called again.
+typedef void (*log_batch_callback_t)(char* messages, int count);
+
+// Called once by prefetch_capabilities when every printer has been fetched.
+// `failed` counts printers whose query failed or returned nothing.
+typedef void (*prefetch_callback_t)(int64_t request_id, int succeeded, int failed);
+
+// Log levels for set_log_level
+#define LOG_LEVEL_OFF 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+// Codes returned by get_last_error_code. Submit functions fail with
+// PRINTING_ERROR_PRINTER_STOPPED or PRINTING_ERROR_NOT_ACCEPTING_JOBS before
+// spooling anything when admission control rejects the printer.
+#define PRINTING_ERROR_NONE 0
+#define PRINTING_ERROR_FAILED 1
+#define PRINTING_ERROR_PRINTER_STOPPED 2
+#define PRINTING_ERROR_NOT_ACCEPTING_JOBS 3
+
 // Struct for returning printer information
 typedef struct {
     char* name;
@@ -33,6 +58,34 @@ typedef struct {
     PrinterInfo* printers;
 } PrinterList;
 
+// Kinds of change reported by get_printer_changes
+#define PRINTER_CHANGE_ADDED 0
+#define PRINTER_CHANGE_MODIFIED 1
+#define PRINTER_CHANGE_REMOVED 2
+
+// Struct for a single printer directory change
+typedef struct {
+    int32_t change_type;
+    PrinterInfo printer;
+} PrinterChange;
+
+// Struct for returning the printer directory changes since a generation.
+// When `reset` is true the list is a full snapshot and replaces any previously held model.
+typedef struct {
+    uint64_t generation;
+    bool reset;
+    int count;
+    PrinterChange* changes;
+} PrinterChangeList;
+
+// Opaque handle to an open printer, see open_printer_handle
+typedef struct PrinterHandle PrinterHandle;
+
+// Scopes for cancel_all_jobs
+#define CANCEL_SCOPE_ALL_JOBS 0
+#define CANCEL_SCOPE_MY_JOBS 1
+#define CANCEL_SCOPE_PURGE 2
+
 // Struct for returning print job information
 typedef struct {
     uint32_t id;
@@ -45,6 +98,138 @@ typedef struct {
     JobInfo* jobs;
 } JobList;
 
+// Job selections for get_print_jobs_paged
+#define WHICH_JOBS_ACTIVE 0
+#define WHICH_JOBS_COMPLETED 1
+#define WHICH_JOBS_ALL 2
+
+// Attribute mask bits for get_print_jobs_paged; fields not requested are left zero/NULL
+#define JOB_ATTR_TITLE (1 << 0)
+#define JOB_ATTR_STATE (1 << 1)
+#define JOB_ATTR_USER (1 << 2)
+#define JOB_ATTR_SIZE (1 << 3)
+#define JOB_ATTR_PAGES (1 << 4)
+#define JOB_ATTR_TIMES (1 << 5)
+
+// Struct for a single row of a paginated job listing. Times are seconds since the Unix epoch.
+typedef struct {
+    uint32_t id;
+    uint32_t state;
+    char* title;
+    char* user;
+    uint32_t size_kb;
+    int32_t pages_completed;
+    int64_t created_at;
+    int64_t processing_at;
+    int64_t completed_at;
+} JobEntry;
+
+// Struct for returning one page of jobs. `has_more` is true if rows exist past this page.
+typedef struct {
+    int count;
+    bool has_more;
+    JobEntry* jobs;
+} JobPage;
+
+// Job lifecycle stages recorded by the tracer, see get_job_timings
+#define JOB_STAGE_OPTIONS_PARSED 0
+#define JOB_STAGE_SPOOLED 1
+#define JOB_STAGE_REQUEST_SENT 2
+#define JOB_STAGE_JOB_ID_RETURNED 3
+#define JOB_STAGE_FIRST_PROCESSING 4
+#define JOB_STAGE_COMPLETED 5
+#define JOB_STAGE_CANCELED 6
+#define JOB_STAGE_ABORTED 7
+#define JOB_STAGE_COUNT 8
+
+// Intervals summarized by get_job_timings
+#define JOB_INTERVAL_SUBMIT 0   // Submit call entry -> job id returned
+#define JOB_INTERVAL_QUEUED 1   // Job id returned -> first observed processing
+#define JOB_INTERVAL_PRINTING 2 // First observed processing -> completed
+#define JOB_INTERVAL_TOTAL 3    // Submit call entry -> completed
+#define JOB_INTERVAL_COUNT 4
+
+// Struct for the trace of a single job. `stage_ns` holds nanoseconds since
+// `started_ns` (monotonic clock) for each JOB_STAGE_*, or 0 if not observed.
+typedef struct {
+    uint32_t job_id;
+    char* printer_name;
+    uint64_t started_ns;
+    uint64_t stage_ns[JOB_STAGE_COUNT];
+} JobTrace;
+
+// Struct for the latency distribution of one interval on one printer
+typedef struct {
+    char* printer_name;
+    int32_t interval;
+    uint32_t samples;
+    uint64_t p50_ns;
+    uint64_t p95_ns;
+    uint64_t p99_ns;
+    uint64_t max_ns;
+} JobTimingSummary;
+
+typedef struct {
+    int trace_count;
+    JobTrace* traces;
+    int summary_count;
+    JobTimingSummary* summaries;
+} JobTimings;
+
+// Operations tracked by the metrics registry, see get_metrics_snapshot
+#define METRIC_OP_GET_PRINTERS 0
+#define METRIC_OP_GET_PRINT_JOBS 1
+#define METRIC_OP_PRINT_RAW 2    // raw_data_to_printer and submit_raw_data_job
+#define METRIC_OP_PRINT_PDF 3    // print_pdf and submit_pdf_job
+#define METRIC_OP_CAPABILITIES 4 // Get-Printer-Attributes capability queries (CUPS only)
+#define METRIC_OP_IPP_REQUEST 5  // IPP round trips to the scheduler (CUPS only)
+#define METRIC_OP_COUNT 6
+
+// Log-linear latency buckets over microseconds: buckets 0-3 cover 1us each,
+// then each power of two is split into 4 sub-buckets.
+#define METRIC_HISTOGRAM_BUCKETS 144
+
+// Struct for the counters and latency distribution of one operation
+typedef struct {
+    uint64_t calls;
+    uint64_t errors;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t buckets[METRIC_HISTOGRAM_BUCKETS];
+} OperationMetrics;
+
+typedef struct {
+    OperationMetrics operations[METRIC_OP_COUNT];
+} MetricsSnapshot;
+
+// Calls captured by start_call_recording. A recording starts with the 8-byte
+// magic "PFFIREC1", a uint32 version and the uint64 wall-clock start time in
+// milliseconds; each record follows as a uint32 length and its fields, all
+// little-endian (see _call_record_write in printing_ffi.c). The handle-based
+// variants (*_h) are recorded as the call they mirror, under the handle's
+// printer name.
+#define CALL_RECORD_VERSION 2
+#define CALL_GET_PRINTERS 0
+#define CALL_GET_PRINT_JOBS 1
+#define CALL_PRINT_RAW 2                 // raw_data_to_printer
+#define CALL_SUBMIT_RAW 3                // submit_raw_data_job
+#define CALL_PRINT_PDF 4                 // print_pdf
+#define CALL_SUBMIT_PDF 5                // submit_pdf_job
+#define CALL_PAUSE_JOB 6                 // pause_print_job
+#define CALL_RESUME_JOB 7                // resume_print_job
+#define CALL_CANCEL_JOB 8                // cancel_print_job
+#define CALL_CANCEL_JOBS 9               // cancel_jobs
+#define CALL_HOLD_JOBS 10                // hold_jobs
+#define CALL_RELEASE_JOBS 11             // release_jobs
+#define CALL_CANCEL_ALL_JOBS 12          // cancel_all_jobs
+#define CALL_GET_PRINT_JOBS_PAGED 13     // get_print_jobs_paged
+#define CALL_GET_PRINTER_STATUSES 14     // get_printer_statuses
+#define CALL_COUNT 15
+
 // Struct for a single CUPS option choice
 typedef struct {
     char* choice;
@@ -64,7 +249,8 @@ typedef struct {
     CupsOptionChoiceList supported_values;
 } CupsOption;
 
-// Struct for a list of CUPS printer options
+// Struct for a list of CUPS printer options. Lists returned by
+// get_supported_cups_options are shared and must not be modified.
 typedef struct {
     int count;
     CupsOption* options;
@@ -127,26 +313,149 @@ typedef struct {
     bool supports_landscape;
 } WindowsPrinterCapabilities;
 
+// One supply (toner, ink, ...) reported through marker-names / marker-levels.
+typedef struct {
+    char* name;
+    int level; // Percent, or IPP's -1 (unavailable), -2 (unknown) or -3 (some remaining).
+} SupplyLevel;
+
+// Struct for a printer's status, returned by get_printer_statuses
+typedef struct {
+    char* name;
+    bool found;             // false if the printer could not be read; the fields below are then unset.
+    uint32_t state;         // Same meaning as PrinterInfo.state.
+    char* state_reasons;    // Comma-separated printer-state-reasons, "none" if there are none.
+    bool is_accepting_jobs;
+    int queued_job_count;
+    int supply_count;       // Always 0 on Windows.
+    SupplyLevel* supplies;
+} PrinterStatus;
+
+typedef struct {
+    int count;
+    PrinterStatus* statuses;
+} PrinterStatusList;
+
+// A media size from the built-in PWG 5101.1 table. Strings are empty when the
+// size has no name of that kind; windows_id is 0 when it has no DMPAPER id.
+typedef struct {
+    char* pwg_name;
+    char* ppd_name;
+    char* ipp_name;
+    short windows_id;
+    float width_mm;
+    float height_mm;
+} MediaSizeInfo;
+
+// A printer's capabilities serialized into one flat buffer by
+// get_capability_snapshot. `data` points just past the struct, in the same
+// allocation, and holds `size` bytes.
+typedef struct {
+    uint8_t* data;
+    uint32_t size;
+} CapabilitySnapshot;
+
+// Capability snapshot layout. Integers are little-endian. A string field is
+// the offset from the start of the buffer to a uint32 byte length followed by
+// that many UTF-8 bytes and a NUL, or 0 for no string.
+//   header:   char magic[4] "PFCS", uint16 version, uint16 kind, uint32 size,
+//             uint32 flags, uint32 section_count
+//   sections: section_count x { uint32 offset, uint32 count, uint32 record_size }
+// CUPS (kind 1), flags 0:
+//   0 options: { string name, string default_value, uint32 first_choice, uint32 choice_count }
+//   1 choices: { string choice, string text }
+// Windows (kind 2), flags CAPABILITY_SNAPSHOT_FLAG_*:
+//   0 paper sizes:   { string name, int32 id, float width_mm, float height_mm }
+//   1 paper sources: { string name, int32 id }
+//   2 resolutions:   { int32 x_dpi, int32 y_dpi }
+//   3 media types:   { string name, int32 id }
+// Readers should use record_size as the stride so that fields appended by a
+// later version are skipped.
+#define CAPABILITY_SNAPSHOT_VERSION 1
+#define CAPABILITY_SNAPSHOT_CUPS 1
+#define CAPABILITY_SNAPSHOT_WINDOWS 2
+#define CAPABILITY_SNAPSHOT_FLAG_COLOR 1
+#define CAPABILITY_SNAPSHOT_FLAG_MONOCHROME 2
+#define CAPABILITY_SNAPSHOT_FLAG_LANDSCAPE 4
+
+// Results of validate_options
+#define OPTION_VALIDATION_ERROR -1      // The capabilities could not be loaded.
+#define OPTION_VALIDATION_OK 0
+#define OPTION_VALIDATION_UNSUPPORTED 1 // A value is not supported by the printer.
+#define OPTION_VALIDATION_CONFLICT 2    // Values violate one of the printer's constraints.
+
 FFI_PLUGIN_EXPORT int sum(int a, int b);
 FFI_PLUGIN_EXPORT int sum_long_running(int a, int b);
 FFI_PLUGIN_EXPORT PrinterList* get_printers(void);
 FFI_PLUGIN_EXPORT void register_log_callback(log_callback_t callback);
+FFI_PLUGIN_EXPORT void register_log_batch_callback(log_batch_callback_t callback);
+FFI_PLUGIN_EXPORT void set_log_level(int level);
+FFI_PLUGIN_EXPORT int get_log_level(void);
 FFI_PLUGIN_EXPORT void free_printer_list(PrinterList* printer_list);
 FFI_PLUGIN_EXPORT PrinterInfo* get_default_printer(void);
 FFI_PLUGIN_EXPORT void free_printer_info(PrinterInfo* printer_info);
+FFI_PLUGIN_EXPORT PrinterChangeList* get_printer_changes(uint64_t since_generation);
+FFI_PLUGIN_EXPORT void free_printer_change_list(PrinterChangeList* change_list);
+FFI_PLUGIN_EXPORT void invalidate_printer_caches(void);
+FFI_PLUGIN_EXPORT bool open_shared_printer_snapshot(const char* name);
+FFI_PLUGIN_EXPORT void close_shared_printer_snapshot(void);
+FFI_PLUGIN_EXPORT PrinterList* get_printers_shared(uint32_t max_age_ms);
 FFI_PLUGIN_EXPORT int open_printer_properties(const char* printer_name, intptr_t hwnd);
 FFI_PLUGIN_EXPORT bool raw_data_to_printer(const char* printer_name, const uint8_t* data, int length, const char* doc_name, int num_options, const char** option_keys, const char** option_values);
 FFI_PLUGIN_EXPORT bool print_pdf(const char* printer_name, const char* pdf_file_path, const char* doc_name, int scaling_mode, int copies, const char* page_range, int num_options, const char** option_keys, const char** option_values, const char* alignment);
 FFI_PLUGIN_EXPORT JobList* get_print_jobs(const char* printer_name);
 FFI_PLUGIN_EXPORT void free_job_list(JobList* job_list);
+FFI_PLUGIN_EXPORT PrinterStatusList* get_printer_statuses(const char** printer_names, int count);
+FFI_PLUGIN_EXPORT void free_printer_status_list(PrinterStatusList* list);
+FFI_PLUGIN_EXPORT PrinterHandle* open_printer_handle(const char* printer_name);
+FFI_PLUGIN_EXPORT void close_printer_handle(PrinterHandle* handle);
+FFI_PLUGIN_EXPORT JobList* get_print_jobs_h(PrinterHandle* handle);
 FFI_PLUGIN_EXPORT bool pause_print_job(const char* printer_name, uint32_t job_id);
 FFI_PLUGIN_EXPORT bool resume_print_job(const char* printer_name, uint32_t job_id);
 FFI_PLUGIN_EXPORT bool cancel_print_job(const char* printer_name, uint32_t job_id);
+FFI_PLUGIN_EXPORT bool pause_print_job_h(PrinterHandle* handle, uint32_t job_id);
+FFI_PLUGIN_EXPORT bool resume_print_job_h(PrinterHandle* handle, uint32_t job_id);
+FFI_PLUGIN_EXPORT bool cancel_print_job_h(PrinterHandle* handle, uint32_t job_id);
+FFI_PLUGIN_EXPORT int cancel_jobs(const char* printer_name, const uint32_t* job_ids, int count);
+FFI_PLUGIN_EXPORT int hold_jobs(const char* printer_name, const uint32_t* job_ids, int count);
+FFI_PLUGIN_EXPORT int release_jobs(const char* printer_name, const uint32_t* job_ids, int count);
+FFI_PLUGIN_EXPORT int cancel_jobs_h(PrinterHandle* handle, const uint32_t* job_ids, int count);
+FFI_PLUGIN_EXPORT int hold_jobs_h(PrinterHandle* handle, const uint32_t* job_ids, int count);
+FFI_PLUGIN_EXPORT int release_jobs_h(PrinterHandle* handle, const uint32_t* job_ids, int count);
+FFI_PLUGIN_EXPORT bool cancel_all_jobs(const char* printer_name, int scope);
+FFI_PLUGIN_EXPORT bool cancel_all_jobs_h(PrinterHandle* handle, int scope);
+FFI_PLUGIN_EXPORT JobPage* get_print_jobs_paged(const char* printer_name, int first_index, int limit, int which_jobs, bool my_jobs, uint32_t attributes);
+FFI_PLUGIN_EXPORT JobPage* get_print_jobs_paged_h(PrinterHandle* handle, int first_index, int limit, int which_jobs, bool my_jobs, uint32_t attributes);
+FFI_PLUGIN_EXPORT void free_job_page(JobPage* page);
+FFI_PLUGIN_EXPORT JobTimings* get_job_timings(const char* printer_name);
+FFI_PLUGIN_EXPORT void free_job_timings(JobTimings* timings);
+FFI_PLUGIN_EXPORT void reset_job_timings(void);
+FFI_PLUGIN_EXPORT MetricsSnapshot* get_metrics_snapshot(void);
+FFI_PLUGIN_EXPORT void free_metrics_snapshot(MetricsSnapshot* snapshot);
+FFI_PLUGIN_EXPORT void reset_metrics(void);
+FFI_PLUGIN_EXPORT char* render_metrics_prometheus(void);
+FFI_PLUGIN_EXPORT void free_native_string(char* str);
+FFI_PLUGIN_EXPORT bool start_trace_recording(const char* output_path);
+FFI_PLUGIN_EXPORT bool stop_trace_recording(void);
+FFI_PLUGIN_EXPORT bool start_call_recording(const char* output_path);
+FFI_PLUGIN_EXPORT bool stop_call_recording(void);
+FFI_PLUGIN_EXPORT bool set_capabilities_cache_dir(const char* directory);
 FFI_PLUGIN_EXPORT CupsOptionList* get_supported_cups_options(const char* printer_name);
 FFI_PLUGIN_EXPORT void free_cups_option_list(CupsOptionList* option_list);
 FFI_PLUGIN_EXPORT WindowsPrinterCapabilities* get_windows_printer_capabilities(const char* printer_name);
 FFI_PLUGIN_EXPORT void free_windows_printer_capabilities(WindowsPrinterCapabilities* capabilities);
+FFI_PLUGIN_EXPORT MediaSizeInfo* get_media_size(const char* name);
+FFI_PLUGIN_EXPORT MediaSizeInfo* get_media_size_by_windows_id(int windows_id);
+FFI_PLUGIN_EXPORT void free_media_size_info(MediaSizeInfo* info);
+FFI_PLUGIN_EXPORT CapabilitySnapshot* get_capability_snapshot(const char* printer_name);
+FFI_PLUGIN_EXPORT void free_capability_snapshot(CapabilitySnapshot* snapshot);
+FFI_PLUGIN_EXPORT int validate_options(const char* printer_name, int num_options, const char** option_keys, const char** option_values);
+FFI_PLUGIN_EXPORT bool prefetch_capabilities(const char** printers, int count, int concurrency, int64_t request_id, prefetch_callback_t callback);
 FFI_PLUGIN_EXPORT const char* get_last_error();
+FFI_PLUGIN_EXPORT int get_last_error_code(void);
+FFI_PLUGIN_EXPORT void set_admission_control(bool enabled, uint32_t max_age_ms);
+FFI_PLUGIN_EXPORT bool set_fallback_printer(const char* printer_name, const char* fallback_printer);
+FFI_PLUGIN_EXPORT const char* get_last_rerouted_printer(void);
 
 // Functions that submit a job and return a job ID for status tracking.
 FFI_PLUGIN_EXPORT int32_t submit_raw_data_job(const char* printer_name, const uint8_t* data, int length, const char* doc_name, int num_options, const char** option_keys, const char** option_values);
@@ -0,0 +1,1376 @@
+// Native benchmarks for printing_ffi.
+//
+// The benchmark compiles the library source directly so that internal helpers
+// (capability loading, page-range parsing) can be measured alongside the
+// exported API. Run it against a local stand-in rather than real printers,
+// e.g. on Linux or macOS:
+//
+//   dart run tool/mock_ipp_server.dart --port 8631 --queues 50 --complete-after 600000 &
+//   CUPS_SERVER=127.0.0.1:8631 ./printing_ffi_bench --output results.json
+//
+// Results are written as JSON so that runs can be compared over time.
+//
+// The tail_latency scenario can route all IPP traffic through an in-process
+// TCP proxy that adds delay, jitter and stalls (see --inject-* below), to
+// reproduce a print server that hiccups under concurrent load.
+//
+// `printing_ffi_bench replay <file>` re-issues calls captured with
+// start_call_recording at the recorded rate or faster.
+#define PRINTING_FFI_BENCH
+#include "printing_ffi.c"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+
+#ifndef MSG_NOSIGNAL
+// macOS has no MSG_NOSIGNAL; SIGPIPE is ignored when the proxy starts instead.
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+#define BENCH_MAX_LIST 16
+
+typedef struct
+{
+    const char *scenario;
+    char params[256]; // JSON object members.
+    int errors;
+    uint64_t *samples;
+    int count;
+    int capacity;
+    uint64_t elapsed_ns;
+    uint64_t bytes;
+} BenchResult;
+
+typedef struct
+{
+    const char *printer;
+    int iterations;
+    int payload_sizes[BENCH_MAX_LIST];
+    int payload_size_count;
+    int queue_depths[BENCH_MAX_LIST];
+    int queue_depth_count;
+    int threads;
+    int inject_delay_ms;
+    int inject_jitter_ms;
+    int inject_stall_ms;
+    double inject_stall_rate;
+} BenchConfig;
+
+static StringBuilder s_bench_json = {0};
+static int s_bench_result_count = 0;
+
+static void _bench_begin(BenchResult *result, const char *scenario, int capacity)
+{
+    memset(result, 0, sizeof(*result));
+    result->scenario = scenario;
+    result->capacity = capacity > 0 ? capacity : 1;
+    result->samples = (uint64_t *)malloc((size_t)result->capacity * sizeof(uint64_t));
+    result->elapsed_ns = _monotonic_ns();
+}
+
+static void _bench_sample(BenchResult *result, uint64_t started_ns, bool ok)
+{
+    uint64_t elapsed = _monotonic_ns() - started_ns;
+    if (!ok)
+        result->errors++;
+    if (result->samples && result->count < result->capacity)
+        result->samples[result->count++] = elapsed;
+}
+
+static double _bench_percentile_us(const uint64_t *sorted, int count, double quantile)
+{
+    if (count == 0)
+        return 0;
+    int rank = (int)(quantile * count + 0.999999);
+    if (rank < 1)
+        rank = 1;
+    return (double)sorted[rank - 1] / 1000.0;
+}
+
+// Summarizes a finished scenario into the JSON results and prints a one-line summary.
+static void _bench_end(BenchResult *result)
+{
+    result->elapsed_ns = _monotonic_ns() - result->elapsed_ns;
+    qsort(result->samples, (size_t)result->count, sizeof(uint64_t), _compare_u64);
+
+    double total_us = 0;
+    for (int i = 0; i < result->count; i++)
+        total_us += (double)result->samples[i] / 1000.0;
+    double seconds = (double)result->elapsed_ns / 1e9;
+    double mean_us = result->count ? total_us / result->count : 0;
+    double ops_per_sec = seconds > 0 ? result->count / seconds : 0;
+    double mb_per_sec = seconds > 0 ? (double)result->bytes / (1024.0 * 1024.0) / seconds : 0;
+
+    _sb_appendf(&s_bench_json,
+                "%s\n    {\"scenario\":\"%s\",\"params\":{%s},\"samples\":%d,\"errors\":%d,"
+                "\"mean_us\":%.3f,\"p50_us\":%.3f,\"p90_us\":%.3f,\"p99_us\":%.3f,\"p999_us\":%.3f,\"max_us\":%.3f,"
+                "\"ops_per_sec\":%.3f,\"mb_per_sec\":%.3f}",
+                s_bench_result_count++ ? "," : "", result->scenario, result->params, result->count, result->errors,
+                mean_us, _bench_percentile_us(result->samples, result->count, 0.50),
+                _bench_percentile_us(result->samples, result->count, 0.90),
+                _bench_percentile_us(result->samples, result->count, 0.99),
+                _bench_percentile_us(result->samples, result->count, 0.999),
+                _bench_percentile_us(result->samples, result->count, 1.0),
+                ops_per_sec, mb_per_sec);
+    fprintf(stderr, "%-14s {%s} n=%d errors=%d p50=%.1fus p99=%.1fus %.1f ops/s\n",
+            result->scenario, result->params, result->count, result->errors,
+            _bench_percentile_us(result->samples, result->count, 0.50),
+            _bench_percentile_us(result->samples, result->count, 0.99), ops_per_sec);
+    free(result->samples);
+    result->samples = NULL;
+}
+
+// Worker threads, declared with BENCH_THREAD(name) and ended with BENCH_THREAD_RETURN.
+#ifdef _WIN32
+typedef HANDLE bench_thread_t;
+typedef LPTHREAD_START_ROUTINE bench_thread_entry_t;
+#define BENCH_THREAD(name) DWORD WINAPI name(LPVOID arg)
+#define BENCH_THREAD_RETURN return 0
+#else
+typedef pthread_t bench_thread_t;
+typedef void *(*bench_thread_entry_t)(void *);
+#define BENCH_THREAD(name) void *name(void *arg)
+#define BENCH_THREAD_RETURN return NULL
+#endif
+
+static bool _bench_thread_start(bench_thread_t *thread, bench_thread_entry_t entry, void *arg)
+{
+#ifdef _WIN32
+    *thread = CreateThread(NULL, 0, entry, arg, 0, NULL);
+    return *thread != NULL;
+#else
+    return pthread_create(thread, NULL, entry, arg) == 0;
+#endif
+}
+
+static void _bench_thread_join(bench_thread_t thread)
+{
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+// --- Latency injection proxy ---
+
+#ifndef _WIN32
+// A TCP proxy between libcups and the upstream server. Every chunk forwarded
+// in either direction is delayed by delay + uniform(0, jitter) milliseconds,
+// and with probability `stall_rate` additionally stalls for `stall_ms`.
+typedef struct
+{
+    char upstream_host[256];
+    char upstream_port[16];
+    int delay_ms;
+    int jitter_ms;
+    int stall_ms;
+    double stall_rate;
+    int listen_fd;
+    char address[64]; // host:port to use as the CUPS server.
+    uint64_t stalls;
+} BenchProxy;
+
+static BenchProxy s_bench_proxy;
+
+static int _proxy_connect_upstream(void)
+{
+    struct addrinfo hints = {0}, *addresses = NULL;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(s_bench_proxy.upstream_host, s_bench_proxy.upstream_port, &hints, &addresses) != 0)
+        return -1;
+    int fd = -1;
+    for (struct addrinfo *a = addresses; a && fd < 0; a = a->ai_next)
+    {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    return fd;
+}
+
+static void _proxy_inject(unsigned int *seed)
+{
+    unsigned int delay_ms = (unsigned int)s_bench_proxy.delay_ms;
+    if (s_bench_proxy.jitter_ms > 0)
+        delay_ms += (unsigned int)(rand_r(seed) % (s_bench_proxy.jitter_ms + 1));
+    if (s_bench_proxy.stall_rate > 0 && (double)rand_r(seed) / RAND_MAX < s_bench_proxy.stall_rate)
+    {
+        delay_ms += (unsigned int)s_bench_proxy.stall_ms;
+        ffi_atomic_add_u64(&s_bench_proxy.stalls, 1);
+    }
+    if (delay_ms > 0)
+        _log_sleep_ms(delay_ms);
+}
+
+static bool _proxy_send_all(int fd, const char *data, ssize_t length)
+{
+    while (length > 0)
+    {
+        ssize_t sent = send(fd, data, (size_t)length, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false;
+        data += sent;
+        length -= sent;
+    }
+    return true;
+}
+
+static void *_proxy_connection_thread(void *arg)
+{
+    int client = (int)(intptr_t)arg;
+    int upstream = _proxy_connect_upstream();
+    if (upstream < 0)
+    {
+        close(client);
+        return NULL;
+    }
+    int one = 1;
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(upstream, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    unsigned int seed = (unsigned int)_monotonic_ns() ^ (unsigned int)client;
+    struct pollfd fds[2] = {{client, POLLIN, 0}, {upstream, POLLIN, 0}};
+    char buffer[65536];
+    bool open = true;
+    while (open)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        for (int i = 0; i < 2 && open; i++)
+        {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            ssize_t received = recv(fds[i].fd, buffer, sizeof(buffer), 0);
+            if (received <= 0)
+            {
+                open = false;
+                break;
+            }
+            _proxy_inject(&seed);
+            open = _proxy_send_all(fds[1 - i].fd, buffer, received);
+        }
+    }
+    close(client);
+    close(upstream);
+    return NULL;
+}
+
+static void *_proxy_accept_thread(void *arg)
+{
+    (void)arg;
+    for (;;)
+    {
+        int client = accept(s_bench_proxy.listen_fd, NULL, NULL);
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            return NULL;
+        }
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, _proxy_connection_thread, (void *)(intptr_t)client) == 0)
+            pthread_detach(thread);
+        else
+            close(client);
+    }
+}
+
+// Starts the proxy in front of the server libcups would otherwise use and
+// makes it the default server for every thread. Returns false on failure.
+static bool _proxy_start(const BenchConfig *config)
+{
+    s_bench_proxy.delay_ms = config->inject_delay_ms;
+    s_bench_proxy.jitter_ms = config->inject_jitter_ms;
+    s_bench_proxy.stall_ms = config->inject_stall_ms;
+    s_bench_proxy.stall_rate = config->inject_stall_rate;
+
+    // Only TCP servers can be proxied; a domain socket path falls back to the local scheduler.
+    const char *server = cupsServer();
+    if (!server || server[0] == '/')
+        server = "localhost:631";
+    snprintf(s_bench_proxy.upstream_host, sizeof(s_bench_proxy.upstream_host), "%s", server);
+    char *colon = strrchr(s_bench_proxy.upstream_host, ':');
+    if (colon)
+    {
+        *colon = '\0';
+        snprintf(s_bench_proxy.upstream_port, sizeof(s_bench_proxy.upstream_port), "%s", colon + 1);
+    }
+    else
+    {
+        snprintf(s_bench_proxy.upstream_port, sizeof(s_bench_proxy.upstream_port), "631");
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    s_bench_proxy.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (s_bench_proxy.listen_fd < 0 ||
+        bind(s_bench_proxy.listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(s_bench_proxy.listen_fd, 128) != 0 ||
+        getsockname(s_bench_proxy.listen_fd, (struct sockaddr *)&address, &length) != 0)
+    {
+        fprintf(stderr, "proxy: failed to listen, errno %d\n", errno);
+        return false;
+    }
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, _proxy_accept_thread, NULL) != 0)
+        return false;
+    pthread_detach(thread);
+
+    snprintf(s_bench_proxy.address, sizeof(s_bench_proxy.address), "127.0.0.1:%d", ntohs(address.sin_port));
+    // New threads pick the server up from the environment; the calling thread
+    // needs cupsSetServer because libcups caches the server per thread.
+    setenv("CUPS_SERVER", s_bench_proxy.address, 1);
+    cupsSetServer(s_bench_proxy.address);
+    fprintf(stderr, "proxy: %s -> %s:%s, delay %dms, jitter %dms, stall %dms at rate %.4f\n",
+            s_bench_proxy.address, s_bench_proxy.upstream_host, s_bench_proxy.upstream_port,
+            config->inject_delay_ms, config->inject_jitter_ms, config->inject_stall_ms, config->inject_stall_rate);
+    return true;
+}
+#endif
+
+// --- Scenarios ---
+
+// Printer enumeration latency. The queue count is whatever the server exposes,
+// so run it against mock servers with different --queues to get the curve.
+static void _bench_enumerate(const BenchConfig *config)
+{
+    BenchResult result;
+    _bench_begin(&result, "enumerate", config->iterations);
+    int queues = 0;
+    for (int i = 0; i < config->iterations; i++)
+    {
+        uint64_t started = _monotonic_ns();
+        PrinterList *list = get_printers();
+        _bench_sample(&result, started, list != NULL);
+        if (list)
+        {
+            queues = list->count;
+            free_printer_list(list);
+        }
+    }
+    snprintf(result.params, sizeof(result.params), "\"queues\":%d", queues);
+    _bench_end(&result);
+}
+
+// Raw submission throughput for each payload size.
+static void _bench_submit_raw(const BenchConfig *config)
+{
+    for (int s = 0; s < config->payload_size_count; s++)
+    {
+        int size = config->payload_sizes[s];
+        uint8_t *payload = (uint8_t *)malloc((size_t)size);
+        if (!payload)
+            continue;
+        for (int i = 0; i < size; i++)
+            payload[i] = (uint8_t)(i * 31 + 7);
+
+        BenchResult result;
+        _bench_begin(&result, "submit_raw", config->iterations);
+        snprintf(result.params, sizeof(result.params), "\"payload_bytes\":%d", size);
+        for (int i = 0; i < config->iterations; i++)
+        {
+            uint64_t started = _monotonic_ns();
+            int32_t job_id = submit_raw_data_job(config->printer, payload, size, "printing_ffi_bench", 0, NULL, NULL);
+            _bench_sample(&result, started, job_id > 0);
+            if (job_id > 0)
+                result.bytes += (uint64_t)size;
+        }
+        _bench_end(&result);
+        free(payload);
+    }
+}
+
+// Job-status polling cost as the queue grows. Jobs are submitted until each
+// target depth is reached; the server should be configured not to complete
+// them during the run (e.g. a large --complete-after on the mock server).
+static void _bench_poll_jobs(const BenchConfig *config)
+{
+    static const uint8_t payload[64] = {0};
+    cancel_all_jobs(config->printer, CANCEL_SCOPE_PURGE);
+    int queued = 0;
+
+    for (int d = 0; d < config->queue_depth_count; d++)
+    {
+        int depth = config->queue_depths[d];
+        while (queued < depth && submit_raw_data_job(config->printer, payload, (int)sizeof(payload), "printing_ffi_bench poll", 0, NULL, NULL) > 0)
+            queued++;
+
+        BenchResult result;
+        _bench_begin(&result, "poll_jobs", config->iterations);
+        int observed = 0;
+        for (int i = 0; i < config->iterations; i++)
+        {
+            uint64_t started = _monotonic_ns();
+            JobList *list = get_print_jobs(config->printer);
+            _bench_sample(&result, started, list != NULL);
+            if (list)
+            {
+                observed = list->count;
+                free_job_list(list);
+            }
+        }
+        snprintf(result.params, sizeof(result.params), "\"queue_depth\":%d", observed);
+        _bench_end(&result);
+    }
+    cancel_all_jobs(config->printer, CANCEL_SCOPE_PURGE);
+}
+
+// Capability query and option building, bypassing the option cache.
+static void _bench_cups_options(const BenchConfig *config)
+{
+#ifdef _WIN32
+    (void)config;
+    fprintf(stderr, "cups_options: skipped, CUPS options are only available with CUPS\n");
+#else
+    // Cold: a full Get-Printer-Attributes request and option build on every call.
+    BenchResult result;
+    _bench_begin(&result, "cups_options", config->iterations);
+    int options = 0;
+    for (int i = 0; i < config->iterations; i++)
+    {
+        uint64_t started = _monotonic_ns();
+        time_t change_time = 0;
+        CupsOptionList *list = _load_ipp_options(config->printer, &change_time);
+        _bench_sample(&result, started, list != NULL && list->count > 0);
+        if (list)
+        {
+            options = list->count;
+            free_cups_option_list(list);
+        }
+    }
+    snprintf(result.params, sizeof(result.params), "\"options\":%d,\"cache\":\"cold\"", options);
+    _bench_end(&result);
+
+    // Warm: get_supported_cups_options revalidating its cached, shared list.
+    free_cups_option_list(get_supported_cups_options(config->printer));
+    _bench_begin(&result, "cups_options", config->iterations);
+    for (int i = 0; i < config->iterations; i++)
+    {
+        uint64_t started = _monotonic_ns();
+        CupsOptionList *list = get_supported_cups_options(config->printer);
+        _bench_sample(&result, started, list != NULL && list->count > 0);
+        free_cups_option_list(list);
+    }
+    snprintf(result.params, sizeof(result.params), "\"options\":%d,\"cache\":\"warm\"", options);
+    _bench_end(&result);
+#endif
+}
+
+// Page-range parsing for a 500-page document. Each sample times a batch of
+// parses so that the clock overhead does not dominate.
+static void _bench_page_range(const BenchConfig *config)
+{
+    static const char *const ranges[] = {"", "1-500", "1,3,5,7,9,11,13,15,17,19,21,23,25,27,29,31", "1-10, 20-30, 40-50, 60-70, 80-90, 100-110, 400-500"};
+    enum
+    {
+        TOTAL_PAGES = 500,
+        BATCH = 100
+    };
+    bool page_flags[TOTAL_PAGES];
+
+    for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++)
+    {
+        BenchResult result;
+        _bench_begin(&result, "page_range", config->iterations);
+        snprintf(result.params, sizeof(result.params), "\"range\":\"%s\",\"pages\":%d,\"batch\":%d", ranges[r], TOTAL_PAGES, BATCH);
+        for (int i = 0; i < config->iterations; i++)
+        {
+            uint64_t started = _monotonic_ns();
+            bool ok = true;
+            for (int b = 0; b < BATCH; b++)
+                ok = parse_page_range(ranges[r], page_flags, TOTAL_PAGES) && ok;
+            _bench_sample(&result, started, ok);
+        }
+        _bench_end(&result);
+    }
+}
+
+// Submission and status polling latency under concurrency. Each worker
+// alternates a small raw submit with a job listing on its own connection.
+typedef struct
+{
+    const BenchConfig *config;
+    BenchResult submit;
+    BenchResult poll;
+} TailWorker;
+
+static BENCH_THREAD(_bench_tail_worker)
+{
+    TailWorker *worker = (TailWorker *)arg;
+    const BenchConfig *config = worker->config;
+    static const uint8_t payload[512] = {0};
+#ifndef _WIN32
+    if (s_bench_proxy.address[0])
+        cupsSetServer(s_bench_proxy.address);
+#endif
+    for (int i = 0; i < config->iterations; i++)
+    {
+        uint64_t started = _monotonic_ns();
+        int32_t job_id = submit_raw_data_job(config->printer, payload, (int)sizeof(payload), "printing_ffi_bench tail", 0, NULL, NULL);
+        _bench_sample(&worker->submit, started, job_id > 0);
+
+        started = _monotonic_ns();
+        JobList *list = get_print_jobs(config->printer);
+        _bench_sample(&worker->poll, started, list != NULL);
+        free_job_list(list);
+    }
+    BENCH_THREAD_RETURN;
+}
+
+static void _bench_tail_latency(const BenchConfig *config)
+{
+    int threads = config->threads;
+    TailWorker *workers = (TailWorker *)calloc((size_t)threads, sizeof(TailWorker));
+    if (!workers)
+        return;
+    BenchResult submit, poll;
+    _bench_begin(&submit, "tail_submit", threads * config->iterations);
+    _bench_begin(&poll, "tail_poll", threads * config->iterations);
+
+    bench_thread_t *handles = (bench_thread_t *)calloc((size_t)threads, sizeof(bench_thread_t));
+    bool *started = (bool *)calloc((size_t)threads, sizeof(bool));
+    for (int t = 0; t < threads && handles && started; t++)
+    {
+        workers[t].config = config;
+        _bench_begin(&workers[t].submit, "tail_submit", config->iterations);
+        _bench_begin(&workers[t].poll, "tail_poll", config->iterations);
+        started[t] = _bench_thread_start(&handles[t], _bench_tail_worker, &workers[t]);
+    }
+    for (int t = 0; t < threads && handles && started; t++)
+    {
+        if (started[t])
+            _bench_thread_join(handles[t]);
+        // Merge the per-thread samples so that percentiles cover every call.
+        BenchResult *parts[2] = {&workers[t].submit, &workers[t].poll};
+        BenchResult *totals[2] = {&submit, &poll};
+        for (int k = 0; k < 2; k++)
+        {
+            for (int i = 0; i < parts[k]->count && totals[k]->count < totals[k]->capacity; i++)
+                totals[k]->samples[totals[k]->count++] = parts[k]->samples[i];
+            totals[k]->errors += parts[k]->errors;
+            free(parts[k]->samples);
+        }
+    }
+    free(started);
+    free(handles);
+    free(workers);
+
+    for (int k = 0; k < 2; k++)
+    {
+        BenchResult *result = k == 0 ? &submit : &poll;
+        snprintf(result->params, sizeof(result->params),
+                 "\"threads\":%d,\"delay_ms\":%d,\"jitter_ms\":%d,\"stall_ms\":%d,\"stall_rate\":%.4f",
+                 threads, config->inject_delay_ms, config->inject_jitter_ms, config->inject_stall_ms, config->inject_stall_rate);
+        _bench_end(result);
+    }
+    cancel_all_jobs(config->printer, CANCEL_SCOPE_PURGE);
+}
+
+typedef struct
+{
+    const char *name;
+    void (*run)(const BenchConfig *config);
+    bool needs_printer;
+} BenchScenario;
+
+static const BenchScenario s_bench_scenarios[] = {
+    {"enumerate", _bench_enumerate, false},
+    {"submit_raw", _bench_submit_raw, true},
+    {"poll_jobs", _bench_poll_jobs, true},
+    {"cups_options", _bench_cups_options, true},
+    {"page_range", _bench_page_range, false},
+    {"tail_latency", _bench_tail_latency, true},
+};
+
+// --- Replay ---
+
+// Re-issues a recording made with start_call_recording, keeping the recorded
+// spacing between calls (scaled by --speed) so that real burst shapes reach
+// the server. Calls that overlapped when recorded overlap again, up to
+// --threads at a time. Raw payloads are replaced by zeroes of the recorded size.
+// Job control calls act on the jobs their recorded submits created in the
+// replay; a job whose submit was not replayed keeps its recorded id.
+typedef struct
+{
+    int call;
+    bool ok;
+    int64_t result;
+    uint32_t replayed_job_id; // Set once a replayed submit returns; guarded by s_replay_lock.
+    uint64_t offset_ns;
+    uint64_t duration_ns;
+    int copies;
+    int scaling_mode;
+    uint64_t payload_size;
+    char *strings[5]; // Printer, document name, PDF path, page range and alignment.
+    int num_options;
+    char **option_keys;
+    char **option_values;
+    int num_values;
+    uint32_t *values; // Job ids, or the scope or paging arguments.
+    int num_names;
+    char **names; // The printers of a status sweep.
+} ReplayCall;
+
+typedef struct
+{
+    uint32_t recorded_job_id;
+    int call_index; // The submit that returned recorded_job_id.
+} ReplayJob;
+
+typedef struct
+{
+    ReplayCall *calls;
+    int count;
+    ReplayJob *jobs; // Sorted by recorded_job_id.
+    int job_count;
+    double speed; // 0 replays as fast as possible.
+    const char *printer;       // Replaces the recorded printer when set.
+    const char *pdf_file_path; // Replaces the recorded PDF path when set.
+    const uint8_t *payload;
+    uint64_t next;
+    uint64_t started_ns;
+    int skipped;
+    BenchResult results[CALL_COUNT];
+    BenchResult lag;
+} ReplayState;
+
+typedef struct
+{
+    const uint8_t *p;
+    const uint8_t *end;
+    bool failed;
+} ReplayReader;
+
+static const char *s_replay_call_names[CALL_COUNT] = {
+    "get_printers", "get_print_jobs", "print_raw", "submit_raw", "print_pdf", "submit_pdf", "pause_job", "resume_job",
+    "cancel_job", "cancel_jobs", "hold_jobs", "release_jobs", "cancel_all_jobs", "get_print_jobs_paged", "get_printer_statuses"};
+
+static ffi_mutex_t s_replay_lock = FFI_MUTEX_INITIALIZER;
+
+static uint64_t _replay_get(ReplayReader *reader, int bytes)
+{
+    if (reader->failed || reader->end - reader->p < bytes)
+    {
+        reader->failed = true;
+        return 0;
+    }
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++)
+        value |= (uint64_t)reader->p[i] << (8 * i);
+    reader->p += bytes;
+    return value;
+}
+
+// Returns a copy of the next string, or NULL if it was recorded as NULL or the record is truncated.
+static char *_replay_get_string(ReplayReader *reader)
+{
+    uint64_t length = _replay_get(reader, 2);
+    if (reader->failed || length == CALL_RECORD_NULL_STRING)
+        return NULL;
+    if ((uint64_t)(reader->end - reader->p) < length)
+    {
+        reader->failed = true;
+        return NULL;
+    }
+    char *value = (char *)malloc((size_t)length + 1);
+    if (!value)
+    {
+        reader->failed = true;
+        return NULL;
+    }
+    memcpy(value, reader->p, (size_t)length);
+    value[length] = '\0';
+    reader->p += length;
+    return value;
+}
+
+static void _replay_free_call(ReplayCall *call)
+{
+    for (int s = 0; s < 5; s++)
+        free(call->strings[s]);
+    for (int o = 0; o < call->num_options; o++)
+    {
+        if (call->option_keys)
+            free(call->option_keys[o]);
+        if (call->option_values)
+            free(call->option_values[o]);
+    }
+    free(call->option_keys);
+    free(call->option_values);
+    free(call->values);
+    for (int n = 0; n < call->num_names && call->names; n++)
+        free(call->names[n]);
+    free(call->names);
+}
+
+static void _replay_free_calls(ReplayCall *calls, int count)
+{
+    for (int i = 0; i < count; i++)
+        _replay_free_call(&calls[i]);
+    free(calls);
+}
+
+static int _replay_compare_offset(const void *a, const void *b)
+{
+    uint64_t x = ((const ReplayCall *)a)->offset_ns, y = ((const ReplayCall *)b)->offset_ns;
+    return x < y ? -1 : x > y;
+}
+
+static int _replay_compare_job(const void *a, const void *b)
+{
+    uint32_t x = ((const ReplayJob *)a)->recorded_job_id, y = ((const ReplayJob *)b)->recorded_job_id;
+    return x < y ? -1 : x > y;
+}
+
+// Indexes the job ids returned by recorded submits, so that job control calls
+// can be pointed at the jobs the replay creates.
+static void _replay_index_jobs(ReplayState *state)
+{
+    state->jobs = (ReplayJob *)malloc((size_t)(state->count ? state->count : 1) * sizeof(ReplayJob));
+    if (!state->jobs)
+        return;
+    for (int i = 0; i < state->count; i++)
+    {
+        const ReplayCall *call = &state->calls[i];
+        if ((call->call == CALL_SUBMIT_RAW || call->call == CALL_SUBMIT_PDF) && call->result > 0 && call->result <= UINT32_MAX)
+            state->jobs[state->job_count++] = (ReplayJob){(uint32_t)call->result, i};
+    }
+    qsort(state->jobs, (size_t)state->job_count, sizeof(ReplayJob), _replay_compare_job);
+}
+
+// Reads a recording into `state`. Returns false and prints why on failure.
+static bool _replay_load(const char *path, ReplayState *state)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "replay: cannot open %s\n", path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = size > 0 ? (uint8_t *)malloc((size_t)size) : NULL;
+    bool read = data && fread(data, 1, (size_t)size, file) == (size_t)size;
+    fclose(file);
+
+    ReplayReader header = {data, data + (read ? size : 0), false};
+    if (!read || size < 20 || memcmp(data, CALL_RECORD_MAGIC, 8) != 0)
+    {
+        fprintf(stderr, "replay: %s is not a call recording\n", path);
+        free(data);
+        return false;
+    }
+    header.p += 8;
+    uint64_t version = _replay_get(&header, 4);
+    uint64_t started_ms = _replay_get(&header, 8);
+    if (version < 1 || version > CALL_RECORD_VERSION)
+    {
+        fprintf(stderr, "replay: unsupported recording version %llu\n", (unsigned long long)version);
+        free(data);
+        return false;
+    }
+
+    int capacity = 0;
+    while (header.p < header.end)
+    {
+        uint64_t length = _replay_get(&header, 4);
+        if (header.failed || (uint64_t)(header.end - header.p) < length)
+        {
+            fprintf(stderr, "replay: recording is truncated after %d calls\n", state->count);
+            break;
+        }
+        ReplayReader reader = {header.p, header.p + length, false};
+        header.p += length;
+
+        if (state->count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 1024;
+            ReplayCall *calls = (ReplayCall *)realloc(state->calls, (size_t)capacity * sizeof(ReplayCall));
+            if (!calls)
+                break;
+            state->calls = calls;
+        }
+        ReplayCall *call = &state->calls[state->count];
+        memset(call, 0, sizeof(*call));
+        call->call = (int)_replay_get(&reader, 1);
+        call->ok = _replay_get(&reader, 1) != 0;
+        call->num_options = (int)_replay_get(&reader, 2);
+        call->offset_ns = _replay_get(&reader, 8);
+        call->duration_ns = _replay_get(&reader, 8);
+        call->result = (int64_t)_replay_get(&reader, 8);
+        call->copies = (int)(int32_t)_replay_get(&reader, 4);
+        call->scaling_mode = (int)(int32_t)_replay_get(&reader, 4);
+        call->payload_size = _replay_get(&reader, 8);
+        _replay_get(&reader, 8); // Payload hash.
+        for (int s = 0; s < 5; s++)
+            call->strings[s] = _replay_get_string(&reader);
+        if (call->num_options > 0)
+        {
+            call->option_keys = (char **)calloc((size_t)call->num_options, sizeof(char *));
+            call->option_values = (char **)calloc((size_t)call->num_options, sizeof(char *));
+            if (!call->option_keys || !call->option_values)
+                reader.failed = true;
+            for (int o = 0; o < call->num_options && !reader.failed; o++)
+            {
+                call->option_keys[o] = _replay_get_string(&reader);
+                call->option_values[o] = _replay_get_string(&reader);
+            }
+        }
+        if (version >= 2)
+        {
+            call->num_values = (int)_replay_get(&reader, 2);
+            call->values = call->num_values > 0 ? (uint32_t *)calloc((size_t)call->num_values, sizeof(uint32_t)) : NULL;
+            if (call->num_values > 0 && !call->values)
+                reader.failed = true;
+            for (int v = 0; v < call->num_values && !reader.failed; v++)
+                call->values[v] = (uint32_t)_replay_get(&reader, 4);
+            call->num_names = (int)_replay_get(&reader, 2);
+            call->names = call->num_names > 0 ? (char **)calloc((size_t)call->num_names, sizeof(char *)) : NULL;
+            if (call->num_names > 0 && !call->names)
+                reader.failed = true;
+            for (int n = 0; n < call->num_names && !reader.failed; n++)
+                call->names[n] = _replay_get_string(&reader);
+        }
+        // Calls from newer library versions are skipped rather than treated as corrupt.
+        if (reader.failed || call->call < 0 || call->call >= CALL_COUNT)
+        {
+            _replay_free_call(call);
+            state->skipped++;
+            continue;
+        }
+        state->count++;
+    }
+    free(data);
+    // Calls are recorded as they complete; replay them in the order they started.
+    qsort(state->calls, (size_t)state->count, sizeof(ReplayCall), _replay_compare_offset);
+    _replay_index_jobs(state);
+    fprintf(stderr, "replay: %d calls recorded at %llu (unix ms)\n", state->count, (unsigned long long)started_ms);
+    return true;
+}
+
+static void _replay_wait_until(uint64_t due_ns)
+{
+    for (;;)
+    {
+        uint64_t now = _monotonic_ns();
+        if (now >= due_ns)
+            return;
+        // Sleep while more than a millisecond away, then spin for precision.
+        uint64_t remaining_ms = (due_ns - now) / 1000000;
+        if (remaining_ms > 1)
+            _log_sleep_ms((unsigned int)(remaining_ms - 1));
+    }
+}
+
+// Returns the id the replay gave the job a recorded submit returned as `recorded`.
+static uint32_t _replay_job_id(const ReplayState *state, uint32_t recorded)
+{
+    ReplayJob key = {recorded, 0};
+    const ReplayJob *job = state->jobs ? (const ReplayJob *)bsearch(&key, state->jobs, (size_t)state->job_count, sizeof(ReplayJob), _replay_compare_job) : NULL;
+    if (!job)
+        return recorded;
+    ffi_mutex_lock(&s_replay_lock);
+    uint32_t replayed = state->calls[job->call_index].replayed_job_id;
+    ffi_mutex_unlock(&s_replay_lock);
+    return replayed ? replayed : recorded;
+}
+
+static void _replay_set_job_id(ReplayCall *call, int32_t job_id)
+{
+    if (job_id <= 0)
+        return;
+    ffi_mutex_lock(&s_replay_lock);
+    call->replayed_job_id = (uint32_t)job_id;
+    ffi_mutex_unlock(&s_replay_lock);
+}
+
+// Replays a bulk job call with its job ids mapped to the replayed jobs.
+static int _replay_bulk(const ReplayState *state, const ReplayCall *call, const char *printer)
+{
+    if (call->num_values == 0)
+        return -1;
+    uint32_t *ids = (uint32_t *)malloc((size_t)call->num_values * sizeof(uint32_t));
+    if (!ids)
+        return -1;
+    for (int i = 0; i < call->num_values; i++)
+        ids[i] = _replay_job_id(state, call->values[i]);
+    int (*action)(const char *, const uint32_t *, int) = call->call == CALL_CANCEL_JOBS ? cancel_jobs : call->call == CALL_HOLD_JOBS ? hold_jobs : release_jobs;
+    int succeeded = action(printer, ids, call->num_values);
+    free(ids);
+    return succeeded == call->num_values;
+}
+
+// Issues one recorded call. Returns 1 on success, 0 on failure and -1 if it cannot be replayed.
+static int _replay_issue(const ReplayState *state, ReplayCall *call)
+{
+    const char *printer = state->printer ? state->printer : call->strings[0];
+    const char *doc_name = call->strings[1] ? call->strings[1] : "printing_ffi_bench replay";
+    const char **keys = (const char **)call->option_keys;
+    const char **values = (const char **)call->option_values;
+    switch (call->call)
+    {
+    case CALL_GET_PRINTERS:
+    {
+        PrinterList *list = get_printers();
+        free_printer_list(list);
+        return list != NULL;
+    }
+    case CALL_GET_PRINT_JOBS:
+    {
+        JobList *list = get_print_jobs(printer);
+        free_job_list(list);
+        return list != NULL;
+    }
+    case CALL_PRINT_RAW:
+    case CALL_SUBMIT_RAW:
+        if (call->payload_size > INT_MAX)
+            return -1;
+        if (call->call == CALL_PRINT_RAW)
+            return raw_data_to_printer(printer, state->payload, (int)call->payload_size, doc_name, call->num_options, keys, values);
+    {
+        int32_t job_id = submit_raw_data_job(printer, state->payload, (int)call->payload_size, doc_name, call->num_options, keys, values);
+        _replay_set_job_id(call, job_id);
+        return job_id > 0;
+    }
+    case CALL_PRINT_PDF:
+    case CALL_SUBMIT_PDF:
+    {
+        const char *path = state->pdf_file_path ? state->pdf_file_path : call->strings[2];
+        FILE *file = path ? fopen(path, "rb") : NULL;
+        if (!file)
+            return -1;
+        fclose(file);
+        if (call->call == CALL_PRINT_PDF)
+            return print_pdf(printer, path, doc_name, call->scaling_mode, call->copies, call->strings[3], call->num_options, keys, values, call->strings[4]);
+        int32_t job_id = submit_pdf_job(printer, path, doc_name, call->scaling_mode, call->copies, call->strings[3], call->num_options, keys, values, call->strings[4]);
+        _replay_set_job_id(call, job_id);
+        return job_id > 0;
+    }
+    case CALL_PAUSE_JOB:
+    case CALL_RESUME_JOB:
+    case CALL_CANCEL_JOB:
+    {
+        if (call->num_values != 1)
+            return -1;
+        uint32_t job_id = _replay_job_id(state, call->values[0]);
+        if (call->call == CALL_PAUSE_JOB)
+            return pause_print_job(printer, job_id);
+        if (call->call == CALL_RESUME_JOB)
+            return resume_print_job(printer, job_id);
+        return cancel_print_job(printer, job_id);
+    }
+    case CALL_CANCEL_JOBS:
+    case CALL_HOLD_JOBS:
+    case CALL_RELEASE_JOBS:
+        return _replay_bulk(state, call, printer);
+    case CALL_CANCEL_ALL_JOBS:
+        if (call->num_values != 1)
+            return -1;
+        return cancel_all_jobs(printer, (int)call->values[0]);
+    case CALL_GET_PRINT_JOBS_PAGED:
+    {
+        if (call->num_values != 5)
+            return -1;
+        const uint32_t *args = call->values;
+        JobPage *page = get_print_jobs_paged(printer, (int)args[0], (int)args[1], (int)args[2], args[3] != 0, args[4]);
+        free_job_page(page);
+        return page != NULL;
+    }
+    case CALL_GET_PRINTER_STATUSES:
+    {
+        // With --printer set, every recorded name is swept as that printer.
+        const char **names = call->num_names > 0 ? (const char **)calloc((size_t)call->num_names, sizeof(char *)) : NULL;
+        if (call->num_names > 0 && !names)
+            return -1;
+        for (int n = 0; n < call->num_names; n++)
+            names[n] = state->printer ? state->printer : call->names[n];
+        PrinterStatusList *list = get_printer_statuses(names, call->num_names);
+        free(names);
+        free_printer_status_list(list);
+        return list != NULL;
+    }
+    default:
+        return -1;
+    }
+}
+
+static BENCH_THREAD(_replay_worker)
+{
+    ReplayState *state = (ReplayState *)arg;
+    for (;;)
+    {
+        uint64_t index = ffi_atomic_add_u64(&state->next, 1);
+        if (index >= (uint64_t)state->count)
+            break;
+        ReplayCall *call = &state->calls[index];
+        uint64_t due = state->started_ns + (state->speed > 0 ? (uint64_t)((double)call->offset_ns / state->speed) : 0);
+        _replay_wait_until(due);
+
+        uint64_t started = _monotonic_ns();
+        int outcome = _replay_issue(state, call);
+        uint64_t ended = _monotonic_ns();
+
+        ffi_mutex_lock(&s_replay_lock);
+        if (outcome < 0)
+        {
+            state->skipped++;
+        }
+        else
+        {
+            BenchResult *result = &state->results[call->call];
+            if (result->count < result->capacity)
+                result->samples[result->count++] = ended - started;
+            if (!outcome)
+                result->errors++;
+            if (state->speed > 0 && state->lag.count < state->lag.capacity)
+                state->lag.samples[state->lag.count++] = started - due;
+        }
+        ffi_mutex_unlock(&s_replay_lock);
+    }
+    BENCH_THREAD_RETURN;
+}
+
+// Replays the calls of each kind and reports their latency next to the recorded latency.
+static void _bench_replay(ReplayState *state, const char *speed_label, int threads)
+{
+    int counts[CALL_COUNT] = {0};
+    uint64_t payload_size = 1;
+    for (int i = 0; i < state->count; i++)
+    {
+        counts[state->calls[i].call]++;
+        if ((state->calls[i].call == CALL_PRINT_RAW || state->calls[i].call == CALL_SUBMIT_RAW) &&
+            state->calls[i].payload_size > payload_size && state->calls[i].payload_size <= INT_MAX)
+            payload_size = state->calls[i].payload_size;
+    }
+    uint8_t *payload = (uint8_t *)calloc((size_t)payload_size, 1);
+    if (!payload)
+        return;
+    state->payload = payload;
+
+    // The recorded latencies, for comparison with the replay.
+    for (int c = 0; c < CALL_COUNT; c++)
+    {
+        if (!counts[c])
+            continue;
+        BenchResult recorded;
+        _bench_begin(&recorded, s_replay_call_names[c], counts[c]);
+        for (int i = 0; i < state->count; i++)
+        {
+            if (state->calls[i].call == c && recorded.count < recorded.capacity)
+            {
+                recorded.samples[recorded.count++] = state->calls[i].duration_ns;
+                recorded.errors += state->calls[i].ok ? 0 : 1;
+            }
+        }
+        snprintf(recorded.params, sizeof(recorded.params), "\"source\":\"recorded\"");
+        // Report throughput over the recorded time span rather than the time taken here.
+        recorded.elapsed_ns = _monotonic_ns() - state->calls[state->count - 1].offset_ns;
+        _bench_end(&recorded);
+    }
+
+    for (int c = 0; c < CALL_COUNT; c++)
+        _bench_begin(&state->results[c], s_replay_call_names[c], counts[c]);
+    _bench_begin(&state->lag, "replay_lag", state->count);
+
+    bench_thread_t *handles = (bench_thread_t *)calloc((size_t)threads, sizeof(bench_thread_t));
+    bool *started = (bool *)calloc((size_t)threads, sizeof(bool));
+    state->started_ns = _monotonic_ns();
+    for (int t = 0; t < threads && handles && started; t++)
+        started[t] = _bench_thread_start(&handles[t], _replay_worker, state);
+    for (int t = 0; t < threads && handles && started; t++)
+    {
+        if (started[t])
+            _bench_thread_join(handles[t]);
+    }
+    free(started);
+    free(handles);
+
+    for (int c = 0; c < CALL_COUNT; c++)
+    {
+        BenchResult *result = &state->results[c];
+        if (!counts[c])
+        {
+            free(result->samples);
+            continue;
+        }
+        snprintf(result->params, sizeof(result->params), "\"source\":\"replayed\",\"speed\":\"%s\",\"threads\":%d", speed_label, threads);
+        _bench_end(result);
+    }
+    // How late calls were issued relative to the scaled schedule; large values
+    // mean the replay could not keep up and the burst shape was flattened.
+    snprintf(state->lag.params, sizeof(state->lag.params), "\"speed\":\"%s\",\"threads\":%d,\"skipped\":%d", speed_label, threads, state->skipped);
+    _bench_end(&state->lag);
+    free(payload);
+}
+
+// --- Command line ---
+
+static int _bench_parse_list(const char *value, int *out)
+{
+    int count = 0;
+    const char *p = value;
+    while (*p && count < BENCH_MAX_LIST)
+    {
+        char *end;
+        long parsed = strtol(p, &end, 10);
+        if (end == p || parsed < 0)
+            return -1;
+        out[count++] = (int)parsed;
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',')
+            return -1;
+    }
+    return count;
+}
+
+static bool _bench_selected(const char *selection, const char *name)
+{
+    if (!selection || strcmp(selection, "all") == 0)
+        return true;
+    size_t length = strlen(name);
+    for (const char *p = selection; (p = strstr(p, name)) != NULL; p += length)
+    {
+        bool starts = p == selection || p[-1] == ',';
+        bool ends = p[length] == '\0' || p[length] == ',';
+        if (starts && ends)
+            return true;
+    }
+    return false;
+}
+
+static void _bench_usage(void)
+{
+    fprintf(stderr,
+            "usage: printing_ffi_bench [options]\n"
+            "       printing_ffi_bench replay <recording> [replay options]\n"
+            "  --scenario <a,b,...>     enumerate, submit_raw, poll_jobs, cups_options, page_range, tail_latency or all (default all)\n"
+            "  --printer <name>         Queue to submit to (default: the first printer found)\n"
+            "  --iterations <n>         Samples per scenario and parameter (default 200)\n"
+            "  --payload-sizes <a,b>    Raw payload sizes in bytes (default 1024,16384,262144,4194304)\n"
+            "  --queue-depths <a,b>     Queue depths for poll_jobs (default 0,10,100,1000)\n"
+            "  --threads <n>            Concurrent workers for tail_latency (default 8)\n"
+            "  --inject-delay-ms <n>    Proxy IPP traffic and delay every forwarded chunk (CUPS only)\n"
+            "  --inject-jitter-ms <n>   Add a uniform random delay of up to n ms per chunk\n"
+            "  --inject-stall-ms <n>    Length of an injected stall\n"
+            "  --inject-stall-rate <p>  Probability that a chunk stalls\n"
+            "  --output <file>          Write JSON results to a file instead of stdout\n"
+            "replay options:\n"
+            "  --speed <1|10|max>       Replay at a multiple of the recorded rate, or back to back (default 1)\n"
+            "  --threads <n>            Calls in flight at once (default 16)\n"
+            "  --printer <name>         Send every call to this queue instead of the recorded one\n"
+            "  --pdf <file>             Print this file for PDF calls whose recorded file is missing\n"
+            "  --output <file>          Write JSON results to a file instead of stdout\n");
+}
+
+#ifdef _WIN32
+#define BENCH_PLATFORM "windows"
+#elif defined(__APPLE__)
+#define BENCH_PLATFORM "macos"
+#else
+#define BENCH_PLATFORM "linux"
+#endif
+
+// Writes the collected results with the run description in `members` (JSON object members).
+static int _bench_write_report(const char *output, const char *printer, const char *members)
+{
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "Failed to open %s\n", output);
+        return 1;
+    }
+    fprintf(out, "{\n  \"benchmark\": \"printing_ffi\",\n  \"platform\": \"%s\",\n  \"printer\": \"%s\",\n  %s,\n  \"results\": [%s\n  ]\n}\n",
+            BENCH_PLATFORM, printer ? printer : "", members, s_bench_json.data ? s_bench_json.data : "");
+    if (out != stdout)
+        fclose(out);
+    free(s_bench_json.data);
+    s_bench_json.data = NULL;
+    return 0;
+}
+
+static int _bench_replay_main(int argc, char **argv)
+{
+    if (argc < 1)
+    {
+        _bench_usage();
+        return 2;
+    }
+    ReplayState state = {0};
+    state.speed = 1;
+    const char *speed_label = "1";
+    const char *output = NULL;
+    int threads = 16;
+    for (int i = 1; i < argc; i++)
+    {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value)
+        {
+            _bench_usage();
+            return 2;
+        }
+        if (strcmp(argv[i], "--speed") == 0)
+        {
+            speed_label = value;
+            state.speed = strcmp(value, "max") == 0 ? 0 : atof(value);
+            if (strcmp(value, "max") != 0 && state.speed <= 0)
+            {
+                _bench_usage();
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "--threads") == 0)
+            threads = atoi(value);
+        else if (strcmp(argv[i], "--printer") == 0)
+            state.printer = value;
+        else if (strcmp(argv[i], "--pdf") == 0)
+            state.pdf_file_path = value;
+        else if (strcmp(argv[i], "--output") == 0)
+            output = value;
+        else
+        {
+            _bench_usage();
+            return 2;
+        }
+        i++;
+    }
+    if (threads <= 0)
+    {
+        _bench_usage();
+        return 2;
+    }
+    if (!_replay_load(argv[0], &state))
+        return 1;
+    if (state.count > 0)
+        _bench_replay(&state, speed_label, threads);
+
+    char members[256];
+    snprintf(members, sizeof(members), "\"recording\": %d,\n  \"skipped\": %d", state.count, state.skipped);
+    _replay_free_calls(state.calls, state.count);
+    free(state.jobs);
+    return _bench_write_report(output, state.printer, members);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "replay") == 0)
+        return _bench_replay_main(argc - 2, argv + 2);
+
+    BenchConfig config = {NULL, 200, {1024, 16384, 262144, 4194304}, 4, {0, 10, 100, 1000}, 4, 8, 0, 0, 0, 0.0};
+    const char *selection = NULL;
+    const char *output = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value)
+        {
+            _bench_usage();
+            return 2;
+        }
+        if (strcmp(argv[i], "--scenario") == 0)
+            selection = value;
+        else if (strcmp(argv[i], "--printer") == 0)
+            config.printer = value;
+        else if (strcmp(argv[i], "--iterations") == 0)
+            config.iterations = atoi(value);
+        else if (strcmp(argv[i], "--payload-sizes") == 0)
+            config.payload_size_count = _bench_parse_list(value, config.payload_sizes);
+        else if (strcmp(argv[i], "--queue-depths") == 0)
+            config.queue_depth_count = _bench_parse_list(value, config.queue_depths);
+        else if (strcmp(argv[i], "--output") == 0)
+            output = value;
+        else if (strcmp(argv[i], "--threads") == 0)
+            config.threads = atoi(value);
+        else if (strcmp(argv[i], "--inject-delay-ms") == 0)
+            config.inject_delay_ms = atoi(value);
+        else if (strcmp(argv[i], "--inject-jitter-ms") == 0)
+            config.inject_jitter_ms = atoi(value);
+        else if (strcmp(argv[i], "--inject-stall-ms") == 0)
+            config.inject_stall_ms = atoi(value);
+        else if (strcmp(argv[i], "--inject-stall-rate") == 0)
+            config.inject_stall_rate = atof(value);
+        else
+        {
+            _bench_usage();
+            return 2;
+        }
+        i++;
+    }
+    if (config.iterations <= 0 || config.payload_size_count < 0 || config.queue_depth_count < 0 || config.threads <= 0 ||
+        config.inject_delay_ms < 0 || config.inject_jitter_ms < 0 || config.inject_stall_ms < 0 ||
+        config.inject_stall_rate < 0 || config.inject_stall_rate > 1)
+    {
+        _bench_usage();
+        return 2;
+    }
+
+    bool inject = config.inject_delay_ms > 0 || config.inject_jitter_ms > 0 || (config.inject_stall_ms > 0 && config.inject_stall_rate > 0);
+    if (inject)
+    {
+#ifdef _WIN32
+        fprintf(stderr, "--inject-* options need CUPS; the Windows spooler is not reached over the network\n");
+        return 2;
+#else
+        if (!_proxy_start(&config))
+            return 1;
+#endif
+    }
+
+    char *default_printer = NULL;
+    if (!config.printer)
+    {
+        PrinterList *list = get_printers();
+        if (list && list->count > 0)
+            default_printer = strdup(list->printers[0].name);
+        free_printer_list(list);
+        config.printer = default_printer;
+    }
+
+    for (size_t s = 0; s < sizeof(s_bench_scenarios) / sizeof(s_bench_scenarios[0]); s++)
+    {
+        const BenchScenario *scenario = &s_bench_scenarios[s];
+        if (!_bench_selected(selection, scenario->name))
+            continue;
+        if (scenario->needs_printer && !config.printer)
+        {
+            fprintf(stderr, "%s: skipped, no printer found (set CUPS_SERVER or --printer)\n", scenario->name);
+            continue;
+        }
+        scenario->run(&config);
+    }
+
+    uint64_t stalls = 0;
+#ifndef _WIN32
+    stalls = ffi_atomic_load_u64(&s_bench_proxy.stalls);
+#endif
+    char members[128];
+    snprintf(members, sizeof(members), "\"iterations\": %d,\n  \"injected_stalls\": %llu", config.iterations, (unsigned long long)stalls);
+    int status = _bench_write_report(output, config.printer, members);
+    free(default_printer);
+    return status;
+}
@@ -0,0 +1,133 @@
+// A no-op stand-in for the printing_ffi library, used by
+// benchmark/bridge_benchmark.dart to measure the Dart/native boundary on its
+// own. It exports the subset of the API the benchmark calls; every call
+// returns immediately, and list results are allocated the same way as the
+// real library allocates them so that the free calls cost the same.
+//
+// The number of printers returned by get_printers can be set with the
+// PRINTING_FFI_NOOP_PRINTERS environment variable (default 16), and the
+// number of jobs returned by get_print_jobs with PRINTING_FFI_NOOP_JOBS
+// (default 16).
+#include "printing_ffi.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define strdup _strdup
+#endif
+
+static int _noop_count(const char *variable, int fallback)
+{
+    const char *value = getenv(variable);
+    int count = value ? atoi(value) : fallback;
+    return count >= 0 ? count : fallback;
+}
+
+static char *_noop_format(const char *format, int index)
+{
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), format, index);
+    return strdup(buffer);
+}
+
+FFI_PLUGIN_EXPORT int sum(int a, int b)
+{
+    return a + b;
+}
+
+FFI_PLUGIN_EXPORT const char *get_last_error()
+{
+    return "";
+}
+
+FFI_PLUGIN_EXPORT void free_native_string(char *str)
+{
+    free(str);
+}
+
+FFI_PLUGIN_EXPORT PrinterList *get_printers(void)
+{
+    PrinterList *list = (PrinterList *)malloc(sizeof(PrinterList));
+    if (!list)
+        return NULL;
+    list->count = _noop_count("PRINTING_FFI_NOOP_PRINTERS", 16);
+    list->printers = list->count ? (PrinterInfo *)calloc((size_t)list->count, sizeof(PrinterInfo)) : NULL;
+    if (list->count && !list->printers)
+    {
+        free(list);
+        return NULL;
+    }
+    for (int i = 0; i < list->count; i++)
+    {
+        PrinterInfo *info = &list->printers[i];
+        info->name = _noop_format("noop-%d", i + 1);
+        info->state = 3;
+        info->url = _noop_format("ipp://localhost/printers/noop-%d", i + 1);
+        info->model = strdup("Generic Label Printer");
+        info->location = _noop_format("Dock %d", i + 1);
+        info->comment = strdup("");
+        info->is_default = i == 0;
+        info->is_available = true;
+    }
+    return list;
+}
+
+FFI_PLUGIN_EXPORT void free_printer_list(PrinterList *printer_list)
+{
+    if (!printer_list)
+        return;
+    for (int i = 0; i < printer_list->count; i++)
+    {
+        PrinterInfo *info = &printer_list->printers[i];
+        free(info->name);
+        free(info->url);
+        free(info->model);
+        free(info->location);
+        free(info->comment);
+    }
+    free(printer_list->printers);
+    free(printer_list);
+}
+
+FFI_PLUGIN_EXPORT bool raw_data_to_printer(const char *printer_name, const uint8_t *data, int length, const char *doc_name, int num_options, const char **option_keys, const char **option_values)
+{
+    return printer_name != NULL && (length == 0 || data != NULL);
+}
+
+FFI_PLUGIN_EXPORT int32_t submit_raw_data_job(const char *printer_name, const uint8_t *data, int length, const char *doc_name, int num_options, const char **option_keys, const char **option_values)
+{
+    static int32_t s_next_job_id = 0;
+    return printer_name != NULL ? ++s_next_job_id : 0;
+}
+
+FFI_PLUGIN_EXPORT JobList *get_print_jobs(const char *printer_name)
+{
+    JobList *list = (JobList *)malloc(sizeof(JobList));
+    if (!list)
+        return NULL;
+    list->count = _noop_count("PRINTING_FFI_NOOP_JOBS", 16);
+    list->jobs = list->count ? (JobInfo *)calloc((size_t)list->count, sizeof(JobInfo)) : NULL;
+    if (list->count && !list->jobs)
+    {
+        free(list);
+        return NULL;
+    }
+    for (int i = 0; i < list->count; i++)
+    {
+        list->jobs[i].id = (uint32_t)(i + 1);
+        list->jobs[i].title = _noop_format("label-%d.zpl", i + 1);
+        list->jobs[i].status = 3;
+    }
+    return list;
+}
+
+FFI_PLUGIN_EXPORT void free_job_list(JobList *job_list)
+{
+    if (!job_list)
+        return;
+    for (int i = 0; i < job_list->count; i++)
+        free(job_list->jobs[i].title);
+    free(job_list->jobs);
+    free(job_list);
+}
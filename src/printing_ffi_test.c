@@ -0,0 +1,492 @@
+// Native unit tests for printing_ffi.
+//
+// Like the benchmark, the tests compile the library source directly so that
+// internal helpers (page ranges, option and media tables, the capabilities
+// cache, capability snapshots and option validation) can be checked without a
+// printing system. Configure with -DPRINTING_FFI_BUILD_TESTS=ON and run:
+//
+//   ctest --output-on-failure
+//
+// Tests that need a scheduler live in test/ and run against
+// tool/mock_ipp_server.dart.
+#define PRINTING_FFI_TEST
+#include "printing_ffi.c"
+
+static int s_test_failures = 0;
+
+#define CHECK(condition)                                                               \
+    do                                                                                 \
+    {                                                                                  \
+        if (!(condition))                                                              \
+        {                                                                              \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            s_test_failures++;                                                         \
+        }                                                                              \
+    } while (0)
+
+#define CHECK_STR(actual, expected)                                                                      \
+    do                                                                                                   \
+    {                                                                                                    \
+        const char *actual_ = (actual);                                                                  \
+        const char *expected_ = (expected);                                                              \
+        if (!(actual_ == expected_ || (actual_ && expected_ && strcmp(actual_, expected_) == 0)))        \
+        {                                                                                                \
+            fprintf(stderr, "%s:%d: expected %s to be \"%s\", got \"%s\"\n", __FILE__, __LINE__, #actual, \
+                    expected_ ? expected_ : "(null)", actual_ ? actual_ : "(null)");                     \
+            s_test_failures++;                                                                           \
+        }                                                                                                \
+    } while (0)
+
+// --- Page ranges ---
+
+// Parses `range` for a document of `total_pages` and returns the selected
+// pages as a string of '1' and '0', or NULL if the range is rejected.
+static const char *_test_page_range(const char *range, int total_pages)
+{
+    static char selected[64];
+    bool flags[64];
+    if (!parse_page_range(range, flags, total_pages))
+        return NULL;
+    for (int i = 0; i < total_pages; i++)
+        selected[i] = flags[i] ? '1' : '0';
+    selected[total_pages] = '\0';
+    return selected;
+}
+
+static void test_parse_page_range(void)
+{
+    CHECK_STR(_test_page_range(NULL, 4), "1111");
+    CHECK_STR(_test_page_range("", 4), "1111");
+    CHECK_STR(_test_page_range("1-3,5,8-10", 10), "1110100111");
+    CHECK_STR(_test_page_range(" 2 , 4-4 ,", 5), "01010");
+    CHECK_STR(_test_page_range("3-1", 5), NULL);
+    CHECK_STR(_test_page_range("0", 5), NULL);
+    CHECK_STR(_test_page_range("4-6", 5), NULL);
+    CHECK_STR(_test_page_range("abc", 5), NULL);
+    CHECK_STR(_test_page_range("1", 0), NULL);
+}
+
+// --- Option normalization ---
+
+static void test_option_lookup(void)
+{
+    int count = (int)(sizeof(s_option_keys) / sizeof(s_option_keys[0]));
+    for (int i = 0; i < count; i++)
+        CHECK(_lookup_option_key(s_option_keys[i].key) == &s_option_keys[i]);
+    CHECK(_lookup_option_key(NULL) == NULL);
+    CHECK(_lookup_option_key("") == NULL);
+    CHECK(_lookup_option_key("Duplex") == NULL);
+    CHECK(_lookup_option_key("sides") == NULL);
+    CHECK(_lookup_option_key("media") == NULL);
+
+    const OptionKey *duplex = _lookup_option_key("duplex");
+    CHECK_STR(_lookup_option_choice(duplex, "duplexShortEdge")->ipp_value, "two-sided-short-edge");
+    CHECK(_lookup_option_choice(duplex, "sideways") == NULL);
+    const OptionKey *orientation = _lookup_option_key("orientation");
+    CHECK(_lookup_option_choice(orientation, "sideways") == &orientation->choices[orientation->fallback]);
+
+    const char *name;
+    const char *value;
+    CHECK(_normalize_ipp_option("duplex", "duplexLongEdge", &name, &value));
+    CHECK_STR(name, "sides");
+    CHECK_STR(value, "two-sided-long-edge");
+    CHECK(_normalize_ipp_option("media", "iso_a4_210x297mm", &name, &value));
+    CHECK_STR(name, "media");
+    CHECK_STR(value, "iso_a4_210x297mm");
+    CHECK(!_normalize_ipp_option("paper-size-id", "9", &name, &value));
+}
+
+// --- Media sizes ---
+
+static void test_pwg_media_lookup(void)
+{
+    int count = (int)(sizeof(s_pwg_media) / sizeof(s_pwg_media[0]));
+    for (int i = 0; i < count; i++)
+    {
+        const PwgMedia *media = &s_pwg_media[i];
+        CHECK(_lookup_pwg_media(media->pwg_name) == media);
+        if (media->ppd_name)
+            CHECK(_lookup_pwg_media(media->ppd_name) == media);
+        if (media->ipp_name)
+            CHECK(_lookup_pwg_media(media->ipp_name) == media);
+        if (media->windows_id)
+            CHECK(_lookup_pwg_media_by_windows_id(media->windows_id) == media);
+    }
+    CHECK(_lookup_pwg_media(NULL) == NULL);
+    CHECK(_lookup_pwg_media("a4") == NULL);
+    CHECK(_lookup_pwg_media("iso_a4") == NULL);
+    CHECK(_lookup_pwg_media("iso_a4_210x297mmx") == NULL);
+    CHECK(_lookup_pwg_media("iso-designated-long") == _lookup_pwg_media("iso_dl_110x220mm"));
+    CHECK(_lookup_pwg_media("iso-designated") == NULL);
+    CHECK(_lookup_pwg_media_by_windows_id(0) == NULL);
+    CHECK(_lookup_pwg_media_by_windows_id(256) == NULL);
+
+    MediaSizeInfo *info = get_media_size("A4");
+    CHECK(info != NULL);
+    if (info)
+    {
+        CHECK_STR(info->pwg_name, "iso_a4_210x297mm");
+        CHECK_STR(info->ipp_name, "iso-a4");
+        CHECK(info->windows_id == 9);
+    }
+    free_media_size_info(info);
+}
+
+static void test_parse_pwg_media_name(void)
+{
+    int width = 0;
+    int height = 0;
+    CHECK(_parse_pwg_media_name("oe_4x6-label_4x6in", &width, &height));
+    CHECK(width == 10160 && height == 15240);
+    CHECK(_parse_pwg_media_name("na_letter_8.5x11in", &width, &height));
+    CHECK(width == 21590 && height == 27940);
+    CHECK(_parse_pwg_media_name("custom_foo_100x150.25mm", &width, &height));
+    CHECK(width == 10000 && height == 15025);
+    CHECK(_parse_pwg_media_name("om_small-photo_100x150mm", &width, &height));
+    CHECK(width == 10000 && height == 15000);
+
+    CHECK(!_parse_pwg_media_name("iso_a4", &width, &height));
+    CHECK(!_parse_pwg_media_name("a4_210x297mm", &width, &height));
+    CHECK(!_parse_pwg_media_name("iso_a4_210x297cm", &width, &height));
+    CHECK(!_parse_pwg_media_name("iso_a4_210297mm", &width, &height));
+    CHECK(!_parse_pwg_media_name("iso_a4_0x297mm", &width, &height));
+    CHECK(!_parse_pwg_media_name("iso_a4_x297mm", &width, &height));
+
+    MediaSizeInfo *info = get_media_size("custom_foo_100x150mm");
+    CHECK(info != NULL);
+    if (info)
+    {
+        CHECK_STR(info->pwg_name, "custom_foo_100x150mm");
+        CHECK_STR(info->ppd_name, "");
+        CHECK(info->width_mm == 100.0f && info->height_mm == 150.0f);
+    }
+    free_media_size_info(info);
+}
+
+// --- Job control ---
+
+static void test_cancel_all_jobs_scope(void)
+{
+    // Rejected before anything is sent, so no scheduler is needed.
+    CHECK(!cancel_all_jobs("mock-1", 3));
+    CHECK_STR(get_last_error(), "Invalid cancel scope: 3.");
+    CHECK(!cancel_all_jobs("mock-1", -1));
+}
+
+#ifndef _WIN32
+// --- Option lists ---
+
+static void _test_add_option(CupsOptionList *list, const char *name, const char *default_value, const char *const *choices, int num_choices)
+{
+    CupsOption *option = &list->options[list->count++];
+    option->name = strdup(name);
+    option->default_value = default_value ? strdup(default_value) : NULL;
+    option->supported_values.choices = (CupsOptionChoice *)calloc((size_t)num_choices, sizeof(CupsOptionChoice));
+    for (int i = 0; i < num_choices; i++)
+    {
+        CupsOptionChoice *choice = &option->supported_values.choices[option->supported_values.count++];
+        choice->choice = strdup(choices[i]);
+        // Enum-like choices carry a display text; keywords are their own text.
+        choice->text = strdup(strcmp(choices[i], "4") == 0 ? "normal" : choices[i]);
+    }
+}
+
+// Builds the option list a queue like tool/mock_ipp_server.dart reports, with
+// one constraint that forbids printing labels two-sided.
+static CupsOptionList *_test_option_list(void)
+{
+    static const char *const media[] = {"iso_a4_210x297mm", "na_letter_8.5x11in", "oe_4x6-label_4x6in"};
+    static const char *const sides[] = {"one-sided", "two-sided-long-edge"};
+    static const char *const quality[] = {"3", "4", "5"};
+    CupsOptionList *list = _alloc_cups_option_list();
+    list->options = (CupsOption *)calloc(4, sizeof(CupsOption));
+    _test_add_option(list, "media", "iso_a4_210x297mm", media, 3);
+    _test_add_option(list, "sides", "one-sided", sides, 2);
+    _test_add_option(list, "print-quality", "4", quality, 3);
+    _test_add_option(list, "output-bin", NULL, NULL, 0);
+
+    ipp_t *collections[2];
+    collections[0] = ippNew();
+    ippAddString(collections[0], IPP_TAG_ZERO, IPP_TAG_NAME, "resolver-name", NULL, "no-duplex-labels");
+    ippAddString(collections[0], IPP_TAG_ZERO, IPP_TAG_KEYWORD, "media", NULL, "oe_4x6-label_4x6in");
+    ippAddString(collections[0], IPP_TAG_ZERO, IPP_TAG_KEYWORD, "sides", NULL, "two-sided-long-edge");
+    // Names an attribute the list does not have, so it cannot be selected and is dropped.
+    collections[1] = ippNew();
+    ippAddString(collections[1], IPP_TAG_ZERO, IPP_TAG_NAME, "resolver-name", NULL, "no-stapled-labels");
+    ippAddString(collections[1], IPP_TAG_ZERO, IPP_TAG_KEYWORD, "media", NULL, "oe_4x6-label_4x6in");
+    ippAddString(collections[1], IPP_TAG_ZERO, IPP_TAG_KEYWORD, "finishings-col", NULL, "staple");
+    ipp_t *response = ippNew();
+    ippAddCollections(response, IPP_TAG_PRINTER, "job-constraints-supported", 2, (const ipp_t **)collections);
+    ((SharedCupsOptionList *)list)->constraints = _compile_option_constraints(list, response);
+    ippDelete(collections[0]);
+    ippDelete(collections[1]);
+    ippDelete(response);
+    return list;
+}
+
+static void _test_check_same_options(const CupsOptionList *actual, const CupsOptionList *expected)
+{
+    CHECK(actual->count == expected->count);
+    for (int i = 0; i < actual->count && i < expected->count; i++)
+    {
+        const CupsOption *a = &actual->options[i];
+        const CupsOption *e = &expected->options[i];
+        CHECK_STR(a->name, e->name);
+        CHECK_STR(a->default_value, e->default_value);
+        CHECK(a->supported_values.count == e->supported_values.count);
+        for (int j = 0; j < a->supported_values.count && j < e->supported_values.count; j++)
+        {
+            CHECK_STR(a->supported_values.choices[j].choice, e->supported_values.choices[j].choice);
+            CHECK_STR(a->supported_values.choices[j].text, e->supported_values.choices[j].text);
+        }
+    }
+}
+
+static void test_compile_option_constraints(void)
+{
+    CupsOptionList *list = _test_option_list();
+    const OptionConstraints *constraints = ((SharedCupsOptionList *)list)->constraints;
+    CHECK(constraints != NULL);
+    if (constraints)
+    {
+        CHECK(constraints->count == 1);
+        CHECK(constraints->num_words == 1);
+        CHECK(constraints->arity[0] == 2);
+        CHECK_STR(constraints->names[0], "no-duplex-labels");
+        // media choice 2 is bit 2; sides follows the 3 media choices, so its choice 1 is bit 4.
+        CHECK(constraints->sets[0] == ((1ULL << 2) | (1ULL << 4)));
+    }
+    free_cups_option_list(list);
+}
+
+static void test_validate_options(void)
+{
+    CupsOptionList *list = _test_option_list();
+    const char *none[] = {NULL};
+    CHECK(_validate_cups_options(list, "mock-1", 0, none, none) == OPTION_VALIDATION_OK);
+
+    const char *supported_keys[] = {"media", "duplex", "print-quality", "job-name"};
+    const char *supported_values[] = {"A4", "duplexLongEdge", "high", "anything"};
+    CHECK(_validate_cups_options(list, "mock-1", 4, supported_keys, supported_values) == OPTION_VALIDATION_OK);
+
+    const char *aliases[] = {"iso-a4", "Letter", "na_letter_8.5x11in"};
+    for (int i = 0; i < 3; i++)
+    {
+        const char *key[] = {"media"};
+        CHECK(_validate_cups_options(list, "mock-1", 1, key, &aliases[i]) == OPTION_VALIDATION_OK);
+    }
+
+    const char *unsupported_keys[] = {"sides"};
+    const char *unsupported_values[] = {"two-sided-short-edge"};
+    CHECK(_validate_cups_options(list, "mock-1", 1, unsupported_keys, unsupported_values) == OPTION_VALIDATION_UNSUPPORTED);
+    CHECK(strstr(get_last_error(), "two-sided-short-edge") != NULL);
+
+    const char *conflict_keys[] = {"media", "sides"};
+    const char *conflict_values[] = {"oe_4x6-label_4x6in", "two-sided-long-edge"};
+    CHECK(_validate_cups_options(list, "mock-1", 2, conflict_keys, conflict_values) == OPTION_VALIDATION_CONFLICT);
+    CHECK_STR(get_last_error(), "Options conflict on 'mock-1': media=oe_4x6-label_4x6in, sides=two-sided-long-edge (no-duplex-labels).");
+
+    // The generic duplex option is normalized before the constraint is checked.
+    const char *generic_values[] = {"oe_4x6-label_4x6in", "duplexLongEdge"};
+    const char *generic_keys[] = {"media", "duplex"};
+    CHECK(_validate_cups_options(list, "mock-1", 2, generic_keys, generic_values) == OPTION_VALIDATION_CONFLICT);
+
+    // Either value alone is fine.
+    CHECK(_validate_cups_options(list, "mock-1", 1, conflict_keys, conflict_values) == OPTION_VALIDATION_OK);
+    CHECK(_validate_cups_options(list, "mock-1", 1, conflict_keys + 1, conflict_values + 1) == OPTION_VALIDATION_OK);
+    free_cups_option_list(list);
+}
+
+// --- Persistent capabilities cache ---
+
+static void test_caps_cache_round_trip(void)
+{
+    char directory[] = "/tmp/printing_ffi_test.XXXXXX";
+    CHECK(mkdtemp(directory) != NULL);
+    CHECK(set_capabilities_cache_dir(directory));
+
+    CupsOptionList *list = _test_option_list();
+    _caps_cache_store_cups_options("mock-1", list, (time_t)1700000000);
+
+    time_t change_time = 0;
+    CupsOptionList *loaded = _caps_cache_load_cups_options("mock-1", &change_time);
+    CHECK(loaded != NULL);
+    CHECK(change_time == (time_t)1700000000);
+    if (loaded)
+    {
+        _test_check_same_options(loaded, list);
+        const OptionConstraints *expected = ((SharedCupsOptionList *)list)->constraints;
+        const OptionConstraints *actual = ((SharedCupsOptionList *)loaded)->constraints;
+        CHECK(actual != NULL && expected != NULL);
+        if (actual && expected)
+        {
+            CHECK(actual->count == expected->count && actual->num_words == expected->num_words);
+            CHECK(memcmp(actual->sets, expected->sets, (size_t)expected->count * expected->num_words * sizeof(uint64_t)) == 0);
+            CHECK(memcmp(actual->arity, expected->arity, (size_t)expected->count) == 0);
+            CHECK_STR(actual->names[0], expected->names[0]);
+        }
+        const char *keys[] = {"media", "sides"};
+        const char *values[] = {"oe_4x6-label_4x6in", "two-sided-long-edge"};
+        CHECK(_validate_cups_options(loaded, "mock-1", 2, keys, values) == OPTION_VALIDATION_CONFLICT);
+    }
+    free_cups_option_list(loaded);
+
+    // Another printer's file is not used, and a damaged file is ignored.
+    CHECK(_caps_cache_load_cups_options("mock-2", &change_time) == NULL);
+    char path[1024];
+    CHECK(_caps_cache_path("mock-1", path, sizeof(path)));
+    FILE *file = fopen(path, "r+b");
+    CHECK(file != NULL);
+    if (file)
+    {
+        fseek(file, -1, SEEK_END);
+        int last = fgetc(file);
+        fseek(file, -1, SEEK_END);
+        fputc(last ^ 0xFF, file);
+        fclose(file);
+    }
+    CHECK(_caps_cache_load_cups_options("mock-1", &change_time) == NULL);
+
+    free_cups_option_list(list);
+    unlink(path);
+    CHECK(set_capabilities_cache_dir(NULL));
+    rmdir(directory);
+}
+
+// --- Capability snapshots ---
+
+static uint32_t _test_u32(const uint8_t *data, uint32_t offset)
+{
+    return (uint32_t)data[offset] | (uint32_t)data[offset + 1] << 8 | (uint32_t)data[offset + 2] << 16 | (uint32_t)data[offset + 3] << 24;
+}
+
+// Returns the string at `offset` of a snapshot, or NULL for offset 0.
+static const char *_test_snapshot_string(const CapabilitySnapshot *snapshot, uint32_t offset)
+{
+    if (offset == 0)
+        return NULL;
+    CHECK(offset + 4 <= snapshot->size);
+    uint32_t length = _test_u32(snapshot->data, offset);
+    CHECK(offset + 4 + length < snapshot->size);
+    const char *value = (const char *)snapshot->data + offset + 4;
+    CHECK(strlen(value) == length);
+    return value;
+}
+
+static void test_capability_snapshot_round_trip(void)
+{
+    CupsOptionList *list = _test_option_list();
+    CapabilitySnapshot *snapshot = _snapshot_cups_options(list);
+    CHECK(snapshot != NULL);
+    if (!snapshot)
+    {
+        free_cups_option_list(list);
+        return;
+    }
+    const uint8_t *data = snapshot->data;
+    CHECK(memcmp(data, CAPABILITY_SNAPSHOT_MAGIC, 4) == 0);
+    CHECK((data[4] | data[5] << 8) == CAPABILITY_SNAPSHOT_VERSION);
+    CHECK((data[6] | data[7] << 8) == CAPABILITY_SNAPSHOT_CUPS);
+    CHECK(_test_u32(data, 8) == snapshot->size);
+    CHECK(_test_u32(data, 12) == 0);
+    CHECK(_test_u32(data, 16) == 2);
+
+    uint32_t options_offset = _test_u32(data, 20);
+    uint32_t options_count = _test_u32(data, 24);
+    uint32_t options_stride = _test_u32(data, 28);
+    uint32_t choices_offset = _test_u32(data, 32);
+    uint32_t choices_count = _test_u32(data, 36);
+    uint32_t choices_stride = _test_u32(data, 40);
+    CHECK(options_count == (uint32_t)list->count);
+    CHECK(choices_count == 8);
+    CHECK(options_offset + options_count * options_stride <= snapshot->size);
+    CHECK(choices_offset + choices_count * choices_stride <= snapshot->size);
+
+    for (uint32_t i = 0; i < options_count && i < (uint32_t)list->count; i++)
+    {
+        const uint8_t *record = data + options_offset + i * options_stride;
+        const CupsOption *option = &list->options[i];
+        CHECK_STR(_test_snapshot_string(snapshot, _test_u32(record, 0)), option->name);
+        CHECK_STR(_test_snapshot_string(snapshot, _test_u32(record, 4)), option->default_value);
+        uint32_t first_choice = _test_u32(record, 8);
+        uint32_t choice_count = _test_u32(record, 12);
+        CHECK(choice_count == (uint32_t)option->supported_values.count);
+        for (uint32_t j = 0; j < choice_count && first_choice + j < choices_count; j++)
+        {
+            const uint8_t *choice = data + choices_offset + (first_choice + j) * choices_stride;
+            CHECK_STR(_test_snapshot_string(snapshot, _test_u32(choice, 0)), option->supported_values.choices[j].choice);
+            CHECK_STR(_test_snapshot_string(snapshot, _test_u32(choice, 4)), option->supported_values.choices[j].text);
+        }
+    }
+    free_capability_snapshot(snapshot);
+    free_cups_option_list(list);
+}
+
+static void test_job_trace_mark_departed(void)
+{
+    reset_job_timings();
+    JobTraceBuilder trace;
+    _job_trace_begin(&trace);
+    _job_trace_mark(&trace, JOB_STAGE_JOB_ID_RETURNED);
+    _job_trace_commit(&trace, "queue", 7);
+    _job_trace_commit(&trace, "queue", 8);
+    _job_trace_commit(&trace, "other", 9);
+    _job_trace_observe("queue", 8, JOB_STAGE_CANCELED);
+
+    cups_job_t active = {.id = 7};
+    _job_trace_mark_departed("queue", &active, 1);
+    CHECK(s_job_traces[7].departed_ns == 0);
+    CHECK(s_job_traces[8].departed_ns == 0);
+    CHECK(s_job_traces[9].departed_ns == 0);
+
+    _job_trace_mark_departed("queue", NULL, 0);
+    uint64_t departed = s_job_traces[7].departed_ns;
+    CHECK(departed != 0);
+    CHECK(s_job_traces[8].departed_ns == 0);
+    CHECK(s_job_traces[9].departed_ns == 0);
+
+    // Later listings keep the time of the first one that missed the job.
+    _job_trace_mark_departed("queue", NULL, 0);
+    CHECK(s_job_traces[7].departed_ns == departed);
+    reset_job_timings();
+}
+#endif
+
+typedef struct
+{
+    const char *name;
+    void (*run)(void);
+} TestCase;
+
+static const TestCase s_tests[] = {
+    {"parse_page_range", test_parse_page_range},
+    {"option_lookup", test_option_lookup},
+    {"pwg_media_lookup", test_pwg_media_lookup},
+    {"parse_pwg_media_name", test_parse_pwg_media_name},
+    {"cancel_all_jobs_scope", test_cancel_all_jobs_scope},
+#ifndef _WIN32
+    {"compile_option_constraints", test_compile_option_constraints},
+    {"validate_options", test_validate_options},
+    {"caps_cache_round_trip", test_caps_cache_round_trip},
+    {"capability_snapshot_round_trip", test_capability_snapshot_round_trip},
+    {"job_trace_mark_departed", test_job_trace_mark_departed},
+#endif
+};
+
+int main(int argc, char **argv)
+{
+    const char *only = argc > 1 ? argv[1] : NULL;
+    int failed_tests = 0;
+    for (size_t i = 0; i < sizeof(s_tests) / sizeof(s_tests[0]); i++)
+    {
+        if (only && strcmp(only, s_tests[i].name) != 0)
+            continue;
+        int failures = s_test_failures;
+        s_tests[i].run();
+        bool passed = s_test_failures == failures;
+        printf("%s %s\n", passed ? "ok  " : "FAIL", s_tests[i].name);
+        failed_tests += passed ? 0 : 1;
+    }
+    printf("%d of %d tests failed\n", failed_tests, (int)(sizeof(s_tests) / sizeof(s_tests[0])));
+    return failed_tests == 0 ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+// Runs the CUPS code paths against tool/mock_ipp_server.dart. The tests load
+// the native library built for the host, so build it first and put it on the
+// library path:
+//
+//   cmake -S src -B build && cmake --build build
+//   LD_LIBRARY_PATH=$PWD/build flutter test test/mock_ipp_server_test.dart
+//
+// The pure native helpers are covered by src/printing_ffi_test.c.
+@TestOn('linux')
+library;
+
+import 'dart:ffi';
+import 'dart:isolate';
+import 'dart:typed_data';
+
+import 'package:ffi/ffi.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:printing_ffi/printing_ffi.dart';
+
+import '../tool/mock_ipp_server.dart';
+
+// mock-1 takes jobs, mock-2 is stopped, mock-3 rejects jobs and mock-4 is
+// only used for paging. Jobs stay pending so that they can be held and canceled.
+const _config = MockIppConfig(
+  port: 0,
+  queues: 4,
+  processingAfter: Duration(minutes: 10),
+  completeAfter: Duration(minutes: 20),
+  stopped: {'mock-2'},
+  rejecting: {'mock-3'},
+);
+
+/// Serves [_config] until the isolate is killed, and sends back its port.
+Future<void> _serve(SendPort reply) async {
+  final server = MockIppServer(_config);
+  await server.start();
+  reply.send(server.port);
+}
+
+/// Points libcups at the mock server. libcups reads CUPS_SERVER once per
+/// thread, so this has to run before the first CUPS call.
+void _setCupsServer(String server) {
+  final setenv = DynamicLibrary.process().lookupFunction<Int32 Function(Pointer<Utf8>, Pointer<Utf8>, Int32), int Function(Pointer<Utf8>, Pointer<Utf8>, int)>('setenv');
+  final name = 'CUPS_SERVER'.toNativeUtf8();
+  final value = server.toNativeUtf8();
+  try {
+    setenv(name, value, 1);
+  } finally {
+    malloc.free(name);
+    malloc.free(value);
+  }
+}
+
+void main() {
+  final printing = PrintingFfi.instance;
+  final payload = Uint8List.fromList(List<int>.generate(2048, (i) => i % 256));
+  late Isolate server;
+
+  setUpAll(() async {
+    // The server runs on its own isolate because listPrinters blocks the calling one.
+    final ready = ReceivePort();
+    server = await Isolate.spawn(_serve, ready.sendPort);
+    final port = await ready.first as int;
+    _setCupsServer('127.0.0.1:$port');
+  });
+
+  tearDownAll(() {
+    server.kill(priority: Isolate.immediate);
+  });
+
+  Future<PrintJob> submit(String printerName, String docName) {
+    return printing.rawDataToPrinterAndStreamStatus(printerName, payload, docName: docName, pollInterval: const Duration(milliseconds: 100)).first;
+  }
+
+  Future<PrintJob?> findJob(String printerName, int jobId) async {
+    final jobs = await printing.listPrintJobs(printerName);
+    for (final job in jobs) {
+      if (job.id == jobId) return job;
+    }
+    return null;
+  }
+
+  test('lists the mock queues', () {
+    final printers = {for (final printer in printing.listPrinters()) printer.name: printer};
+    expect(printers.keys, containsAll(<String>['mock-1', 'mock-2', 'mock-3', 'mock-4']));
+    expect(printers['mock-1']!.state, 3);
+    expect(printers['mock-2']!.state, 5);
+    expect(printers['mock-1']!.model, 'printing_ffi Mock IPP Printer');
+  });
+
+  test('submits a raw job', () async {
+    expect(await printing.rawDataToPrinter('mock-1', payload, docName: 'raw-print'), isTrue);
+
+    final job = await submit('mock-1', 'raw-submit');
+    expect(job.id, greaterThan(0));
+    final listed = await findJob('mock-1', job.id);
+    expect(listed, isNotNull);
+    expect(listed!.title, 'raw-submit');
+    expect(listed.status, PrintJobStatus.pending);
+  });
+
+  test('holds, releases and cancels jobs', () async {
+    final job = await submit('mock-1', 'job-control');
+
+    expect(await printing.pausePrintJob('mock-1', job.id), isTrue);
+    expect((await findJob('mock-1', job.id))!.status, PrintJobStatus.held);
+    expect(await printing.resumePrintJob('mock-1', job.id), isTrue);
+    expect((await findJob('mock-1', job.id))!.status, PrintJobStatus.pending);
+    expect(await printing.cancelPrintJob('mock-1', job.id), isTrue);
+    expect(await findJob('mock-1', job.id), isNull);
+    expect(await printing.cancelPrintJob('mock-1', job.id), isFalse);
+
+    final first = await submit('mock-1', 'bulk-1');
+    final second = await submit('mock-1', 'bulk-2');
+    final ids = [first.id, second.id];
+    expect(await printing.holdPrintJobs('mock-1', ids), 2);
+    expect((await findJob('mock-1', second.id))!.status, PrintJobStatus.held);
+    expect(await printing.releasePrintJobs('mock-1', ids), 2);
+    expect((await findJob('mock-1', second.id))!.status, PrintJobStatus.pending);
+    expect(await printing.cancelPrintJobs('mock-1', ids), 2);
+    expect(await findJob('mock-1', first.id), isNull);
+    expect(await findJob('mock-1', second.id), isNull);
+  });
+
+  test('pages through Get-Jobs', () async {
+    final submitted = <int>[];
+    for (var i = 0; i < 5; i++) {
+      submitted.add((await submit('mock-4', 'page-$i')).id);
+    }
+
+    final first = await printing.listPrintJobsPage('mock-4', limit: 2);
+    expect(first.jobs.map((job) => job.id), submitted.take(2));
+    expect(first.jobs.first.title, 'page-0');
+    expect(first.hasMore, isTrue);
+
+    final last = await printing.listPrintJobsPage('mock-4', firstIndex: 4, limit: 2);
+    expect(last.jobs.map((job) => job.id), [submitted[4]]);
+    expect(last.hasMore, isFalse);
+
+    final untitled = await printing.listPrintJobsPage('mock-4', limit: 1, fields: const {PrintJobField.state});
+    expect(untitled.jobs.single.title, isEmpty);
+    expect(untitled.jobs.single.status, PrintJobStatus.pending);
+  });
+
+  test('reports printer statuses', () async {
+    final reports = {for (final report in await printing.getPrinterStatuses(['mock-1', 'mock-2', 'mock-3', 'missing'])) report.name: report};
+
+    expect(reports['mock-1']!.found, isTrue);
+    expect(reports['mock-1']!.isAcceptingJobs, isTrue);
+    expect(reports['mock-1']!.supplies.map((supply) => supply.name), ['Black Toner', 'Drum Unit']);
+    expect(reports['mock-2']!.state, 5);
+    expect(reports['mock-2']!.stateReasons, contains('paused'));
+    expect(reports['mock-3']!.isAcceptingJobs, isFalse);
+    expect(reports['missing']!.found, isFalse);
+  });
+
+  group('admission control', () {
+    tearDown(() => printing.setAdmissionControl(enabled: false));
+
+    test('is off by default', () async {
+      expect(await printing.rawDataToPrinter('mock-2', payload, docName: 'stopped-queue'), isTrue);
+    });
+
+    test('rejects stopped and rejecting queues', () async {
+      printing.setAdmissionControl(enabled: true);
+
+      await expectLater(
+        printing.rawDataToPrinter('mock-2', payload),
+        throwsA(isA<PrinterUnavailableException>().having((e) => e.reason, 'reason', PrinterUnavailableReason.stopped)),
+      );
+      await expectLater(
+        submit('mock-3', 'rejected'),
+        throwsA(isA<PrinterUnavailableException>().having((e) => e.reason, 'reason', PrinterUnavailableReason.notAcceptingJobs)),
+      );
+      expect(await printing.rawDataToPrinter('mock-1', payload, docName: 'admitted'), isTrue);
+    });
+
+    test('reroutes to the fallback printer', () async {
+      printing
+        ..setAdmissionControl(enabled: true)
+        ..setFallbackPrinter('mock-2', 'mock-1');
+      addTearDown(() => printing.setFallbackPrinter('mock-2', null));
+
+      final job = await submit('mock-2', 'rerouted');
+      expect(await findJob('mock-1', job.id), isNotNull);
+    });
+  });
+}
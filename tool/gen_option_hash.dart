@@ -0,0 +1,65 @@
+// Generates the perfect-hash slot table for the generic print option keys
+// that src/printing_ffi.c normalizes (see "Option Normalization" there).
+//
+//   dart run tool/gen_option_hash.dart
+//
+// The keys below must be listed in the same order as s_option_keys. The
+// script searches for the first seed for which _perfect_hash sends every
+// key to a different slot, then prints OPTION_HASH_SEED and s_option_slots to
+// paste over the generated block in printing_ffi.c. Rerun it whenever a key
+// is added, removed or reordered.
+import 'dart:convert';
+import 'dart:io';
+
+const keys = [
+  'orientation',
+  'color-mode',
+  'print-quality',
+  'duplex',
+  'collate',
+  'paper-size-id',
+  'paper-source-id',
+  'media-type-id',
+  'custom-scale-factor',
+];
+
+/// Must match OPTION_HASH_BITS in printing_ffi.c.
+const hashBits = 4;
+
+/// Mirrors _perfect_hash: 32-bit FNV-1a with the seed mixed into the offset
+/// basis, keeping the top [hashBits] bits.
+int optionKeyHash(String key, int seed) {
+  var hash = (0x811c9dc5 ^ seed) & 0xffffffff;
+  for (final byte in utf8.encode(key)) {
+    hash ^= byte;
+    hash = (hash * 0x01000193) & 0xffffffff;
+  }
+  return hash >> (32 - hashBits);
+}
+
+void main() {
+  const slotCount = 1 << hashBits;
+  if (keys.length > slotCount) {
+    stderr.writeln('${keys.length} keys do not fit in $slotCount slots; raise hashBits.');
+    exit(1);
+  }
+  for (var seed = 0; seed < 1 << 24; seed++) {
+    final slots = List<int>.filled(slotCount, -1);
+    var perfect = true;
+    for (var i = 0; i < keys.length && perfect; i++) {
+      final slot = optionKeyHash(keys[i], seed);
+      if (slots[slot] >= 0) {
+        perfect = false;
+      } else {
+        slots[slot] = i;
+      }
+    }
+    if (!perfect) continue;
+    stdout.writeln('// Generated by tool/gen_option_hash.dart; do not edit by hand.');
+    stdout.writeln('#define OPTION_HASH_SEED ${seed}u');
+    stdout.writeln('static const signed char s_option_slots[1 << OPTION_HASH_BITS] = {${slots.join(', ')}};');
+    return;
+  }
+  stderr.writeln('No perfect seed found; raise hashBits.');
+  exit(1);
+}
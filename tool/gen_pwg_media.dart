@@ -0,0 +1,145 @@
+// Generates the PWG 5101.1 media size table in src/printing_ffi.c (see
+// "Media Sizes" there), together with the perfect-hash slots used to look a
+// size up by its PWG name, PPD PageSize name or legacy IPP keyword, and the
+// index used to look one up by its Windows DMPAPER id.
+//
+//   dart run tool/gen_pwg_media.dart
+//
+// Paste the output over the generated block in printing_ffi.c. Sizes are in
+// PWG units (hundredths of a millimeter); inch sizes are rounded the same way
+// as CUPS rounds them.
+import 'dart:convert';
+import 'dart:io';
+
+class Media {
+  final String pwg;
+  final String? ppd;
+  final String? ipp;
+  final int windowsId;
+  final int width;
+  final int height;
+
+  const Media(this.pwg, this.ppd, this.ipp, this.windowsId, this.width, this.height);
+}
+
+int _in(double inches) => (inches * 2540).round();
+int _mm(double millimeters) => (millimeters * 100).round();
+
+final media = [
+  Media('na_letter_8.5x11in', 'Letter', 'na-letter', 1, _in(8.5), _in(11)),
+  Media('na_legal_8.5x14in', 'Legal', 'na-legal', 5, _in(8.5), _in(14)),
+  Media('na_ledger_11x17in', 'Tabloid', 'tabloid', 3, _in(11), _in(17)),
+  Media('na_executive_7.25x10.5in', 'Executive', 'executive', 7, _in(7.25), _in(10.5)),
+  Media('na_invoice_5.5x8.5in', 'Statement', 'invoice', 6, _in(5.5), _in(8.5)),
+  Media('na_foolscap_8.5x13in', 'FanFoldGermanLegal', null, 14, _in(8.5), _in(13)),
+  Media('na_10x14_10x14in', '10x14', null, 16, _in(10), _in(14)),
+  Media('na_govt-letter_8x10in', '8x10', 'na-8x10', 0, _in(8), _in(10)),
+  Media('na_5x7_5x7in', '5x7', 'na-5x7', 0, _in(5), _in(7)),
+  Media('na_index-4x6_4x6in', '4x6', null, 0, _in(4), _in(6)),
+  Media('na_index-3x5_3x5in', '3x5', null, 0, _in(3), _in(5)),
+  Media('oe_photo-l_3.5x5in', '3.5x5', null, 0, _in(3.5), _in(5)),
+  Media('na_number-9_3.875x8.875in', 'Env9', 'na-number-9-envelope', 19, _in(3.875), _in(8.875)),
+  Media('na_number-10_4.125x9.5in', 'Env10', 'na-number-10-envelope', 20, _in(4.125), _in(9.5)),
+  Media('na_monarch_3.875x7.5in', 'EnvMonarch', 'monarch-envelope', 37, _in(3.875), _in(7.5)),
+  Media('na_personal_3.625x6.5in', 'EnvPersonal', null, 38, _in(3.625), _in(6.5)),
+  Media('iso_a0_841x1189mm', 'A0', 'iso-a0', 0, _mm(841), _mm(1189)),
+  Media('iso_a1_594x841mm', 'A1', 'iso-a1', 0, _mm(594), _mm(841)),
+  Media('iso_a2_420x594mm', 'A2', 'iso-a2', 66, _mm(420), _mm(594)),
+  Media('iso_a3_297x420mm', 'A3', 'iso-a3', 8, _mm(297), _mm(420)),
+  Media('iso_a4_210x297mm', 'A4', 'iso-a4', 9, _mm(210), _mm(297)),
+  Media('iso_a5_148x210mm', 'A5', 'iso-a5', 11, _mm(148), _mm(210)),
+  Media('iso_a6_105x148mm', 'A6', 'iso-a6', 70, _mm(105), _mm(148)),
+  Media('iso_b4_250x353mm', 'ISOB4', 'iso-b4', 42, _mm(250), _mm(353)),
+  Media('iso_b5_176x250mm', 'ISOB5', 'iso-b5', 34, _mm(176), _mm(250)),
+  Media('jis_b4_257x364mm', 'B4', 'jis-b4', 12, _mm(257), _mm(364)),
+  Media('jis_b5_182x257mm', 'B5', 'jis-b5', 13, _mm(182), _mm(257)),
+  Media('iso_c4_229x324mm', 'EnvC4', 'iso-c4', 30, _mm(229), _mm(324)),
+  Media('iso_c5_162x229mm', 'EnvC5', 'iso-c5', 28, _mm(162), _mm(229)),
+  Media('iso_c6_114x162mm', 'EnvC6', 'iso-c6', 31, _mm(114), _mm(162)),
+  Media('iso_dl_110x220mm', 'EnvDL', 'iso-designated-long', 27, _mm(110), _mm(220)),
+  Media('jpn_hagaki_100x148mm', 'Postcard', null, 43, _mm(100), _mm(148)),
+];
+
+/// Must match MEDIA_HASH_BITS in printing_ffi.c.
+const hashBits = 9;
+
+/// Mirrors _perfect_hash: 32-bit FNV-1a with the seed mixed into the offset
+/// basis, keeping the top [bits] bits.
+int perfectHash(String key, int seed, int bits) {
+  var hash = (0x811c9dc5 ^ seed) & 0xffffffff;
+  for (final byte in utf8.encode(key)) {
+    hash ^= byte;
+    hash = (hash * 0x01000193) & 0xffffffff;
+  }
+  return hash >> (32 - bits);
+}
+
+String _quote(String? value) => value == null ? 'NULL' : '"$value"';
+
+void _writeArray(String declaration, List<int> values) {
+  stdout.writeln('$declaration = {');
+  for (var i = 0; i < values.length; i += 16) {
+    final end = i + 16 < values.length ? i + 16 : values.length;
+    stdout.writeln('    ${values.sublist(i, end).join(', ')},');
+  }
+  stdout.writeln('};');
+}
+
+void main() {
+  // Each key is encoded as media index * 4 + field (0 PWG, 1 PPD, 2 IPP).
+  final keys = <String, int>{};
+  for (var i = 0; i < media.length; i++) {
+    final names = [media[i].pwg, media[i].ppd, media[i].ipp];
+    for (var field = 0; field < names.length; field++) {
+      final name = names[field];
+      if (name == null) continue;
+      if (keys.containsKey(name)) {
+        stderr.writeln('Duplicate media name $name.');
+        exit(1);
+      }
+      keys[name] = i * 4 + field;
+    }
+  }
+
+  const slotCount = 1 << hashBits;
+  List<int>? slots;
+  var seed = 0;
+  for (; seed < 1 << 24 && slots == null; seed++) {
+    final candidate = List<int>.filled(slotCount, -1);
+    var perfect = true;
+    for (final entry in keys.entries) {
+      final slot = perfectHash(entry.key, seed, hashBits);
+      if (candidate[slot] >= 0) {
+        perfect = false;
+        break;
+      }
+      candidate[slot] = entry.value;
+    }
+    if (perfect) slots = candidate;
+  }
+  if (slots == null) {
+    stderr.writeln('No perfect seed found; raise hashBits.');
+    exit(1);
+  }
+  seed--;
+
+  var maxWindowsId = 0;
+  for (final size in media) {
+    if (size.windowsId > maxWindowsId) maxWindowsId = size.windowsId;
+  }
+  final byWindowsId = List<int>.filled(maxWindowsId + 1, -1);
+  for (var i = 0; i < media.length; i++) {
+    if (media[i].windowsId > 0) byWindowsId[media[i].windowsId] = i;
+  }
+
+  stdout.writeln('// Generated by tool/gen_pwg_media.dart; do not edit by hand.');
+  stdout.writeln('static const PwgMedia s_pwg_media[] = {');
+  for (final size in media) {
+    stdout.writeln('    {${_quote(size.pwg)}, ${_quote(size.ppd)}, ${_quote(size.ipp)}, ${size.windowsId}, ${size.width}, ${size.height}},');
+  }
+  stdout.writeln('};');
+  stdout.writeln('#define MEDIA_HASH_SEED ${seed}u');
+  _writeArray('static const short s_media_slots[1 << MEDIA_HASH_BITS]', slots);
+  stdout.writeln('#define MEDIA_MAX_WINDOWS_ID $maxWindowsId');
+  _writeArray('static const signed char s_media_by_windows_id[MEDIA_MAX_WINDOWS_ID + 1]', byWindowsId);
+}
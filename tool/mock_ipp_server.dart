@@ -0,0 +1,1012 @@
+// A stand-in for cupsd that speaks enough IPP/HTTP for libcups to enumerate
+// printers, fetch PPDs, submit jobs and control them, without real printers.
+//
+// Run it and point libcups at it through the CUPS_SERVER environment variable:
+//
+//   dart run tool/mock_ipp_server.dart --queues 50 --latency 5 --jitter 2
+//   CUPS_SERVER=127.0.0.1:8631 ./printing_ffi_bench ...
+//
+// Options:
+//   --port <n>               Port to listen on (default 8631, 0 for any free port).
+//   --queues <n>             Number of print queues, named mock-1 .. mock-n (default 4).
+//   --latency <ms>           Delay added before every response (default 0).
+//   --jitter <ms>            Uniform random delay added on top of --latency (default 0).
+//   --fail-rate <p>          Probability in [0, 1] that a request fails (default 0).
+//   --fail-ops <a,b,...>     Only inject failures into these operations, e.g. print-job,get-jobs.
+//   --processing-after <ms>  Time from submission until a job is processing (default 200).
+//   --complete-after <ms>    Time from submission until a job is completed (default 1000).
+//   --ppd-options <n>        Extra PickOne options in each generated PPD (default 0).
+//   --ppd-choices <n>        Choices per extra PPD option (default 8).
+//   --seed <n>               Seed for the jitter and failure random generator.
+//   --stopped <a,b,...>      Queues reported as stopped (printer-state 5), e.g. mock-2.
+//   --rejecting <a,b,...>    Queues that are not accepting jobs and refuse submissions.
+//
+// When it is listening, the server prints one JSON line to stdout with the
+// port and the CUPS_SERVER value to use, so harnesses can start it with
+// `--port 0` and read where it ended up.
+import 'dart:async';
+import 'dart:convert';
+import 'dart:io';
+import 'dart:math';
+import 'dart:typed_data';
+
+Future<void> main(List<String> args) async {
+  final MockIppConfig config;
+  try {
+    config = MockIppConfig.parse(args);
+  } on FormatException catch (e) {
+    stderr.writeln('mock_ipp_server: ${e.message}');
+    exitCode = 64;
+    return;
+  }
+
+  final server = MockIppServer(config);
+  await server.start();
+  stdout.writeln(jsonEncode({'port': server.port, 'cups_server': '127.0.0.1:${server.port}', 'printers': server.printerNames}));
+
+  await ProcessSignal.sigint.watch().first;
+  await server.stop();
+  stdout.writeln(jsonEncode(server.stats));
+}
+
+/// Behavior of a [MockIppServer].
+class MockIppConfig {
+  final int port;
+  final int queues;
+  final Duration latency;
+  final Duration jitter;
+  final double failRate;
+  final Set<String> failOps;
+  final Duration processingAfter;
+  final Duration completeAfter;
+  final int ppdOptions;
+  final int ppdChoices;
+  final int? seed;
+  final Set<String> stopped;
+  final Set<String> rejecting;
+
+  const MockIppConfig({
+    this.port = 8631,
+    this.queues = 4,
+    this.latency = Duration.zero,
+    this.jitter = Duration.zero,
+    this.failRate = 0,
+    this.failOps = const {},
+    this.processingAfter = const Duration(milliseconds: 200),
+    this.completeAfter = const Duration(seconds: 1),
+    this.ppdOptions = 0,
+    this.ppdChoices = 8,
+    this.seed,
+    this.stopped = const {},
+    this.rejecting = const {},
+  });
+
+  factory MockIppConfig.parse(List<String> args) {
+    final values = <String, String>{};
+    for (var i = 0; i < args.length; i++) {
+      final arg = args[i];
+      if (!arg.startsWith('--') || i + 1 >= args.length) {
+        throw FormatException('unexpected argument "$arg"');
+      }
+      values[arg.substring(2)] = args[++i];
+    }
+
+    int intOption(String name, int fallback) {
+      final value = values.remove(name);
+      if (value == null) return fallback;
+      final parsed = int.tryParse(value);
+      if (parsed == null || parsed < 0) throw FormatException('--$name expects a non-negative integer');
+      return parsed;
+    }
+
+    final failRateValue = values.remove('fail-rate');
+    final failRate = failRateValue == null ? 0.0 : double.tryParse(failRateValue);
+    if (failRate == null || failRate < 0 || failRate > 1) {
+      throw const FormatException('--fail-rate expects a number between 0 and 1');
+    }
+    Set<String> listOption(String name) {
+      final value = values.remove(name);
+      return value == null ? const {} : value.split(',').map((item) => item.trim()).where((item) => item.isNotEmpty).toSet();
+    }
+
+    final seedValue = values.remove('seed');
+
+    final config = MockIppConfig(
+      port: intOption('port', 8631),
+      queues: intOption('queues', 4),
+      latency: Duration(milliseconds: intOption('latency', 0)),
+      jitter: Duration(milliseconds: intOption('jitter', 0)),
+      failRate: failRate,
+      failOps: listOption('fail-ops'),
+      processingAfter: Duration(milliseconds: intOption('processing-after', 200)),
+      completeAfter: Duration(milliseconds: intOption('complete-after', 1000)),
+      ppdOptions: intOption('ppd-options', 0),
+      ppdChoices: intOption('ppd-choices', 8),
+      seed: seedValue == null ? null : int.tryParse(seedValue),
+      stopped: listOption('stopped'),
+      rejecting: listOption('rejecting'),
+    );
+    if (values.isNotEmpty) {
+      throw FormatException('unknown option --${values.keys.first}');
+    }
+    return config;
+  }
+}
+
+// --- IPP encoding ---
+
+/// IPP delimiter and value tags used by the server.
+abstract final class IppTag {
+  static const operationGroup = 0x01;
+  static const jobGroup = 0x02;
+  static const endOfAttributes = 0x03;
+  static const printerGroup = 0x04;
+  static const unsupportedGroup = 0x05;
+
+  static const noValue = 0x13;
+  static const integer = 0x21;
+  static const boolean = 0x22;
+  static const enumValue = 0x23;
+  static const octetString = 0x30;
+  static const dateTime = 0x31;
+  static const resolution = 0x32;
+  static const rangeOfInteger = 0x33;
+  static const text = 0x41;
+  static const name = 0x42;
+  static const keyword = 0x44;
+  static const uri = 0x45;
+  static const charset = 0x47;
+  static const naturalLanguage = 0x48;
+  static const mimeMediaType = 0x49;
+}
+
+/// IPP operation ids handled by the server.
+abstract final class IppOp {
+  static const printJob = 0x0002;
+  static const validateJob = 0x0004;
+  static const createJob = 0x0005;
+  static const sendDocument = 0x0006;
+  static const cancelJob = 0x0008;
+  static const getJobAttributes = 0x0009;
+  static const getJobs = 0x000A;
+  static const getPrinterAttributes = 0x000B;
+  static const holdJob = 0x000C;
+  static const releaseJob = 0x000D;
+  static const purgeJobs = 0x0012;
+  static const cancelJobs = 0x0038;
+  static const cancelMyJobs = 0x0039;
+  static const cupsGetDefault = 0x4001;
+  static const cupsGetPrinters = 0x4002;
+  static const cupsGetClasses = 0x4005;
+
+  static const names = {
+    printJob: 'print-job',
+    validateJob: 'validate-job',
+    createJob: 'create-job',
+    sendDocument: 'send-document',
+    cancelJob: 'cancel-job',
+    getJobAttributes: 'get-job-attributes',
+    getJobs: 'get-jobs',
+    getPrinterAttributes: 'get-printer-attributes',
+    holdJob: 'hold-job',
+    releaseJob: 'release-job',
+    purgeJobs: 'purge-jobs',
+    cancelJobs: 'cancel-jobs',
+    cancelMyJobs: 'cancel-my-jobs',
+    cupsGetDefault: 'cups-get-default',
+    cupsGetPrinters: 'cups-get-printers',
+    cupsGetClasses: 'cups-get-classes',
+  };
+}
+
+/// IPP status codes returned by the server.
+abstract final class IppStatus {
+  static const ok = 0x0000;
+  static const badRequest = 0x0400;
+  static const notPossible = 0x0404;
+  static const notFound = 0x0406;
+  static const internalError = 0x0500;
+  static const operationNotSupported = 0x0501;
+  static const serviceUnavailable = 0x0502;
+  static const notAcceptingJobs = 0x0506;
+}
+
+/// Job states as defined by RFC 8011.
+abstract final class IppJobState {
+  static const pending = 3;
+  static const held = 4;
+  static const processing = 5;
+  static const canceled = 7;
+  static const completed = 9;
+}
+
+/// A `rangeOfInteger` value.
+class IppRange {
+  final int lower;
+  final int upper;
+  const IppRange(this.lower, this.upper);
+}
+
+/// A `resolution` value in dots per inch.
+class IppResolution {
+  final int x;
+  final int y;
+  const IppResolution(this.x, this.y);
+}
+
+class IppAttribute {
+  final int tag;
+  final String name;
+  final List<Object> values;
+  IppAttribute(this.tag, this.name, this.values);
+
+  Object? get first => values.isEmpty ? null : values.first;
+}
+
+class IppGroup {
+  final int tag;
+  final List<IppAttribute> attributes;
+  IppGroup(this.tag, [List<IppAttribute>? attributes]) : attributes = attributes ?? [];
+
+  IppAttribute? operator [](String name) {
+    for (final attribute in attributes) {
+      if (attribute.name == name) return attribute;
+    }
+    return null;
+  }
+
+  void add(int tag, String name, Object value) => attributes.add(IppAttribute(tag, name, value is List<Object> ? value : [value]));
+}
+
+class IppMessage {
+  final int version;
+
+  /// The operation id of a request or the status code of a response.
+  final int code;
+  final int requestId;
+  final List<IppGroup> groups;
+
+  /// Document data following the attributes.
+  final Uint8List data;
+
+  IppMessage(this.version, this.code, this.requestId, this.groups, [Uint8List? data]) : data = data ?? Uint8List(0);
+
+  IppGroup? group(int tag) {
+    for (final group in groups) {
+      if (group.tag == tag) return group;
+    }
+    return null;
+  }
+
+  IppAttribute? operationAttribute(String name) => group(IppTag.operationGroup)?[name];
+
+  static IppMessage decode(Uint8List bytes) {
+    final view = ByteData.sublistView(bytes);
+    if (bytes.length < 9) throw const FormatException('IPP message too short');
+    final version = view.getUint16(0);
+    final code = view.getUint16(2);
+    final requestId = view.getUint32(4);
+    final groups = <IppGroup>[];
+    var offset = 8;
+    IppGroup? current;
+    IppAttribute? last;
+
+    while (offset < bytes.length) {
+      final tag = bytes[offset++];
+      if (tag == IppTag.endOfAttributes) {
+        return IppMessage(version, code, requestId, groups, Uint8List.sublistView(bytes, offset));
+      }
+      if (tag < 0x10) {
+        current = IppGroup(tag);
+        groups.add(current);
+        last = null;
+        continue;
+      }
+      if (current == null || offset + 2 > bytes.length) throw const FormatException('Malformed IPP attribute');
+      final nameLength = view.getUint16(offset);
+      offset += 2;
+      final name = utf8.decode(bytes.sublist(offset, offset + nameLength));
+      offset += nameLength;
+      final valueLength = view.getUint16(offset);
+      offset += 2;
+      if (offset + valueLength > bytes.length) throw const FormatException('Truncated IPP value');
+      final value = _decodeValue(tag, ByteData.sublistView(bytes, offset, offset + valueLength), Uint8List.sublistView(bytes, offset, offset + valueLength));
+      offset += valueLength;
+
+      if (nameLength == 0 && last != null) {
+        last.values.add(value); // Additional value of a 1setOf attribute.
+      } else {
+        last = IppAttribute(tag, name, [value]);
+        current.attributes.add(last);
+      }
+    }
+    throw const FormatException('Missing end-of-attributes tag');
+  }
+
+  static Object _decodeValue(int tag, ByteData view, Uint8List raw) {
+    switch (tag) {
+      case IppTag.integer:
+      case IppTag.enumValue:
+        return raw.length == 4 ? view.getInt32(0) : 0;
+      case IppTag.boolean:
+        return raw.isNotEmpty && raw[0] != 0;
+      case IppTag.rangeOfInteger:
+        return raw.length == 8 ? IppRange(view.getInt32(0), view.getInt32(4)) : const IppRange(0, 0);
+      case IppTag.resolution:
+        return raw.length == 9 ? IppResolution(view.getInt32(0), view.getInt32(4)) : const IppResolution(0, 0);
+      case IppTag.octetString:
+      case IppTag.dateTime:
+        return Uint8List.fromList(raw);
+      default:
+        return tag >= 0x40 ? utf8.decode(raw, allowMalformed: true) : Uint8List.fromList(raw);
+    }
+  }
+
+  Uint8List encode() {
+    final out = BytesBuilder(copy: false);
+    final header = ByteData(8)
+      ..setUint16(0, version)
+      ..setUint16(2, code)
+      ..setUint32(4, requestId);
+    out.add(header.buffer.asUint8List());
+    for (final group in groups) {
+      out.addByte(group.tag);
+      for (final attribute in group.attributes) {
+        if (attribute.values.isEmpty) {
+          _writeValue(out, IppTag.noValue, attribute.name, Uint8List(0));
+          continue;
+        }
+        for (var i = 0; i < attribute.values.length; i++) {
+          _writeValue(out, attribute.tag, i == 0 ? attribute.name : '', _encodeValue(attribute.tag, attribute.values[i]));
+        }
+      }
+    }
+    out.addByte(IppTag.endOfAttributes);
+    out.add(data);
+    return out.takeBytes();
+  }
+
+  static void _writeValue(BytesBuilder out, int tag, String name, Uint8List value) {
+    final nameBytes = utf8.encode(name);
+    out
+      ..addByte(tag)
+      ..addByte(nameBytes.length >> 8)
+      ..addByte(nameBytes.length & 0xFF)
+      ..add(nameBytes)
+      ..addByte(value.length >> 8)
+      ..addByte(value.length & 0xFF)
+      ..add(value);
+  }
+
+  static Uint8List _encodeValue(int tag, Object value) {
+    switch (value) {
+      case int v when tag == IppTag.integer || tag == IppTag.enumValue:
+        return (ByteData(4)..setInt32(0, v)).buffer.asUint8List();
+      case bool v:
+        return Uint8List.fromList([v ? 1 : 0]);
+      case IppRange v:
+        return (ByteData(8)
+              ..setInt32(0, v.lower)
+              ..setInt32(4, v.upper))
+            .buffer
+            .asUint8List();
+      case IppResolution v:
+        return (ByteData(9)
+              ..setInt32(0, v.x)
+              ..setInt32(4, v.y)
+              ..setUint8(8, 3)) // 3 = dots per inch
+            .buffer
+            .asUint8List();
+      case Uint8List v:
+        return v;
+      default:
+        return Uint8List.fromList(utf8.encode(value.toString()));
+    }
+  }
+}
+
+// --- Printer and job model ---
+
+class MockJob {
+  final int id;
+  final MockPrinter printer;
+  final String name;
+  final String user;
+  final DateTime createdAt;
+  int sizeBytes = 0;
+
+  /// Submission time used for state progression; reset when a held job is released.
+  DateTime queuedAt;
+  int? _finalState;
+  DateTime? _finishedAt;
+  bool held = false;
+
+  MockJob(this.id, this.printer, this.name, this.user, this.createdAt) : queuedAt = createdAt;
+
+  int stateAt(DateTime now, MockIppConfig config) {
+    if (_finalState != null) return _finalState!;
+    if (held) return IppJobState.held;
+    final elapsed = now.difference(queuedAt);
+    if (elapsed >= config.completeAfter) return IppJobState.completed;
+    if (elapsed >= config.processingAfter) return IppJobState.processing;
+    return IppJobState.pending;
+  }
+
+  DateTime? processingAt(MockIppConfig config) {
+    if (held || (_finalState != null && _finishedAt!.difference(queuedAt) < config.processingAfter)) return null;
+    return queuedAt.add(config.processingAfter);
+  }
+
+  DateTime? completedAt(DateTime now, MockIppConfig config) {
+    if (_finishedAt != null) return _finishedAt;
+    return stateAt(now, config) == IppJobState.completed ? queuedAt.add(config.completeAfter) : null;
+  }
+
+  bool isFinished(DateTime now, MockIppConfig config) => stateAt(now, config) >= IppJobState.canceled;
+
+  void cancel(DateTime now) {
+    _finalState = IppJobState.canceled;
+    _finishedAt = now;
+  }
+}
+
+class MockPrinter {
+  final String name;
+  final int index;
+  final Map<int, MockJob> jobs = {};
+  MockPrinter(this.name, this.index);
+}
+
+// --- Server ---
+
+/// An IPP server that mimics the subset of cupsd used by printing_ffi.
+class MockIppServer {
+  final MockIppConfig config;
+  final List<MockPrinter> _printers;
+  final Random _random;
+  final Map<String, int> _requestCounts = {};
+  final DateTime _startedAt = DateTime.now();
+  ServerSocket? _socket;
+  int _nextJobId = 1;
+  int _failures = 0;
+
+  MockIppServer(this.config) : _printers = List.generate(config.queues, (i) => MockPrinter('mock-${i + 1}', i)), _random = Random(config.seed);
+
+  int get port => _socket!.port;
+
+  List<String> get printerNames => [for (final printer in _printers) printer.name];
+
+  Map<String, Object> get stats => {'requests': Map.of(_requestCounts), 'injected_failures': _failures, 'jobs': _nextJobId - 1};
+
+  Future<void> start() async {
+    _socket = await ServerSocket.bind(InternetAddress.loopbackIPv4, config.port);
+    _socket!.listen((client) => _serveConnection(client).catchError((Object _) => client.destroy()));
+  }
+
+  Future<void> stop() async {
+    await _socket?.close();
+    _socket = null;
+  }
+
+  Future<void> _serveConnection(Socket client) async {
+    client.setOption(SocketOption.tcpNoDelay, true);
+    final reader = _HttpReader(client);
+    try {
+      while (true) {
+        final request = await reader.readRequest(onExpectContinue: () => client.add(ascii.encode('HTTP/1.1 100 Continue\r\n\r\n')));
+        if (request == null) break;
+        await _delay();
+        final response = _handleHttp(request);
+        client.add(response);
+        await client.flush();
+        if (request.headers['connection']?.toLowerCase() == 'close') break;
+      }
+    } finally {
+      await reader.cancel();
+      await client.close();
+    }
+  }
+
+  Future<void> _delay() {
+    var delay = config.latency;
+    if (config.jitter > Duration.zero) {
+      delay += Duration(microseconds: _random.nextInt(config.jitter.inMicroseconds + 1));
+    }
+    return delay > Duration.zero ? Future<void>.delayed(delay) : Future<void>.value();
+  }
+
+  Uint8List _handleHttp(_HttpRequest request) {
+    if (request.method == 'POST') {
+      Uint8List body;
+      try {
+        body = _handleIpp(IppMessage.decode(request.body)).encode();
+      } on FormatException {
+        return _httpResponse(400, 'text/plain', Uint8List.fromList(ascii.encode('Bad IPP request')));
+      }
+      return _httpResponse(200, 'application/ipp', body);
+    }
+    if (request.method == 'GET' && request.path.startsWith('/printers/') && request.path.endsWith('.ppd')) {
+      _count('get-ppd');
+      final printer = _printerNamed(request.path.substring('/printers/'.length, request.path.length - '.ppd'.length));
+      if (printer == null) return _httpResponse(404, 'text/plain', Uint8List(0));
+      // PPDs never change while the server runs; their Last-Modified is the start time.
+      final ifModifiedSince = _parseHttpDate(request.headers['if-modified-since']);
+      if (ifModifiedSince != null && ifModifiedSince.millisecondsSinceEpoch ~/ 1000 >= _startedAt.millisecondsSinceEpoch ~/ 1000) {
+        _count('get-ppd-not-modified');
+        return _httpResponse(304, 'application/vnd.cups-ppd', Uint8List(0));
+      }
+      return _httpResponse(200, 'application/vnd.cups-ppd', Uint8List.fromList(utf8.encode(_ppdFor(printer))));
+    }
+    return _httpResponse(404, 'text/plain', Uint8List(0));
+  }
+
+  Uint8List _httpResponse(int status, String contentType, Uint8List body) {
+    const reasons = {200: 'OK', 304: 'Not Modified', 400: 'Bad Request', 404: 'Not Found'};
+    final header = 'HTTP/1.1 $status ${reasons[status]}\r\n'
+        'Date: ${HttpDate.format(DateTime.now())}\r\n'
+        'Last-Modified: ${HttpDate.format(_startedAt)}\r\n'
+        'Content-Type: $contentType\r\n'
+        'Content-Length: ${body.length}\r\n'
+        'Connection: Keep-Alive\r\n\r\n';
+    return (BytesBuilder(copy: false)
+          ..add(ascii.encode(header))
+          ..add(body))
+        .takeBytes();
+  }
+
+  DateTime? _parseHttpDate(String? value) {
+    if (value == null) return null;
+    try {
+      return HttpDate.parse(value);
+    } on HttpException {
+      return null;
+    }
+  }
+
+  void _count(String name) => _requestCounts[name] = (_requestCounts[name] ?? 0) + 1;
+
+  MockPrinter? _printerNamed(String name) {
+    final decoded = Uri.decodeComponent(name);
+    for (final printer in _printers) {
+      if (printer.name == decoded) return printer;
+    }
+    return null;
+  }
+
+  MockPrinter? _printerFromUri(String? uri) {
+    if (uri == null) return null;
+    final path = Uri.tryParse(uri)?.path ?? '';
+    final slash = path.lastIndexOf('/');
+    return slash < 0 ? null : _printerNamed(path.substring(slash + 1));
+  }
+
+  String _printerUri(MockPrinter printer) => 'ipp://127.0.0.1:$port/printers/${printer.name}';
+
+  IppMessage _handleIpp(IppMessage request) {
+    final opName = IppOp.names[request.code] ?? 'unknown-0x${request.code.toRadixString(16)}';
+    _count(opName);
+
+    final operation = IppGroup(IppTag.operationGroup)
+      ..add(IppTag.charset, 'attributes-charset', 'utf-8')
+      ..add(IppTag.naturalLanguage, 'attributes-natural-language', 'en');
+    final groups = [operation];
+    IppMessage respond(int status, [String? message]) {
+      if (message != null) operation.add(IppTag.text, 'status-message', message);
+      return IppMessage(request.version, status, request.requestId, groups);
+    }
+
+    if (config.failRate > 0 && (config.failOps.isEmpty || config.failOps.contains(opName)) && _random.nextDouble() < config.failRate) {
+      _failures++;
+      return respond(IppStatus.serviceUnavailable, 'Injected failure');
+    }
+
+    final now = DateTime.now();
+    final requested = _requestedAttributes(request);
+    final printer = _printerFromUri(request.operationAttribute('printer-uri')?.first as String?);
+    final user = request.operationAttribute('requesting-user-name')?.first as String? ?? 'anonymous';
+
+    switch (request.code) {
+      case IppOp.cupsGetPrinters:
+        final limit = request.operationAttribute('limit')?.first as int? ?? _printers.length;
+        for (final p in _printers.take(limit)) {
+          groups.add(_printerAttributes(p, now, requested));
+        }
+        return respond(IppStatus.ok);
+
+      case IppOp.cupsGetClasses:
+        return respond(IppStatus.ok);
+
+      case IppOp.cupsGetDefault:
+        if (_printers.isEmpty) return respond(IppStatus.notFound, 'No default printer');
+        groups.add(_printerAttributes(_printers.first, now, requested));
+        return respond(IppStatus.ok);
+
+      case IppOp.getPrinterAttributes:
+        if (printer == null) return respond(IppStatus.notFound, 'The printer does not exist');
+        groups.add(_printerAttributes(printer, now, requested));
+        return respond(IppStatus.ok);
+
+      case IppOp.validateJob:
+        return respond(printer == null ? IppStatus.notFound : IppStatus.ok);
+
+      case IppOp.printJob:
+      case IppOp.createJob:
+        if (printer == null) return respond(IppStatus.notFound, 'The printer does not exist');
+        if (config.rejecting.contains(printer.name)) return respond(IppStatus.notAcceptingJobs, 'The printer is not accepting jobs');
+        final job = MockJob(_nextJobId++, printer, request.operationAttribute('job-name')?.first as String? ?? 'Untitled', user, now)..sizeBytes = request.data.length;
+        printer.jobs[job.id] = job;
+        groups.add(_jobAttributes(job, now, const {'job-id', 'job-uri', 'job-state', 'job-state-reasons'}));
+        return respond(IppStatus.ok);
+
+      case IppOp.sendDocument:
+        final job = _jobFor(request, printer);
+        if (job == null) return respond(IppStatus.notFound, 'The job does not exist');
+        job.sizeBytes += request.data.length;
+        groups.add(_jobAttributes(job, now, const {'job-id', 'job-uri', 'job-state', 'job-state-reasons'}));
+        return respond(IppStatus.ok);
+
+      case IppOp.getJobAttributes:
+        final job = _jobFor(request, printer);
+        if (job == null) return respond(IppStatus.notFound, 'The job does not exist');
+        groups.add(_jobAttributes(job, now, requested));
+        return respond(IppStatus.ok);
+
+      case IppOp.getJobs:
+        return _getJobs(request, printer, user, now, requested, groups, respond);
+
+      case IppOp.cancelJob:
+      case IppOp.holdJob:
+      case IppOp.releaseJob:
+        final job = _jobFor(request, printer);
+        if (job == null) return respond(IppStatus.notFound, 'The job does not exist');
+        if (job.isFinished(now, config)) return respond(IppStatus.notPossible, 'The job is already finished');
+        if (request.code == IppOp.cancelJob) {
+          job.cancel(now);
+        } else if (request.code == IppOp.holdJob) {
+          job.held = true;
+        } else if (job.held) {
+          job
+            ..held = false
+            ..queuedAt = now;
+        }
+        return respond(IppStatus.ok);
+
+      case IppOp.cancelJobs:
+        if (printer == null) return respond(IppStatus.notFound, 'The printer does not exist');
+        final ids = request.operationAttribute('job-ids')?.values.whereType<int>() ?? const <int>[];
+        for (final id in ids) {
+          final job = printer.jobs[id];
+          if (job == null || job.isFinished(now, config)) return respond(IppStatus.notPossible, 'Job $id cannot be canceled');
+        }
+        for (final id in ids) {
+          printer.jobs[id]!.cancel(now);
+        }
+        return respond(IppStatus.ok);
+
+      case IppOp.cancelMyJobs:
+      case IppOp.purgeJobs:
+        final targets = printer == null ? _printers : [printer];
+        for (final p in targets) {
+          if (request.code == IppOp.purgeJobs) {
+            p.jobs.clear();
+            continue;
+          }
+          for (final job in p.jobs.values) {
+            if (job.user == user && !job.isFinished(now, config)) job.cancel(now);
+          }
+        }
+        return respond(IppStatus.ok);
+
+      default:
+        return respond(IppStatus.operationNotSupported, 'Operation $opName is not supported by the mock server');
+    }
+  }
+
+  IppMessage _getJobs(IppMessage request, MockPrinter? printer, String user, DateTime now, Set<String>? requested, List<IppGroup> groups, IppMessage Function(int, [String?]) respond) {
+    final which = request.operationAttribute('which-jobs')?.first as String? ?? 'not-completed';
+    final myJobs = request.operationAttribute('my-jobs')?.first as bool? ?? false;
+    final firstIndex = request.operationAttribute('first-index')?.first as int? ?? 1;
+    final limit = request.operationAttribute('limit')?.first as int?;
+
+    final jobs = <MockJob>[
+      for (final p in printer == null ? _printers : [printer])
+        for (final job in p.jobs.values)
+          if ((which == 'all' || (which == 'completed') == job.isFinished(now, config)) && (!myJobs || job.user == user)) job,
+    ]..sort((a, b) => which == 'completed' ? b.id.compareTo(a.id) : a.id.compareTo(b.id));
+
+    // Default attributes when none are requested, as cupsd does.
+    final attributes = requested ?? const {'job-id', 'job-uri'};
+    var emitted = 0;
+    for (final job in jobs.skip(firstIndex - 1)) {
+      if (limit != null && emitted >= limit) break;
+      groups.add(_jobAttributes(job, now, attributes));
+      emitted++;
+    }
+    return respond(IppStatus.ok);
+  }
+
+  MockJob? _jobFor(IppMessage request, MockPrinter? printer) {
+    var id = request.operationAttribute('job-id')?.first as int?;
+    final jobUri = request.operationAttribute('job-uri')?.first as String?;
+    if (id == null && jobUri != null) {
+      id = int.tryParse(jobUri.substring(jobUri.lastIndexOf('/') + 1));
+    }
+    if (id == null) return null;
+    if (printer != null) return printer.jobs[id];
+    for (final p in _printers) {
+      final job = p.jobs[id];
+      if (job != null) return job;
+    }
+    return null;
+  }
+
+  Set<String>? _requestedAttributes(IppMessage request) {
+    final values = request.operationAttribute('requested-attributes')?.values.whereType<String>().toSet();
+    if (values == null || values.contains('all') || values.contains('printer-description') || values.contains('job-description') || values.contains('job-template')) {
+      return null;
+    }
+    return values;
+  }
+
+  IppGroup _printerAttributes(MockPrinter printer, DateTime now, Set<String>? requested) {
+    final group = IppGroup(IppTag.printerGroup);
+    void add(int tag, String name, Object value) {
+      if (requested == null || requested.contains(name)) group.add(tag, name, value);
+    }
+
+    final active = printer.jobs.values.where((job) => !job.isFinished(now, config)).toList();
+    final processing = active.any((job) => job.stateAt(now, config) == IppJobState.processing);
+    add(IppTag.name, 'printer-name', printer.name);
+    add(IppTag.uri, 'printer-uri-supported', _printerUri(printer));
+    add(IppTag.uri, 'device-uri', 'file:///dev/null');
+    add(IppTag.text, 'printer-info', 'Mock Printer ${printer.index + 1}');
+    add(IppTag.text, 'printer-location', 'printing_ffi mock rack ${printer.index ~/ 16 + 1}');
+    add(IppTag.text, 'printer-make-and-model', 'printing_ffi Mock IPP Printer');
+    final stopped = config.stopped.contains(printer.name);
+    add(IppTag.enumValue, 'printer-state', stopped ? 5 : processing ? 4 : 3);
+    add(IppTag.keyword, 'printer-state-reasons', stopped ? 'paused' : 'none');
+    add(IppTag.boolean, 'printer-is-accepting-jobs', !config.rejecting.contains(printer.name));
+    add(IppTag.boolean, 'printer-is-shared', false);
+    // CUPS_PRINTER_COLOR | CUPS_PRINTER_DUPLEX | CUPS_PRINTER_COPIES
+    add(IppTag.enumValue, 'printer-type', 0x0114);
+    add(IppTag.integer, 'queued-job-count', active.length);
+    add(IppTag.name, 'marker-names', <Object>['Black Toner', 'Drum Unit']);
+    add(IppTag.integer, 'marker-levels', <Object>[100 - printer.index * 7 % 100, -2]);
+    add(IppTag.integer, 'printer-up-time', now.millisecondsSinceEpoch ~/ 1000);
+    add(IppTag.mimeMediaType, 'document-format-supported', <Object>['application/octet-stream', 'application/pdf', 'image/pwg-raster']);
+    add(IppTag.mimeMediaType, 'document-format-default', 'application/octet-stream');
+    add(IppTag.keyword, 'media-supported', <Object>['iso_a4_210x297mm', 'na_letter_8.5x11in', 'oe_4x6-label_4x6in']);
+    add(IppTag.keyword, 'media-default', 'iso_a4_210x297mm');
+    add(IppTag.keyword, 'sides-supported', <Object>['one-sided', 'two-sided-long-edge', 'two-sided-short-edge']);
+    add(IppTag.keyword, 'sides-default', 'one-sided');
+    add(IppTag.keyword, 'print-color-mode-supported', <Object>['monochrome', 'color']);
+    add(IppTag.keyword, 'print-color-mode-default', 'monochrome');
+    add(IppTag.rangeOfInteger, 'copies-supported', const IppRange(1, 999));
+    add(IppTag.integer, 'copies-default', 1);
+    add(IppTag.resolution, 'printer-resolution-supported', <Object>[const IppResolution(300, 300), const IppResolution(600, 600)]);
+    add(IppTag.resolution, 'printer-resolution-default', const IppResolution(300, 300));
+    add(IppTag.enumValue, 'print-quality-supported', <Object>[3, 4, 5]);
+    add(IppTag.enumValue, 'print-quality-default', 4);
+    add(IppTag.enumValue, 'orientation-requested-supported', <Object>[3, 4, 5, 6]);
+    add(IppTag.enumValue, 'orientation-requested-default', 3);
+    add(IppTag.enumValue, 'finishings-supported', <Object>[3, 4]);
+    add(IppTag.enumValue, 'finishings-default', 3);
+    add(IppTag.keyword, 'job-hold-until-supported', <Object>['no-hold', 'indefinite']);
+    add(IppTag.integer, 'printer-config-change-time', _startedAt.millisecondsSinceEpoch ~/ 1000);
+    return group;
+  }
+
+  IppGroup _jobAttributes(MockJob job, DateTime now, Set<String>? requested) {
+    final group = IppGroup(IppTag.jobGroup);
+    void add(int tag, String name, Object value) {
+      if (requested == null || requested.contains(name)) group.add(tag, name, value);
+    }
+
+    int seconds(DateTime? time) => time == null ? 0 : time.millisecondsSinceEpoch ~/ 1000;
+    final state = job.stateAt(now, config);
+    add(IppTag.integer, 'job-id', job.id);
+    add(IppTag.uri, 'job-uri', 'ipp://127.0.0.1:$port/jobs/${job.id}');
+    add(IppTag.uri, 'job-printer-uri', _printerUri(job.printer));
+    add(IppTag.name, 'job-name', job.name);
+    add(IppTag.name, 'job-originating-user-name', job.user);
+    add(IppTag.enumValue, 'job-state', state);
+    add(IppTag.keyword, 'job-state-reasons', switch (state) {
+      IppJobState.held => 'job-hold-until-specified',
+      IppJobState.processing => 'job-printing',
+      IppJobState.canceled => 'job-canceled-by-user',
+      IppJobState.completed => 'job-completed-successfully',
+      _ => 'none',
+    });
+    add(IppTag.integer, 'job-k-octets', (job.sizeBytes + 1023) ~/ 1024);
+    add(IppTag.integer, 'job-impressions-completed', state == IppJobState.completed ? 1 : 0);
+    add(IppTag.integer, 'job-priority', 50);
+    add(IppTag.integer, 'time-at-creation', seconds(job.createdAt));
+    add(IppTag.integer, 'time-at-processing', state >= IppJobState.processing ? seconds(job.processingAt(config)) : 0);
+    add(IppTag.integer, 'time-at-completed', seconds(job.completedAt(now, config)));
+    return group;
+  }
+
+  String _ppdFor(MockPrinter printer) {
+    final ppd = StringBuffer()
+      ..writeln('*PPD-Adobe: "4.3"')
+      ..writeln('*FormatVersion: "4.3"')
+      ..writeln('*FileVersion: "1.0"')
+      ..writeln('*LanguageVersion: English')
+      ..writeln('*LanguageEncoding: ISOLatin1')
+      ..writeln('*PCFileName: "MOCKIPP.PPD"')
+      ..writeln('*Manufacturer: "printing_ffi"')
+      ..writeln('*Product: "(Mock IPP Printer)"')
+      ..writeln('*ModelName: "printing_ffi Mock IPP Printer"')
+      ..writeln('*ShortNickName: "printing_ffi Mock"')
+      ..writeln('*NickName: "printing_ffi Mock IPP Printer, ${printer.name}"')
+      ..writeln('*PSVersion: "(3010.000) 0"')
+      ..writeln('*LanguageLevel: "3"')
+      ..writeln('*ColorDevice: True')
+      ..writeln('*DefaultColorSpace: RGB')
+      ..writeln('*FileSystem: False')
+      ..writeln('*Throughput: "1"')
+      ..writeln('*LandscapeOrientation: Plus90')
+      ..writeln('*TTRasterizer: Type42')
+      ..writeln('*cupsFilter: "application/vnd.cups-raw 0 -"')
+      ..writeln('*OpenGroup: General/General')
+      ..writeln('*OpenUI *PageSize/Media Size: PickOne')
+      ..writeln('*OrderDependency: 10 AnySetup *PageSize')
+      ..writeln('*DefaultPageSize: A4')
+      ..writeln('*PageSize A4/A4: "<</PageSize[595 842]>>setpagedevice"')
+      ..writeln('*PageSize Letter/US Letter: "<</PageSize[612 792]>>setpagedevice"')
+      ..writeln('*PageSize w288h432/4x6 Label: "<</PageSize[288 432]>>setpagedevice"')
+      ..writeln('*CloseUI: *PageSize')
+      ..writeln('*OpenUI *PageRegion/Media Size: PickOne')
+      ..writeln('*OrderDependency: 10 AnySetup *PageRegion')
+      ..writeln('*DefaultPageRegion: A4')
+      ..writeln('*PageRegion A4/A4: "<</PageSize[595 842]>>setpagedevice"')
+      ..writeln('*PageRegion Letter/US Letter: "<</PageSize[612 792]>>setpagedevice"')
+      ..writeln('*PageRegion w288h432/4x6 Label: "<</PageSize[288 432]>>setpagedevice"')
+      ..writeln('*CloseUI: *PageRegion')
+      ..writeln('*DefaultImageableArea: A4')
+      ..writeln('*ImageableArea A4/A4: "18 36 577 806"')
+      ..writeln('*ImageableArea Letter/US Letter: "18 36 594 756"')
+      ..writeln('*ImageableArea w288h432/4x6 Label: "0 0 288 432"')
+      ..writeln('*DefaultPaperDimension: A4')
+      ..writeln('*PaperDimension A4/A4: "595 842"')
+      ..writeln('*PaperDimension Letter/US Letter: "612 792"')
+      ..writeln('*PaperDimension w288h432/4x6 Label: "288 432"')
+      ..writeln('*OpenUI *Duplex/2-Sided Printing: PickOne')
+      ..writeln('*OrderDependency: 10 AnySetup *Duplex')
+      ..writeln('*DefaultDuplex: None')
+      ..writeln('*Duplex None/Off: "<</Duplex false>>setpagedevice"')
+      ..writeln('*Duplex DuplexNoTumble/Long Edge: "<</Duplex true/Tumble false>>setpagedevice"')
+      ..writeln('*Duplex DuplexTumble/Short Edge: "<</Duplex true/Tumble true>>setpagedevice"')
+      ..writeln('*CloseUI: *Duplex')
+      ..writeln('*OpenUI *ColorModel/Color Mode: PickOne')
+      ..writeln('*OrderDependency: 10 AnySetup *ColorModel')
+      ..writeln('*DefaultColorModel: Gray')
+      ..writeln('*ColorModel Gray/Grayscale: "<</cupsColorSpace 18>>setpagedevice"')
+      ..writeln('*ColorModel RGB/Color: "<</cupsColorSpace 19>>setpagedevice"')
+      ..writeln('*CloseUI: *ColorModel')
+      ..writeln('*OpenUI *Resolution/Resolution: PickOne')
+      ..writeln('*OrderDependency: 10 AnySetup *Resolution')
+      ..writeln('*DefaultResolution: 300dpi')
+      ..writeln('*Resolution 300dpi/300 DPI: "<</HWResolution[300 300]>>setpagedevice"')
+      ..writeln('*Resolution 600dpi/600 DPI: "<</HWResolution[600 600]>>setpagedevice"')
+      ..writeln('*CloseUI: *Resolution');
+    // Extra options let benchmarks scale PPD parsing cost independently of the queue count.
+    for (var o = 1; o <= config.ppdOptions; o++) {
+      ppd
+        ..writeln('*OpenUI *MockOption$o/Mock Option $o: PickOne')
+        ..writeln('*OrderDependency: 20 AnySetup *MockOption$o')
+        ..writeln('*DefaultMockOption$o: Choice1');
+      for (var c = 1; c <= config.ppdChoices; c++) {
+        ppd.writeln('*MockOption$o Choice$c/Choice $c: ""');
+      }
+      ppd.writeln('*CloseUI: *MockOption$o');
+    }
+    ppd.writeln('*CloseGroup: General');
+    return ppd.toString();
+  }
+}
+
+// --- Minimal HTTP/1.1 ---
+
+class _HttpRequest {
+  final String method;
+  final String path;
+  final Map<String, String> headers;
+  final Uint8List body;
+  _HttpRequest(this.method, this.path, this.headers, this.body);
+}
+
+/// Reads pipelined HTTP/1.1 requests from a socket, including chunked bodies
+/// and `Expect: 100-continue`, which libcups uses for IPP requests with documents.
+class _HttpReader {
+  final StreamIterator<Uint8List> _input;
+  final BytesBuilder _pending = BytesBuilder();
+  Uint8List _buffer = Uint8List(0);
+  int _offset = 0;
+
+  _HttpReader(Socket socket) : _input = StreamIterator(socket);
+
+  Future<void> cancel() => _input.cancel();
+
+  Future<bool> _fill() async {
+    if (!await _input.moveNext()) return false;
+    _pending
+      ..add(Uint8List.sublistView(_buffer, _offset))
+      ..add(_input.current);
+    _buffer = _pending.takeBytes();
+    _offset = 0;
+    return true;
+  }
+
+  Future<String?> _readLine() async {
+    while (true) {
+      for (var i = _offset; i + 1 < _buffer.length; i++) {
+        if (_buffer[i] == 13 && _buffer[i + 1] == 10) {
+          final line = latin1.decode(Uint8List.sublistView(_buffer, _offset, i));
+          _offset = i + 2;
+          return line;
+        }
+      }
+      if (!await _fill()) return null;
+    }
+  }
+
+  Future<Uint8List?> _readExact(int length) async {
+    while (_buffer.length - _offset < length) {
+      if (!await _fill()) return null;
+    }
+    final bytes = Uint8List.fromList(Uint8List.sublistView(_buffer, _offset, _offset + length));
+    _offset += length;
+    return bytes;
+  }
+
+  Future<_HttpRequest?> readRequest({required void Function() onExpectContinue}) async {
+    String? requestLine;
+    do {
+      requestLine = await _readLine();
+      if (requestLine == null) return null;
+    } while (requestLine.isEmpty);
+
+    final parts = requestLine.split(' ');
+    if (parts.length < 2) return null;
+    final headers = <String, String>{};
+    while (true) {
+      final line = await _readLine();
+      if (line == null) return null;
+      if (line.isEmpty) break;
+      final colon = line.indexOf(':');
+      if (colon > 0) headers[line.substring(0, colon).trim().toLowerCase()] = line.substring(colon + 1).trim();
+    }
+
+    if (headers['expect']?.toLowerCase() == '100-continue') onExpectContinue();
+
+    final body = BytesBuilder(copy: false);
+    if (headers['transfer-encoding']?.toLowerCase() == 'chunked') {
+      while (true) {
+        final sizeLine = await _readLine();
+        if (sizeLine == null) return null;
+        final size = int.tryParse(sizeLine.split(';').first.trim(), radix: 16);
+        if (size == null) return null;
+        if (size == 0) {
+          // Skip trailers up to the terminating empty line.
+          String? trailer;
+          do {
+            trailer = await _readLine();
+          } while (trailer != null && trailer.isNotEmpty);
+          break;
+        }
+        final chunk = await _readExact(size);
+        if (chunk == null || await _readLine() == null) return null;
+        body.add(chunk);
+      }
+    } else {
+      final length = int.tryParse(headers['content-length'] ?? '0') ?? 0;
+      if (length > 0) {
+        final content = await _readExact(length);
+        if (content == null) return null;
+        body.add(content);
+      }
+    }
+    return _HttpRequest(parts[0], parts[1], headers, body.takeBytes());
+  }
+}